@@ -0,0 +1,21 @@
+//
+//  NSData+TCDGzip.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/25/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@interface NSData (TCDGzip)
+
+/**
+ Compresses the data in gzip format.
+
+ @param level   The zlib compression level, 1 (fastest) to 9 (smallest), or -1 for zlib's default.
+ @return        The compressed data, or nil if zlib failed.
+ */
+- (NSData *) gzippedDataWithCompressionLevel:(int)level;
+
+@end
@@ -0,0 +1,37 @@
+//
+//  NSData+TCDGzip.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/25/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "NSData+TCDGzip.h"
+#import <zlib.h>
+
+@implementation NSData (TCDGzip)
+
+- (NSData *) gzippedDataWithCompressionLevel:(int)level
+{
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    // 15 window bits, +16 for a gzip header and trailer instead of a zlib one.
+    if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return nil;
+
+    NSMutableData *compressed = [NSMutableData dataWithLength:deflateBound(&stream, (uLong)self.length)];
+    stream.next_in = (Bytef *)self.bytes;
+    stream.avail_in = (uInt)self.length;
+    stream.next_out = compressed.mutableBytes;
+    stream.avail_out = (uInt)compressed.length;
+
+    int status = deflate(&stream, Z_FINISH);
+    deflateEnd(&stream);
+    if (status != Z_STREAM_END)
+        return nil;
+
+    compressed.length = stream.total_out;
+    return compressed;
+}
+
+@end
@@ -0,0 +1,50 @@
+//
+//  TCAPI+TCDDocumentBatch.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/7/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <TinCan/TCAPI.h>
+#import "TCDDocumentBatch.h"
+
+/**
+ Batched versions of the TCAPI document methods. Each starts a TCDDocumentBatch that sends one request per document,
+ a few at a time, and calls the completion once with every result keyed by state or profile id.
+ Saved and deleted documents are reported as NSNull.
+ */
+@interface TCAPI (TCDDocumentBatch)
+
+#pragma mark - Activity states
+
+- (TCDDocumentBatch *) getActivityStatesWithIds:(NSArray *)stateIds activityId:(NSString *)activityId actor:(TCAgent *)actor registrationId:(NSString *)registrationId completion:(TCDDocumentBatchCompletion)completion;
+
+- (TCDDocumentBatch *) saveActivityStates:(NSArray *)states completion:(TCDDocumentBatchCompletion)completion;
+
+- (TCDDocumentBatch *) deleteActivityStatesWithIds:(NSArray *)stateIds activityId:(NSString *)activityId actor:(TCAgent *)actor registrationId:(NSString *)registrationId completion:(TCDDocumentBatchCompletion)completion;
+
+/**
+ Retrieves the ids of an actor's states for an activity, then every one of those states.
+ This is what a course does when it launches; it costs two round trips instead of one per state.
+ The returned batch covers both steps: cancelling it cancels the fetch of the states as well.
+ */
+- (TCDDocumentBatch *) loadActivityStatesWithActivityId:(NSString *)activityId actor:(TCAgent *)actor registrationId:(NSString *)registrationId completion:(TCDDocumentBatchCompletion)completion;
+
+#pragma mark - Activity profiles
+
+- (TCDDocumentBatch *) getActivityProfilesWithIds:(NSArray *)profileIds activity:(TCActivity *)activity completion:(TCDDocumentBatchCompletion)completion;
+
+- (TCDDocumentBatch *) saveActivityProfiles:(NSArray *)profiles completion:(TCDDocumentBatchCompletion)completion;
+
+- (TCDDocumentBatch *) deleteActivityProfilesWithIds:(NSArray *)profileIds activity:(TCActivity *)activity completion:(TCDDocumentBatchCompletion)completion;
+
+#pragma mark - Actor profiles
+
+- (TCDDocumentBatch *) getActorProfilesWithIds:(NSArray *)profileIds actor:(TCAgent *)actor completion:(TCDDocumentBatchCompletion)completion;
+
+- (TCDDocumentBatch *) saveActorProfiles:(NSArray *)profiles completion:(TCDDocumentBatchCompletion)completion;
+
+- (TCDDocumentBatch *) deleteActorProfilesWithIds:(NSArray *)profileIds actor:(TCAgent *)actor completion:(TCDDocumentBatchCompletion)completion;
+
+@end
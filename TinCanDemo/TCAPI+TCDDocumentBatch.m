@@ -0,0 +1,157 @@
+//
+//  TCAPI+TCDDocumentBatch.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/7/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCAPI+TCDDocumentBatch.h"
+
+@implementation TCAPI (TCDDocumentBatch)
+
+#pragma mark - Activity states
+
+- (TCDDocumentBatch *) getActivityStatesWithIds:(NSArray *)stateIds activityId:(NSString *)activityId actor:(TCAgent *)actor registrationId:(NSString *)registrationId completion:(TCDDocumentBatchCompletion)completion
+{
+    TCDDocumentBatch *batch = [[TCDDocumentBatch alloc] initWithAPI:self];
+    for (NSString *stateId in stateIds)
+    {
+        [batch addRequestWithKey:stateId requestClass:[TCAPIActivityStateRequest class] resultKey:@"state" configuration:^(TCAPIActivityStateRequest *request) {
+            [request getActivityStateWithActivityId:activityId actor:actor andStateId:stateId registrationId:registrationId];
+        }];
+    }
+    [batch startWithCompletion:completion];
+    return batch;
+}
+
+- (TCDDocumentBatch *) saveActivityStates:(NSArray *)states completion:(TCDDocumentBatchCompletion)completion
+{
+    TCDDocumentBatch *batch = [[TCDDocumentBatch alloc] initWithAPI:self];
+    for (TCActivityState *state in states)
+    {
+        [batch addRequestWithKey:state.stateId requestClass:[TCAPIActivityStateRequest class] resultKey:nil configuration:^(TCAPIActivityStateRequest *request) {
+            [request saveActivityState:state];
+        }];
+    }
+    [batch startWithCompletion:completion];
+    return batch;
+}
+
+- (TCDDocumentBatch *) deleteActivityStatesWithIds:(NSArray *)stateIds activityId:(NSString *)activityId actor:(TCAgent *)actor registrationId:(NSString *)registrationId completion:(TCDDocumentBatchCompletion)completion
+{
+    TCDDocumentBatch *batch = [[TCDDocumentBatch alloc] initWithAPI:self];
+    for (NSString *stateId in stateIds)
+    {
+        [batch addRequestWithKey:stateId requestClass:[TCAPIActivityStateRequest class] resultKey:nil configuration:^(TCAPIActivityStateRequest *request) {
+            [request deleteActivityStateWithActivityId:activityId actor:actor andStateId:stateId registrationId:registrationId];
+        }];
+    }
+    [batch startWithCompletion:completion];
+    return batch;
+}
+
+- (TCDDocumentBatch *) loadActivityStatesWithActivityId:(NSString *)activityId actor:(TCAgent *)actor registrationId:(NSString *)registrationId completion:(TCDDocumentBatchCompletion)completion
+{
+    TCDDocumentBatch *listing = [[TCDDocumentBatch alloc] initWithAPI:self];
+    __weak TCDDocumentBatch *weakListing = listing;
+    [listing addRequestWithKey:@"stateIds" requestClass:[TCAPIActivityStateRequest class] resultKey:@"stateIds" configuration:^(TCAPIActivityStateRequest *request) {
+        [request getActivityStateIdsWithActivityId:activityId forActor:actor registrationId:registrationId since:nil];
+    }];
+    [listing startWithCompletion:^(NSDictionary *results, NSDictionary *errors) {
+        NSArray *stateIds = [results objectForKey:@"stateIds"];
+        if (errors.count > 0 || ![stateIds isKindOfClass:[NSArray class]] || stateIds.count == 0)
+        {
+            if (completion)
+                completion(@{}, errors);
+            return;
+        }
+        // The listing is what the caller holds; cancelling it cancels the fetch too.
+        weakListing.followUpBatch = [self getActivityStatesWithIds:stateIds activityId:activityId actor:actor registrationId:registrationId completion:completion];
+    }];
+    return listing;
+}
+
+#pragma mark - Activity profiles
+
+- (TCDDocumentBatch *) getActivityProfilesWithIds:(NSArray *)profileIds activity:(TCActivity *)activity completion:(TCDDocumentBatchCompletion)completion
+{
+    TCDDocumentBatch *batch = [[TCDDocumentBatch alloc] initWithAPI:self];
+    for (NSString *profileId in profileIds)
+    {
+        [batch addRequestWithKey:profileId requestClass:[TCAPIActivityProfileRequest class] resultKey:@"profile" configuration:^(TCAPIActivityProfileRequest *request) {
+            [request retrieveActivityProfileForActivity:activity andProfileId:profileId];
+        }];
+    }
+    [batch startWithCompletion:completion];
+    return batch;
+}
+
+- (TCDDocumentBatch *) saveActivityProfiles:(NSArray *)profiles completion:(TCDDocumentBatchCompletion)completion
+{
+    TCDDocumentBatch *batch = [[TCDDocumentBatch alloc] initWithAPI:self];
+    for (TCActivityProfile *profile in profiles)
+    {
+        [batch addRequestWithKey:profile.profileId requestClass:[TCAPIActivityProfileRequest class] resultKey:nil configuration:^(TCAPIActivityProfileRequest *request) {
+            [request saveActivityProfile:profile];
+        }];
+    }
+    [batch startWithCompletion:completion];
+    return batch;
+}
+
+- (TCDDocumentBatch *) deleteActivityProfilesWithIds:(NSArray *)profileIds activity:(TCActivity *)activity completion:(TCDDocumentBatchCompletion)completion
+{
+    TCDDocumentBatch *batch = [[TCDDocumentBatch alloc] initWithAPI:self];
+    for (NSString *profileId in profileIds)
+    {
+        [batch addRequestWithKey:profileId requestClass:[TCAPIActivityProfileRequest class] resultKey:nil configuration:^(TCAPIActivityProfileRequest *request) {
+            [request deleteActivityProfileForActivity:activity andProfileId:profileId];
+        }];
+    }
+    [batch startWithCompletion:completion];
+    return batch;
+}
+
+#pragma mark - Actor profiles
+
+- (TCDDocumentBatch *) getActorProfilesWithIds:(NSArray *)profileIds actor:(TCAgent *)actor completion:(TCDDocumentBatchCompletion)completion
+{
+    TCDDocumentBatch *batch = [[TCDDocumentBatch alloc] initWithAPI:self];
+    for (NSString *profileId in profileIds)
+    {
+        [batch addRequestWithKey:profileId requestClass:[TCAPIActorProfileRequest class] resultKey:@"profile" configuration:^(TCAPIActorProfileRequest *request) {
+            [request retrieveActorProfileForActor:actor andProfileId:profileId];
+        }];
+    }
+    [batch startWithCompletion:completion];
+    return batch;
+}
+
+- (TCDDocumentBatch *) saveActorProfiles:(NSArray *)profiles completion:(TCDDocumentBatchCompletion)completion
+{
+    TCDDocumentBatch *batch = [[TCDDocumentBatch alloc] initWithAPI:self];
+    for (TCActorProfile *profile in profiles)
+    {
+        [batch addRequestWithKey:profile.profileId requestClass:[TCAPIActorProfileRequest class] resultKey:nil configuration:^(TCAPIActorProfileRequest *request) {
+            [request saveActorProfile:profile];
+        }];
+    }
+    [batch startWithCompletion:completion];
+    return batch;
+}
+
+- (TCDDocumentBatch *) deleteActorProfilesWithIds:(NSArray *)profileIds actor:(TCAgent *)actor completion:(TCDDocumentBatchCompletion)completion
+{
+    TCDDocumentBatch *batch = [[TCDDocumentBatch alloc] initWithAPI:self];
+    for (NSString *profileId in profileIds)
+    {
+        [batch addRequestWithKey:profileId requestClass:[TCAPIActorProfileRequest class] resultKey:nil configuration:^(TCAPIActorProfileRequest *request) {
+            [request deleteActorProfileForActor:actor andProfileId:profileId];
+        }];
+    }
+    [batch startWithCompletion:completion];
+    return batch;
+}
+
+@end
@@ -0,0 +1,27 @@
+//
+//  TCAPI+TCDQueuedStatementOverlay.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/4/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <TinCan/TCAPI.h>
+#import "TCDQueuedStatementOverlay.h"
+
+@interface TCAPI (TCDQueuedStatementOverlay)
+
+/**
+ Retrieves statements from the LRS using the specified query without waiting for the statement queue to flush.
+
+ @param query                       The query object to use to query the LRS for learning records.
+ @param includeQueuedStatements     Set to YES to add the statements in the statement queue that match the query and
+                                    haven't been persisted yet to the result (see TCDQueuedStatementOverlay).
+                                    Use this instead of getStatementWithQuery:afterFlushingQueue:delegate: to see
+                                    statements the app has stored without waiting for them to be uploaded.
+ @param aDelegate                   The delegate of the request.
+ @return                            A reference to the API request that was created.
+ */
+- (TCAPIGetStatementsRequest *) getStatementWithQuery:(TCStatementQuery *)query includingQueuedStatements:(BOOL)includeQueuedStatements delegate:(id<TCAPIStatementRequestDelegate>)aDelegate;
+
+@end
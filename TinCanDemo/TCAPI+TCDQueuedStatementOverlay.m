@@ -0,0 +1,29 @@
+//
+//  TCAPI+TCDQueuedStatementOverlay.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/4/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCAPI+TCDQueuedStatementOverlay.h"
+#import <objc/runtime.h>
+
+// Requests don't retain their delegate, so each request keeps its overlay alive.
+static char kTCDQueuedStatementOverlayKey;
+
+@implementation TCAPI (TCDQueuedStatementOverlay)
+
+- (TCAPIGetStatementsRequest *) getStatementWithQuery:(TCStatementQuery *)query includingQueuedStatements:(BOOL)includeQueuedStatements delegate:(id<TCAPIStatementRequestDelegate>)aDelegate
+{
+    if (!includeQueuedStatements || !self.statementQueue)
+        return [self getStatementWithQuery:query afterFlushingQueue:NO delegate:aDelegate];
+
+    TCDQueuedStatementOverlay *overlay = [[TCDQueuedStatementOverlay alloc] initWithQuery:query statementQueue:self.statementQueue delegate:aDelegate];
+    TCAPIGetStatementsRequest *request = [self getStatementWithQuery:query afterFlushingQueue:NO delegate:overlay];
+    if (request)
+        objc_setAssociatedObject(request, &kTCDQueuedStatementOverlayKey, overlay, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    return request;
+}
+
+@end
@@ -0,0 +1,23 @@
+//
+//  TCAPI+TCDRateLimiting.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/11/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <TinCan/TCAPI.h>
+#import "TCDRequestRateLimiter.h"
+
+/**
+ A rate limiter shared by every request an API sends.
+ */
+@interface TCAPI (TCDRateLimiting)
+
+/**
+ The limiter requests sent through the API wait for (nil if they aren't limited).
+ It is registered for the API's authorizationProvider, so set it after the provider; APIs that share a provider share the limiter.
+ */
+@property (nonatomic, strong) TCDRequestRateLimiter *rateLimiter;
+
+@end
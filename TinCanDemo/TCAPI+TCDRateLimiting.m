@@ -0,0 +1,23 @@
+//
+//  TCAPI+TCDRateLimiting.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/11/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCAPI+TCDRateLimiting.h"
+
+@implementation TCAPI (TCDRateLimiting)
+
+- (TCDRequestRateLimiter *) rateLimiter
+{
+    return [TCDRequestRateLimiter rateLimiterForAuthorizationProvider:self.authorizationProvider];
+}
+
+- (void) setRateLimiter:(TCDRequestRateLimiter *)rateLimiter
+{
+    [TCDRequestRateLimiter setRateLimiter:rateLimiter forAuthorizationProvider:self.authorizationProvider];
+}
+
+@end
@@ -0,0 +1,25 @@
+//
+//  TCAPI+TCDStatementCursor.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/28/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <TinCan/TCAPI.h>
+#import "TCDStatementCursor.h"
+
+@interface TCAPI (TCDStatementCursor)
+
+/**
+ Starts walking every page of statements that match a query.
+ Use this instead of following TCStatementsResult's more property with getStatementsWithStatementResult:withDelegate:,
+ which accumulates every page in memory.
+
+ @param query       The query to walk.
+ @param delegate    The delegate of the cursor.
+ @return            The cursor (already started).
+ */
+- (TCDStatementCursor *) statementCursorWithQuery:(TCStatementQuery *)query delegate:(id<TCDStatementCursorDelegate>)delegate;
+
+@end
@@ -0,0 +1,21 @@
+//
+//  TCAPI+TCDStatementCursor.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/28/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCAPI+TCDStatementCursor.h"
+
+@implementation TCAPI (TCDStatementCursor)
+
+- (TCDStatementCursor *) statementCursorWithQuery:(TCStatementQuery *)query delegate:(id<TCDStatementCursorDelegate>)delegate
+{
+    TCDStatementCursor *cursor = [[TCDStatementCursor alloc] initWithQuery:query api:self];
+    cursor.delegate = delegate;
+    [cursor start];
+    return cursor;
+}
+
+@end
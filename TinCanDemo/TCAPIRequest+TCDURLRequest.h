@@ -0,0 +1,33 @@
+//
+//  TCAPIRequest+TCDURLRequest.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/24/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <TinCan/TCAPIRequest.h>
+
+/**
+ Access to the NSMutableURLRequest a TCAPIRequest builds, for request filters that need to change more than its headers,
+ and to the response it received.
+ */
+@interface TCAPIRequest (TCDURLRequest)
+
+/**
+ The URL request the connection will be created from (nil if the request hasn't been prepared).
+ Changes made after the request has started have no effect.
+ */
+@property (nonatomic, readonly) NSMutableURLRequest *URLRequest;
+
+/**
+ The response the LRS sent (nil until one is received).
+ */
+@property (nonatomic, readonly) NSHTTPURLResponse *HTTPResponse;
+
+/**
+ The body of the response received so far (nil until a response is received).
+ */
+@property (nonatomic, readonly) NSData *responseBody;
+
+@end
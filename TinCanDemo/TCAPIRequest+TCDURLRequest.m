@@ -0,0 +1,32 @@
+//
+//  TCAPIRequest+TCDURLRequest.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/24/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCAPIRequest+TCDURLRequest.h"
+
+@implementation TCAPIRequest (TCDURLRequest)
+
+- (NSMutableURLRequest *) URLRequest
+{
+    // TCAPIRequest keeps the URL request in a private ivar with no accessor; KVC reads it directly.
+    id URLRequest = [self valueForKey:@"request"];
+    return [URLRequest isKindOfClass:[NSMutableURLRequest class]] ? URLRequest : nil;
+}
+
+- (NSHTTPURLResponse *) HTTPResponse
+{
+    id HTTPResponse = [self valueForKey:@"response"];
+    return [HTTPResponse isKindOfClass:[NSHTTPURLResponse class]] ? HTTPResponse : nil;
+}
+
+- (NSData *) responseBody
+{
+    id responseBody = [self valueForKey:@"responseData"];
+    return [responseBody isKindOfClass:[NSData class]] ? [responseBody copy] : nil;
+}
+
+@end
@@ -0,0 +1,101 @@
+//
+//  TCDActivityStateCache.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/5/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "TCDActivityStateMergePolicy.h"
+
+@class TCAPI, TCAgent, TCActivityState;
+
+/**
+ Posted when the cache gives up saving a state. The userInfo holds the state ("state") and the error ("error").
+ */
+extern NSString* const TCDActivityStateCacheSaveFailedNotification;
+
+/**
+ A write-back cache of activity states, keyed by activity id, actor, state id and registration id.
+
+ Reads are answered from the cache while the cached copy is younger than revalidationInterval (or has unsaved
+ changes); after that the cache asks the LRS with If-None-Match, and a 304 answer reuses the cached copy.
+ Saves only update the cache. Every flushInterval the states that changed are sent to the LRS, one PUT each
+ no matter how many times they were saved, with If-Match set to the ETag they were read with (If-None-Match: *
+ when the cache never saw the state on the LRS). When the LRS answers 412 the cache reads the current version
+ and asks the merge policy what to save instead; until that read succeeds (it is retried on each flush) the state
+ isn't sent again. Unsaved states only live in memory, so they are also flushed
+ when the app enters the background (with a background task to let the PUTs finish) and when it terminates.
+
+ Use the cache from the main thread.
+ */
+@interface TCDActivityStateCache : NSObject
+
+@property (nonatomic, strong, readonly) TCAPI *api;
+
+/**
+ Resolves 412 conflicts. Defaults to a TCDDictionaryMergePolicy.
+ */
+@property (nonatomic, strong) id<TCDActivityStateMergePolicy> mergePolicy;
+
+/**
+ Seconds between flushes of unsaved states. Defaults to 5. Set to 0 to flush only when flush is called.
+ */
+@property (nonatomic, readwrite) NSTimeInterval flushInterval;
+
+/**
+ Seconds a cached state is used without asking the LRS whether it changed. Defaults to 60.
+ */
+@property (nonatomic, readwrite) NSTimeInterval revalidationInterval;
+
+/**
+ Times a save is merged and retried after a 412 before it is given up. Defaults to 3.
+ */
+@property (nonatomic, readwrite) NSUInteger maxConflictRetries;
+
+/**
+ Number of states with changes that haven't been saved to the LRS.
+ */
+@property (nonatomic, readonly) NSUInteger numberOfUnsavedStates;
+
+/**
+ Reads answered without a request, and reads the LRS answered with 304.
+ */
+@property (nonatomic, readonly) NSUInteger cacheHits;
+@property (nonatomic, readonly) NSUInteger revalidations;
+
+/**
+ Saves that were folded into a later PUT.
+ */
+@property (nonatomic, readonly) NSUInteger coalescedSaves;
+
+/**
+ Designated initializer.
+ */
+- (id) initWithAPI:(TCAPI *)api;
+
+/**
+ Retrieves an activity state, from the cache when possible.
+
+ @param completion  Called on the main thread with the state (nil if the LRS has none) or the error.
+ */
+- (void) getActivityStateWithActivityId:(NSString *)activityId actor:(TCAgent *)actor stateId:(NSString *)stateId registrationId:(NSString *)registrationId completion:(void (^)(TCActivityState *state, NSError *error))completion;
+
+/**
+ Stores the state in the cache and schedules it to be saved to the LRS.
+ The state must have a stateId, activityId and actor.
+ */
+- (void) saveActivityState:(TCActivityState *)state;
+
+/**
+ Sends every unsaved state to the LRS now.
+ */
+- (void) flush;
+
+/**
+ Forgets every cached state that has no unsaved changes.
+ */
+- (void) removeCleanStates;
+
+@end
@@ -0,0 +1,474 @@
+//
+//  TCDActivityStateCache.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/5/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDActivityStateCache.h"
+#import "TCDConditionalActivityStateRequest.h"
+#import "TCDStatementAttributes.h"
+#import "TCState+TCDConcurrency.h"
+#import <CommonCrypto/CommonDigest.h>
+
+NSString* const TCDActivityStateCacheSaveFailedNotification = @"TCDActivityStateCacheSaveFailedNotification";
+
+/**
+ The ETag the LRS gives a document: the SHA1 of its contents.
+ */
+static NSString *TCDEntityTagForContents(NSData *contents)
+{
+    unsigned char digest[CC_SHA1_DIGEST_LENGTH];
+    CC_SHA1(contents.bytes, (CC_LONG)contents.length, digest);
+    NSMutableString *tag = [NSMutableString stringWithCapacity:CC_SHA1_DIGEST_LENGTH * 2 + 2];
+    [tag appendString:@"\""];
+    for (int i = 0; i < CC_SHA1_DIGEST_LENGTH; i++)
+        [tag appendFormat:@"%02x", digest[i]];
+    [tag appendString:@"\""];
+    return tag;
+}
+
+/**
+ A cached state and what the cache knows about its version on the LRS.
+ */
+@interface TCDActivityStateCacheEntry : NSObject
+@property (nonatomic, strong) TCActivityState *state;
+@property (nonatomic, strong) NSString *entityTag;
+// Contents of the version on the LRS the cached state is based on (the base of a three-way merge).
+@property (nonatomic, strong) NSData *serverContents;
+@property (nonatomic, strong) NSDate *validatedDate;
+@property (nonatomic, readwrite) BOOL existsOnServer;
+// The state has changed since it was last sent.
+@property (nonatomic, readwrite) BOOL dirty;
+// A PUT hit a 412; the LRS's version has to be read (and merged) before the state is sent again.
+@property (nonatomic, readwrite) BOOL needsReread;
+@property (nonatomic, readwrite) NSUInteger conflictCount;
+@property (nonatomic, strong) TCDConditionalActivityStateRequest *saveRequest;
+@property (nonatomic, strong) TCDConditionalActivityStateRequest *getRequest;
+// Completions waiting on getRequest.
+@property (nonatomic, strong) NSMutableArray *readers;
+@end
+
+@implementation TCDActivityStateCacheEntry
+
+- (id) init
+{
+    if ((self = [super init]))
+        self.readers = [NSMutableArray array];
+    return self;
+}
+
+@end
+
+@interface TCDActivityStateCache () <TCAPIActivityStateRequestDelegate>
+{
+    NSMutableDictionary *entries;
+    // Request in flight -> the entry it belongs to.
+    NSMapTable *entriesByRequest;
+    NSTimer *flushTimer;
+    UIBackgroundTaskIdentifier backgroundTask;
+}
+@property (nonatomic, strong, readwrite) TCAPI *api;
+@property (nonatomic, readwrite) NSUInteger cacheHits;
+@property (nonatomic, readwrite) NSUInteger revalidations;
+@property (nonatomic, readwrite) NSUInteger coalescedSaves;
+@end
+
+@implementation TCDActivityStateCache
+
+- (id) initWithAPI:(TCAPI *)api
+{
+    if ((self = [super init]))
+    {
+        self.api = api;
+        self.mergePolicy = [[TCDDictionaryMergePolicy alloc] init];
+        self.flushInterval = 5;
+        self.revalidationInterval = 60;
+        self.maxConflictRetries = 3;
+        entries = [[NSMutableDictionary alloc] init];
+        entriesByRequest = [NSMapTable strongToStrongObjectsMapTable];
+        backgroundTask = UIBackgroundTaskInvalid;
+
+        NSNotificationCenter *center = [NSNotificationCenter defaultCenter];
+        [center addObserver:self selector:@selector(applicationDidEnterBackground:) name:UIApplicationDidEnterBackgroundNotification object:nil];
+        [center addObserver:self selector:@selector(applicationWillTerminate:) name:UIApplicationWillTerminateNotification object:nil];
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    [flushTimer invalidate];
+    [self endBackgroundTask];
+}
+
++ (NSString *) keyForActivityId:(NSString *)activityId actor:(TCAgent *)actor stateId:(NSString *)stateId registrationId:(NSString *)registrationId
+{
+    return [NSString stringWithFormat:@"%@\n%@\n%@\n%@", activityId ?: @"", [TCDStatementAttributes keyForAgent:actor] ?: @"", stateId ?: @"", registrationId ?: @""];
+}
+
+- (TCDActivityStateCacheEntry *) entryForKey:(NSString *)key
+{
+    TCDActivityStateCacheEntry *entry = [entries objectForKey:key];
+    if (!entry)
+    {
+        entry = [[TCDActivityStateCacheEntry alloc] init];
+        [entries setObject:entry forKey:key];
+    }
+    return entry;
+}
+
+- (void) startRequest:(TCDConditionalActivityStateRequest *)request forEntry:(TCDActivityStateCacheEntry *)entry
+{
+    [entriesByRequest setObject:entry forKey:request];
+    [request start];
+}
+
+/**
+ The entry a finished request belongs to; the request is forgotten.
+ */
+- (TCDActivityStateCacheEntry *) takeEntryForRequest:(TCAPIRequest *)request
+{
+    TCDActivityStateCacheEntry *entry = [entriesByRequest objectForKey:request];
+    if (!entry)
+        return nil;
+    [entriesByRequest removeObjectForKey:request];
+    return (entry.getRequest == request || entry.saveRequest == request) ? entry : nil;
+}
+
+- (NSUInteger) numberOfUnsavedStates
+{
+    NSUInteger count = 0;
+    for (TCDActivityStateCacheEntry *entry in [entries allValues])
+    {
+        if (entry.dirty || entry.saveRequest)
+            count++;
+    }
+    return count;
+}
+
+- (TCDConditionalActivityStateRequest *) newRequest
+{
+    return [[TCDConditionalActivityStateRequest alloc] initWithLRS:self.api.endpoint andAuthorizationProvider:self.api.authorizationProvider delegate:self];
+}
+
+#pragma mark - Reading
+
+- (void) getActivityStateWithActivityId:(NSString *)activityId actor:(TCAgent *)actor stateId:(NSString *)stateId registrationId:(NSString *)registrationId completion:(void (^)(TCActivityState *, NSError *))completion
+{
+    NSString *key = [[self class] keyForActivityId:activityId actor:actor stateId:stateId registrationId:registrationId];
+    TCDActivityStateCacheEntry *entry = [self entryForKey:key];
+
+    BOOL fresh = entry.validatedDate && -[entry.validatedDate timeIntervalSinceNow] < self.revalidationInterval;
+    if ((fresh || entry.dirty || entry.saveRequest) && !entry.getRequest)
+    {
+        self.cacheHits++;
+        TCActivityState *state = entry.state;
+        if (completion)
+            dispatch_async(dispatch_get_main_queue(), ^{ completion(state, nil); });
+        return;
+    }
+
+    if (completion)
+        [entry.readers addObject:[completion copy]];
+    if (entry.getRequest)
+        return;
+
+    TCDConditionalActivityStateRequest *request = [self newRequest];
+    [request getActivityStateWithActivityId:activityId actor:actor andStateId:stateId registrationId:registrationId];
+    if (entry.entityTag && entry.validatedDate)
+        [request setValue:entry.entityTag forHTTPHeaderField:kIfNoneMatch];
+    entry.getRequest = request;
+    [self startRequest:request forEntry:entry];
+}
+
+- (void) finishReadingEntry:(TCDActivityStateCacheEntry *)entry error:(NSError *)error
+{
+    NSArray *readers = [entry.readers copy];
+    [entry.readers removeAllObjects];
+    TCActivityState *state = error ? nil : entry.state;
+    for (void (^reader)(TCActivityState *, NSError *) in readers)
+        reader(state, error);
+}
+
+/**
+ Records the version of a state the LRS returned. Local changes that haven't been saved are kept.
+ */
+- (void) entry:(TCDActivityStateCacheEntry *)entry didReceiveServerState:(TCActivityState *)state entityTag:(NSString *)entityTag
+{
+    entry.validatedDate = [NSDate date];
+    entry.needsReread = NO;
+    entry.existsOnServer = (state != nil);
+    entry.entityTag = entityTag ?: (state ? TCDEntityTagForContents(state.contents) : nil);
+    entry.serverContents = state.contents;
+    state.concurencyDigest = entry.entityTag;
+    if (!entry.dirty && !entry.saveRequest)
+        entry.state = state;
+}
+
+#pragma mark - Saving
+
+- (void) saveActivityState:(TCActivityState *)state
+{
+    NSString *key = [[self class] keyForActivityId:state.activityId actor:state.actor stateId:state.stateId registrationId:state.registrationId];
+    TCDActivityStateCacheEntry *entry = [self entryForKey:key];
+    if (entry.dirty)
+        self.coalescedSaves++;
+    entry.state = state;
+    entry.dirty = YES;
+    entry.conflictCount = 0;
+    [self scheduleFlush];
+}
+
+- (void) scheduleFlush
+{
+    if (flushTimer || self.flushInterval <= 0)
+        return;
+    flushTimer = [NSTimer scheduledTimerWithTimeInterval:self.flushInterval target:self selector:@selector(flushTimerFired:) userInfo:nil repeats:NO];
+}
+
+- (void) flushTimerFired:(NSTimer *)timer
+{
+    flushTimer = nil;
+    [self flush];
+}
+
+- (void) flush
+{
+    [flushTimer invalidate];
+    flushTimer = nil;
+
+    for (TCDActivityStateCacheEntry *entry in [entries allValues])
+    {
+        // A state saved again while its PUT is in flight is sent once that PUT finishes.
+        if (!entry.dirty || entry.saveRequest || entry.getRequest)
+            continue;
+        if (entry.needsReread)
+            [self rereadEntry:entry];
+        else
+            [self sendEntry:entry];
+    }
+}
+
+/**
+ Reads the LRS's version of a state whose PUT conflicted; the response is merged and sent (see handleRequestDidFinish:).
+ */
+- (void) rereadEntry:(TCDActivityStateCacheEntry *)entry
+{
+    TCActivityState *state = entry.state;
+    TCDConditionalActivityStateRequest *get = [self newRequest];
+    [get getActivityStateWithActivityId:state.activityId actor:state.actor andStateId:state.stateId registrationId:state.registrationId];
+    entry.getRequest = get;
+    [self startRequest:get forEntry:entry];
+}
+
+- (void) sendEntry:(TCDActivityStateCacheEntry *)entry
+{
+    TCDConditionalActivityStateRequest *request = [self newRequest];
+    [request saveActivityState:entry.state];
+    if (entry.entityTag)
+        [request setValue:entry.entityTag forHTTPHeaderField:kIfMatch];
+    else if (!entry.existsOnServer)
+        [request setValue:@"*" forHTTPHeaderField:kIfNoneMatch];
+
+    entry.dirty = NO;
+    entry.saveRequest = request;
+    [self startRequest:request forEntry:entry];
+}
+
+- (void) entry:(TCDActivityStateCacheEntry *)entry didSaveWithRequest:(TCDConditionalActivityStateRequest *)request
+{
+    TCActivityState *saved = request.state;
+    entry.saveRequest = nil;
+    entry.conflictCount = 0;
+    entry.existsOnServer = YES;
+    entry.serverContents = saved.contents;
+    entry.validatedDate = [NSDate date];
+    entry.entityTag = request.entityTag ?: TCDEntityTagForContents(saved.contents);
+    saved.concurencyDigest = entry.entityTag;
+
+    if (entry.dirty)
+        [self scheduleFlush];
+}
+
+- (void) entry:(TCDActivityStateCacheEntry *)entry didFailToSaveWithRequest:(TCDConditionalActivityStateRequest *)request error:(NSError *)error
+{
+    TCActivityState *unsaved = request.state;
+    entry.saveRequest = nil;
+
+    if (request.preconditionFailed && entry.conflictCount < self.maxConflictRetries)
+    {
+        // Someone else changed the state; read their version and merge on top of it.
+        entry.conflictCount++;
+        if (!entry.dirty)
+            entry.state = unsaved;
+        entry.dirty = YES;
+        entry.validatedDate = nil;
+        // The stale ETag is kept: until the read succeeds the state is never sent, let alone without If-Match.
+        entry.needsReread = YES;
+        [self rereadEntry:entry];
+        return;
+    }
+
+    if (!request.preconditionFailed && (request.statusCode == 0 || request.statusCode >= 500))
+    {
+        // The LRS couldn't be reached or had trouble; keep the changes and try again on the next flush.
+        entry.dirty = YES;
+        [self scheduleFlush];
+        return;
+    }
+
+    // The LRS rejected the state (or kept conflicting); give up on this version.
+    entry.validatedDate = nil;
+    [[NSNotificationCenter defaultCenter] postNotificationName:TCDActivityStateCacheSaveFailedNotification
+                                                        object:self
+                                                      userInfo:@{@"state": unsaved, @"error": error ?: [NSNull null]}];
+}
+
+/**
+ Applies the merge policy once the LRS's version of a conflicting state has been read.
+ */
+- (void) resolveConflictForEntry:(TCDActivityStateCacheEntry *)entry serverState:(TCActivityState *)serverState baseContents:(NSData *)baseContents
+{
+    TCActivityState *merged = [self.mergePolicy mergeLocalState:entry.state withServerState:serverState baseContents:baseContents];
+    if (!merged)
+    {
+        entry.state = serverState;
+        entry.dirty = NO;
+        return;
+    }
+    entry.state = merged;
+    [self sendEntry:entry];
+}
+
+#pragma mark - Application state
+
+- (void) applicationDidEnterBackground:(NSNotification *)notification
+{
+    // Unsaved states only live in memory, so send them now and ask for time to finish before the app is suspended.
+    if (backgroundTask == UIBackgroundTaskInvalid)
+    {
+        __weak TCDActivityStateCache *weakSelf = self;
+        backgroundTask = [[UIApplication sharedApplication] beginBackgroundTaskWithExpirationHandler:^{
+            [weakSelf endBackgroundTask];
+        }];
+    }
+    [self flush];
+    [self endBackgroundTaskIfIdle];
+}
+
+- (void) applicationWillTerminate:(NSNotification *)notification
+{
+    // The process is about to exit; there's no waiting for the answers, but the PUTs are on their way.
+    [self flush];
+}
+
+- (void) endBackgroundTaskIfIdle
+{
+    if (entriesByRequest.count == 0)
+        [self endBackgroundTask];
+}
+
+- (void) endBackgroundTask
+{
+    if (backgroundTask == UIBackgroundTaskInvalid)
+        return;
+    [[UIApplication sharedApplication] endBackgroundTask:backgroundTask];
+    backgroundTask = UIBackgroundTaskInvalid;
+}
+
+#pragma mark - Forgetting states
+
+- (void) removeCleanStates
+{
+    for (NSString *key in [entries allKeys])
+    {
+        TCDActivityStateCacheEntry *entry = [entries objectForKey:key];
+        if (!entry.dirty && !entry.saveRequest && !entry.getRequest)
+            [entries removeObjectForKey:key];
+    }
+}
+
+#pragma mark - TCAPIActivityStateRequestDelegate
+
+- (void) requestDidFinish:(TCAPIRequest *)aRequest
+{
+    [self handleRequestDidFinish:(TCDConditionalActivityStateRequest *)aRequest];
+    [self endBackgroundTaskIfIdle];
+}
+
+- (void) request:(TCAPIRequest *)aRequest didFailWithError:(NSError *)error
+{
+    [self handleRequest:(TCDConditionalActivityStateRequest *)aRequest didFailWithError:error];
+    [self endBackgroundTaskIfIdle];
+}
+
+- (void) handleRequestDidFinish:(TCDConditionalActivityStateRequest *)request
+{
+    TCDActivityStateCacheEntry *entry = [self takeEntryForRequest:request];
+    if (!entry)
+        return;
+
+    if (entry.saveRequest == request)
+    {
+        [self entry:entry didSaveWithRequest:request];
+        return;
+    }
+
+    entry.getRequest = nil;
+    if (request.notModified)
+    {
+        self.revalidations++;
+        entry.validatedDate = [NSDate date];
+    }
+    else
+    {
+        NSData *base = entry.serverContents;
+        BOOL conflicted = entry.needsReread || entry.conflictCount > 0;
+        [self entry:entry didReceiveServerState:request.state entityTag:request.entityTag];
+        if (conflicted && entry.dirty)
+            [self resolveConflictForEntry:entry serverState:request.state baseContents:base];
+    }
+    [self finishReadingEntry:entry error:nil];
+}
+
+- (void) handleRequest:(TCDConditionalActivityStateRequest *)request didFailWithError:(NSError *)error
+{
+    TCDActivityStateCacheEntry *entry = [self takeEntryForRequest:request];
+    if (!entry)
+        return;
+
+    if (entry.saveRequest == request)
+    {
+        [self entry:entry didFailToSaveWithRequest:request error:error];
+        return;
+    }
+
+    entry.getRequest = nil;
+    if (request.notModified)
+    {
+        self.revalidations++;
+        entry.validatedDate = [NSDate date];
+        [self finishReadingEntry:entry error:nil];
+    }
+    else if (request.statusCode == 404)
+    {
+        NSData *base = entry.serverContents;
+        BOOL conflicted = entry.needsReread || entry.conflictCount > 0;
+        [self entry:entry didReceiveServerState:nil entityTag:nil];
+        if (conflicted && entry.dirty)
+            [self resolveConflictForEntry:entry serverState:nil baseContents:base];
+        [self finishReadingEntry:entry error:nil];
+    }
+    else
+    {
+        // A conflicting state waits for the LRS's version; try reading it again on the next flush.
+        if (entry.needsReread && entry.dirty)
+            [self scheduleFlush];
+        [self finishReadingEntry:entry error:error];
+    }
+}
+
+@end
@@ -0,0 +1,47 @@
+//
+//  TCDActivityStateMergePolicy.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/5/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class TCActivityState;
+
+/**
+ Resolves a conflict between an activity state saved locally and a newer version on the LRS
+ (the LRS rejected the save with 412 Precondition Failed).
+ */
+@protocol TCDActivityStateMergePolicy <NSObject>
+@required
+
+/**
+ @param localState      The state the application saved.
+ @param serverState     The version currently on the LRS (nil if the LRS no longer has one).
+ @param baseContents    The contents of the version the local changes were made to (nil if unknown).
+ @return                The state to save in place of localState, or nil to keep the LRS's version and drop the local changes.
+ */
+- (TCActivityState *) mergeLocalState:(TCActivityState *)localState withServerState:(TCActivityState *)serverState baseContents:(NSData *)baseContents;
+
+@end
+
+/**
+ Keeps the local state; the LRS's changes are overwritten.
+ */
+@interface TCDClientWinsMergePolicy : NSObject <TCDActivityStateMergePolicy>
+@end
+
+/**
+ Keeps the LRS's state; the local changes are dropped.
+ */
+@interface TCDServerWinsMergePolicy : NSObject <TCDActivityStateMergePolicy>
+@end
+
+/**
+ Three-way merge of JSON object states by top-level key: keys changed locally since the base take the local value,
+ every other key takes the LRS's value. Falls back to the local state when either side isn't a JSON object.
+ */
+@interface TCDDictionaryMergePolicy : NSObject <TCDActivityStateMergePolicy>
+@end
@@ -0,0 +1,66 @@
+//
+//  TCDActivityStateMergePolicy.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/5/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDActivityStateMergePolicy.h"
+
+@implementation TCDClientWinsMergePolicy
+
+- (TCActivityState *) mergeLocalState:(TCActivityState *)localState withServerState:(TCActivityState *)serverState baseContents:(NSData *)baseContents
+{
+    return localState;
+}
+
+@end
+
+@implementation TCDServerWinsMergePolicy
+
+- (TCActivityState *) mergeLocalState:(TCActivityState *)localState withServerState:(TCActivityState *)serverState baseContents:(NSData *)baseContents
+{
+    return nil;
+}
+
+@end
+
+@implementation TCDDictionaryMergePolicy
+
+static NSDictionary *TCDDictionaryFromContents(NSData *contents)
+{
+    if (contents.length == 0)
+        return @{};
+    id object = [NSJSONSerialization JSONObjectWithData:contents options:0 error:NULL];
+    return [object isKindOfClass:[NSDictionary class]] ? object : nil;
+}
+
+- (TCActivityState *) mergeLocalState:(TCActivityState *)localState withServerState:(TCActivityState *)serverState baseContents:(NSData *)baseContents
+{
+    NSDictionary *local = TCDDictionaryFromContents(localState.contents);
+    NSDictionary *server = TCDDictionaryFromContents(serverState.contents);
+    NSDictionary *base = TCDDictionaryFromContents(baseContents);
+    if (!local || !server || !base)
+        return localState;
+
+    NSMutableDictionary *merged = [server mutableCopy];
+    NSMutableSet *keys = [NSMutableSet setWithArray:[local allKeys]];
+    [keys addObjectsFromArray:[base allKeys]];
+    for (NSString *key in keys)
+    {
+        id localValue = [local objectForKey:key];
+        id baseValue = [base objectForKey:key];
+        if (localValue == baseValue || [localValue isEqual:baseValue])
+            continue;
+        if (localValue)
+            [merged setObject:localValue forKey:key];
+        else
+            [merged removeObjectForKey:key];
+    }
+
+    localState.dictionaryContents = merged;
+    return localState;
+}
+
+@end
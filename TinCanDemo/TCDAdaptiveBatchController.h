@@ -0,0 +1,94 @@
+//
+//  TCDAdaptiveBatchController.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/23/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ Decides how many statement batches may be in flight at once and how many statements go in each,
+ using additive-increase/multiplicative-decrease (AIMD).
+
+ Every batch that is stored within latencyTarget grows the concurrency window by 1/window (so the window grows by
+ one batch per window's worth of successes) and the batch size by batchSizeIncrement / window. A timeout, a 5xx
+ response, or a batch slower than latencyTarget halves both (by multiplicativeDecrease). Only one decrease happens per
+ round trip: batches that were already in flight when the window was cut don't cut it again.
+
+ The windows are key-value observable, so they can be watched or logged as metrics.
+ */
+@interface TCDAdaptiveBatchController : NSObject
+
+/**
+ Batches allowed in flight, before rounding down (starts at minimumConcurrency).
+ */
+@property (nonatomic, readonly) double concurrencyWindow;
+
+/**
+ Statements allowed per batch, before rounding down (starts at 10).
+ */
+@property (nonatomic, readonly) double batchSizeWindow;
+
+/**
+ The concurrency window rounded down, never less than 1.
+ */
+@property (nonatomic, readonly) NSUInteger maxBatchesInFlight;
+
+/**
+ The batch size window rounded down, never less than minimumBatchSize.
+ */
+@property (nonatomic, readonly) NSUInteger maxStatementsPerBatch;
+
+/**
+ Bounds of the windows (defaults: 1-8 batches, 1-50 statements).
+ */
+@property (nonatomic, readwrite) NSUInteger minimumConcurrency;
+@property (nonatomic, readwrite) NSUInteger maximumConcurrency;
+@property (nonatomic, readwrite) NSUInteger minimumBatchSize;
+@property (nonatomic, readwrite) NSUInteger maximumBatchSize;
+
+/**
+ Statements added to the batch size window per window's worth of successful batches (default=5).
+ */
+@property (nonatomic, readwrite) double batchSizeIncrement;
+
+/**
+ Factor both windows are multiplied by on congestion (default=0.5).
+ */
+@property (nonatomic, readwrite) double multiplicativeDecrease;
+
+/**
+ Successful batches slower than this count as congestion (default=5 seconds).
+ */
+@property (nonatomic, readwrite) NSTimeInterval latencyTarget;
+
+/**
+ Number of times the windows have been cut.
+ */
+@property (nonatomic, readonly) NSUInteger decreaseCount;
+
+/**
+ Records a batch the LRS stored.
+
+ @param sentDate    When the batch was sent.
+ @param latency     How long the LRS took to respond.
+ */
+- (void) recordSuccessForBatchSentAt:(NSDate *)sentDate latency:(NSTimeInterval)latency;
+
+/**
+ Records a batch that failed. Only timeouts and server errors change the windows.
+
+ @param sentDate    When the batch was sent.
+ @param error       The error the request failed with.
+ @param timedOut    YES if the request timed out.
+ */
+- (void) recordFailureForBatchSentAt:(NSDate *)sentDate error:(NSError *)error timedOut:(BOOL)timedOut;
+
+/**
+ Returns both windows to their starting values.
+ */
+- (void) reset;
+
+@end
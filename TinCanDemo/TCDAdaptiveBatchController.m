@@ -0,0 +1,97 @@
+//
+//  TCDAdaptiveBatchController.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/23/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDAdaptiveBatchController.h"
+
+@interface TCDAdaptiveBatchController ()
+@property (nonatomic, readwrite) double concurrencyWindow;
+@property (nonatomic, readwrite) double batchSizeWindow;
+@property (nonatomic, readwrite) NSUInteger decreaseCount;
+@property (nonatomic, strong) NSDate *lastDecreaseDate;
+@end
+
+@implementation TCDAdaptiveBatchController
+
+- (id) init
+{
+    if ((self = [super init]))
+    {
+        self.minimumConcurrency = 1;
+        self.maximumConcurrency = 8;
+        self.minimumBatchSize = 1;
+        self.maximumBatchSize = 50;
+        self.batchSizeIncrement = 5;
+        self.multiplicativeDecrease = 0.5;
+        self.latencyTarget = 5;
+        [self reset];
+    }
+    return self;
+}
+
+- (void) reset
+{
+    self.concurrencyWindow = self.minimumConcurrency;
+    self.batchSizeWindow = MIN(MAX(10, self.minimumBatchSize), self.maximumBatchSize);
+    self.lastDecreaseDate = nil;
+}
+
++ (NSSet *) keyPathsForValuesAffectingMaxBatchesInFlight
+{
+    return [NSSet setWithObject:@"concurrencyWindow"];
+}
+
++ (NSSet *) keyPathsForValuesAffectingMaxStatementsPerBatch
+{
+    return [NSSet setWithObject:@"batchSizeWindow"];
+}
+
+- (NSUInteger) maxBatchesInFlight
+{
+    return MAX((NSUInteger)self.concurrencyWindow, 1);
+}
+
+- (NSUInteger) maxStatementsPerBatch
+{
+    return MAX((NSUInteger)self.batchSizeWindow, MAX(self.minimumBatchSize, 1));
+}
+
+- (void) recordSuccessForBatchSentAt:(NSDate *)sentDate latency:(NSTimeInterval)latency
+{
+    if (latency > self.latencyTarget)
+    {
+        [self decreaseForBatchSentAt:sentDate];
+        return;
+    }
+
+    double window = MAX(self.concurrencyWindow, 1);
+    self.concurrencyWindow = MIN(self.concurrencyWindow + 1 / window, self.maximumConcurrency);
+    self.batchSizeWindow = MIN(self.batchSizeWindow + self.batchSizeIncrement / window, self.maximumBatchSize);
+}
+
+- (void) recordFailureForBatchSentAt:(NSDate *)sentDate error:(NSError *)error timedOut:(BOOL)timedOut
+{
+    BOOL congested = timedOut
+        || ([error.domain isEqualToString:NSURLErrorDomain] && error.code == NSURLErrorTimedOut)
+        || (error.code >= 500 && error.code < 600);
+    if (congested)
+        [self decreaseForBatchSentAt:sentDate];
+}
+
+- (void) decreaseForBatchSentAt:(NSDate *)sentDate
+{
+    // A batch sent before the last cut was sized by the old window; it says nothing about the new one.
+    if (self.lastDecreaseDate && [sentDate compare:self.lastDecreaseDate] != NSOrderedDescending)
+        return;
+
+    self.concurrencyWindow = MAX(self.concurrencyWindow * self.multiplicativeDecrease, self.minimumConcurrency);
+    self.batchSizeWindow = MAX(self.batchSizeWindow * self.multiplicativeDecrease, self.minimumBatchSize);
+    self.decreaseCount++;
+    self.lastDecreaseDate = [NSDate date];
+}
+
+@end
@@ -8,14 +8,38 @@
 
 #import "TCDAppDelegate.h"
 #import "TCDViewController.h"
+#import "TCDStatementQueue.h"
+#import "TCDStatementQueueLogPersistence.h"
+#import "TCDStatementUploader.h"
+#import "TCDDeadLetterStore.h"
+#import "TCDRetryScheduler.h"
+#import "TCDCircuitBreaker.h"
+#import "TCDRequestPipeline.h"
+#import "TCDRequestPriorityFilter.h"
+#import "TCDCompressionFilter.h"
+#import "TCAPI+TCDRateLimiting.h"
+
+@interface TCDAppDelegate ()
+@property (strong, nonatomic) TCDStatementQueueLogPersistence *statementStore;
+@property (strong, nonatomic) TCDStatementUploader *statementUploader;
+- (void)configureStatementQueue;
+@end
 
 @implementation TCDAppDelegate
 
 - (BOOL)application:(UIApplication *)application didFinishLaunchingWithOptions:(NSDictionary *)launchOptions
 {
     
+    TCDRequestPipeline *pipeline = [[TCDRequestPipeline alloc] initWithAuthenticationProvider:[[TCBasicHTTPAuthentication alloc] initWithUsername:@"public" andPassword:@""]];
+    TCDRequestPriorityFilter *priorityFilter = [[TCDRequestPriorityFilter alloc] init];
+    [pipeline addFilter:priorityFilter];
+    [pipeline addFilter:[[TCDCompressionFilter alloc] init]];
     [TCAPI configureDefaultAPIWithLRS:[NSURL URLWithString:@"https://cloud.scorm.com/ScormEngineInterface/TCAPI/public/"]
-	            authorizationProvider:[[TCBasicHTTPAuthentication alloc] initWithUsername:@"public" andPassword:@""]];
+	            authorizationProvider:pipeline];
+    TCDRequestRateLimiter *rateLimiter = [[TCDRequestRateLimiter alloc] init];
+    rateLimiter.priorityFilter = priorityFilter;
+    [TCAPI defaultAPI].rateLimiter = rateLimiter;
+    [self configureStatementQueue];
     
     self.window = [[UIWindow alloc] initWithFrame:[[UIScreen mainScreen] bounds]];
     // Override point for customization after application launch.
@@ -25,6 +49,44 @@
     return YES;
 }
 
+- (void)configureStatementQueue
+{
+    TCDStatementQueue *queue = [TCDStatementQueue defaultStatementQueue];
+    TCStatementQueue *frameworkQueue = [TCAPI defaultAPI].statementQueue;
+    [TCAPI defaultAPI].statementQueue = queue;
+    queue.lanes = [TCDStatementLane standardLanes];
+    id<TCStatementQueuePersisting> legacyStore = queue.persistenceCoordinator;
+    TCDStatementQueueLogPersistence *logStore = [[TCDStatementQueueLogPersistence alloc] initWithQueue:queue];
+    if (logStore.isOpen)
+    {
+        logStore.restoresLazily = YES;
+
+        // Setting the coordinator restores the log straight into the queue and then persists the queue to it,
+        // which moves anything the plist store restored on launch into the log.
+        queue.persistenceCoordinator = logStore;
+        self.statementStore = logStore;
+
+        // The plist is emptied so it isn't restored twice.
+        if (legacyStore != logStore)
+            [legacyStore persistStatements:@[] withError:NULL];
+    }
+    else
+    {
+        // Keep the plist store rather than queue statements that can't be saved.
+        NSLog(@"Falling back to %@ to persist the statement queue", legacyStore);
+    }
+
+    // TCAPI starts out with TCStatementQueue's default queue; take over whatever it restored from its plist.
+    [queue adoptStatementsFromQueue:frameworkQueue];
+
+    self.statementUploader = [[TCDStatementUploader alloc] initWithAPI:[TCAPI defaultAPI] queue:queue];
+    self.statementUploader.isolatesRejectedStatements = YES;
+    self.statementUploader.deadLetterStore = [[TCDDeadLetterStore alloc] init];
+    self.statementUploader.retryScheduler = [TCDRetryScheduler schedulerForEndpoint:[TCAPI defaultAPI].endpoint];
+    self.statementUploader.circuitBreaker = [[TCDCircuitBreaker alloc] initWithEndpoint:[TCAPI defaultAPI].endpoint];
+    [self.statementUploader start];
+}
+
 - (void)applicationWillResignActive:(UIApplication *)application
 {
     // Sent when the application is about to move from active to inactive state. This can occur for certain types of temporary interruptions (such as an incoming phone call or SMS message) or when the user quits the application and it begins the transition to the background state.
@@ -35,6 +97,7 @@
 {
     // Use this method to release shared resources, save user data, invalidate timers, and store enough application state information to restore your application to its current state in case it is terminated later. 
     // If your application supports background execution, this method is called instead of applicationWillTerminate: when the user quits.
+    [self.statementStore synchronizeWithError:NULL];
 }
 
 - (void)applicationWillEnterForeground:(UIApplication *)application
@@ -0,0 +1,123 @@
+//
+//  TCDCircuitBreaker.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/10/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class TCAPIRequest;
+
+typedef enum
+{
+    /**
+     Requests are sent normally.
+     */
+    TCDCircuitBreakerStateClosed,
+    /**
+     The LRS is failing; no requests are sent until openInterval has passed.
+     */
+    TCDCircuitBreakerStateOpen,
+    /**
+     openInterval has passed; a single probe request is allowed to find out whether the LRS has recovered.
+     */
+    TCDCircuitBreakerStateHalfOpen
+} TCDCircuitBreakerState;
+
+/**
+ Posted when a circuit breaker changes state. The userInfo holds the new and previous states
+ as NSNumbers ("state" and "previousState").
+ */
+extern NSString* const TCDCircuitBreakerStateDidChangeNotification;
+
+/**
+ Stops sending work to an LRS that is failing or too slow to be useful.
+
+ The breaker watches every TCAPIRequest to its endpoint through TinCan's request notifications and keeps the
+ outcome and latency of the last windowSize requests. Timeouts, connection failures, 429 and 5xx responses count
+ as errors (other 4xx responses are the request's fault, not the LRS's); successful requests slower than
+ slowCallThreshold count as slow. Once there are minimumSamples outcomes and either rate reaches its threshold, the
+ breaker opens. After openInterval the breaker is half-open: the next request a caller registers with
+ beginProbeWithRequest: is the probe, and only its outcome counts--its success closes the breaker and clears the
+ window, its failure opens it again.
+ */
+@interface TCDCircuitBreaker : NSObject
+
+@property (nonatomic, strong, readonly) NSURL *endpoint;
+@property (nonatomic, readonly) TCDCircuitBreakerState state;
+
+/**
+ Number of recent requests the rates are computed over (default=20).
+ */
+@property (nonatomic, readwrite) NSUInteger windowSize;
+
+/**
+ Outcomes needed before the breaker can open (default=10).
+ */
+@property (nonatomic, readwrite) NSUInteger minimumSamples;
+
+/**
+ Fraction of failed requests that opens the breaker (default=0.5).
+ */
+@property (nonatomic, readwrite) double errorRateThreshold;
+
+/**
+ Requests slower than this are slow (default=10 seconds).
+ */
+@property (nonatomic, readwrite) NSTimeInterval slowCallThreshold;
+
+/**
+ Fraction of slow requests that opens the breaker (default=0.8).
+ */
+@property (nonatomic, readwrite) double slowCallRateThreshold;
+
+/**
+ Seconds the breaker stays open before allowing a probe (default=30).
+ */
+@property (nonatomic, readwrite) NSTimeInterval openInterval;
+
+/**
+ Failed and slow fractions of the requests in the window.
+ */
+@property (nonatomic, readonly) double errorRate;
+@property (nonatomic, readonly) double slowCallRate;
+
+/**
+ When an open breaker will allow a probe (nil unless open).
+ */
+@property (nonatomic, strong, readonly) NSDate *probeDate;
+
+/**
+ Designated initializer. Starts watching requests to the endpoint's host.
+ */
+- (id) initWithEndpoint:(NSURL *)endpoint;
+
+/**
+ YES if a request may be sent now. When the breaker is open and openInterval has passed, this moves it to half-open.
+ While half-open, YES means no probe is in flight: a caller that goes on to send a request registers it with
+ beginProbeWithRequest:. Nothing is reserved by asking, so a caller that ends up sending nothing needn't undo anything.
+ */
+- (BOOL) allowsRequest;
+
+/**
+ Makes a request the half-open breaker's probe.
+
+ @return    NO if the breaker isn't half-open or already has a probe (the request's outcome then doesn't decide anything).
+ */
+- (BOOL) beginProbeWithRequest:(TCAPIRequest *)request;
+
+/**
+ Record the outcome of a request the breaker can't see (requests to its endpoint are recorded automatically).
+ While half-open these decide only if no probe request has been begun.
+ */
+- (void) recordSuccessWithLatency:(NSTimeInterval)latency;
+- (void) recordFailure;
+
+/**
+ Closes the breaker and clears the window.
+ */
+- (void) reset;
+
+@end
@@ -0,0 +1,266 @@
+//
+//  TCDCircuitBreaker.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/10/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDCircuitBreaker.h"
+#import "TCAPIRequest+TCDURLRequest.h"
+
+NSString* const TCDCircuitBreakerStateDidChangeNotification = @"TCDCircuitBreakerStateDidChangeNotification";
+
+/**
+ The outcome of one request in the window.
+ */
+typedef struct
+{
+    BOOL failed;
+    BOOL slow;
+} TCDCircuitBreakerOutcome;
+
+@interface TCDCircuitBreaker ()
+{
+    TCDCircuitBreakerOutcome *outcomes;
+    NSUInteger outcomeCapacity;
+    NSUInteger outcomeCount;
+    NSUInteger nextOutcome;
+    // The request whose outcome decides a half-open breaker (nil until one is begun).
+    TCAPIRequest *probeRequest;
+    // Request -> when it started; requests that were never seen starting have no latency.
+    NSMapTable *startDates;
+}
+@property (nonatomic, strong, readwrite) NSURL *endpoint;
+@property (nonatomic, readwrite) TCDCircuitBreakerState state;
+@property (nonatomic, strong, readwrite) NSDate *probeDate;
+@end
+
+@implementation TCDCircuitBreaker
+
+- (id) initWithEndpoint:(NSURL *)endpoint
+{
+    if ((self = [super init]))
+    {
+        self.endpoint = endpoint;
+        self.windowSize = 20;
+        self.minimumSamples = 10;
+        self.errorRateThreshold = 0.5;
+        self.slowCallThreshold = 10;
+        self.slowCallRateThreshold = 0.8;
+        self.openInterval = 30;
+        startDates = [NSMapTable weakToStrongObjectsMapTable];
+
+        NSNotificationCenter *center = [NSNotificationCenter defaultCenter];
+        [center addObserver:self selector:@selector(requestStarted:) name:TCRequestStartedNotification object:nil];
+        [center addObserver:self selector:@selector(requestFinished:) name:TCRequestFinishedNotification object:nil];
+        [center addObserver:self selector:@selector(requestFailed:) name:TCRequestFailedNotification object:nil];
+        [center addObserver:self selector:@selector(requestCanceled:) name:TCRequestCanceledNotification object:nil];
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    free(outcomes);
+}
+
+#pragma mark - State
+
+- (void) transitionToState:(TCDCircuitBreakerState)state
+{
+    TCDCircuitBreakerState previousState;
+    @synchronized(self)
+    {
+        previousState = self.state;
+        if (state == previousState)
+            return;
+        self.state = state;
+        self.probeDate = (state == TCDCircuitBreakerStateOpen) ? [NSDate dateWithTimeIntervalSinceNow:self.openInterval] : nil;
+        probeRequest = nil;
+        if (state == TCDCircuitBreakerStateClosed)
+            outcomeCount = nextOutcome = 0;
+    }
+
+    [[NSNotificationCenter defaultCenter] postNotificationName:TCDCircuitBreakerStateDidChangeNotification
+                                                        object:self
+                                                      userInfo:@{ @"state" : @(state), @"previousState" : @(previousState) }];
+}
+
+- (BOOL) allowsRequest
+{
+    @synchronized(self)
+    {
+        switch (self.state)
+        {
+            case TCDCircuitBreakerStateClosed:
+                return YES;
+            case TCDCircuitBreakerStateOpen:
+                if ([self.probeDate timeIntervalSinceNow] > 0)
+                    return NO;
+                break;
+            case TCDCircuitBreakerStateHalfOpen:
+                return probeRequest == nil;
+        }
+    }
+
+    [self transitionToState:TCDCircuitBreakerStateHalfOpen];
+    return YES;
+}
+
+- (BOOL) beginProbeWithRequest:(TCAPIRequest *)request
+{
+    @synchronized(self)
+    {
+        if (self.state != TCDCircuitBreakerStateHalfOpen || probeRequest || !request)
+            return NO;
+        probeRequest = request;
+        return YES;
+    }
+}
+
+- (void) reset
+{
+    [self transitionToState:TCDCircuitBreakerStateClosed];
+    @synchronized(self)
+    {
+        outcomeCount = nextOutcome = 0;
+    }
+}
+
+#pragma mark - Outcomes
+
+- (void) recordOutcome:(TCDCircuitBreakerOutcome)outcome ofRequest:(TCAPIRequest *)request
+{
+    TCDCircuitBreakerState newState;
+    @synchronized(self)
+    {
+        newState = self.state;
+        if (self.state == TCDCircuitBreakerStateHalfOpen)
+        {
+            // Only the probe decides; requests that were already in flight, or that weren't gated, prove nothing.
+            if (request != probeRequest)
+                return;
+            newState = (outcome.failed || outcome.slow) ? TCDCircuitBreakerStateOpen : TCDCircuitBreakerStateClosed;
+        }
+        else if (self.state == TCDCircuitBreakerStateClosed)
+        {
+            NSUInteger capacity = MAX(self.windowSize, (NSUInteger)1);
+            if (capacity != outcomeCapacity)
+            {
+                outcomes = reallocf(outcomes, capacity * sizeof(TCDCircuitBreakerOutcome));
+                outcomeCapacity = capacity;
+                outcomeCount = nextOutcome = 0;
+            }
+            outcomes[nextOutcome] = outcome;
+            nextOutcome = (nextOutcome + 1) % outcomeCapacity;
+            outcomeCount = MIN(outcomeCount + 1, outcomeCapacity);
+
+            if (outcomeCount >= self.minimumSamples && (self.errorRate >= self.errorRateThreshold || self.slowCallRate >= self.slowCallRateThreshold))
+                newState = TCDCircuitBreakerStateOpen;
+        }
+    }
+    [self transitionToState:newState];
+}
+
+- (double) rateOfOutcomesWhere:(BOOL (^)(TCDCircuitBreakerOutcome outcome))predicate
+{
+    @synchronized(self)
+    {
+        if (outcomeCount == 0)
+            return 0;
+        NSUInteger matching = 0;
+        for (NSUInteger i = 0; i < outcomeCount; i++)
+        {
+            if (predicate(outcomes[i]))
+                matching++;
+        }
+        return (double)matching / outcomeCount;
+    }
+}
+
+- (double) errorRate
+{
+    return [self rateOfOutcomesWhere:^BOOL(TCDCircuitBreakerOutcome outcome) { return outcome.failed; }];
+}
+
+- (double) slowCallRate
+{
+    return [self rateOfOutcomesWhere:^BOOL(TCDCircuitBreakerOutcome outcome) { return outcome.slow; }];
+}
+
+- (void) recordSuccessWithLatency:(NSTimeInterval)latency
+{
+    [self recordOutcome:(TCDCircuitBreakerOutcome){ NO, latency > self.slowCallThreshold } ofRequest:nil];
+}
+
+- (void) recordFailure
+{
+    [self recordOutcome:(TCDCircuitBreakerOutcome){ YES, NO } ofRequest:nil];
+}
+
+#pragma mark - Request notifications
+
+- (BOOL) watchesRequest:(id)request
+{
+    if (![request isKindOfClass:[TCAPIRequest class]])
+        return NO;
+    NSURL *URL = [(TCAPIRequest *)request URL];
+    return [URL.host isEqualToString:self.endpoint.host];
+}
+
+- (void) requestStarted:(NSNotification *)notification
+{
+    if (![self watchesRequest:notification.object])
+        return;
+    @synchronized(self)
+    {
+        [startDates setObject:[NSDate date] forKey:notification.object];
+    }
+}
+
+- (NSTimeInterval) latencyOfRequest:(id)request
+{
+    NSDate *started;
+    @synchronized(self)
+    {
+        started = [startDates objectForKey:request];
+        [startDates removeObjectForKey:request];
+    }
+    return started ? -[started timeIntervalSinceNow] : 0;
+}
+
+- (void) requestFinished:(NSNotification *)notification
+{
+    TCAPIRequest *request = notification.object;
+    if ([self watchesRequest:request])
+        [self recordOutcome:(TCDCircuitBreakerOutcome){ NO, [self latencyOfRequest:request] > self.slowCallThreshold } ofRequest:request];
+}
+
+- (void) requestFailed:(NSNotification *)notification
+{
+    TCAPIRequest *request = notification.object;
+    if (![self watchesRequest:request])
+        return;
+    NSTimeInterval latency = [self latencyOfRequest:request];
+
+    NSInteger statusCode = request.HTTPResponse.statusCode;
+    BOOL failed = (request.didTimeOut || statusCode == 0 || statusCode == 429 || statusCode >= 500);
+    [self recordOutcome:(TCDCircuitBreakerOutcome){ failed, !failed && latency > self.slowCallThreshold } ofRequest:request];
+}
+
+- (void) requestCanceled:(NSNotification *)notification
+{
+    if (![self watchesRequest:notification.object])
+        return;
+    [self latencyOfRequest:notification.object];
+    @synchronized(self)
+    {
+        // A cancelled probe proves nothing; let another one through.
+        if (notification.object == probeRequest)
+            probeRequest = nil;
+    }
+}
+
+@end
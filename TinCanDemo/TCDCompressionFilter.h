@@ -0,0 +1,56 @@
+//
+//  TCDCompressionFilter.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/25/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "TCDRequestFilter.h"
+
+/**
+ Compresses request bodies and asks for compressed responses.
+
+ POST and PUT bodies of at least minimumBodyLength bytes are gzipped and sent with Content-Encoding: gzip
+ (only when compressesRequestBodies is on--the LRS has to accept compressed bodies). Every request asks for
+ gzip or deflate responses, which the URL loading system decompresses as the data arrives.
+ */
+@interface TCDCompressionFilter : NSObject <TCDRequestFilter>
+
+/**
+ YES to gzip POST and PUT bodies (default=NO).
+ */
+@property (nonatomic, readwrite) BOOL compressesRequestBodies;
+
+/**
+ YES to send Accept-Encoding: gzip, deflate (default=YES).
+ */
+@property (nonatomic, readwrite) BOOL requestsCompressedResponses;
+
+/**
+ The zlib compression level, 1 (fastest) to 9 (smallest) (default=6).
+ */
+@property (nonatomic, readwrite) int compressionLevel;
+
+/**
+ Bodies shorter than this are sent as they are (default=1024).
+ */
+@property (nonatomic, readwrite) NSUInteger minimumBodyLength;
+
+/**
+ Total length of the bodies compressed, before compression.
+ */
+@property (nonatomic, readonly) unsigned long long uncompressedByteCount;
+
+/**
+ Total length of the bodies compressed, after compression (what went on the wire).
+ */
+@property (nonatomic, readonly) unsigned long long compressedByteCount;
+
+/**
+ Total time spent compressing bodies.
+ */
+@property (nonatomic, readonly) NSTimeInterval compressionTime;
+
+@end
@@ -0,0 +1,71 @@
+//
+//  TCDCompressionFilter.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/25/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDCompressionFilter.h"
+#import "TCAPIRequest+TCDURLRequest.h"
+#import "NSData+TCDGzip.h"
+
+@interface TCDCompressionFilter ()
+@property (nonatomic, readwrite) unsigned long long uncompressedByteCount;
+@property (nonatomic, readwrite) unsigned long long compressedByteCount;
+@property (nonatomic, readwrite) NSTimeInterval compressionTime;
+@end
+
+@implementation TCDCompressionFilter
+
+- (id) init
+{
+    if ((self = [super init]))
+    {
+        self.requestsCompressedResponses = YES;
+        self.compressionLevel = 6;
+        self.minimumBodyLength = 1024;
+    }
+    return self;
+}
+
+- (void) filterRequest:(TCAPIRequest *)request
+{
+    if (self.requestsCompressedResponses && ![request valueForHTTPHeaderField:@"Accept-Encoding"])
+        [request setValue:@"gzip, deflate" forHTTPHeaderField:@"Accept-Encoding"];
+}
+
+- (void) filterPreparedRequest:(TCAPIRequest *)request
+{
+    // Statement and document requests set their body after filterRequest: runs, so it is compressed here.
+    if (!self.compressesRequestBodies)
+        return;
+    if (request.HTTPMethod != TCAPIRequestTypePOST && request.HTTPMethod != TCAPIRequestTypePUT)
+        return;
+    if ([request valueForHTTPHeaderField:@"Content-Encoding"])
+        return;
+
+    // HTTPBody on TCAPIRequest doesn't retain; the URL request copies its body, so change it there.
+    NSMutableURLRequest *URLRequest = request.URLRequest;
+    NSData *body = URLRequest.HTTPBody;
+    if (body.length < self.minimumBodyLength)
+        return;
+
+    NSDate *started = [NSDate date];
+    NSData *compressed = [body gzippedDataWithCompressionLevel:self.compressionLevel];
+    NSTimeInterval elapsed = -[started timeIntervalSinceNow];
+    if (!compressed || compressed.length >= body.length)
+        return;
+
+    URLRequest.HTTPBody = compressed;
+    [request setValue:@"gzip" forHTTPHeaderField:@"Content-Encoding"];
+
+    @synchronized(self)
+    {
+        self.uncompressedByteCount += body.length;
+        self.compressedByteCount += compressed.length;
+        self.compressionTime += elapsed;
+    }
+}
+
+@end
@@ -0,0 +1,42 @@
+//
+//  TCDConditionalActivityStateRequest.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/5/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <TinCan/TCAPIActivityStateRequest.h>
+
+/**
+ A TCAPIActivityStateRequest that records the status code and ETag of the LRS's response,
+ so conditional requests (If-Match / If-None-Match) can tell a 304 or 412 from other outcomes.
+ */
+@interface TCDConditionalActivityStateRequest : TCAPIActivityStateRequest
+
+/**
+ The state being saved, or the state the LRS returned. Implemented by TCAPIActivityStateRequest but not published.
+ */
+@property (nonatomic, strong, readonly) TCActivityState *state;
+
+/**
+ The HTTP status code of the response (0 until one is received).
+ */
+@property (nonatomic, readonly) NSInteger statusCode;
+
+/**
+ The ETag of the response (nil if the LRS didn't send one).
+ */
+@property (nonatomic, strong, readonly) NSString *entityTag;
+
+/**
+ YES if the LRS answered 304 Not Modified.
+ */
+@property (nonatomic, readonly) BOOL notModified;
+
+/**
+ YES if the LRS answered 412 Precondition Failed.
+ */
+@property (nonatomic, readonly) BOOL preconditionFailed;
+
+@end
@@ -0,0 +1,50 @@
+//
+//  TCDConditionalActivityStateRequest.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/5/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDConditionalActivityStateRequest.h"
+
+@interface TCDConditionalActivityStateRequest ()
+@property (nonatomic, readwrite) NSInteger statusCode;
+@property (nonatomic, strong, readwrite) NSString *entityTag;
+@end
+
+@implementation TCDConditionalActivityStateRequest
+
+@dynamic state;
+
+- (void) recordResponse
+{
+    if (!response)
+        return;
+    self.statusCode = response.statusCode;
+    self.entityTag = [[response allHeaderFields] objectForKey:@"ETag"];
+}
+
+- (BOOL) notModified
+{
+    return self.statusCode == 304;
+}
+
+- (BOOL) preconditionFailed
+{
+    return self.statusCode == 412;
+}
+
+- (void) requestDidFinish
+{
+    [self recordResponse];
+    [super requestDidFinish];
+}
+
+- (void) requestDidFailWithError:(NSError *)error
+{
+    [self recordResponse];
+    [super requestDidFailWithError:error];
+}
+
+@end
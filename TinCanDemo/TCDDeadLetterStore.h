@@ -0,0 +1,87 @@
+//
+//  TCDDeadLetterStore.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/8/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class TCStatement;
+
+/**
+ A statement the LRS rejected, with what the LRS said about it.
+ */
+@interface TCDDeadLetter : NSObject
+
+@property (nonatomic, strong, readonly) TCStatement *statement;
+@property (nonatomic, strong, readonly) NSDate *rejectedDate;
+
+/**
+ The HTTP status code of the rejection (0 if unknown).
+ */
+@property (nonatomic, readonly) NSInteger statusCode;
+
+/**
+ The domain, code and description of the error the request failed with.
+ */
+@property (nonatomic, strong, readonly) NSString *errorDomain;
+@property (nonatomic, readonly) NSInteger errorCode;
+@property (nonatomic, strong, readonly) NSString *errorDescription;
+
+/**
+ The body of the LRS's response, usually its explanation of what was wrong (nil if it sent none).
+ */
+@property (nonatomic, strong, readonly) NSString *serverMessage;
+
+@end
+
+/**
+ Statements the LRS rejected, kept on disk (in a TCDStatementLog keyed by statement id) so they can be inspected,
+ fixed and sent again instead of blocking the statement queue.
+ */
+@interface TCDDeadLetterStore : NSObject
+
+/**
+ Number of statements in the store.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+
+/**
+ Creates a store in Documents/tcDeadLetters.
+ */
+- (id) init;
+
+/**
+ Designated initializer. Opens (or creates) the store in the directory.
+ */
+- (id) initWithDirectory:(NSString *)directory;
+
+/**
+ Adds a rejected statement, replacing any earlier rejection of the same statement.
+
+ @param statement       The statement the LRS rejected. It must have an id.
+ @param error           The error the request failed with.
+ @param statusCode      The HTTP status code of the rejection.
+ @param serverMessage   The body of the LRS's response (may be nil).
+ @param outError        Returns any error encountered while storing the statement.
+ */
+- (BOOL) addStatement:(TCStatement *)statement rejectedWithError:(NSError *)error statusCode:(NSInteger)statusCode serverMessage:(NSString *)serverMessage error:(NSError **)outError;
+
+/**
+ Every rejected statement, oldest first.
+ */
+- (NSArray *) deadLetters;
+
+/**
+ Removes a statement (e.g. after it has been fixed and queued again).
+ */
+- (BOOL) removeStatementWithId:(NSString *)sid error:(NSError **)error;
+
+/**
+ Removes every statement.
+ */
+- (BOOL) removeAllStatementsWithError:(NSError **)error;
+
+@end
@@ -0,0 +1,112 @@
+//
+//  TCDDeadLetterStore.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/8/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDDeadLetterStore.h"
+#import "TCDStatementLog.h"
+#import "TCDJSONWriter.h"
+
+static NSString* const kTCDDefaultDeadLetterDirectory = @"tcDeadLetters";
+
+@interface TCDDeadLetter ()
+@property (nonatomic, strong, readwrite) TCStatement *statement;
+@property (nonatomic, strong, readwrite) NSDate *rejectedDate;
+@property (nonatomic, readwrite) NSInteger statusCode;
+@property (nonatomic, strong, readwrite) NSString *errorDomain;
+@property (nonatomic, readwrite) NSInteger errorCode;
+@property (nonatomic, strong, readwrite) NSString *errorDescription;
+@property (nonatomic, strong, readwrite) NSString *serverMessage;
+@end
+
+@implementation TCDDeadLetter
+@end
+
+@implementation TCDDeadLetterStore
+{
+    TCDStatementLog *log;
+}
+
+- (id) init
+{
+    NSString *documents = [NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES) objectAtIndex:0];
+    return [self initWithDirectory:[documents stringByAppendingPathComponent:kTCDDefaultDeadLetterDirectory]];
+}
+
+- (id) initWithDirectory:(NSString *)directory
+{
+    if ((self = [super init]))
+    {
+        log = [[TCDStatementLog alloc] initWithDirectory:directory];
+
+        NSError *error = nil;
+        if (![log openWithError:&error])
+            NSLog(@"Unable to open the dead letter store at %@: %@", directory, error);
+    }
+    return self;
+}
+
+- (NSUInteger) count
+{
+    return log.count;
+}
+
+- (BOOL) addStatement:(TCStatement *)statement rejectedWithError:(NSError *)error statusCode:(NSInteger)statusCode serverMessage:(NSString *)serverMessage error:(NSError **)outError
+{
+    if (statement.sid.length == 0)
+        return NO;
+
+    NSMutableDictionary *record = [NSMutableDictionary dictionary];
+    [record setObject:[statement dictionary] forKey:@"statement"];
+    [record setObject:@([[NSDate date] timeIntervalSince1970]) forKey:@"rejected"];
+    [record setObject:@(statusCode) forKey:@"status"];
+    if (error)
+    {
+        [record setObject:error.domain forKey:@"errorDomain"];
+        [record setObject:@(error.code) forKey:@"errorCode"];
+        [record setObject:[error localizedDescription] ?: @"" forKey:@"errorDescription"];
+    }
+    if (serverMessage)
+        [record setObject:serverMessage forKey:@"serverMessage"];
+
+    NSData *payload = [TCDJSONWriter dataWithJSONObject:record error:outError];
+    if (!payload)
+        return NO;
+    return [log appendPayloads:@[payload] forKeys:@[statement.sid] error:outError];
+}
+
+- (NSArray *) deadLetters
+{
+    NSMutableArray *deadLetters = [NSMutableArray arrayWithCapacity:log.count];
+    [log enumerateRecordsUsingBlock:^(NSString *key, NSData *payload, BOOL *stop) {
+        NSDictionary *record = [NSJSONSerialization JSONObjectWithData:payload options:0 error:NULL];
+        if (![record isKindOfClass:[NSDictionary class]])
+            return;
+
+        TCDDeadLetter *deadLetter = [[TCDDeadLetter alloc] init];
+        deadLetter.statement = [[TCStatement alloc] initWithDictionary:[record objectForKey:@"statement"]];
+        deadLetter.rejectedDate = [NSDate dateWithTimeIntervalSince1970:[[record objectForKey:@"rejected"] doubleValue]];
+        deadLetter.statusCode = [[record objectForKey:@"status"] integerValue];
+        deadLetter.errorDomain = [record objectForKey:@"errorDomain"];
+        deadLetter.errorCode = [[record objectForKey:@"errorCode"] integerValue];
+        deadLetter.errorDescription = [record objectForKey:@"errorDescription"];
+        deadLetter.serverMessage = [record objectForKey:@"serverMessage"];
+        [deadLetters addObject:deadLetter];
+    }];
+    return deadLetters;
+}
+
+- (BOOL) removeStatementWithId:(NSString *)sid error:(NSError **)error
+{
+    return !sid || [log acknowledgeKeys:@[sid] error:error];
+}
+
+- (BOOL) removeAllStatementsWithError:(NSError **)error
+{
+    return [log removeAllRecordsWithError:error];
+}
+
+@end
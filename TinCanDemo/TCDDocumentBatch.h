@@ -0,0 +1,80 @@
+//
+//  TCDDocumentBatch.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/7/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class TCAPI;
+
+/**
+ Called once every request in a batch has finished.
+
+ @param results     Key -> what the request produced (the retrieved document, or NSNull for saves and deletes).
+                    Documents the LRS doesn't have are left out.
+ @param errors      Key -> error for the requests that failed.
+ */
+typedef void (^TCDDocumentBatchCompletion)(NSDictionary *results, NSDictionary *errors);
+
+/**
+ Runs a set of document requests (activity state, activity profile, actor profile) with bounded concurrency
+ and reports them with a single completion.
+
+ Requests are created with the API's endpoint and authorization provider, so they go through the request
+ pipeline and share the connections NSURLConnection keeps to the LRS. The batch itself keeps at most
+ maxConcurrentRequests in flight; each one that finishes starts the next.
+ The batch keeps itself alive until it finishes. Use it from the main thread.
+ */
+@interface TCDDocumentBatch : NSObject
+
+@property (nonatomic, strong, readonly) TCAPI *api;
+
+/**
+ Most of the batch's requests in flight at once (default=4, the number of connections per host NSURLConnection opens).
+ */
+@property (nonatomic, readwrite) NSUInteger maxConcurrentRequests;
+
+/**
+ A batch started from this batch's completion (e.g. fetching the states a listing returned).
+ Cancelling this batch cancels it too, and this batch isn't finished until it is.
+ */
+@property (nonatomic, strong) TCDDocumentBatch *followUpBatch;
+
+/**
+ Number of requests in the batch.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+
+@property (nonatomic, readonly) BOOL isFinished;
+
+/**
+ Designated initializer.
+ */
+- (id) initWithAPI:(TCAPI *)api;
+
+/**
+ Adds a request to the batch. Must be called before start.
+
+ @param key             Identifies the request in the results (e.g. the state id).
+ @param requestClass    A TCAPIRequest subclass; it is created with the API's endpoint and authorization provider.
+ @param resultKey       The request property holding its result once it finishes (e.g. @"state"), or nil to report NSNull.
+ @param configuration   Sets up the request (e.g. calls getActivityStateWithActivityId:...).
+ */
+- (void) addRequestWithKey:(NSString *)key requestClass:(Class)requestClass resultKey:(NSString *)resultKey configuration:(void (^)(id request))configuration;
+
+/**
+ Starts the requests.
+
+ @param completion  Called on the main thread when every request has finished.
+ */
+- (void) startWithCompletion:(TCDDocumentBatchCompletion)completion;
+
+/**
+ Cancels the requests that haven't finished, and the follow-up batch. The completion isn't called.
+ */
+- (void) cancel;
+
+@end
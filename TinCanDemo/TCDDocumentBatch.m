@@ -0,0 +1,166 @@
+//
+//  TCDDocumentBatch.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/7/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDDocumentBatch.h"
+#import "TCAPIRequest+TCDURLRequest.h"
+
+/**
+ A request waiting to be sent, or in flight.
+ */
+@interface TCDDocumentBatchOperation : NSObject
+@property (nonatomic, strong) NSString *key;
+@property (nonatomic, assign) Class requestClass;
+@property (nonatomic, strong) NSString *resultKey;
+@property (nonatomic, copy) void (^configuration)(id request);
+@property (nonatomic, strong) TCAPIRequest *request;
+@end
+
+@implementation TCDDocumentBatchOperation
+@end
+
+@interface TCDDocumentBatch () <TCAPIRequestDelegate>
+{
+    NSMutableArray *pending;
+    NSMutableArray *active;
+    NSMutableDictionary *results;
+    NSMutableDictionary *errors;
+    TCDDocumentBatchCompletion completion;
+    // Keeps the batch alive while it runs.
+    TCDDocumentBatch *running;
+}
+@property (nonatomic, strong, readwrite) TCAPI *api;
+@property (nonatomic, readwrite) NSUInteger count;
+@property (nonatomic, readwrite) BOOL isFinished;
+@end
+
+@implementation TCDDocumentBatch
+
+@synthesize isFinished = _isFinished;
+
+- (id) initWithAPI:(TCAPI *)api
+{
+    if ((self = [super init]))
+    {
+        self.api = api;
+        self.maxConcurrentRequests = 4;
+        pending = [[NSMutableArray alloc] init];
+        active = [[NSMutableArray alloc] init];
+        results = [[NSMutableDictionary alloc] init];
+        errors = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+- (void) addRequestWithKey:(NSString *)key requestClass:(Class)requestClass resultKey:(NSString *)resultKey configuration:(void (^)(id))configuration
+{
+    NSAssert(!running && !self.isFinished, @"Requests must be added before the batch starts");
+    TCDDocumentBatchOperation *operation = [[TCDDocumentBatchOperation alloc] init];
+    operation.key = key;
+    operation.requestClass = requestClass;
+    operation.resultKey = resultKey;
+    operation.configuration = configuration;
+    [pending addObject:operation];
+    self.count++;
+}
+
+- (void) startWithCompletion:(TCDDocumentBatchCompletion)aCompletion
+{
+    completion = [aCompletion copy];
+    running = self;
+    [self startPendingRequests];
+    [self finishIfDone];
+}
+
+- (BOOL) isFinished
+{
+    return _isFinished && (!self.followUpBatch || self.followUpBatch.isFinished);
+}
+
+- (void) startPendingRequests
+{
+    while (pending.count > 0 && active.count < MAX(self.maxConcurrentRequests, (NSUInteger)1))
+    {
+        TCDDocumentBatchOperation *operation = [pending objectAtIndex:0];
+        [pending removeObjectAtIndex:0];
+
+        TCAPIRequest *request = [[operation.requestClass alloc] initWithLRS:self.api.endpoint andAuthorizationProvider:self.api.authorizationProvider delegate:self];
+        operation.configuration(request);
+        operation.request = request;
+        [active addObject:operation];
+        [request start];
+    }
+}
+
+- (void) finishIfDone
+{
+    if (!running || pending.count > 0 || active.count > 0)
+        return;
+
+    self.isFinished = YES;
+    TCDDocumentBatchCompletion finished = completion;
+    completion = nil;
+    if (finished)
+        finished([results copy], [errors copy]);
+    running = nil;
+}
+
+- (void) cancel
+{
+    [self.followUpBatch cancel];
+    [pending removeAllObjects];
+    for (TCDDocumentBatchOperation *operation in active)
+        [operation.request cancel];
+    [active removeAllObjects];
+    completion = nil;
+    running = nil;
+}
+
+- (TCDDocumentBatchOperation *) operationForRequest:(TCAPIRequest *)request
+{
+    for (TCDDocumentBatchOperation *operation in active)
+    {
+        if (operation.request == request)
+            return operation;
+    }
+    return nil;
+}
+
+#pragma mark - TCAPIRequestDelegate
+
+- (void) requestDidFinish:(TCAPIRequest *)request
+{
+    TCDDocumentBatchOperation *operation = [self operationForRequest:request];
+    if (!operation)
+        return;
+    [active removeObject:operation];
+
+    id result = operation.resultKey ? [request valueForKey:operation.resultKey] : [NSNull null];
+    if (result && operation.key)
+        [results setObject:result forKey:operation.key];
+
+    [self startPendingRequests];
+    [self finishIfDone];
+}
+
+- (void) request:(TCAPIRequest *)request didFailWithError:(NSError *)error
+{
+    TCDDocumentBatchOperation *operation = [self operationForRequest:request];
+    if (!operation)
+        return;
+    [active removeObject:operation];
+
+    // A document the LRS doesn't have is an empty result, not a failure.
+    BOOL notFound = (request.HTTPMethod == TCAPIRequestTypeGET && request.HTTPResponse.statusCode == 404);
+    if (!notFound && operation.key)
+        [errors setObject:error ?: [NSNull null] forKey:operation.key];
+
+    [self startPendingRequests];
+    [self finishIfDone];
+}
+
+@end
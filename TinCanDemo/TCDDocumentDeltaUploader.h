@@ -0,0 +1,90 @@
+//
+//  TCDDocumentDeltaUploader.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/6/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class TCAPI, TCState, TCActivityState, TCActivityProfile, TCActorProfile;
+@class TCAPIActivityStateRequest, TCAPIActivityProfileRequest, TCAPIActorProfileRequest;
+@protocol TCAPIActivityStateRequestDelegate, TCAPIActivityProfileRequestDelegate, TCAPIActorProfileRequestDelegate;
+
+/**
+ Saves activity states, activity profiles and actor profiles by sending only what changed.
+
+ The uploader remembers the last version of each document it saw on the LRS: documents it saved, and documents
+ retrieved through any TCAPI request. When a JSON object document is saved again, the top-level keys that were
+ added or changed go to the LRS as a POST, which the LRS merges into the stored document. The whole document is
+ PUT instead when there is no known version, a key was removed (a merge can't remove keys), the document isn't a
+ JSON object, or the change is more than maxPatchRatio of the document.
+
+ If the LRS rejects a merge POST the document is sent again with PUT, and merges aren't tried again while
+ serverSupportsMerge is NO. The delegate sees a single save either way.
+
+ Use the uploader from the main thread.
+ */
+@interface TCDDocumentDeltaUploader : NSObject
+
+@property (nonatomic, strong, readonly) TCAPI *api;
+
+/**
+ Largest size of a merge body, as a fraction of the full document, worth sending. Defaults to 0.5.
+ */
+@property (nonatomic, readwrite) double maxPatchRatio;
+
+/**
+ NO once the LRS has rejected a merge POST.
+ */
+@property (nonatomic, readwrite) BOOL serverSupportsMerge;
+
+/**
+ Saves sent as merge POSTs, saves sent as full PUTs, and merge POSTs the LRS rejected.
+ */
+@property (nonatomic, readonly) NSUInteger patchCount;
+@property (nonatomic, readonly) NSUInteger fullUploadCount;
+@property (nonatomic, readonly) NSUInteger fallbackCount;
+
+/**
+ Bytes of document bodies that merge POSTs didn't have to send.
+ */
+@property (nonatomic, readonly) unsigned long long bytesSaved;
+
+/**
+ Designated initializer.
+ */
+- (id) initWithAPI:(TCAPI *)api;
+
+/**
+ Records the document's contents as the version on the LRS.
+ Documents retrieved through TCAPI are recorded automatically.
+ */
+- (void) recordServerVersionOfDocument:(TCState *)document;
+
+/**
+ Saves an activity state (see TCAPI's saveActivityState:withDelegate:). The request is started.
+ */
+- (TCAPIActivityStateRequest *) saveActivityState:(TCActivityState *)state delegate:(id<TCAPIActivityStateRequestDelegate>)delegate;
+
+/**
+ Saves an activity profile (see TCAPI's saveActivityProfile:delegate:). The request is started.
+ */
+- (TCAPIActivityProfileRequest *) saveActivityProfile:(TCActivityProfile *)profile delegate:(id<TCAPIActivityProfileRequestDelegate>)delegate;
+
+/**
+ Saves an actor profile (see TCAPI's saveActorProfile:delegate:). The request is started.
+ */
+- (TCAPIActorProfileRequest *) saveActorProfile:(TCActorProfile *)profile delegate:(id<TCAPIActorProfileRequestDelegate>)delegate;
+
+/**
+ The body of a merge POST that turns one JSON object document into another: the top-level keys of contents that
+ base doesn't have or has with a different value.
+
+ @return    The merge body, or nil if the change can't be sent as a merge (a key was removed, or either document
+            isn't a JSON object).
+ */
++ (NSData *) mergeBodyFromContents:(NSData *)base toContents:(NSData *)contents;
+
+@end
@@ -0,0 +1,259 @@
+//
+//  TCDDocumentDeltaUploader.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/6/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDDocumentDeltaUploader.h"
+#import "TCDJSONWriter.h"
+#import "TCDStatementAttributes.h"
+#import "TCAPIRequest+TCDURLRequest.h"
+
+/**
+ A document being saved, and how.
+ */
+@interface TCDDocumentUpload : NSObject
+@property (nonatomic, strong) TCState *document;
+@property (nonatomic, strong) NSString *key;
+@property (nonatomic, weak) id<TCAPIRequestDelegate> delegate;
+@property (nonatomic, strong) TCAPIRequest *request;
+// TCAPIRequest doesn't retain its HTTPBody.
+@property (nonatomic, strong) NSData *mergeBody;
+@end
+
+@implementation TCDDocumentUpload
+@end
+
+@interface TCDDocumentDeltaUploader () <TCAPIActivityStateRequestDelegate, TCAPIActivityProfileRequestDelegate, TCAPIActorProfileRequestDelegate>
+{
+    // Document key -> contents of the version on the LRS.
+    NSMutableDictionary *serverContents;
+    NSMutableArray *uploads;
+}
+@property (nonatomic, strong, readwrite) TCAPI *api;
+@property (nonatomic, readwrite) NSUInteger patchCount;
+@property (nonatomic, readwrite) NSUInteger fullUploadCount;
+@property (nonatomic, readwrite) NSUInteger fallbackCount;
+@property (nonatomic, readwrite) unsigned long long bytesSaved;
+@end
+
+@implementation TCDDocumentDeltaUploader
+
+- (id) initWithAPI:(TCAPI *)api
+{
+    if ((self = [super init]))
+    {
+        self.api = api;
+        self.maxPatchRatio = 0.5;
+        self.serverSupportsMerge = YES;
+        serverContents = [[NSMutableDictionary alloc] init];
+        uploads = [[NSMutableArray alloc] init];
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(requestFinished:) name:TCRequestFinishedNotification object:nil];
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+}
+
+#pragma mark - Server versions
+
++ (NSString *) keyForDocument:(TCState *)document
+{
+    if ([document isKindOfClass:[TCActivityState class]])
+    {
+        TCActivityState *state = (TCActivityState *)document;
+        return [NSString stringWithFormat:@"state\n%@\n%@\n%@\n%@", state.activityId, [TCDStatementAttributes keyForAgent:state.actor], state.stateId, state.registrationId ?: @""];
+    }
+    if ([document isKindOfClass:[TCActivityProfile class]])
+    {
+        TCActivityProfile *profile = (TCActivityProfile *)document;
+        return [NSString stringWithFormat:@"activityProfile\n%@\n%@", profile.activityId, profile.profileId];
+    }
+    if ([document isKindOfClass:[TCActorProfile class]])
+    {
+        TCActorProfile *profile = (TCActorProfile *)document;
+        return [NSString stringWithFormat:@"actorProfile\n%@\n%@", [TCDStatementAttributes keyForAgent:profile.actor], profile.profileId];
+    }
+    return nil;
+}
+
+- (void) recordServerVersionOfDocument:(TCState *)document
+{
+    NSString *key = [[self class] keyForDocument:document];
+    if (!key)
+        return;
+    if (document.contents)
+        [serverContents setObject:[document.contents copy] forKey:key];
+    else
+        [serverContents removeObjectForKey:key];
+}
+
+- (void) requestFinished:(NSNotification *)notification
+{
+    // Learn the LRS's version from documents retrieved by anyone.
+    TCAPIRequest *request = notification.object;
+    if (![request isKindOfClass:[TCAPIRequest class]] || request.HTTPMethod != TCAPIRequestTypeGET)
+        return;
+
+    NSString *documentKey = nil;
+    if ([request isKindOfClass:[TCAPIActivityStateRequest class]])
+        documentKey = @"state";
+    else if ([request isKindOfClass:[TCAPIActivityProfileRequest class]] || [request isKindOfClass:[TCAPIActorProfileRequest class]])
+        documentKey = @"profile";
+
+    // The retrieved document is in a property the request classes don't publish.
+    id document = documentKey ? [request valueForKey:documentKey] : nil;
+    if ([document isKindOfClass:[TCState class]])
+        [self recordServerVersionOfDocument:document];
+}
+
++ (NSData *) mergeBodyFromContents:(NSData *)base toContents:(NSData *)contents
+{
+    if (!base || !contents)
+        return nil;
+    NSDictionary *old = [NSJSONSerialization JSONObjectWithData:base options:0 error:NULL];
+    NSDictionary *new = [NSJSONSerialization JSONObjectWithData:contents options:0 error:NULL];
+    if (![old isKindOfClass:[NSDictionary class]] || ![new isKindOfClass:[NSDictionary class]])
+        return nil;
+
+    for (NSString *key in old)
+    {
+        if (![new objectForKey:key])
+            return nil;
+    }
+
+    NSMutableDictionary *changed = [NSMutableDictionary dictionary];
+    [new enumerateKeysAndObjectsUsingBlock:^(NSString *key, id value, BOOL *stop) {
+        if (![value isEqual:[old objectForKey:key]])
+            [changed setObject:value forKey:key];
+    }];
+    return [TCDJSONWriter dataWithJSONObject:changed error:NULL];
+}
+
+#pragma mark - Saving
+
+- (TCAPIActivityStateRequest *) saveActivityState:(TCActivityState *)state delegate:(id<TCAPIActivityStateRequestDelegate>)delegate
+{
+    TCAPIActivityStateRequest *request = [[TCAPIActivityStateRequest alloc] initWithLRS:self.api.endpoint andAuthorizationProvider:self.api.authorizationProvider delegate:self];
+    [request saveActivityState:state];
+    [self sendDocument:state withRequest:request delegate:delegate];
+    return request;
+}
+
+- (TCAPIActivityProfileRequest *) saveActivityProfile:(TCActivityProfile *)profile delegate:(id<TCAPIActivityProfileRequestDelegate>)delegate
+{
+    TCAPIActivityProfileRequest *request = [[TCAPIActivityProfileRequest alloc] initWithLRS:self.api.endpoint andAuthorizationProvider:self.api.authorizationProvider delegate:self];
+    [request saveActivityProfile:profile];
+    [self sendDocument:profile withRequest:request delegate:delegate];
+    return request;
+}
+
+- (TCAPIActorProfileRequest *) saveActorProfile:(TCActorProfile *)profile delegate:(id<TCAPIActorProfileRequestDelegate>)delegate
+{
+    TCAPIActorProfileRequest *request = [[TCAPIActorProfileRequest alloc] initWithLRS:self.api.endpoint andAuthorizationProvider:self.api.authorizationProvider delegate:self];
+    [request saveActorProfile:profile];
+    [self sendDocument:profile withRequest:request delegate:delegate];
+    return request;
+}
+
+/**
+ Starts a save request that has been set up to PUT the whole document, turning it into a merge POST when that's smaller.
+ */
+- (void) sendDocument:(TCState *)document withRequest:(TCAPIRequest *)request delegate:(id<TCAPIRequestDelegate>)delegate
+{
+    TCDDocumentUpload *upload = [[TCDDocumentUpload alloc] init];
+    upload.document = document;
+    upload.key = [[self class] keyForDocument:document];
+    upload.delegate = delegate;
+    upload.request = request;
+
+    NSData *base = upload.key ? [serverContents objectForKey:upload.key] : nil;
+    NSData *mergeBody = self.serverSupportsMerge ? [[self class] mergeBodyFromContents:base toContents:document.contents] : nil;
+    if (mergeBody && mergeBody.length <= self.maxPatchRatio * document.contents.length)
+    {
+        upload.mergeBody = mergeBody;
+        request.HTTPMethod = TCAPIRequestTypePOST;
+        request.HTTPBody = mergeBody;
+        [request setValue:@"application/json" forHTTPHeaderField:kContentType];
+        self.patchCount++;
+        self.bytesSaved += document.contents.length - mergeBody.length;
+    }
+    else
+    {
+        self.fullUploadCount++;
+    }
+
+    [uploads addObject:upload];
+    [request start];
+}
+
+- (TCDDocumentUpload *) uploadForRequest:(TCAPIRequest *)request
+{
+    for (TCDDocumentUpload *upload in uploads)
+    {
+        if (upload.request == request)
+            return upload;
+    }
+    return nil;
+}
+
+#pragma mark - TCAPIRequestDelegate
+
+- (void) requestDidFinish:(TCAPIRequest *)request
+{
+    TCDDocumentUpload *upload = [self uploadForRequest:request];
+    if (!upload)
+        return;
+    [uploads removeObject:upload];
+    [self recordServerVersionOfDocument:upload.document];
+
+    id delegate = upload.delegate;
+    if ([upload.document isKindOfClass:[TCActivityState class]] && [delegate respondsToSelector:@selector(activityStateSaved:)])
+        [delegate activityStateSaved:(TCActivityState *)upload.document];
+    else if ([upload.document isKindOfClass:[TCActivityProfile class]] && [delegate respondsToSelector:@selector(activityProfileSaved:)])
+        [delegate activityProfileSaved:(TCActivityProfile *)upload.document];
+    else if ([upload.document isKindOfClass:[TCActorProfile class]] && [delegate respondsToSelector:@selector(actorProfileSaved:)])
+        [delegate actorProfileSaved:(TCActorProfile *)upload.document];
+    if ([delegate respondsToSelector:@selector(requestDidFinish:)])
+        [delegate requestDidFinish:request];
+}
+
+- (void) request:(TCAPIRequest *)request didFailWithError:(NSError *)error
+{
+    TCDDocumentUpload *upload = [self uploadForRequest:request];
+    if (!upload)
+        return;
+    [uploads removeObject:upload];
+
+    NSInteger statusCode = request.HTTPResponse.statusCode;
+    if (upload.mergeBody && statusCode >= 400 && statusCode < 500 && statusCode != 401 && statusCode != 409 && statusCode != 412)
+    {
+        // The LRS wouldn't merge the document; send the whole thing.
+        self.serverSupportsMerge = NO;
+        self.fallbackCount++;
+        self.bytesSaved -= upload.document.contents.length - upload.mergeBody.length;
+        self.patchCount--;
+        [serverContents removeObjectForKey:upload.key];
+
+        if ([upload.document isKindOfClass:[TCActivityState class]])
+            [self saveActivityState:(TCActivityState *)upload.document delegate:(id)upload.delegate];
+        else if ([upload.document isKindOfClass:[TCActivityProfile class]])
+            [self saveActivityProfile:(TCActivityProfile *)upload.document delegate:(id)upload.delegate];
+        else
+            [self saveActorProfile:(TCActorProfile *)upload.document delegate:(id)upload.delegate];
+        return;
+    }
+
+    // The document may or may not have reached the LRS; don't merge against a version that may be stale.
+    [serverContents removeObjectForKey:upload.key];
+    id<TCAPIRequestDelegate> delegate = upload.delegate;
+    if ([delegate respondsToSelector:@selector(request:didFailWithError:)])
+        [delegate request:request didFailWithError:error];
+}
+
+@end
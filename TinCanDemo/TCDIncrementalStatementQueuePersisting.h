@@ -0,0 +1,36 @@
+//
+//  TCDIncrementalStatementQueuePersisting.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/20/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <TinCan/TCStatementQueuePersisting.h>
+
+/**
+ Persisting coordinators that can record individual changes to the queue instead of the whole queue.
+ TCDStatementQueue uses these methods when its coordinator implements them.
+ */
+@protocol TCDIncrementalStatementQueuePersisting <TCStatementQueuePersisting>
+
+/**
+ Invoked by the statement queue when statements are added to the end of the queue.
+
+ @param statements  The statements that were added.
+ @param error       Return any error encountered while persisting the statements.
+ @returns           YES if the statements were stored successfully.
+ */
+- (BOOL) appendStatements:(NSArray *)statements withError:(NSError **)error;
+
+/**
+ Invoked by the statement queue when statements leave the queue.
+
+ @param statements  The statements that were removed.
+ @param error       Return any error encountered while persisting the change.
+ @returns           YES if the change was stored successfully.
+ */
+- (BOOL) acknowledgeStatements:(NSArray *)statements withError:(NSError **)error;
+
+@end
@@ -0,0 +1,66 @@
+//
+//  TCDIndexedStatementStore.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/3/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "TCDStatementStore.h"
+#import "TCDLogStatementStore.h"
+
+@class TCStatementQuery;
+
+/**
+ A TCDStatementStore that answers TCStatementQuery filters locally.
+
+ Statements are kept on disk in a TCDLogStatementStore. Next to it the store keeps secondary indexes
+ mirroring the query's filters: statement id, verb, object id, actor identity, registration, instructor and
+ context activity id (for queries with context set) each map a value to the set of statements that have it,
+ and the stored times are kept sorted for since/until.
+ A query starts from whichever index selects the fewest statements, so its cost depends on how many statements
+ match, not on how many are stored.
+
+ The indexes live in memory. Each statement's indexed attributes are stored with its record in compact form
+ (see -[TCDStatementAttributes encodedData]), so when the store is opened the indexes are rebuilt from those
+ alone, without reading or parsing the statements.
+ */
+@interface TCDIndexedStatementStore : NSObject <TCDStatementStore>
+
+/**
+ The store holding the statements.
+ */
+@property (nonatomic, strong, readonly) TCDLogStatementStore *backingStore;
+
+/**
+ How long rebuilding the indexes took when the store was opened.
+ */
+@property (nonatomic, readonly) NSTimeInterval indexBuildTime;
+
+/**
+ Creates a store in Documents/tcStatementStore.
+ */
+- (id) init;
+
+/**
+ Designated initializer. Opens (or creates) the store in the directory and indexes its statements.
+ */
+- (id) initWithDirectory:(NSString *)directory;
+
+/**
+ The ids of the stored statements that satisfy the query, most recently stored first, at most query.limit of them.
+ */
+- (NSArray *) statementIdsMatchingQuery:(TCStatementQuery *)query;
+
+/**
+ The stored statements that satisfy the query, most recently stored first, at most query.limit of them.
+ */
+- (NSArray *) statementsMatchingQuery:(TCStatementQuery *)query;
+
+/**
+ Deletes every stored statement.
+ */
+- (BOOL) removeAllStatementsWithError:(NSError **)error;
+
+@end
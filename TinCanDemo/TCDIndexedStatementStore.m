@@ -0,0 +1,432 @@
+//
+//  TCDIndexedStatementStore.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/3/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDIndexedStatementStore.h"
+#import "TCDStatementAttributes.h"
+#import "TCDStatementQueryMatcher.h"
+#import "TCStatement+TCDJSONEncoding.h"
+
+/**
+ An entry in the time index. Entries are sorted by stored time, then ordinal.
+ */
+typedef struct
+{
+    NSTimeInterval stored;
+    NSUInteger ordinal;
+} TCDTimeIndexEntry;
+
+static int TCDCompareTimeIndexEntries(const void *a, const void *b)
+{
+    const TCDTimeIndexEntry *x = a, *y = b;
+    if (x->stored != y->stored)
+        return x->stored < y->stored ? -1 : 1;
+    if (x->ordinal != y->ordinal)
+        return x->ordinal < y->ordinal ? -1 : 1;
+    return 0;
+}
+
+// The attributes with a value index, in the order their dictionaries are kept in valueIndexes.
+static NSString* const kTCDIndexedAttributes[] = { @"verb", @"objectId", @"actorKey", @"registration", @"instructorKey" };
+static const NSUInteger kTCDIndexedAttributeCount = sizeof(kTCDIndexedAttributes) / sizeof(kTCDIndexedAttributes[0]);
+static const NSUInteger kTCDObjectIdIndex = 1;
+
+static void TCDIndexOrdinal(NSMutableDictionary *index, NSString *value, NSUInteger ordinal)
+{
+    NSMutableIndexSet *ordinals = [index objectForKey:value];
+    if (!ordinals)
+    {
+        ordinals = [NSMutableIndexSet indexSet];
+        [index setObject:ordinals forKey:value];
+    }
+    [ordinals addIndex:ordinal];
+}
+
+static void TCDUnindexOrdinal(NSMutableDictionary *index, NSString *value, NSUInteger ordinal)
+{
+    NSMutableIndexSet *ordinals = [index objectForKey:value];
+    [ordinals removeIndex:ordinal];
+    if (ordinals.count == 0)
+        [index removeObjectForKey:value];
+}
+
+@interface TCDIndexedStatementStore ()
+{
+    // Every statement is given an ordinal when it's first indexed; the index sets hold ordinals.
+    NSMutableArray *attributesByOrdinal;
+    NSMutableDictionary *ordinalsBySid;
+    // One dictionary per indexed attribute, value -> NSMutableIndexSet of ordinals.
+    NSMutableArray *valueIndexes;
+    // Context activity id -> NSMutableIndexSet of ordinals.
+    NSMutableDictionary *contextActivityIndex;
+    TCDTimeIndexEntry *timeIndex;
+    NSUInteger timeIndexCount;
+    NSUInteger timeIndexCapacity;
+    // Set while the indexes are rebuilt from the log; the time index is only sorted once the build finishes.
+    BOOL building;
+}
+@property (nonatomic, strong, readwrite) TCDLogStatementStore *backingStore;
+@property (nonatomic, readwrite) NSTimeInterval indexBuildTime;
+@end
+
+@implementation TCDIndexedStatementStore
+
+- (id) init
+{
+    return [self initWithDirectory:nil];
+}
+
+- (id) initWithDirectory:(NSString *)directory
+{
+    if ((self = [super init]))
+    {
+        self.backingStore = directory ? [[TCDLogStatementStore alloc] initWithDirectory:directory] : [[TCDLogStatementStore alloc] init];
+        [self resetIndexes];
+        [self buildIndexes];
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    free(timeIndex);
+}
+
+#pragma mark - Building the indexes
+
+- (void) resetIndexes
+{
+    attributesByOrdinal = [[NSMutableArray alloc] init];
+    ordinalsBySid = [[NSMutableDictionary alloc] init];
+    valueIndexes = [[NSMutableArray alloc] initWithCapacity:kTCDIndexedAttributeCount];
+    for (NSUInteger i = 0; i < kTCDIndexedAttributeCount; i++)
+        [valueIndexes addObject:[NSMutableDictionary dictionary]];
+    contextActivityIndex = [[NSMutableDictionary alloc] init];
+    timeIndexCount = 0;
+}
+
+- (void) buildIndexes
+{
+    NSDate *start = [NSDate date];
+    building = YES;
+    [self.backingStore.log enumerateMappedRecordsWithMetadataUsingBlock:^(NSString *key, NSData *segmentData, NSRange payloadRange, NSRange metadataRange, BOOL *stop) {
+        @autoreleasepool
+        {
+            // Records carry their attributes, so the statements themselves aren't read.
+            TCDStatementAttributes *recorded = nil;
+            if (metadataRange.length > 0)
+                recorded = [[TCDStatementAttributes alloc] initWithEncodedBytes:(const char *)segmentData.bytes + metadataRange.location
+                                                                         length:metadataRange.length sid:key];
+            if (recorded)
+            {
+                [self indexAttributes:recorded sid:key];
+                return;
+            }
+
+            // Written before attributes (or their context activities) were stored with the records; parse the statement.
+            NSData *payload = [NSData dataWithBytesNoCopy:(void *)((const char *)segmentData.bytes + payloadRange.location)
+                                                   length:payloadRange.length
+                                             freeWhenDone:NO];
+            NSDictionary *dictionary = [NSJSONSerialization JSONObjectWithData:payload options:0 error:NULL];
+            if (![dictionary isKindOfClass:[NSDictionary class]])
+                return;
+            [self indexAttributes:[[TCDStatementAttributes alloc] initWithDictionary:dictionary] sid:key];
+        }
+    }];
+
+    // The log is in write order, not stored order; sort once instead of inserting each entry in place.
+    qsort(timeIndex, timeIndexCount, sizeof(TCDTimeIndexEntry), TCDCompareTimeIndexEntries);
+    building = NO;
+    self.indexBuildTime = -[start timeIntervalSinceNow];
+}
+
+/**
+ Position of the first entry in the time index that doesn't sort before the entry.
+ */
+- (NSUInteger) timeIndexPositionOfEntry:(TCDTimeIndexEntry)entry
+{
+    NSUInteger low = 0, high = timeIndexCount;
+    while (low < high)
+    {
+        NSUInteger middle = low + (high - low) / 2;
+        if (TCDCompareTimeIndexEntries(&timeIndex[middle], &entry) < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+- (void) insertTimeIndexEntry:(TCDTimeIndexEntry)entry sorted:(BOOL)sorted
+{
+    if (timeIndexCount == timeIndexCapacity)
+    {
+        timeIndexCapacity = MAX(timeIndexCapacity * 2, (NSUInteger)1024);
+        timeIndex = reallocf(timeIndex, timeIndexCapacity * sizeof(TCDTimeIndexEntry));
+    }
+
+    NSUInteger position = sorted ? [self timeIndexPositionOfEntry:entry] : timeIndexCount;
+    if (position < timeIndexCount)
+        memmove(&timeIndex[position + 1], &timeIndex[position], (timeIndexCount - position) * sizeof(TCDTimeIndexEntry));
+    timeIndex[position] = entry;
+    timeIndexCount++;
+}
+
+- (void) removeTimeIndexEntry:(TCDTimeIndexEntry)entry
+{
+    NSUInteger position = [self timeIndexPositionOfEntry:entry];
+    if (position >= timeIndexCount || TCDCompareTimeIndexEntries(&timeIndex[position], &entry) != 0)
+        return;
+    memmove(&timeIndex[position], &timeIndex[position + 1], (timeIndexCount - position - 1) * sizeof(TCDTimeIndexEntry));
+    timeIndexCount--;
+}
+
+/**
+ Adds (or replaces) the attributes of a statement in every index. During the initial build the time index is
+ appended to and sorted afterwards; later insertions keep it sorted.
+ */
+- (void) indexAttributes:(TCDStatementAttributes *)attributes sid:(NSString *)sid
+{
+    if (sid.length == 0)
+        return;
+
+    NSNumber *existing = [ordinalsBySid objectForKey:sid];
+    NSUInteger ordinal;
+    if (existing)
+    {
+        ordinal = [existing unsignedIntegerValue];
+        [self unindexAttributes:[attributesByOrdinal objectAtIndex:ordinal] ordinal:ordinal sorted:!building];
+        [attributesByOrdinal replaceObjectAtIndex:ordinal withObject:attributes];
+    }
+    else
+    {
+        ordinal = attributesByOrdinal.count;
+        [attributesByOrdinal addObject:attributes];
+        [ordinalsBySid setObject:@(ordinal) forKey:sid];
+    }
+
+    for (NSUInteger i = 0; i < kTCDIndexedAttributeCount; i++)
+    {
+        NSString *value = [attributes valueForKey:kTCDIndexedAttributes[i]];
+        if (value)
+            TCDIndexOrdinal([valueIndexes objectAtIndex:i], value, ordinal);
+    }
+    for (NSString *activityId in attributes.contextActivityIds)
+        TCDIndexOrdinal(contextActivityIndex, activityId, ordinal);
+
+    if (!isnan(attributes.stored))
+        [self insertTimeIndexEntry:(TCDTimeIndexEntry){ attributes.stored, ordinal } sorted:!building];
+}
+
+- (void) unindexAttributes:(TCDStatementAttributes *)attributes ordinal:(NSUInteger)ordinal sorted:(BOOL)sorted
+{
+    for (NSUInteger i = 0; i < kTCDIndexedAttributeCount; i++)
+    {
+        NSString *value = [attributes valueForKey:kTCDIndexedAttributes[i]];
+        if (value)
+            TCDUnindexOrdinal([valueIndexes objectAtIndex:i], value, ordinal);
+    }
+    for (NSString *activityId in attributes.contextActivityIds)
+        TCDUnindexOrdinal(contextActivityIndex, activityId, ordinal);
+
+    if (isnan(attributes.stored))
+        return;
+    TCDTimeIndexEntry entry = { attributes.stored, ordinal };
+    if (sorted)
+    {
+        [self removeTimeIndexEntry:entry];
+        return;
+    }
+    // Still building, so the time index isn't sorted yet.
+    for (NSUInteger i = 0; i < timeIndexCount; i++)
+    {
+        if (timeIndex[i].ordinal == ordinal)
+        {
+            timeIndex[i] = timeIndex[--timeIndexCount];
+            break;
+        }
+    }
+}
+
+#pragma mark - TCDStatementStore
+
+- (NSUInteger) count
+{
+    return self.backingStore.count;
+}
+
+- (BOOL) upsertStatements:(NSArray *)statements insertedCount:(NSUInteger *)insertedCount error:(NSError **)error
+{
+    @synchronized(self)
+    {
+        // Statements already stored are left alone (and not encoded or indexed again). Each new statement is
+        // encoded once; its attributes are read from that encoding and stored with it, so reopening the store
+        // rebuilds the indexes from the attributes alone.
+        NSMutableArray *newStatements = [NSMutableArray arrayWithCapacity:statements.count];
+        NSMutableSet *newIds = [NSMutableSet setWithCapacity:statements.count];
+        for (TCStatement *statement in statements)
+        {
+            NSString *sid = statement.sid;
+            if (sid.length == 0 || [newIds containsObject:sid] || [self.backingStore containsStatementWithId:sid])
+                continue;
+            [newIds addObject:sid];
+            [newStatements addObject:statement];
+        }
+
+        NSMutableArray *attributesList = [NSMutableArray arrayWithCapacity:newStatements.count];
+        NSMutableArray *metadata = [NSMutableArray arrayWithCapacity:newStatements.count];
+        for (TCStatement *statement in newStatements)
+        {
+            [statement encodedJSONData];
+            TCDStatementAttributes *attributes = [TCDStatementAttributes attributesOfStatement:statement];
+            [attributesList addObject:attributes];
+            [metadata addObject:[attributes encodedData] ?: [NSNull null]];
+        }
+        if (![self.backingStore upsertStatements:newStatements metadata:metadata insertedCount:insertedCount error:error])
+            return NO;
+        for (TCDStatementAttributes *attributes in attributesList)
+            [self indexAttributes:attributes sid:attributes.sid];
+        return YES;
+    }
+}
+
+- (BOOL) containsStatementWithId:(NSString *)sid
+{
+    return [self.backingStore containsStatementWithId:sid];
+}
+
+- (TCStatement *) statementWithId:(NSString *)sid
+{
+    return [self.backingStore statementWithId:sid];
+}
+
+- (void) enumerateStatementsUsingBlock:(void (^)(TCStatement *, BOOL *))block
+{
+    [self.backingStore enumerateStatementsUsingBlock:block];
+}
+
+- (BOOL) removeAllStatementsWithError:(NSError **)error
+{
+    @synchronized(self)
+    {
+        if (![self.backingStore removeAllStatementsWithError:error])
+            return NO;
+        [self resetIndexes];
+        return YES;
+    }
+}
+
+#pragma mark - Queries
+
+/**
+ The range of the time index inside the matcher's bounds (since exclusive, until inclusive).
+ */
+- (NSRange) timeIndexRangeForMatcher:(TCDStatementQueryMatcher *)matcher
+{
+    NSUInteger low = 0, high = timeIndexCount;
+    if (!isnan(matcher.since))
+        low = [self timeIndexPositionOfEntry:(TCDTimeIndexEntry){ matcher.since, NSUIntegerMax }];
+    if (!isnan(matcher.until))
+        high = [self timeIndexPositionOfEntry:(TCDTimeIndexEntry){ matcher.until, NSUIntegerMax }];
+    return NSMakeRange(low, high > low ? high - low : 0);
+}
+
+- (NSArray *) statementIdsMatchingQuery:(TCStatementQuery *)query
+{
+    TCDStatementQueryMatcher *matcher = [[TCDStatementQueryMatcher alloc] initWithQuery:query];
+    NSUInteger limit = matcher.limit > 0 ? matcher.limit : NSUIntegerMax;
+    NSMutableArray *sids = [NSMutableArray array];
+
+    @synchronized(self)
+    {
+        // The smallest value index any of the query's filters selects; nil if the query has no value filters.
+        NSIndexSet *candidates = nil;
+        if (matcher.statementId)
+        {
+            NSNumber *ordinal = [ordinalsBySid objectForKey:matcher.statementId];
+            candidates = ordinal ? [NSIndexSet indexSetWithIndex:[ordinal unsignedIntegerValue]] : [NSIndexSet indexSet];
+        }
+        for (NSUInteger i = 0; i < kTCDIndexedAttributeCount; i++)
+        {
+            NSString *value = [matcher valueForKey:kTCDIndexedAttributes[i]];
+            if (!value)
+                continue;
+            NSIndexSet *ordinals = [[valueIndexes objectAtIndex:i] objectForKey:value] ?: [NSIndexSet indexSet];
+            if (i == kTCDObjectIdIndex && matcher.matchesContextActivities)
+            {
+                // The object filter also selects statements with the object among their context activities.
+                NSMutableIndexSet *either = [ordinals mutableCopy];
+                [either addIndexes:[contextActivityIndex objectForKey:value] ?: [NSIndexSet indexSet]];
+                ordinals = either;
+            }
+            if (!candidates || ordinals.count < candidates.count)
+                candidates = ordinals;
+        }
+
+        NSRange timeRange = [self timeIndexRangeForMatcher:matcher];
+        if (!candidates && !matcher.hasTimeBounds)
+            timeRange = NSMakeRange(0, timeIndexCount);
+
+        if (!candidates || timeRange.length <= candidates.count)
+        {
+            // Walk the time range newest first; it's already in result order.
+            for (NSUInteger i = NSMaxRange(timeRange); i > timeRange.location && sids.count < limit; i--)
+            {
+                TCDStatementAttributes *attributes = [attributesByOrdinal objectAtIndex:timeIndex[i - 1].ordinal];
+                if (!candidates || [matcher matchesAttributes:attributes])
+                    [sids addObject:attributes.sid];
+            }
+            if (!candidates && !matcher.hasTimeBounds)
+            {
+                // Statements without a stored time aren't in the time index; they sort last.
+                for (TCDStatementAttributes *attributes in attributesByOrdinal)
+                {
+                    if (sids.count >= limit)
+                        break;
+                    if (isnan(attributes.stored))
+                        [sids addObject:attributes.sid];
+                }
+            }
+            return sids;
+        }
+
+        NSMutableArray *matches = [NSMutableArray arrayWithCapacity:candidates.count];
+        [candidates enumerateIndexesUsingBlock:^(NSUInteger ordinal, BOOL *stop) {
+            TCDStatementAttributes *attributes = [attributesByOrdinal objectAtIndex:ordinal];
+            if ([matcher matchesAttributes:attributes])
+                [matches addObject:attributes];
+        }];
+        [matches sortUsingComparator:^NSComparisonResult(TCDStatementAttributes *a, TCDStatementAttributes *b) {
+            // Newest first; statements without a stored time last.
+            NSTimeInterval x = isnan(a.stored) ? -DBL_MAX : a.stored;
+            NSTimeInterval y = isnan(b.stored) ? -DBL_MAX : b.stored;
+            return x > y ? NSOrderedAscending : (x < y ? NSOrderedDescending : NSOrderedSame);
+        }];
+        for (TCDStatementAttributes *attributes in matches)
+        {
+            if (sids.count >= limit)
+                break;
+            [sids addObject:attributes.sid];
+        }
+    }
+    return sids;
+}
+
+- (NSArray *) statementsMatchingQuery:(TCStatementQuery *)query
+{
+    NSArray *sids = [self statementIdsMatchingQuery:query];
+    NSMutableArray *statements = [NSMutableArray arrayWithCapacity:sids.count];
+    for (NSString *sid in sids)
+    {
+        TCStatement *statement = [self statementWithId:sid];
+        if (statement)
+            [statements addObject:statement];
+    }
+    return statements;
+}
+
+@end
@@ -0,0 +1,67 @@
+//
+//  TCDIngestionRing.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/21/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ A bounded, lock-free multi-producer/single-consumer ring of objects.
+
+ Any number of threads may enqueue at once. Each slot carries a sequence number, so a producer claims a
+ slot with a single compare-and-swap and publishes it with a store--no locks are taken and nothing is
+ allocated, so enqueueing stays cheap however contended the ring is. Only one thread may dequeue.
+ */
+@interface TCDIngestionRing : NSObject
+
+/**
+ Number of slots in the ring (a power of two).
+ */
+@property (nonatomic, readonly) NSUInteger capacity;
+
+/**
+ Total number of objects ever accepted by enqueueObject:.
+ An accepted object may still be in the middle of being published.
+ */
+@property (nonatomic, readonly) unsigned long long enqueuedCount;
+
+/**
+ Total number of objects ever removed by the consumer.
+ */
+@property (nonatomic, readonly) unsigned long long dequeuedCount;
+
+/**
+ Designated initializer.
+
+ @param capacity    The minimum number of slots; rounded up to a power of two.
+ */
+- (id) initWithCapacity:(NSUInteger)capacity;
+
+/**
+ Adds an object to the ring. Safe to call from any thread.
+
+ @param object  The object to add. Must not be nil.
+ @return        NO if the ring is full (the object is not added).
+ */
+- (BOOL) enqueueObject:(id)object;
+
+/**
+ Removes the oldest published object. Must only be called from the consumer thread.
+
+ @return    The object, or nil if nothing is ready.
+ */
+- (id) dequeueObject;
+
+/**
+ Removes published objects, oldest first, and adds them to an array. Must only be called from the consumer thread.
+
+ @param objects     The array to add the objects to.
+ @param maxCount    The maximum number of objects to remove.
+ @return            The number of objects removed.
+ */
+- (NSUInteger) dequeueObjects:(NSMutableArray *)objects maxCount:(NSUInteger)maxCount;
+
+@end
@@ -0,0 +1,137 @@
+//
+//  TCDIngestionRing.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/21/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDIngestionRing.h"
+#import <libkern/OSAtomic.h>
+
+typedef struct
+{
+    // A slot at ring position p is free for ticket p while sequence == p,
+    // and holds ticket p's object once sequence == p + 1.
+    volatile int64_t sequence;
+    void *object;
+} TCDIngestionSlot;
+
+@implementation TCDIngestionRing
+{
+    TCDIngestionSlot *slots;
+    int64_t mask;
+    volatile int64_t enqueueTicket __attribute__((aligned(8)));
+    volatile int64_t dequeueTicket __attribute__((aligned(8)));
+}
+
+- (id) init
+{
+    return [self initWithCapacity:1024];
+}
+
+- (id) initWithCapacity:(NSUInteger)capacity
+{
+    if ((self = [super init]))
+    {
+        NSUInteger size = 2;
+        while (size < capacity)
+            size <<= 1;
+
+        _capacity = size;
+        mask = (int64_t)size - 1;
+        slots = calloc(size, sizeof(TCDIngestionSlot));
+        for (NSUInteger i = 0; i < size; i++)
+            slots[i].sequence = (int64_t)i;
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    // Release anything that was never consumed.
+    while ([self dequeueObject])
+        ;
+    free(slots);
+}
+
+- (unsigned long long) enqueuedCount
+{
+    OSMemoryBarrier();
+    return (unsigned long long)enqueueTicket;
+}
+
+- (unsigned long long) dequeuedCount
+{
+    OSMemoryBarrier();
+    return (unsigned long long)dequeueTicket;
+}
+
+- (BOOL) enqueueObject:(id)object
+{
+    if (!object)
+        return NO;
+
+    TCDIngestionSlot *slot;
+    int64_t ticket = enqueueTicket;
+    for (;;)
+    {
+        slot = &slots[ticket & mask];
+        int64_t sequence = slot->sequence;
+        OSMemoryBarrier();
+
+        int64_t difference = sequence - ticket;
+        if (difference == 0)
+        {
+            if (OSAtomicCompareAndSwap64Barrier(ticket, ticket + 1, &enqueueTicket))
+                break;
+            ticket = enqueueTicket;
+        }
+        else if (difference < 0)
+        {
+            // The consumer hasn't freed this slot from the previous lap yet.
+            return NO;
+        }
+        else
+        {
+            // Another producer claimed this ticket first.
+            ticket = enqueueTicket;
+        }
+    }
+
+    slot->object = (__bridge_retained void *)object;
+    OSMemoryBarrier();
+    slot->sequence = ticket + 1;
+    return YES;
+}
+
+- (id) dequeueObject
+{
+    int64_t ticket = dequeueTicket;
+    TCDIngestionSlot *slot = &slots[ticket & mask];
+    int64_t sequence = slot->sequence;
+    OSMemoryBarrier();
+    if (sequence != ticket + 1)
+        return nil;
+
+    id object = (__bridge_transfer id)slot->object;
+    slot->object = NULL;
+    OSMemoryBarrier();
+    slot->sequence = ticket + mask + 1;
+    dequeueTicket = ticket + 1;
+    return object;
+}
+
+- (NSUInteger) dequeueObjects:(NSMutableArray *)objects maxCount:(NSUInteger)maxCount
+{
+    NSUInteger count = 0;
+    id object;
+    while (count < maxCount && (object = [self dequeueObject]))
+    {
+        [objects addObject:object];
+        count++;
+    }
+    return count;
+}
+
+@end
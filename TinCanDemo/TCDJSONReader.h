@@ -0,0 +1,85 @@
+//
+//  TCDJSONReader.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/12/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+extern NSString* const TCDJSONReaderErrorDomain;
+
+/**
+ Reads JSON a value at a time, so objects can be filled in straight from the bytes (see TCObject+TCDJSONCoding)
+ instead of going through an NSDictionary tree first.
+
+ The typed reads are forgiving about types but not about syntax: asking for a string when the next value is
+ something else skips that value and returns nil, while malformed JSON sets error and makes every later read
+ return nil (or NO).
+
+ The bytes are not copied; they must stay valid for as long as the reader is used.
+ */
+@interface TCDJSONReader : NSObject
+
+- (id) initWithBytes:(const uint8_t *)bytes length:(NSUInteger)length;
+- (id) initWithData:(NSData *)data;
+
+/**
+ The first syntax error found, or nil.
+ */
+@property (nonatomic, strong, readonly) NSError *error;
+
+/**
+ Consumes the opening brace of an object. NO (and the value skipped) if the next value isn't an object.
+ */
+- (BOOL) beginObject;
+
+/**
+ Reads the next key of the current object, with its colon. Returns NULL (having consumed the closing brace) at the
+ end of the object. The key is only valid until the next call.
+ */
+- (const char *) nextKey;
+
+/**
+ Consumes the opening bracket of an array. NO (and the value skipped) if the next value isn't an array.
+ */
+- (BOOL) beginArray;
+
+/**
+ YES if the current array has another element; NO (having consumed the closing bracket) at its end.
+ */
+- (BOOL) nextElement;
+
+/**
+ YES (and consumes it) if the next value is null.
+ */
+- (BOOL) readNull;
+
+- (NSString *) readString;
+- (NSNumber *) readNumber;
+
+/**
+ Reads true or false, or a number as its boolValue. NO for anything else.
+ */
+- (BOOL) readBool;
+
+/**
+ Reads the next value as Foundation objects (dictionaries, arrays, strings, numbers and NSNull), as NSJSONSerialization would.
+ */
+- (id) readValue;
+
+- (void) skipValue;
+
+/**
+ Looks ahead into the next value, if it's an object, for a string at a key, without consuming anything.
+ A second key looks one object deeper (e.g. "definition", then "type"). Pass NULL for the second key to look at the top level only.
+ */
+- (NSString *) peekStringForKey:(const char *)key inObjectForKey:(const char *)parentKey;
+
+/**
+ YES if nothing but whitespace is left (and there was no error).
+ */
+- (BOOL) isAtEnd;
+
+@end
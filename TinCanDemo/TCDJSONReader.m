@@ -0,0 +1,652 @@
+//
+//  TCDJSONReader.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/12/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDJSONReader.h"
+#include <errno.h>
+
+NSString* const TCDJSONReaderErrorDomain = @"TCDJSONReaderErrorDomain";
+
+// Deeper nesting than this is treated as an error rather than risking the stack.
+static const NSUInteger kTCDMaximumDepth = 512;
+
+static inline BOOL TCDIsWhitespace(uint8_t c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static inline int TCDHexValue(uint8_t c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+static void TCDAppendUTF8(UTF32Char codePoint, NSMutableData *data)
+{
+    uint8_t bytes[4];
+    NSUInteger length;
+    if (codePoint < 0x80)
+    {
+        bytes[0] = (uint8_t)codePoint;
+        length = 1;
+    }
+    else if (codePoint < 0x800)
+    {
+        bytes[0] = 0xC0 | (codePoint >> 6);
+        bytes[1] = 0x80 | (codePoint & 0x3F);
+        length = 2;
+    }
+    else if (codePoint < 0x10000)
+    {
+        bytes[0] = 0xE0 | (codePoint >> 12);
+        bytes[1] = 0x80 | ((codePoint >> 6) & 0x3F);
+        bytes[2] = 0x80 | (codePoint & 0x3F);
+        length = 3;
+    }
+    else
+    {
+        bytes[0] = 0xF0 | (codePoint >> 18);
+        bytes[1] = 0x80 | ((codePoint >> 12) & 0x3F);
+        bytes[2] = 0x80 | ((codePoint >> 6) & 0x3F);
+        bytes[3] = 0x80 | (codePoint & 0x3F);
+        length = 4;
+    }
+    [data appendBytes:bytes length:length];
+}
+
+@interface TCDJSONReader ()
+@property (nonatomic, strong, readwrite) NSError *error;
+@end
+
+@implementation TCDJSONReader
+{
+    const uint8_t *bytes;
+    NSUInteger length;
+    NSUInteger position;
+    NSUInteger depth;
+    // YES right after an object or array is opened, before its first member.
+    BOOL first;
+
+    // Strings with escapes are decoded here; keys are copied into keyBuffer with a terminating NUL.
+    NSMutableData *scratch;
+    NSMutableData *keyBuffer;
+    // Keeps the bytes alive when the reader was made from an NSData.
+    NSData *data;
+}
+
+- (id) initWithBytes:(const uint8_t *)someBytes length:(NSUInteger)aLength
+{
+    if ((self = [super init]))
+    {
+        bytes = someBytes;
+        length = aLength;
+        scratch = [[NSMutableData alloc] initWithCapacity:256];
+        keyBuffer = [[NSMutableData alloc] initWithCapacity:64];
+    }
+    return self;
+}
+
+- (id) initWithData:(NSData *)someData
+{
+    if ((self = [self initWithBytes:someData.bytes length:someData.length]))
+    {
+        data = someData;
+    }
+    return self;
+}
+
+- (void) failWithMessage:(NSString *)message
+{
+    if (self.error)
+        return;
+    NSString *description = [NSString stringWithFormat:@"%@ at byte %lu", message, (unsigned long)position];
+    self.error = [NSError errorWithDomain:TCDJSONReaderErrorDomain code:1
+                                 userInfo:@{ NSLocalizedDescriptionKey : description }];
+}
+
+- (uint8_t) peekByte
+{
+    while (position < length && TCDIsWhitespace(bytes[position]))
+        position++;
+    return position < length ? bytes[position] : 0;
+}
+
+- (BOOL) consumeLiteral:(const char *)literal
+{
+    size_t literalLength = strlen(literal);
+    if (length - position < literalLength || memcmp(bytes + position, literal, literalLength) != 0)
+    {
+        [self failWithMessage:@"Unexpected character"];
+        return NO;
+    }
+    position += literalLength;
+    return YES;
+}
+
+- (void) valueEnded
+{
+    first = NO;
+}
+
+#pragma mark - Strings
+
+/**
+ Scans the string at the current position (which must be a quote). The contents are either left in place or, if
+ they have escapes, decoded into scratch; either way *outBytes and *outLength describe the UTF-8.
+ */
+- (BOOL) scanStringBytes:(const uint8_t **)outBytes length:(NSUInteger *)outLength
+{
+    NSUInteger start = ++position;
+    while (position < length)
+    {
+        uint8_t c = bytes[position];
+        if (c == '"')
+        {
+            *outBytes = bytes + start;
+            *outLength = position - start;
+            position++;
+            return YES;
+        }
+        if (c == '\\')
+            break;
+        if (c < 0x20)
+        {
+            [self failWithMessage:@"Unescaped control character in string"];
+            return NO;
+        }
+        position++;
+    }
+
+    [scratch setLength:0];
+    [scratch appendBytes:bytes + start length:position - start];
+    while (position < length)
+    {
+        uint8_t c = bytes[position];
+        if (c == '"')
+        {
+            *outBytes = scratch.bytes;
+            *outLength = scratch.length;
+            position++;
+            return YES;
+        }
+        if (c < 0x20)
+        {
+            [self failWithMessage:@"Unescaped control character in string"];
+            return NO;
+        }
+        if (c != '\\')
+        {
+            NSUInteger runStart = position;
+            while (position < length && bytes[position] != '"' && bytes[position] != '\\' && bytes[position] >= 0x20)
+                position++;
+            [scratch appendBytes:bytes + runStart length:position - runStart];
+            continue;
+        }
+
+        if (position + 1 >= length)
+            break;
+        uint8_t escaped = bytes[position + 1];
+        position += 2;
+        char replacement = 0;
+        switch (escaped)
+        {
+            case '"':  replacement = '"'; break;
+            case '\\': replacement = '\\'; break;
+            case '/':  replacement = '/'; break;
+            case 'b':  replacement = '\b'; break;
+            case 'f':  replacement = '\f'; break;
+            case 'n':  replacement = '\n'; break;
+            case 'r':  replacement = '\r'; break;
+            case 't':  replacement = '\t'; break;
+            case 'u':
+            {
+                UTF32Char unit = [self scanHexUnit];
+                if (self.error)
+                    return NO;
+                if (CFStringIsSurrogateHighCharacter((UniChar)unit) && length - position >= 6 &&
+                    bytes[position] == '\\' && bytes[position + 1] == 'u')
+                {
+                    NSUInteger saved = position;
+                    position += 2;
+                    UTF32Char low = [self scanHexUnit];
+                    if (self.error)
+                        return NO;
+                    if (CFStringIsSurrogateLowCharacter((UniChar)low))
+                        unit = CFStringGetLongCharacterForSurrogatePair((UniChar)unit, (UniChar)low);
+                    else
+                        position = saved;
+                }
+                // A lone surrogate can't be held in UTF-8; it becomes the replacement character.
+                if (unit >= 0xD800 && unit <= 0xDFFF)
+                    unit = 0xFFFD;
+                TCDAppendUTF8(unit, scratch);
+                continue;
+            }
+            default:
+                [self failWithMessage:@"Invalid escape in string"];
+                return NO;
+        }
+        [scratch appendBytes:&replacement length:1];
+    }
+    [self failWithMessage:@"Unterminated string"];
+    return NO;
+}
+
+- (UTF32Char) scanHexUnit
+{
+    if (length - position < 4)
+    {
+        [self failWithMessage:@"Invalid \\u escape in string"];
+        return 0;
+    }
+    UTF32Char unit = 0;
+    for (NSUInteger i = 0; i < 4; i++)
+    {
+        int digit = TCDHexValue(bytes[position + i]);
+        if (digit < 0)
+        {
+            [self failWithMessage:@"Invalid \\u escape in string"];
+            return 0;
+        }
+        unit = (unit << 4) | (UTF32Char)digit;
+    }
+    position += 4;
+    return unit;
+}
+
+- (NSString *) readString
+{
+    if (self.error)
+        return nil;
+    if ([self peekByte] != '"')
+    {
+        if (![self readNull])
+            [self skipValue];
+        return nil;
+    }
+
+    const uint8_t *stringBytes;
+    NSUInteger stringLength;
+    if (![self scanStringBytes:&stringBytes length:&stringLength])
+        return nil;
+    [self valueEnded];
+    NSString *string = [[NSString alloc] initWithBytes:stringBytes length:stringLength encoding:NSUTF8StringEncoding];
+    if (!string)
+        [self failWithMessage:@"Invalid UTF-8 in string"];
+    return string;
+}
+
+#pragma mark - Numbers
+
+/**
+ Scans a number, leaving it NUL-terminated in scratch. *isInteger is YES if it has no fraction or exponent.
+ */
+- (BOOL) scanNumberIsInteger:(BOOL *)isInteger
+{
+    NSUInteger start = position;
+    BOOL integer = YES;
+    if (position < length && bytes[position] == '-')
+        position++;
+    if (position >= length || !isdigit(bytes[position]))
+    {
+        [self failWithMessage:@"Invalid number"];
+        return NO;
+    }
+    if (bytes[position] == '0')
+        position++;
+    else
+        while (position < length && isdigit(bytes[position]))
+            position++;
+    if (position < length && bytes[position] == '.')
+    {
+        integer = NO;
+        position++;
+        if (position >= length || !isdigit(bytes[position]))
+        {
+            [self failWithMessage:@"Invalid number"];
+            return NO;
+        }
+        while (position < length && isdigit(bytes[position]))
+            position++;
+    }
+    if (position < length && (bytes[position] == 'e' || bytes[position] == 'E'))
+    {
+        integer = NO;
+        position++;
+        if (position < length && (bytes[position] == '+' || bytes[position] == '-'))
+            position++;
+        if (position >= length || !isdigit(bytes[position]))
+        {
+            [self failWithMessage:@"Invalid number"];
+            return NO;
+        }
+        while (position < length && isdigit(bytes[position]))
+            position++;
+    }
+
+    [scratch setLength:0];
+    [scratch appendBytes:bytes + start length:position - start];
+    [scratch appendBytes:"" length:1];
+    *isInteger = integer;
+    return YES;
+}
+
+- (NSNumber *) readNumber
+{
+    if (self.error)
+        return nil;
+    uint8_t c = [self peekByte];
+    if (c != '-' && !isdigit(c))
+    {
+        if (![self readNull])
+            [self skipValue];
+        return nil;
+    }
+
+    BOOL isInteger;
+    if (![self scanNumberIsInteger:&isInteger])
+        return nil;
+    [self valueEnded];
+    const char *text = scratch.bytes;
+    if (isInteger)
+    {
+        errno = 0;
+        long long value = strtoll(text, NULL, 10);
+        if (errno != ERANGE)
+            return [NSNumber numberWithLongLong:value];
+        if (text[0] != '-')
+        {
+            errno = 0;
+            unsigned long long unsignedValue = strtoull(text, NULL, 10);
+            if (errno != ERANGE)
+                return [NSNumber numberWithUnsignedLongLong:unsignedValue];
+        }
+    }
+    return [NSNumber numberWithDouble:strtod(text, NULL)];
+}
+
+- (BOOL) readBool
+{
+    if (self.error)
+        return NO;
+    uint8_t c = [self peekByte];
+    if (c == 't' || c == 'f')
+    {
+        BOOL value = (c == 't');
+        if (![self consumeLiteral:value ? "true" : "false"])
+            return NO;
+        [self valueEnded];
+        return value;
+    }
+    if (c == '-' || isdigit(c))
+        return [[self readNumber] boolValue];
+    [self skipValue];
+    return NO;
+}
+
+- (BOOL) readNull
+{
+    if (self.error || [self peekByte] != 'n')
+        return NO;
+    if (![self consumeLiteral:"null"])
+        return NO;
+    [self valueEnded];
+    return YES;
+}
+
+#pragma mark - Objects and arrays
+
+- (BOOL) beginContainer:(uint8_t)open
+{
+    if (self.error)
+        return NO;
+    if ([self peekByte] != open)
+    {
+        [self skipValue];
+        return NO;
+    }
+    if (++depth > kTCDMaximumDepth)
+    {
+        [self failWithMessage:@"Too deeply nested"];
+        return NO;
+    }
+    position++;
+    first = YES;
+    return YES;
+}
+
+- (void) containerEnded
+{
+    position++;
+    depth--;
+    [self valueEnded];
+}
+
+- (BOOL) beginObject
+{
+    return [self beginContainer:'{'];
+}
+
+- (const char *) nextKey
+{
+    if (self.error)
+        return NULL;
+    uint8_t c = [self peekByte];
+    if (c == '}')
+    {
+        [self containerEnded];
+        return NULL;
+    }
+    if (!first)
+    {
+        if (c != ',')
+        {
+            [self failWithMessage:@"Expected , or } in object"];
+            return NULL;
+        }
+        position++;
+        c = [self peekByte];
+    }
+    if (c != '"')
+    {
+        [self failWithMessage:@"Expected a key in object"];
+        return NULL;
+    }
+
+    const uint8_t *keyBytes;
+    NSUInteger keyLength;
+    if (![self scanStringBytes:&keyBytes length:&keyLength])
+        return NULL;
+    [keyBuffer setLength:0];
+    [keyBuffer appendBytes:keyBytes length:keyLength];
+    [keyBuffer appendBytes:"" length:1];
+
+    if ([self peekByte] != ':')
+    {
+        [self failWithMessage:@"Expected : after key"];
+        return NULL;
+    }
+    position++;
+    first = NO;
+    return keyBuffer.bytes;
+}
+
+- (BOOL) beginArray
+{
+    return [self beginContainer:'['];
+}
+
+- (BOOL) nextElement
+{
+    if (self.error)
+        return NO;
+    uint8_t c = [self peekByte];
+    if (c == ']')
+    {
+        [self containerEnded];
+        return NO;
+    }
+    if (first)
+    {
+        first = NO;
+        return YES;
+    }
+    if (c != ',')
+    {
+        [self failWithMessage:@"Expected , or ] in array"];
+        return NO;
+    }
+    position++;
+    return YES;
+}
+
+#pragma mark - Whole values
+
+- (id) readValue
+{
+    if (self.error)
+        return nil;
+    switch ([self peekByte])
+    {
+        case '{':
+        {
+            NSMutableDictionary *dictionary = [NSMutableDictionary dictionary];
+            [self beginObject];
+            const char *key;
+            while ((key = [self nextKey]))
+            {
+                NSString *keyString = [[NSString alloc] initWithBytes:key length:strlen(key) encoding:NSUTF8StringEncoding];
+                if (!keyString)
+                {
+                    [self failWithMessage:@"Invalid UTF-8 in key"];
+                    return nil;
+                }
+                id value = [self readValue];
+                if (!value)
+                    return nil;
+                [dictionary setObject:value forKey:keyString];
+            }
+            return self.error ? nil : dictionary;
+        }
+        case '[':
+        {
+            NSMutableArray *array = [NSMutableArray array];
+            [self beginArray];
+            while ([self nextElement])
+            {
+                id value = [self readValue];
+                if (!value)
+                    return nil;
+                [array addObject:value];
+            }
+            return self.error ? nil : array;
+        }
+        case '"':
+            return [self readString];
+        case 't':
+        case 'f':
+            return [self readBool] ? (id)kCFBooleanTrue : (id)kCFBooleanFalse;
+        case 'n':
+            return [self readNull] ? [NSNull null] : nil;
+        case '-':
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+            return [self readNumber];
+        default:
+            [self failWithMessage:@"Unexpected character"];
+            return nil;
+    }
+}
+
+- (void) skipValue
+{
+    if (self.error)
+        return;
+    const uint8_t *ignoredBytes;
+    NSUInteger ignoredLength;
+    BOOL isInteger;
+    switch ([self peekByte])
+    {
+        case '{':
+            [self beginObject];
+            while ([self nextKey])
+                [self skipValue];
+            break;
+        case '[':
+            [self beginArray];
+            while ([self nextElement])
+                [self skipValue];
+            break;
+        case '"':
+            if ([self scanStringBytes:&ignoredBytes length:&ignoredLength])
+                [self valueEnded];
+            break;
+        case 't':
+            if ([self consumeLiteral:"true"])
+                [self valueEnded];
+            break;
+        case 'f':
+            if ([self consumeLiteral:"false"])
+                [self valueEnded];
+            break;
+        case 'n':
+            if ([self consumeLiteral:"null"])
+                [self valueEnded];
+            break;
+        default:
+            if ([self scanNumberIsInteger:&isInteger])
+                [self valueEnded];
+            break;
+    }
+}
+
+- (NSString *) peekStringForKey:(const char *)key inObjectForKey:(const char *)parentKey
+{
+    if (self.error || [self peekByte] != '{')
+        return nil;
+
+    NSUInteger savedPosition = position;
+    NSUInteger savedDepth = depth;
+    BOOL savedFirst = first;
+
+    NSString *string = nil;
+    const char *wanted = parentKey ?: key;
+    [self beginObject];
+    const char *next;
+    while ((next = [self nextKey]))
+    {
+        if (strcmp(next, wanted) != 0)
+        {
+            [self skipValue];
+            continue;
+        }
+        if (parentKey)
+            string = [self peekStringForKey:key inObjectForKey:NULL];
+        else if ([self peekByte] == '"')
+            string = [self readString];
+        break;
+    }
+
+    // Anything wrong with the JSON will be found again when it is read for real.
+    position = savedPosition;
+    depth = savedDepth;
+    first = savedFirst;
+    self.error = nil;
+    return string;
+}
+
+- (BOOL) isAtEnd
+{
+    return !self.error && [self peekByte] == 0 && position == length;
+}
+
+@end
@@ -0,0 +1,91 @@
+//
+//  TCDJSONWriter.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/26/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+extern NSString* const TCDJSONWriterErrorDomain;
+
+/**
+ Writes compact JSON straight into a byte buffer.
+
+ The output follows NSJSONSerialization's compact form (including escaping "/" as "\/"), but dictionary keys are
+ written in sorted order, so the same object always encodes to the same bytes. Strings are copied into the buffer
+ in one pass and only re-scanned when they contain characters that need escaping; doubles are written with the
+ fewest digits that read back as the same value.
+
+ Only NSDictionary (with string keys), NSArray, NSString, NSNumber and NSNull can be written. Anything else, and
+ NaN or infinite numbers, fail with an error in TCDJSONWriterErrorDomain rather than writing something that isn't JSON.
+
+ Besides encoding whole Foundation objects, a writer can be driven a token at a time (see TCObject+TCDJSONCoding).
+ The writer keeps the first error it runs into; once it has one, what is in the buffer isn't valid JSON.
+ */
+@interface TCDJSONWriter : NSObject
+
+/**
+ Encodes an object as JSON.
+
+ @param object  The object to encode.
+ @param error   Set if the object (or something inside it) can't be written as JSON.
+ @return        The JSON bytes, or nil on error.
+ */
++ (NSData *) dataWithJSONObject:(id)object error:(NSError **)error;
+
+/**
+ Encodes an object as JSON onto the end of a buffer.
+
+ @param object  The object to encode.
+ @param data    The buffer to append to. On error it is left as it was.
+ @param error   Set if the object can't be written as JSON.
+ @return        YES if the object was written.
+ */
++ (BOOL) appendJSONObject:(id)object toData:(NSMutableData *)data error:(NSError **)error;
+
+/**
+ Creates a writer that appends to a buffer.
+ */
+- (id) initWithData:(NSMutableData *)data;
+
+/**
+ The buffer being written to.
+ */
+@property (nonatomic, strong, readonly) NSMutableData *data;
+
+/**
+ The first error the writer ran into, or nil.
+ */
+@property (nonatomic, strong, readonly) NSError *error;
+
+- (void) beginObject;
+- (void) endObject;
+
+/**
+ Writes an object key. Keys are written as they are, so they must not need escaping.
+ Callers writing objects a key at a time are responsible for giving keys in sorted order.
+ */
+- (void) writeKey:(const char *)key;
+
+- (void) beginArray;
+- (void) endArray;
+
+- (void) writeString:(NSString *)string;
+- (void) writeNumber:(NSNumber *)number;
+- (void) writeInteger:(long long)value;
+- (void) writeBool:(BOOL)value;
+- (void) writeNull;
+
+/**
+ Writes a Foundation object (dictionary, array, string, number or null) and everything in it.
+ */
+- (void) writeJSONObject:(id)object;
+
+/**
+ Records an error (if there isn't one already); used by callers that find something they can't write.
+ */
+- (void) failWithMessage:(NSString *)message;
+
+@end
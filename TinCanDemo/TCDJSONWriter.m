@@ -0,0 +1,392 @@
+//
+//  TCDJSONWriter.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/26/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDJSONWriter.h"
+
+NSString* const TCDJSONWriterErrorDomain = @"TCDJSONWriterErrorDomain";
+
+/**
+ The escape sequence for an ASCII byte, or NULL if it's written as it is. unicode must have room for 7 bytes.
+ */
+static const char *TCDEscapeForByte(uint8_t c, char *unicode)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    switch (c)
+    {
+        case '"':  return "\\\"";
+        case '\\': return "\\\\";
+        case '/':  return "\\/";
+        case '\b': return "\\b";
+        case '\f': return "\\f";
+        case '\n': return "\\n";
+        case '\r': return "\\r";
+        case '\t': return "\\t";
+        default:
+            if (c >= 0x20)
+                return NULL;
+            unicode[0] = '\\'; unicode[1] = 'u'; unicode[2] = '0'; unicode[3] = '0';
+            unicode[4] = hex[c >> 4]; unicode[5] = hex[c & 0xF]; unicode[6] = '\0';
+            return unicode;
+    }
+}
+
+/**
+ Writes a string a character at a time. Only used for strings that can't be converted to UTF-8 in one go,
+ which means they hold a lone surrogate; that is written as a \u escape, as NSJSONSerialization would read it.
+ */
+static void TCDAppendStringByCharacter(NSString *string, NSMutableData *data)
+{
+    [data appendBytes:"\"" length:1];
+    NSUInteger length = string.length;
+    for (NSUInteger i = 0; i < length; i++)
+    {
+        unichar c = [string characterAtIndex:i];
+        uint8_t bytes[4];
+        char unicode[7];
+        if (c < 0x80)
+        {
+            const char *escape = TCDEscapeForByte((uint8_t)c, unicode);
+            if (escape)
+            {
+                [data appendBytes:escape length:strlen(escape)];
+            }
+            else
+            {
+                bytes[0] = (uint8_t)c;
+                [data appendBytes:bytes length:1];
+            }
+        }
+        else if (c < 0x800)
+        {
+            bytes[0] = 0xC0 | (c >> 6);
+            bytes[1] = 0x80 | (c & 0x3F);
+            [data appendBytes:bytes length:2];
+        }
+        else if (CFStringIsSurrogateHighCharacter(c) && i + 1 < length && CFStringIsSurrogateLowCharacter([string characterAtIndex:i + 1]))
+        {
+            UTF32Char codePoint = CFStringGetLongCharacterForSurrogatePair(c, [string characterAtIndex:i + 1]);
+            bytes[0] = 0xF0 | (codePoint >> 18);
+            bytes[1] = 0x80 | ((codePoint >> 12) & 0x3F);
+            bytes[2] = 0x80 | ((codePoint >> 6) & 0x3F);
+            bytes[3] = 0x80 | (codePoint & 0x3F);
+            [data appendBytes:bytes length:4];
+            i++;
+        }
+        else if (CFStringIsSurrogateHighCharacter(c) || CFStringIsSurrogateLowCharacter(c))
+        {
+            char escape[7];
+            snprintf(escape, sizeof(escape), "\\u%04x", c);
+            [data appendBytes:escape length:6];
+        }
+        else
+        {
+            bytes[0] = 0xE0 | (c >> 12);
+            bytes[1] = 0x80 | ((c >> 6) & 0x3F);
+            bytes[2] = 0x80 | (c & 0x3F);
+            [data appendBytes:bytes length:3];
+        }
+    }
+    [data appendBytes:"\"" length:1];
+}
+
+static void TCDAppendString(NSString *string, NSMutableData *data)
+{
+    NSUInteger maxLength = [string maximumLengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    NSUInteger start = data.length;
+    // Room for both quotes; escapes grow the buffer below.
+    [data setLength:start + maxLength + 2];
+    uint8_t *bytes = (uint8_t *)data.mutableBytes + start;
+
+    NSUInteger used = 0;
+    NSRange remaining = NSMakeRange(0, 0);
+    BOOL converted = [string getBytes:bytes + 1 maxLength:maxLength usedLength:&used encoding:NSUTF8StringEncoding
+                              options:0 range:NSMakeRange(0, string.length) remainingRange:&remaining];
+    if (!converted || remaining.length > 0)
+    {
+        [data setLength:start];
+        TCDAppendStringByCharacter(string, data);
+        return;
+    }
+
+    BOOL needsEscaping = NO;
+    for (NSUInteger i = 1; i <= used; i++)
+    {
+        uint8_t c = bytes[i];
+        if (c < 0x20 || c == '"' || c == '\\' || c == '/')
+        {
+            needsEscaping = YES;
+            break;
+        }
+    }
+
+    if (!needsEscaping)
+    {
+        bytes[0] = '"';
+        bytes[used + 1] = '"';
+        [data setLength:start + used + 2];
+        return;
+    }
+
+    NSData *raw = [NSData dataWithBytes:bytes + 1 length:used];
+    [data setLength:start];
+    const uint8_t *in = raw.bytes;
+    [data appendBytes:"\"" length:1];
+    NSUInteger runStart = 0;
+    for (NSUInteger i = 0; i < used; i++)
+    {
+        char unicode[7];
+        const char *escape = TCDEscapeForByte(in[i], unicode);
+        if (!escape)
+            continue;
+
+        [data appendBytes:in + runStart length:i - runStart];
+        [data appendBytes:escape length:strlen(escape)];
+        runStart = i + 1;
+    }
+    [data appendBytes:in + runStart length:used - runStart];
+    [data appendBytes:"\"" length:1];
+}
+
+/**
+ Formats a double with the fewest significant digits (15 to 17) that read back as the same value.
+ Fifteen digits are always enough for a value that has a shorter form, and %g drops the trailing zeros.
+ */
+static int TCDFormatDouble(double value, char *buffer, size_t size)
+{
+    for (int precision = 15; precision < 17; precision++)
+    {
+        int length = snprintf(buffer, size, "%.*g", precision, value);
+        if (strtod(buffer, NULL) == value)
+            return length;
+    }
+    return snprintf(buffer, size, "%.17g", value);
+}
+
+/**
+ The same for a float, so 0.1f is written as 0.1 rather than the digits of the double it widens to.
+ */
+static int TCDFormatFloat(float value, char *buffer, size_t size)
+{
+    for (int precision = 6; precision < 9; precision++)
+    {
+        int length = snprintf(buffer, size, "%.*g", precision, value);
+        if (strtof(buffer, NULL) == value)
+            return length;
+    }
+    return snprintf(buffer, size, "%.9g", value);
+}
+
+@interface TCDJSONWriter ()
+@property (nonatomic, strong, readwrite) NSError *error;
+@end
+
+@implementation TCDJSONWriter
+{
+    // YES once a value has been written at the current level, so the next key or element needs a comma.
+    BOOL needsComma;
+}
+
++ (NSData *) dataWithJSONObject:(id)object error:(NSError **)error
+{
+    NSMutableData *data = [NSMutableData dataWithCapacity:1024];
+    if (![self appendJSONObject:object toData:data error:error])
+        return nil;
+    return data;
+}
+
++ (BOOL) appendJSONObject:(id)object toData:(NSMutableData *)data error:(NSError **)error
+{
+    NSUInteger start = data.length;
+    TCDJSONWriter *writer = [[TCDJSONWriter alloc] initWithData:data];
+    [writer writeJSONObject:object];
+    if (writer.error)
+    {
+        [data setLength:start];
+        if (error)
+            *error = writer.error;
+        return NO;
+    }
+    return YES;
+}
+
+- (id) initWithData:(NSMutableData *)data
+{
+    if ((self = [super init]))
+    {
+        _data = data;
+    }
+    return self;
+}
+
+- (void) failWithMessage:(NSString *)message
+{
+    if (!self.error)
+        self.error = [NSError errorWithDomain:TCDJSONWriterErrorDomain code:1
+                                     userInfo:@{ NSLocalizedDescriptionKey : message }];
+}
+
+- (void) beginValue
+{
+    if (needsComma)
+        [_data appendBytes:"," length:1];
+    needsComma = YES;
+}
+
+- (void) beginObject
+{
+    [self beginValue];
+    [_data appendBytes:"{" length:1];
+    needsComma = NO;
+}
+
+- (void) endObject
+{
+    [_data appendBytes:"}" length:1];
+    needsComma = YES;
+}
+
+- (void) writeKey:(const char *)key
+{
+    if (needsComma)
+        [_data appendBytes:"," length:1];
+    [_data appendBytes:"\"" length:1];
+    [_data appendBytes:key length:strlen(key)];
+    [_data appendBytes:"\":" length:2];
+    needsComma = NO;
+}
+
+- (void) beginArray
+{
+    [self beginValue];
+    [_data appendBytes:"[" length:1];
+    needsComma = NO;
+}
+
+- (void) endArray
+{
+    [_data appendBytes:"]" length:1];
+    needsComma = YES;
+}
+
+- (void) writeString:(NSString *)string
+{
+    [self beginValue];
+    TCDAppendString(string, _data);
+}
+
+- (void) writeNumber:(NSNumber *)number
+{
+    if ((__bridge CFBooleanRef)number == kCFBooleanTrue || (__bridge CFBooleanRef)number == kCFBooleanFalse)
+    {
+        [self writeBool:[number boolValue]];
+        return;
+    }
+
+    char buffer[32];
+    int length;
+    const char *type = [number objCType];
+    if (strcmp(type, @encode(double)) == 0 || strcmp(type, @encode(float)) == 0)
+    {
+        double value = [number doubleValue];
+        if (isnan(value) || isinf(value))
+        {
+            [self failWithMessage:@"NaN and infinite numbers can't be written as JSON"];
+            return;
+        }
+        if (strcmp(type, @encode(float)) == 0)
+            length = TCDFormatFloat([number floatValue], buffer, sizeof(buffer));
+        else
+            length = TCDFormatDouble(value, buffer, sizeof(buffer));
+    }
+    else if (strcmp(type, @encode(unsigned long long)) == 0)
+    {
+        length = snprintf(buffer, sizeof(buffer), "%llu", [number unsignedLongLongValue]);
+    }
+    else
+    {
+        length = snprintf(buffer, sizeof(buffer), "%lld", [number longLongValue]);
+    }
+    [self beginValue];
+    [_data appendBytes:buffer length:(NSUInteger)length];
+}
+
+- (void) writeInteger:(long long)value
+{
+    char buffer[32];
+    int length = snprintf(buffer, sizeof(buffer), "%lld", value);
+    [self beginValue];
+    [_data appendBytes:buffer length:(NSUInteger)length];
+}
+
+- (void) writeBool:(BOOL)value
+{
+    [self beginValue];
+    if (value)
+        [_data appendBytes:"true" length:4];
+    else
+        [_data appendBytes:"false" length:5];
+}
+
+- (void) writeNull
+{
+    [self beginValue];
+    [_data appendBytes:"null" length:4];
+}
+
+- (void) writeJSONObject:(id)object
+{
+    if (self.error)
+        return;
+
+    if ([object isKindOfClass:[NSString class]])
+    {
+        [self writeString:object];
+    }
+    else if ([object isKindOfClass:[NSNumber class]])
+    {
+        [self writeNumber:object];
+    }
+    else if ([object isKindOfClass:[NSDictionary class]])
+    {
+        NSArray *keys = [[object allKeys] sortedArrayUsingSelector:@selector(compare:)];
+        [self beginObject];
+        for (id key in keys)
+        {
+            if (![key isKindOfClass:[NSString class]])
+            {
+                [self failWithMessage:[NSString stringWithFormat:@"Dictionary keys must be strings to be written as JSON, not %@", [key class]]];
+                return;
+            }
+            if (needsComma)
+                [_data appendBytes:"," length:1];
+            TCDAppendString(key, _data);
+            [_data appendBytes:":" length:1];
+            needsComma = NO;
+            [self writeJSONObject:[object objectForKey:key]];
+        }
+        [self endObject];
+    }
+    else if ([object isKindOfClass:[NSArray class]])
+    {
+        [self beginArray];
+        for (id element in object)
+            [self writeJSONObject:element];
+        [self endArray];
+    }
+    else if (!object || object == [NSNull null])
+    {
+        [self writeNull];
+    }
+    else
+    {
+        [self failWithMessage:[NSString stringWithFormat:@"%@ can't be written as JSON", [object class]]];
+    }
+}
+
+@end
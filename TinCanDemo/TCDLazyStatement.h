@@ -0,0 +1,61 @@
+//
+//  TCDLazyStatement.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/19/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class TCStatement;
+
+/**
+ Stands in for a TCStatement restored from a memory-mapped statement log.
+
+ Only the statement id and the location of its JSON in the mapped segment are kept until the statement is
+ actually used. The id, the queue bookkeeping flags (sentToLRS and persistedOnLRS), estimatedJSONLength, and
+ encodedJSONData (the stored JSON itself) are answered without inflating anything, so a statement queue can restore, count,
+ and pack batches of lazy statements for free. When the log stored lane attributes with the statement, laneVerb,
+ laneActivityType, and queuedDate (see TCStatement+TCDLaneAttributes) are answered from those as well.
+ Any other message inflates the full TCStatement once and is forwarded to it.
+ */
+@interface TCDLazyStatement : NSProxy
+
+/**
+ The id of the statement (available without inflating the statement).
+ */
+@property (nonatomic, strong, readonly) NSString *sid;
+
+/**
+ YES once the full TCStatement has been created.
+ */
+@property (nonatomic, readonly) BOOL isInflated;
+
+/**
+ The full statement. Inflates it from the mapped JSON on first access.
+ */
+@property (nonatomic, strong, readonly) TCStatement *statement;
+
+/**
+ Initializes a lazy statement.
+
+ @param aSid            The statement id.
+ @param aSegmentData    The memory-mapped segment containing the statement JSON.
+ @param aRange          The range of the statement JSON within the segment.
+ @return                The initialized lazy statement.
+ */
+- (id) initWithSid:(NSString *)aSid segmentData:(NSData *)aSegmentData range:(NSRange)aRange;
+
+/**
+ Initializes a lazy statement whose lane attributes were stored with it.
+
+ @param aSid                    The statement id.
+ @param aSegmentData            The memory-mapped segment containing the statement JSON.
+ @param aRange                  The range of the statement JSON within the segment.
+ @param aLaneAttributesRange    The range of the statement's laneAttributesData within the segment (length 0 if none).
+ @return                        The initialized lazy statement.
+ */
+- (id) initWithSid:(NSString *)aSid segmentData:(NSData *)aSegmentData range:(NSRange)aRange laneAttributesRange:(NSRange)aLaneAttributesRange;
+
+@end
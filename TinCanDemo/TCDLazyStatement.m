@@ -0,0 +1,265 @@
+//
+//  TCDLazyStatement.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/19/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDLazyStatement.h"
+#import "TCStatement+TCDQueueState.h"
+#import "TCStatement+TCDSizeEstimate.h"
+#import "TCStatement+TCDJSONEncoding.h"
+#import "TCStatement+TCDLaneAttributes.h"
+
+@implementation TCDLazyStatement
+{
+    NSString *_sid;
+    NSData *segmentData;
+    NSRange range;
+    TCStatement *inflated;
+    BOOL sentToLRS;
+    BOOL persistedOnLRS;
+    // The lane attributes stored with the statement, if there were any.
+    BOOL hasLaneAttributes;
+    NSString *laneVerb;
+    NSUInteger laneActivityType;
+    NSDate *queuedDate;
+}
+
+- (id) initWithSid:(NSString *)aSid segmentData:(NSData *)aSegmentData range:(NSRange)aRange
+{
+    return [self initWithSid:aSid segmentData:aSegmentData range:aRange laneAttributesRange:NSMakeRange(0, 0)];
+}
+
+- (id) initWithSid:(NSString *)aSid segmentData:(NSData *)aSegmentData range:(NSRange)aRange laneAttributesRange:(NSRange)aLaneAttributesRange
+{
+    _sid = aSid;
+    segmentData = aSegmentData;
+    range = aRange;
+    if (aLaneAttributesRange.length > 0)
+    {
+        NSString *verb = nil;
+        NSDate *date = nil;
+        hasLaneAttributes = [TCStatement getLaneVerb:&verb activityType:&laneActivityType queuedDate:&date
+                                           fromBytes:(const uint8_t *)aSegmentData.bytes + aLaneAttributesRange.location
+                                              length:aLaneAttributesRange.length];
+        laneVerb = verb;
+        queuedDate = date;
+    }
+    return self;
+}
+
+- (NSString *) sid
+{
+    @synchronized(self)
+    {
+        return inflated ? inflated.sid : _sid;
+    }
+}
+
+- (BOOL) isInflated
+{
+    @synchronized(self)
+    {
+        return inflated != nil;
+    }
+}
+
+- (TCStatement *) statement
+{
+    @synchronized(self)
+    {
+        if (!inflated)
+        {
+            NSError *error = nil;
+            inflated = [TCStatement statementWithJSONBytes:(const uint8_t *)segmentData.bytes + range.location
+                                                    length:range.length error:&error];
+            if (!inflated)
+            {
+                NSLog(@"Unable to read restored statement %@: %@", _sid, error);
+                inflated = [[TCStatement alloc] init];
+            }
+            if (inflated.sid.length == 0)
+                [inflated setSid:_sid];
+            inflated.sentToLRS = sentToLRS;
+            inflated.persistedOnLRS = persistedOnLRS;
+            if (queuedDate)
+                inflated.queuedDate = queuedDate;
+            segmentData = nil;
+        }
+        return inflated;
+    }
+}
+
+#pragma mark - Queue bookkeeping (answered without inflating)
+
+- (BOOL) sentToLRS
+{
+    @synchronized(self)
+    {
+        return inflated ? inflated.sentToLRS : sentToLRS;
+    }
+}
+
+- (void) setSentToLRS:(BOOL)flag
+{
+    @synchronized(self)
+    {
+        sentToLRS = flag;
+        inflated.sentToLRS = flag;
+    }
+}
+
+- (BOOL) persistedOnLRS
+{
+    @synchronized(self)
+    {
+        return inflated ? inflated.persistedOnLRS : persistedOnLRS;
+    }
+}
+
+- (void) setPersistedOnLRS:(BOOL)flag
+{
+    @synchronized(self)
+    {
+        persistedOnLRS = flag;
+        inflated.persistedOnLRS = flag;
+    }
+}
+
+#pragma mark - Lane attributes (answered without inflating when they were stored)
+
+- (NSString *) laneVerb
+{
+    @synchronized(self)
+    {
+        if (!inflated && hasLaneAttributes)
+            return laneVerb;
+    }
+    return self.statement.laneVerb;
+}
+
+- (NSUInteger) laneActivityType
+{
+    @synchronized(self)
+    {
+        if (!inflated && hasLaneAttributes)
+            return laneActivityType;
+    }
+    return self.statement.laneActivityType;
+}
+
+- (NSDate *) queuedDate
+{
+    @synchronized(self)
+    {
+        return inflated ? inflated.queuedDate : queuedDate;
+    }
+}
+
+- (void) setQueuedDate:(NSDate *)date
+{
+    @synchronized(self)
+    {
+        queuedDate = date;
+        inflated.queuedDate = date;
+    }
+}
+
+- (NSData *) laneAttributesData
+{
+    @synchronized(self)
+    {
+        if (!inflated && hasLaneAttributes)
+            return [TCStatement laneAttributesDataWithVerb:laneVerb activityType:laneActivityType queuedDate:queuedDate];
+    }
+    return self.statement.laneAttributesData;
+}
+
+#pragma mark - Size and encoding (answered without inflating)
+
+- (NSUInteger) estimatedJSONLength
+{
+    @synchronized(self)
+    {
+        // Until the statement is inflated the stored JSON is exactly what would be sent.
+        return inflated ? inflated.estimatedJSONLength : range.length;
+    }
+}
+
+- (NSData *) encodedJSONData
+{
+    @synchronized(self)
+    {
+        if (inflated)
+            return inflated.encodedJSONData;
+        return [segmentData subdataWithRange:range];
+    }
+}
+
+- (BOOL) hasEncodedJSONData
+{
+    @synchronized(self)
+    {
+        return inflated ? inflated.hasEncodedJSONData : YES;
+    }
+}
+
+#pragma mark - Identity
+
+- (BOOL) isKindOfClass:(Class)aClass
+{
+    return [TCStatement isSubclassOfClass:aClass] || [[self class] isSubclassOfClass:aClass];
+}
+
+- (BOOL) isMemberOfClass:(Class)aClass
+{
+    return aClass == [TCStatement class] || aClass == [self class];
+}
+
+- (BOOL) respondsToSelector:(SEL)aSelector
+{
+    return [TCStatement instancesRespondToSelector:aSelector] || [[self class] instancesRespondToSelector:aSelector];
+}
+
+- (BOOL) conformsToProtocol:(Protocol *)aProtocol
+{
+    return [TCStatement conformsToProtocol:aProtocol];
+}
+
+- (NSUInteger) hash
+{
+    return (NSUInteger)self;
+}
+
+- (BOOL) isEqual:(id)object
+{
+    return object == self;
+}
+
+- (NSString *) description
+{
+    if (self.isInflated)
+        return [self.statement description];
+    return [NSString stringWithFormat:@"<%@: %@ (not inflated)>", NSStringFromClass([self class]), _sid];
+}
+
+#pragma mark - Forwarding
+
+- (id) forwardingTargetForSelector:(SEL)aSelector
+{
+    return self.statement;
+}
+
+- (NSMethodSignature *) methodSignatureForSelector:(SEL)aSelector
+{
+    return [TCStatement instanceMethodSignatureForSelector:aSelector];
+}
+
+- (void) forwardInvocation:(NSInvocation *)invocation
+{
+    [invocation invokeWithTarget:self.statement];
+}
+
+@end
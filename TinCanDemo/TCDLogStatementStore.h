@@ -0,0 +1,51 @@
+//
+//  TCDLogStatementStore.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/2/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "TCDStatementStore.h"
+#import "TCDStatementLog.h"
+
+/**
+ A TCDStatementStore kept in a TCDStatementLog: each statement is a record of its JSON keyed by statement id.
+ Statements are read back lazily (see TCDLazyStatement), so enumerating the store only parses the statements that are used.
+ */
+@interface TCDLogStatementStore : NSObject <TCDStatementStore>
+
+/**
+ The log holding the statements.
+ */
+@property (nonatomic, strong, readonly) TCDStatementLog *log;
+
+/**
+ Creates a store in Documents/tcStatementStore.
+ */
+- (id) init;
+
+/**
+ Designated initializer. Opens (or creates) the log in the directory.
+ */
+- (id) initWithDirectory:(NSString *)directory;
+
+/**
+ Stores statements like upsertStatements:insertedCount:error:, keeping a metadata blob (see TCDStatementLog)
+ with each one.
+
+ @param statements      The statements to store.
+ @param metadata        NSData (at most 64KB; NSNull for none) for each statement, matching the statements array.
+ @param insertedCount   If not NULL, returns how many of the statements weren't already stored.
+ @param error           Returns any error encountered while storing the statements.
+ @return                YES if the statements were stored.
+ */
+- (BOOL) upsertStatements:(NSArray *)statements metadata:(NSArray *)metadata insertedCount:(NSUInteger *)insertedCount error:(NSError **)error;
+
+/**
+ Deletes every stored statement.
+ */
+- (BOOL) removeAllStatementsWithError:(NSError **)error;
+
+@end
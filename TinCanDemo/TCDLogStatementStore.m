@@ -0,0 +1,105 @@
+//
+//  TCDLogStatementStore.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/2/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDLogStatementStore.h"
+#import "TCDLazyStatement.h"
+#import "TCStatement+TCDJSONEncoding.h"
+
+static NSString* const kTCDDefaultStoreDirectory = @"tcStatementStore";
+
+@interface TCDLogStatementStore ()
+@property (nonatomic, strong, readwrite) TCDStatementLog *log;
+@end
+
+@implementation TCDLogStatementStore
+
+- (id) init
+{
+    NSString *documents = [NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES) objectAtIndex:0];
+    return [self initWithDirectory:[documents stringByAppendingPathComponent:kTCDDefaultStoreDirectory]];
+}
+
+- (id) initWithDirectory:(NSString *)directory
+{
+    if ((self = [super init]))
+    {
+        self.log = [[TCDStatementLog alloc] initWithDirectory:directory];
+
+        NSError *error = nil;
+        if (![self.log openWithError:&error])
+            NSLog(@"Unable to open the statement store at %@: %@", directory, error);
+    }
+    return self;
+}
+
+- (NSUInteger) count
+{
+    return self.log.count;
+}
+
+- (BOOL) upsertStatements:(NSArray *)statements insertedCount:(NSUInteger *)insertedCount error:(NSError **)error
+{
+    return [self upsertStatements:statements metadata:nil insertedCount:insertedCount error:error];
+}
+
+- (BOOL) upsertStatements:(NSArray *)statements metadata:(NSArray *)metadata insertedCount:(NSUInteger *)insertedCount error:(NSError **)error
+{
+    NSMutableArray *keys = [NSMutableArray arrayWithCapacity:statements.count];
+    NSMutableArray *payloads = [NSMutableArray arrayWithCapacity:statements.count];
+    NSMutableArray *recordMetadata = metadata ? [NSMutableArray arrayWithCapacity:statements.count] : nil;
+    NSMutableSet *inserted = [NSMutableSet set];
+    for (NSUInteger i = 0; i < statements.count; i++)
+    {
+        TCStatement *statement = [statements objectAtIndex:i];
+        NSString *sid = statement.sid;
+        // Statements are immutable once stored by the LRS, so a stored id is never written again.
+        if (sid.length == 0 || [inserted containsObject:sid] || [self.log containsKey:sid])
+            continue;
+        NSData *payload = statement.encodedJSONData;
+        if (!payload)
+            continue;
+
+        [inserted addObject:sid];
+        [keys addObject:sid];
+        [payloads addObject:payload];
+        [recordMetadata addObject:[metadata objectAtIndex:i]];
+    }
+
+    if (insertedCount)
+        *insertedCount = inserted.count;
+    if (keys.count == 0)
+        return YES;
+    return [self.log appendPayloads:payloads metadata:recordMetadata forKeys:keys error:error];
+}
+
+- (BOOL) containsStatementWithId:(NSString *)sid
+{
+    return sid && [self.log containsKey:sid];
+}
+
+- (TCStatement *) statementWithId:(NSString *)sid
+{
+    NSData *payload = sid ? [self.log payloadForKey:sid] : nil;
+    if (!payload)
+        return nil;
+    return (TCStatement *)[[TCDLazyStatement alloc] initWithSid:sid segmentData:payload range:NSMakeRange(0, payload.length)];
+}
+
+- (void) enumerateStatementsUsingBlock:(void (^)(TCStatement *, BOOL *))block
+{
+    [self.log enumerateMappedRecordsUsingBlock:^(NSString *key, NSData *segmentData, NSRange payloadRange, BOOL *stop) {
+        block((TCStatement *)[[TCDLazyStatement alloc] initWithSid:key segmentData:segmentData range:payloadRange], stop);
+    }];
+}
+
+- (BOOL) removeAllStatementsWithError:(NSError **)error
+{
+    return [self.log removeAllRecordsWithError:error];
+}
+
+@end
@@ -0,0 +1,83 @@
+//
+//  TCDParallelStatementQuery.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/1/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class TCAPI, TCStatement, TCStatementQuery;
+
+/**
+ Retrieves the statements for a query with both since and until set by splitting the time range into windows
+ and walking several windows at once.
+
+ Each window is its own TCDStatementCursor, so pages from different windows download in parallel (at most
+ maxConcurrentWindows at a time) while pages within a window still follow their "more" links in turn. Statements
+ are handed out in the order one query would return them--newest stored first--by reading the windows newest first;
+ the windows behind the one being read prefetch up to two pages each and then wait. A statement stored right on
+ a window boundary can be returned by both windows (and an LRS may return one twice across its own pages), so the
+ id of every statement handed out is kept for the rest of the walk and any repeat is dropped.
+
+ The windows are requested without the query's limit; it caps the statements handed out overall instead.
+
+ A query without since and until is walked as a single window. Use from the main thread, and keep a reference
+ to the query until it completes.
+ */
+@interface TCDParallelStatementQuery : NSObject
+
+/**
+ The query being retrieved.
+ */
+@property (nonatomic, strong, readonly) TCStatementQuery *query;
+
+/**
+ Number of windows the time range is split into (default=4).
+ */
+@property (nonatomic, readwrite) NSUInteger numberOfWindows;
+
+/**
+ The most windows retrieved at once (default=2).
+ */
+@property (nonatomic, readwrite) NSUInteger maxConcurrentWindows;
+
+/**
+ Number of statements returned so far.
+ */
+@property (nonatomic, readonly) NSUInteger numberOfStatements;
+
+/**
+ Number of duplicate statements dropped so far.
+ */
+@property (nonatomic, readonly) NSUInteger numberOfDuplicates;
+
+/**
+ Designated initializer.
+ */
+- (id) initWithQuery:(TCStatementQuery *)aQuery api:(TCAPI *)aAPI;
+
+/**
+ Splits a query's since-until range into equal windows.
+
+ @param query   The query to split.
+ @param count   The number of windows.
+ @return        Queries for the windows, newest first and without a limit (just a copy of the query if it can't be split).
+ */
++ (NSArray *) windowQueriesForQuery:(TCStatementQuery *)query count:(NSUInteger)count;
+
+/**
+ Starts retrieving statements.
+
+ @param block       Called with each statement, newest stored first. Set stop to YES to cancel.
+ @param completion  Called once, when every window is finished (error is nil), one fails, or the block stops.
+ */
+- (void) enumerateStatementsUsingBlock:(void (^)(TCStatement *statement, BOOL *stop))block completion:(void (^)(NSError *error))completion;
+
+/**
+ Stops retrieving statements. The completion block isn't called.
+ */
+- (void) cancel;
+
+@end
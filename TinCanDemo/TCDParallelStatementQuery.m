@@ -0,0 +1,177 @@
+//
+//  TCDParallelStatementQuery.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/1/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDParallelStatementQuery.h"
+#import "TCDStatementCursor.h"
+#import "TCStatementQuery+TCDCopying.h"
+
+@interface TCDParallelStatementQuery () <TCDStatementCursorDelegate>
+@property (nonatomic, strong, readwrite) TCStatementQuery *query;
+@property (nonatomic, readwrite) NSUInteger numberOfStatements;
+@property (nonatomic, readwrite) NSUInteger numberOfDuplicates;
+@property (nonatomic, copy) void (^block)(TCStatement *, BOOL *);
+@property (nonatomic, copy) void (^completion)(NSError *);
+@end
+
+@implementation TCDParallelStatementQuery
+{
+    TCAPI *api;
+    NSMutableArray *pendingWindows;
+    // Started windows, newest first; the first one is being read.
+    NSMutableArray *cursors;
+    // Ids of the statements handed out so far.
+    NSMutableSet *emittedIds;
+    BOOL draining;
+}
+
+- (id) initWithQuery:(TCStatementQuery *)aQuery api:(TCAPI *)aAPI
+{
+    if ((self = [super init]))
+    {
+        self.query = aQuery;
+        api = aAPI;
+        self.numberOfWindows = 4;
+        self.maxConcurrentWindows = 2;
+    }
+    return self;
+}
+
++ (NSArray *) windowQueriesForQuery:(TCStatementQuery *)query count:(NSUInteger)count
+{
+    NSTimeInterval range = [query.until timeIntervalSinceDate:query.since];
+    if (!query.since || !query.until || count < 2 || range <= 0)
+        return @[[query queryCopy]];
+
+    NSMutableArray *windows = [NSMutableArray arrayWithCapacity:count];
+    NSTimeInterval step = range / count;
+    for (NSUInteger i = count; i > 0; i--)
+    {
+        TCStatementQuery *window = [query queryCopy];
+        window.since = (i == 1) ? query.since : [query.since dateByAddingTimeInterval:step * (i - 1)];
+        window.until = (i == count) ? query.until : [query.since dateByAddingTimeInterval:step * i];
+        window.limit = 0;
+        [windows addObject:window];
+    }
+    return windows;
+}
+
+- (void) enumerateStatementsUsingBlock:(void (^)(TCStatement *, BOOL *))block completion:(void (^)(NSError *))completion
+{
+    self.block = block;
+    self.completion = completion;
+
+    NSArray *windows = [[self class] windowQueriesForQuery:self.query count:self.numberOfWindows];
+    pendingWindows = [windows mutableCopy];
+    cursors = [[NSMutableArray alloc] init];
+    emittedIds = [[NSMutableSet alloc] init];
+
+    [self startWindows];
+}
+
+- (void) cancel
+{
+    for (TCDStatementCursor *cursor in cursors)
+    {
+        cursor.delegate = nil;
+        [cursor cancel];
+    }
+    [cursors removeAllObjects];
+    [pendingWindows removeAllObjects];
+    self.block = nil;
+    self.completion = nil;
+}
+
+- (void) startWindows
+{
+    while (cursors.count < MAX(self.maxConcurrentWindows, 1) && pendingWindows.count > 0)
+    {
+        TCStatementQuery *window = [pendingWindows objectAtIndex:0];
+        [pendingWindows removeObjectAtIndex:0];
+
+        TCDStatementCursor *cursor = [[TCDStatementCursor alloc] initWithQuery:window api:api];
+        cursor.delegate = self;
+        [cursors addObject:cursor];
+        [cursor start];
+    }
+}
+
+- (void) complete:(NSError *)error
+{
+    void (^completion)(NSError *) = self.completion;
+    [self cancel];
+    if (completion)
+        completion(error);
+}
+
+- (void) drain
+{
+    // Delegate callbacks can arrive while the block is running; the outer call picks up where this one would.
+    if (draining || !self.block)
+        return;
+    draining = YES;
+
+    while (cursors.count > 0)
+    {
+        TCDStatementCursor *head = [cursors objectAtIndex:0];
+        TCStatement *statement = [head nextStatement];
+        if (!statement)
+        {
+            if (!head.isFinished)
+                break;
+            head.delegate = nil;
+            [cursors removeObjectAtIndex:0];
+            [self startWindows];
+            continue;
+        }
+
+        if (statement.sid)
+        {
+            if ([emittedIds containsObject:statement.sid])
+            {
+                self.numberOfDuplicates++;
+                continue;
+            }
+            [emittedIds addObject:statement.sid];
+        }
+
+        self.numberOfStatements++;
+        BOOL stop = NO;
+        self.block(statement, &stop);
+        if (self.query.limit > 0 && self.numberOfStatements >= (NSUInteger)self.query.limit)
+            stop = YES;
+        if (stop)
+        {
+            draining = NO;
+            [self complete:nil];
+            return;
+        }
+    }
+    draining = NO;
+
+    if (cursors.count == 0 && pendingWindows.count == 0 && self.completion)
+        [self complete:nil];
+}
+
+#pragma mark - TCDStatementCursorDelegate
+
+- (void) statementCursorHasStatementsAvailable:(TCDStatementCursor *)cursor
+{
+    [self drain];
+}
+
+- (void) statementCursorDidFinish:(TCDStatementCursor *)cursor
+{
+    [self drain];
+}
+
+- (void) statementCursor:(TCDStatementCursor *)cursor didFailWithError:(NSError *)error
+{
+    [self complete:error];
+}
+
+@end
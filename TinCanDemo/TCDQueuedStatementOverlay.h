@@ -0,0 +1,53 @@
+//
+//  TCDQueuedStatementOverlay.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/4/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <TinCan/TCAPIRequest.h>
+
+@class TCStatementQuery, TCStatementQueue, TCStatementsResult;
+
+/**
+ Merges statements that are still waiting in a statement queue into the result of a statement query,
+ so a reader sees its own writes without flushing the queue first.
+
+ When it's created the overlay takes the queued statements the LRS hasn't acknowledged and keeps those that
+ satisfy the query (see TCDStatementQueryMatcher). It then stands in as the delegate of the LRS request:
+ statementsReceived: passes on a result with the queued statements added in front of the LRS's statements,
+ most recently queued first, skipping any the LRS already returned. Every other delegate message is forwarded unchanged.
+
+ Only the first page is merged; a page can hold more than query.limit statements when queued statements are added.
+ */
+@interface TCDQueuedStatementOverlay : NSObject <TCAPIStatementRequestDelegate>
+
+/**
+ The delegate the merged result is passed to.
+ */
+@property (nonatomic, weak) id<TCAPIStatementRequestDelegate> delegate;
+
+/**
+ The queued statements that satisfy the query, most recently queued first.
+ */
+@property (nonatomic, strong, readonly) NSArray *queuedStatements;
+
+/**
+ Number of queued statements added to the last result (those the LRS hadn't returned).
+ */
+@property (nonatomic, readonly) NSUInteger mergedStatementCount;
+
+/**
+ Designated initializer. Takes the snapshot of matching queued statements.
+ */
+- (id) initWithQuery:(TCStatementQuery *)query statementQueue:(TCStatementQueue *)queue delegate:(id<TCAPIStatementRequestDelegate>)delegate;
+
+/**
+ A result holding the queued statements the LRS result doesn't contain, followed by the LRS result's statements.
+ The more URL is kept.
+ */
+- (TCStatementsResult *) resultByMergingResult:(TCStatementsResult *)result;
+
+@end
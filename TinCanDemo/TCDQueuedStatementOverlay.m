@@ -0,0 +1,111 @@
+//
+//  TCDQueuedStatementOverlay.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/4/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDQueuedStatementOverlay.h"
+#import "TCDStatementQueryMatcher.h"
+#import "TCDStatementAttributes.h"
+#import "TCDStatementQueue.h"
+#import "TCStatement+TCDQueueState.h"
+
+@interface TCDQueuedStatementOverlay ()
+@property (nonatomic, strong, readwrite) NSArray *queuedStatements;
+@property (nonatomic, readwrite) NSUInteger mergedStatementCount;
+@end
+
+@implementation TCDQueuedStatementOverlay
+
+/**
+ The attributes of a queued statement, read from its JSON once per statement id. A queued statement doesn't
+ change, so every overlay made while it is queued reuses them.
+ */
++ (TCDStatementAttributes *) attributesOfQueuedStatement:(TCStatement *)statement
+{
+    static NSCache *attributesBySid = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        attributesBySid = [[NSCache alloc] init];
+    });
+
+    NSString *sid = statement.sid;
+    TCDStatementAttributes *attributes = sid ? [attributesBySid objectForKey:sid] : nil;
+    if (!attributes)
+    {
+        attributes = [TCDStatementAttributes attributesOfStatement:statement];
+        if (sid)
+            [attributesBySid setObject:attributes forKey:sid];
+    }
+    return attributes;
+}
+
+- (id) initWithQuery:(TCStatementQuery *)query statementQueue:(TCStatementQueue *)queue delegate:(id<TCAPIStatementRequestDelegate>)delegate
+{
+    if ((self = [super init]))
+    {
+        self.delegate = delegate;
+
+        // Statements added from other threads may still be in the ingestion ring.
+        if ([queue isKindOfClass:[TCDStatementQueue class]])
+            [(TCDStatementQueue *)queue waitUntilStatementsAreQueued];
+
+        // The queue is oldest first. Statements are matched on attributes read from their stored JSON, so
+        // restored TCDLazyStatements aren't inflated just to be compared.
+        TCDStatementQueryMatcher *matcher = [[TCDStatementQueryMatcher alloc] initWithQuery:query];
+        NSMutableArray *matches = [NSMutableArray array];
+        for (TCStatement *statement in [[queue getQueuedStatements] reverseObjectEnumerator])
+        {
+            if (!statement.persistedOnLRS && [matcher matchesAttributes:[[self class] attributesOfQueuedStatement:statement]])
+                [matches addObject:statement];
+        }
+        self.queuedStatements = matches;
+    }
+    return self;
+}
+
+- (TCStatementsResult *) resultByMergingResult:(TCStatementsResult *)result
+{
+    NSMutableSet *returned = [NSMutableSet setWithCapacity:result.statements.count];
+    for (TCStatement *statement in result.statements)
+    {
+        if (statement.sid)
+            [returned addObject:statement.sid];
+    }
+
+    NSMutableArray *statements = [NSMutableArray arrayWithCapacity:self.queuedStatements.count + result.statements.count];
+    for (TCStatement *statement in self.queuedStatements)
+    {
+        if (![returned containsObject:statement.sid])
+            [statements addObject:statement];
+    }
+    self.mergedStatementCount = statements.count;
+    if (self.mergedStatementCount == 0)
+        return result;
+
+    [statements addObjectsFromArray:result.statements];
+    return [[TCStatementsResult alloc] initWithStatements:statements andMoreURI:result.more];
+}
+
+#pragma mark - TCAPIStatementRequestDelegate
+
+- (void) statementsReceived:(TCStatementsResult *)result
+{
+    id<TCAPIStatementRequestDelegate> delegate = self.delegate;
+    if ([delegate respondsToSelector:@selector(statementsReceived:)])
+        [delegate statementsReceived:[self resultByMergingResult:result]];
+}
+
+- (BOOL) respondsToSelector:(SEL)aSelector
+{
+    return [super respondsToSelector:aSelector] || [self.delegate respondsToSelector:aSelector];
+}
+
+- (id) forwardingTargetForSelector:(SEL)aSelector
+{
+    return self.delegate;
+}
+
+@end
@@ -0,0 +1,38 @@
+//
+//  TCDRequestFilter.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/24/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class TCAPIRequest;
+
+/**
+ A step in a TCDRequestPipeline. Filters see every request just before its connection is created.
+ */
+@protocol TCDRequestFilter <NSObject>
+@required
+
+/**
+ Modifies a request that is about to start.
+ Headers can be set on the request itself; anything else can be changed through its URLRequest (see TCAPIRequest+TCDURLRequest.h).
+
+ @param request The request to modify.
+ */
+- (void) filterRequest:(TCAPIRequest *)request;
+
+@optional
+
+/**
+ Modifies a request once its class has finished preparing it. filterRequest: runs during -[TCAPIRequest prepareRequest],
+ before subclasses such as TCAPIStoreStatementsRequest set their body; filters that need the body (e.g. to compress it)
+ work on it here instead.
+
+ @param request The prepared request, about to be sent.
+ */
+- (void) filterPreparedRequest:(TCAPIRequest *)request;
+
+@end
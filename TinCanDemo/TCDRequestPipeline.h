@@ -0,0 +1,60 @@
+//
+//  TCDRequestPipeline.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/24/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <TinCan/TCAPIRequest.h>
+#import "TCDRequestFilter.h"
+
+/**
+ Pluggable request filters under TCAPIRequest.
+
+ TCAPIRequest creates its own NSURLConnection, and the only hook it offers before doing so is its authorization
+ provider's configureRequest:. The pipeline is installed as TCAPI's authorizationProvider: it lets the real
+ provider add credentials, then passes the request through each filter in order. Filters shape the request;
+ the connection it is sent on is still opened (and kept alive or not) by the system's URL loading.
+
+ That happens inside -[TCAPIRequest prepareRequest], before a subclass has set the request body. Every prepareRequest
+ implementation is therefore wrapped so that, once the outermost one returns, the request is passed through the filters'
+ filterPreparedRequest: as well.
+ */
+@interface TCDRequestPipeline : NSObject <TCAPIAuthenticationProvider>
+
+/**
+ The provider that adds credentials to each request (e.g. TCBasicHTTPAuthentication).
+ */
+@property (nonatomic, strong, readonly) id<TCAPIAuthenticationProvider> authenticationProvider;
+
+/**
+ The filters requests pass through, in order.
+ */
+@property (nonatomic, copy, readonly) NSArray *filters;
+
+/**
+ Designated initializer.
+
+ @param aProvider   The provider that adds credentials to each request (may be nil).
+ */
+- (id) initWithAuthenticationProvider:(id<TCAPIAuthenticationProvider>)aProvider;
+
+/**
+ Adds a filter to the end of the pipeline.
+ */
+- (void) addFilter:(id<TCDRequestFilter>)filter;
+
+/**
+ Removes a filter from the pipeline.
+ */
+- (void) removeFilter:(id<TCDRequestFilter>)filter;
+
+/**
+ Passes a fully prepared request through the filters that implement filterPreparedRequest:.
+ Called automatically for requests whose authorization provider is the pipeline.
+ */
+- (void) filterPreparedRequest:(TCAPIRequest *)request;
+
+@end
@@ -0,0 +1,124 @@
+//
+//  TCDRequestPipeline.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/24/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDRequestPipeline.h"
+#import <objc/runtime.h>
+
+static char kTCDPrepareDepthKey;
+
+/**
+ Replaces a class's own prepareRequest with one that tells the pipeline when the outermost prepareRequest has returned.
+ Subclasses call super first, so only the outermost call sees the finished request.
+ */
+static void TCDWrapPrepareRequest(Method method)
+{
+    IMP original = method_getImplementation(method);
+    IMP wrapped = imp_implementationWithBlock(^(TCAPIRequest *request) {
+        NSNumber *depth = objc_getAssociatedObject(request, &kTCDPrepareDepthKey);
+        objc_setAssociatedObject(request, &kTCDPrepareDepthKey, @([depth unsignedIntegerValue] + 1), OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+        ((void (*)(id, SEL))original)(request, @selector(prepareRequest));
+        objc_setAssociatedObject(request, &kTCDPrepareDepthKey, depth, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+
+        id provider = request.authorizationProvider;
+        if (!depth && [provider isKindOfClass:[TCDRequestPipeline class]])
+            [(TCDRequestPipeline *)provider filterPreparedRequest:request];
+    });
+    method_setImplementation(method, wrapped);
+}
+
+@interface TCAPIRequest (TCDRequestPipeline)
+@end
+
+@implementation TCAPIRequest (TCDRequestPipeline)
+
++ (void) load
+{
+    int classCount = objc_getClassList(NULL, 0);
+    Class *classes = (Class *)malloc(sizeof(Class) * classCount);
+    classCount = objc_getClassList(classes, classCount);
+    for (int i = 0; i < classCount; i++)
+    {
+        // Walk superclasses directly; messaging every class in the process could initialize classes that aren't ready.
+        Class superclass = classes[i];
+        while (superclass && superclass != self)
+            superclass = class_getSuperclass(superclass);
+        if (!superclass)
+            continue;
+
+        unsigned int methodCount = 0;
+        Method *methods = class_copyMethodList(classes[i], &methodCount);
+        for (unsigned int m = 0; m < methodCount; m++)
+        {
+            if (method_getName(methods[m]) == @selector(prepareRequest))
+                TCDWrapPrepareRequest(methods[m]);
+        }
+        free(methods);
+    }
+    free(classes);
+}
+
+@end
+
+@implementation TCDRequestPipeline
+{
+    NSArray *_filters;
+}
+
+- (id) initWithAuthenticationProvider:(id<TCAPIAuthenticationProvider>)aProvider
+{
+    if ((self = [super init]))
+    {
+        _authenticationProvider = aProvider;
+        _filters = @[];
+    }
+    return self;
+}
+
+- (NSArray *) filters
+{
+    @synchronized(self)
+    {
+        return _filters;
+    }
+}
+
+- (void) addFilter:(id<TCDRequestFilter>)filter
+{
+    @synchronized(self)
+    {
+        _filters = [_filters arrayByAddingObject:filter];
+    }
+}
+
+- (void) removeFilter:(id<TCDRequestFilter>)filter
+{
+    @synchronized(self)
+    {
+        NSMutableArray *filters = [_filters mutableCopy];
+        [filters removeObjectIdenticalTo:filter];
+        _filters = filters;
+    }
+}
+
+- (void) configureRequest:(TCAPIRequest *)request
+{
+    [self.authenticationProvider configureRequest:request];
+    for (id<TCDRequestFilter> filter in self.filters)
+        [filter filterRequest:request];
+}
+
+- (void) filterPreparedRequest:(TCAPIRequest *)request
+{
+    for (id<TCDRequestFilter> filter in self.filters)
+    {
+        if ([filter respondsToSelector:@selector(filterPreparedRequest:)])
+            [filter filterPreparedRequest:request];
+    }
+}
+
+@end
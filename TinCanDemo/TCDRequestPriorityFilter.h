@@ -0,0 +1,39 @@
+//
+//  TCDRequestPriorityFilter.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/25/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "TCDRequestFilter.h"
+
+typedef enum
+{
+    TCDRequestPriorityHigh,
+    TCDRequestPriorityNormal,
+    TCDRequestPriorityLow
+} TCDRequestPriority;
+
+/**
+ Decides which requests to favor when several are waiting for an LRS.
+
+ Statement writes are high priority, document (state, profile, activity, actor) requests are normal priority,
+ and statement reads are low priority; TCDRequestRateLimiter starts waiting requests in that order.
+ Uploads (POST and PUT) are also marked with NSURLNetworkServiceTypeBackground, since they are sent whether or not
+ the user is waiting; reads keep the default service type, because the user usually is.
+ */
+@interface TCDRequestPriorityFilter : NSObject <TCDRequestFilter>
+
+/**
+ The priority of a request, from the priority set for its class (or its closest superclass) with setPriority:forRequestClass:.
+ */
+- (TCDRequestPriority) priorityForRequest:(TCAPIRequest *)request;
+
+/**
+ Sets the priority of every request of a class (and its subclasses, unless they have their own).
+ */
+- (void) setPriority:(TCDRequestPriority)priority forRequestClass:(Class)requestClass;
+
+@end
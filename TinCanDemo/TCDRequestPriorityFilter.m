@@ -0,0 +1,63 @@
+//
+//  TCDRequestPriorityFilter.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/25/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDRequestPriorityFilter.h"
+#import "TCAPIRequest+TCDURLRequest.h"
+
+@implementation TCDRequestPriorityFilter
+{
+    NSMutableDictionary *prioritiesByClassName;
+}
+
+- (id) init
+{
+    if ((self = [super init]))
+    {
+        prioritiesByClassName = [[NSMutableDictionary alloc] init];
+        [self setPriority:TCDRequestPriorityNormal forRequestClass:[TCAPIRequest class]];
+        [self setPriority:TCDRequestPriorityHigh forRequestClass:[TCAPIStoreStatementsRequest class]];
+        [self setPriority:TCDRequestPriorityLow forRequestClass:[TCAPIGetStatementsRequest class]];
+    }
+    return self;
+}
+
+- (void) setPriority:(TCDRequestPriority)priority forRequestClass:(Class)requestClass
+{
+    @synchronized(self)
+    {
+        [prioritiesByClassName setObject:@(priority) forKey:NSStringFromClass(requestClass)];
+    }
+}
+
+- (TCDRequestPriority) priorityForRequest:(TCAPIRequest *)request
+{
+    @synchronized(self)
+    {
+        for (Class class = [request class]; class; class = [class superclass])
+        {
+            NSNumber *priority = [prioritiesByClassName objectForKey:NSStringFromClass(class)];
+            if (priority)
+                return [priority intValue];
+        }
+        return TCDRequestPriorityNormal;
+    }
+}
+
+- (void) filterRequest:(TCAPIRequest *)request
+{
+    // Nothing to set until the request is prepared (see filterPreparedRequest:).
+}
+
+- (void) filterPreparedRequest:(TCAPIRequest *)request
+{
+    // A subclass may set its method while preparing, so it's only final here.
+    BOOL isUpload = (request.HTTPMethod == TCAPIRequestTypePOST || request.HTTPMethod == TCAPIRequestTypePUT);
+    request.URLRequest.networkServiceType = isUpload ? NSURLNetworkServiceTypeBackground : NSURLNetworkServiceTypeDefault;
+}
+
+@end
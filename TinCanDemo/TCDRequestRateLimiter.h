@@ -0,0 +1,106 @@
+//
+//  TCDRequestRateLimiter.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/11/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "TCDRequestPriorityFilter.h"
+
+@class TCAPIRequest;
+
+/**
+ Something the limiter can hold back. TCAPIRequest is one; so is anything that sends a request TinCan prepared over
+ its own connection (e.g. TCDStatementPageRequest), which would otherwise never pass -[TCAPIRequest start].
+ */
+@protocol TCDRateLimitedRequest <NSObject>
+
+/**
+ The request the limiter takes the priority from.
+ */
+- (TCAPIRequest *) rateLimitedRequest;
+
+/**
+ Sends the request. Called by the limiter once the buckets allow it (from the main run loop if it had to wait).
+ */
+- (void) startAdmittedRequest;
+
+@end
+
+/**
+ Keeps the requests an app sends with one set of credentials under the LRS's quota, so they're held back on the
+ device instead of being answered with 429.
+
+ Two token buckets are refilled continuously: one holds up to requestBurst requests and refills at requestsPerSecond,
+ the other holds up to byteBurst body bytes and refills at bytesPerSecond. A request is started as soon as there is a
+ request token and the byte bucket isn't in debt; its body (as sent, i.e. after compression) is charged to the byte
+ bucket when it starts, which may take the bucket below zero and hold back the requests behind it until it has been
+ paid off. Requests that have to wait are queued by priority (high first, oldest first within a priority) and started
+ from the main run loop. A 429 that gets through anyway empties both buckets for its Retry-After interval.
+
+ TCAPIRequest's start and cancel are routed through the limiter registered for the request's authorization provider
+ (see TCAPI+TCDRateLimiting.h), so every request a TCAPI creates is limited, whatever its class. Requests that open
+ their own connection pass through startRequest: themselves (see TCDRateLimitedRequest). Synchronous requests are
+ never held back.
+ */
+@interface TCDRequestRateLimiter : NSObject
+
+/**
+ Refill rate and size of the request bucket (defaults: 5 requests per second, bursts of 10).
+ */
+@property (nonatomic, readwrite) double requestsPerSecond;
+@property (nonatomic, readwrite) double requestBurst;
+
+/**
+ Refill rate and size of the byte bucket (defaults: 256 KB per second, bursts of 1 MB). 0 bytes per second disables it.
+ */
+@property (nonatomic, readwrite) double bytesPerSecond;
+@property (nonatomic, readwrite) double byteBurst;
+
+/**
+ Decides the order waiting requests are started in (if nil, they start in the order they arrived).
+ */
+@property (nonatomic, strong) TCDRequestPriorityFilter *priorityFilter;
+
+/**
+ Number of requests waiting for tokens.
+ */
+@property (nonatomic, readonly) NSUInteger numberOfQueuedRequests;
+
+/**
+ Requests that had to wait, and 429 responses received despite the limiter.
+ */
+@property (nonatomic, readonly) NSUInteger delayedRequestCount;
+@property (nonatomic, readonly) NSUInteger throttledResponseCount;
+
+/**
+ The limiter requests with an authorization provider go through (nil if they aren't limited).
+ */
++ (TCDRequestRateLimiter *) rateLimiterForAuthorizationProvider:(id<TCAPIAuthenticationProvider>)provider;
+
+/**
+ Limits every request with an authorization provider (pass nil to stop limiting them).
+ */
++ (void) setRateLimiter:(TCDRequestRateLimiter *)rateLimiter forAuthorizationProvider:(id<TCAPIAuthenticationProvider>)provider;
+
+/**
+ Starts a request now if the buckets allow it, or queues it until they do.
+ */
+- (void) startRequest:(id<TCDRateLimitedRequest>)request;
+
+/**
+ Removes a request from the queue without starting it.
+
+ @return    YES if the request was queued.
+ */
+- (BOOL) removeQueuedRequest:(id<TCDRateLimitedRequest>)request;
+
+/**
+ Empties both buckets for the response's Retry-After interval (at least a second).
+ TCAPIRequests report their 429s themselves; other TCDRateLimitedRequests call this when they get one.
+ */
+- (void) requestWasThrottledWithResponse:(NSHTTPURLResponse *)response;
+
+@end
@@ -0,0 +1,345 @@
+//
+//  TCDRequestRateLimiter.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/11/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDRequestRateLimiter.h"
+#import "TCDRetryScheduler.h"
+#import "TCAPIRequest+TCDURLRequest.h"
+#import <objc/runtime.h>
+
+// Authorization provider -> the limiter its requests go through.
+static NSMapTable *rateLimitersByProvider = nil;
+
+static char kTCDRateLimiterAdmittedKey;
+
+/**
+ TCAPIRequest's start and cancel, routed through the rate limiter. TCAPI starts the requests it creates itself,
+ so this is the only point every one of them passes before its connection is created.
+ */
+@interface TCAPIRequest (TCDRateLimiting) <TCDRateLimitedRequest>
+@property (nonatomic, readonly) TCDRequestRateLimiter *rateLimiter;
+@property (nonatomic, readonly) BOOL isAdmitted;
+- (id) tcd_start;
+- (void) tcd_cancel;
+@end
+
+@implementation TCAPIRequest (TCDRateLimiting)
+
++ (void) load
+{
+    method_exchangeImplementations(class_getInstanceMethod(self, @selector(start)), class_getInstanceMethod(self, @selector(tcd_start)));
+    method_exchangeImplementations(class_getInstanceMethod(self, @selector(cancel)), class_getInstanceMethod(self, @selector(tcd_cancel)));
+}
+
+- (TCDRequestRateLimiter *) rateLimiter
+{
+    return [TCDRequestRateLimiter rateLimiterForAuthorizationProvider:self.authorizationProvider];
+}
+
+- (BOOL) isAdmitted
+{
+    return objc_getAssociatedObject(self, &kTCDRateLimiterAdmittedKey) != nil;
+}
+
+- (id) tcd_start
+{
+    // The implementations are exchanged: tcd_start is TCAPIRequest's own start.
+    TCDRequestRateLimiter *rateLimiter = self.synchronous ? nil : self.rateLimiter;
+    if (!rateLimiter || self.isAdmitted)
+        return [self tcd_start];
+
+    [rateLimiter startRequest:self];
+    return self;
+}
+
+- (void) tcd_cancel
+{
+    [self.rateLimiter removeQueuedRequest:self];
+    [self tcd_cancel];
+}
+
+- (TCAPIRequest *) rateLimitedRequest
+{
+    return self;
+}
+
+- (void) startAdmittedRequest
+{
+    objc_setAssociatedObject(self, &kTCDRateLimiterAdmittedKey, @YES, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    [self start];
+}
+
+@end
+
+@interface TCDRequestRateLimiter ()
+@property (nonatomic, readwrite) NSUInteger delayedRequestCount;
+@property (nonatomic, readwrite) NSUInteger throttledResponseCount;
+@property (nonatomic, strong) NSTimer *drainTimer;
+@end
+
+@implementation TCDRequestRateLimiter
+{
+    // One FIFO per TCDRequestPriority, highest first.
+    NSArray *queues;
+    double requestTokens;
+    double byteTokens;
+    NSTimeInterval lastRefill;
+    NSTimeInterval pausedUntil;
+}
+
++ (TCDRequestRateLimiter *) rateLimiterForAuthorizationProvider:(id<TCAPIAuthenticationProvider>)provider
+{
+    if (!provider)
+        return nil;
+    @synchronized(self)
+    {
+        return [rateLimitersByProvider objectForKey:provider];
+    }
+}
+
++ (void) setRateLimiter:(TCDRequestRateLimiter *)rateLimiter forAuthorizationProvider:(id<TCAPIAuthenticationProvider>)provider
+{
+    if (!provider)
+        return;
+    @synchronized(self)
+    {
+        if (!rateLimitersByProvider)
+            rateLimitersByProvider = [NSMapTable weakToStrongObjectsMapTable];
+        if (rateLimiter)
+            [rateLimitersByProvider setObject:rateLimiter forKey:provider];
+        else
+            [rateLimitersByProvider removeObjectForKey:provider];
+    }
+}
+
+- (id) init
+{
+    if ((self = [super init]))
+    {
+        self.requestsPerSecond = 5;
+        self.requestBurst = 10;
+        self.bytesPerSecond = 256 * 1024;
+        self.byteBurst = 1024 * 1024;
+        queues = @[[NSMutableArray array], [NSMutableArray array], [NSMutableArray array]];
+        requestTokens = self.requestBurst;
+        byteTokens = self.byteBurst;
+        lastRefill = [NSDate timeIntervalSinceReferenceDate];
+
+        NSNotificationCenter *center = [NSNotificationCenter defaultCenter];
+        [center addObserver:self selector:@selector(requestStarted:) name:TCRequestStartedNotification object:nil];
+        [center addObserver:self selector:@selector(requestFailed:) name:TCRequestFailedNotification object:nil];
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    [self.drainTimer invalidate];
+}
+
+- (NSUInteger) numberOfQueuedRequests
+{
+    @synchronized(self)
+    {
+        NSUInteger count = 0;
+        for (NSMutableArray *queue in queues)
+            count += queue.count;
+        return count;
+    }
+}
+
+#pragma mark - Buckets
+
+// The following methods are called with the limiter locked.
+
+- (void) refill
+{
+    NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+    NSTimeInterval elapsed = MAX(now - MAX(lastRefill, pausedUntil), 0);
+    lastRefill = now;
+    if (now < pausedUntil)
+        return;
+    requestTokens = MIN(requestTokens + elapsed * self.requestsPerSecond, self.requestBurst);
+    byteTokens = MIN(byteTokens + elapsed * self.bytesPerSecond, self.byteBurst);
+}
+
+- (BOOL) canStartRequest
+{
+    if ([NSDate timeIntervalSinceReferenceDate] < pausedUntil)
+        return NO;
+    if (self.requestsPerSecond > 0 && requestTokens < 1)
+        return NO;
+    return self.bytesPerSecond <= 0 || byteTokens > 0;
+}
+
+- (void) takeRequestToken
+{
+    if (self.requestsPerSecond > 0)
+        requestTokens -= 1;
+}
+
+- (NSTimeInterval) delayUntilNextStart
+{
+    NSTimeInterval delay = MAX(pausedUntil - [NSDate timeIntervalSinceReferenceDate], 0);
+    if (self.requestsPerSecond > 0 && requestTokens < 1)
+        delay = MAX(delay, (1 - requestTokens) / self.requestsPerSecond);
+    if (self.bytesPerSecond > 0 && byteTokens <= 0)
+        delay = MAX(delay, (1 - byteTokens) / self.bytesPerSecond);
+    return delay;
+}
+
+#pragma mark - Starting requests
+
+- (NSMutableArray *) queueForRequest:(id<TCDRateLimitedRequest>)request
+{
+    TCDRequestPriority priority = self.priorityFilter ? [self.priorityFilter priorityForRequest:[request rateLimitedRequest]] : TCDRequestPriorityNormal;
+    return [queues objectAtIndex:priority];
+}
+
+- (void) startRequest:(id<TCDRateLimitedRequest>)request
+{
+    BOOL startNow = NO;
+    @synchronized(self)
+    {
+        [self refill];
+        // Requests already waiting go first, whatever their priority.
+        if (self.numberOfQueuedRequests == 0 && [self canStartRequest])
+        {
+            [self takeRequestToken];
+            startNow = YES;
+        }
+        else
+        {
+            [[self queueForRequest:request] addObject:request];
+            self.delayedRequestCount++;
+        }
+    }
+
+    if (startNow)
+        [request startAdmittedRequest];
+    else
+        [self scheduleDrain];
+}
+
+- (BOOL) removeQueuedRequest:(id<TCDRateLimitedRequest>)request
+{
+    @synchronized(self)
+    {
+        for (NSMutableArray *queue in queues)
+        {
+            NSUInteger index = [queue indexOfObjectIdenticalTo:request];
+            if (index != NSNotFound)
+            {
+                [queue removeObjectAtIndex:index];
+                return YES;
+            }
+        }
+        return NO;
+    }
+}
+
+- (void) drain
+{
+    for (;;)
+    {
+        id<TCDRateLimitedRequest> request = nil;
+        @synchronized(self)
+        {
+            [self refill];
+            if (![self canStartRequest])
+                break;
+            for (NSMutableArray *queue in queues)
+            {
+                if (queue.count > 0)
+                {
+                    request = [queue objectAtIndex:0];
+                    [queue removeObjectAtIndex:0];
+                    break;
+                }
+            }
+            if (!request)
+                break;
+            [self takeRequestToken];
+        }
+        // Started outside the lock; its body is charged from requestStarted: before the next one is considered.
+        [request startAdmittedRequest];
+    }
+    [self scheduleDrain];
+}
+
+- (void) scheduleDrain
+{
+    if (![NSThread isMainThread])
+    {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [self scheduleDrain];
+        });
+        return;
+    }
+
+    NSTimeInterval delay;
+    @synchronized(self)
+    {
+        if (self.numberOfQueuedRequests == 0)
+            return;
+        [self refill];
+        delay = [self delayUntilNextStart];
+    }
+    [self.drainTimer invalidate];
+    self.drainTimer = [NSTimer scheduledTimerWithTimeInterval:delay target:self selector:@selector(drainTimerFired:) userInfo:nil repeats:NO];
+}
+
+- (void) drainTimerFired:(NSTimer *)timer
+{
+    self.drainTimer = nil;
+    [self drain];
+}
+
+#pragma mark - Request notifications
+
+- (BOOL) limitsRequest:(id)request
+{
+    return [request isKindOfClass:[TCAPIRequest class]] && [(TCAPIRequest *)request rateLimiter] == self;
+}
+
+- (void) requestStarted:(NSNotification *)notification
+{
+    TCAPIRequest *request = notification.object;
+    if (![self limitsRequest:request])
+        return;
+    @synchronized(self)
+    {
+        [self refill];
+        byteTokens -= request.URLRequest.HTTPBody.length;
+    }
+}
+
+- (void) requestFailed:(NSNotification *)notification
+{
+    TCAPIRequest *request = notification.object;
+    if (![self limitsRequest:request] || request.HTTPResponse.statusCode != 429)
+        return;
+    [self requestWasThrottledWithResponse:request.HTTPResponse];
+}
+
+- (void) requestWasThrottledWithResponse:(NSHTTPURLResponse *)response
+{
+    NSTimeInterval retryAfter = [TCDRetryScheduler retryAfterIntervalForResponse:response];
+    @synchronized(self)
+    {
+        self.throttledResponseCount++;
+        [self refill];
+        // The LRS has seen more than the buckets allowed for; start them again from empty once it's ready.
+        pausedUntil = MAX(pausedUntil, [NSDate timeIntervalSinceReferenceDate] + MAX(retryAfter, 1));
+        requestTokens = MIN(requestTokens, 0);
+        byteTokens = MIN(byteTokens, 0);
+    }
+    [self scheduleDrain];
+}
+
+@end
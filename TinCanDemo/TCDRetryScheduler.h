@@ -0,0 +1,93 @@
+//
+//  TCDRetryScheduler.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/9/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class TCStatement;
+
+/**
+ Decides when requests to an endpoint may be retried after they fail.
+
+ Each consecutive failure backs off with decorrelated jitter: the next delay is drawn uniformly between baseDelay
+ and three times the previous delay, capped at maxDelay. Clients that failed together therefore spread out instead of
+ returning to a recovering LRS at the same moment. When a 429 or 503 response carries Retry-After, that delay is used
+ instead. A success clears the backoff.
+
+ The scheduler also counts how many times each statement has been attempted. The backoff and the counts are saved
+ to statePath whenever they change, so they survive a restart along with the statement queue.
+ */
+@interface TCDRetryScheduler : NSObject
+
+@property (nonatomic, strong, readonly) NSURL *endpoint;
+
+/**
+ Where the scheduler's state is saved (nil to keep it in memory only).
+ */
+@property (nonatomic, strong, readonly) NSString *statePath;
+
+/**
+ Smallest and largest delay between attempts (defaults: 1 second and 5 minutes).
+ */
+@property (nonatomic, readwrite) NSTimeInterval baseDelay;
+@property (nonatomic, readwrite) NSTimeInterval maxDelay;
+
+/**
+ Failures since the last success.
+ */
+@property (nonatomic, readonly) NSUInteger consecutiveFailures;
+
+/**
+ When the next attempt may be made (nil if it may be made now).
+ */
+@property (nonatomic, strong, readonly) NSDate *nextAttemptDate;
+
+/**
+ YES if requests may be sent now.
+ */
+@property (nonatomic, readonly) BOOL isReadyToSend;
+
+/**
+ The shared scheduler for an endpoint's host, saved in Documents/tcRetryState/<host>.plist.
+ */
++ (TCDRetryScheduler *) schedulerForEndpoint:(NSURL *)endpoint;
+
+/**
+ Designated initializer. Restores the state saved at statePath, if any.
+ */
+- (id) initWithEndpoint:(NSURL *)endpoint statePath:(NSString *)statePath;
+
+/**
+ Records a failed attempt to send statements and backs off.
+
+ @param response    The response, if one was received (its Retry-After is honoured on 429 and 503).
+ @param statements  The statements that were sent (may be nil).
+ @return            Seconds until the next attempt may be made.
+ */
+- (NSTimeInterval) recordFailureWithResponse:(NSHTTPURLResponse *)response statements:(NSArray *)statements;
+
+/**
+ Records a successful attempt, clearing the backoff and the statements' attempt counts.
+ */
+- (void) recordSuccessForStatements:(NSArray *)statements;
+
+/**
+ Forgets the attempt counts of statements that won't be sent again.
+ */
+- (void) forgetStatements:(NSArray *)statements;
+
+/**
+ Number of failed attempts to send a statement.
+ */
+- (NSUInteger) attemptCountForStatement:(TCStatement *)statement;
+
+/**
+ The delay a response's Retry-After header asks for (seconds or an HTTP date), or -1 if it has none.
+ */
++ (NSTimeInterval) retryAfterIntervalForResponse:(NSHTTPURLResponse *)response;
+
+@end
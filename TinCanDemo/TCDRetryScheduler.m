@@ -0,0 +1,206 @@
+//
+//  TCDRetryScheduler.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/9/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDRetryScheduler.h"
+
+static NSString* const kTCDRetryStateDirectory = @"tcRetryState";
+
+@interface TCDRetryScheduler ()
+{
+    NSTimeInterval previousDelay;
+    // Statement id -> number of failed attempts.
+    NSMutableDictionary *attemptCounts;
+}
+@property (nonatomic, strong, readwrite) NSURL *endpoint;
+@property (nonatomic, strong, readwrite) NSString *statePath;
+@property (nonatomic, readwrite) NSUInteger consecutiveFailures;
+@property (nonatomic, strong, readwrite) NSDate *nextAttemptDate;
+@end
+
+@implementation TCDRetryScheduler
+
++ (TCDRetryScheduler *) schedulerForEndpoint:(NSURL *)endpoint
+{
+    static NSMutableDictionary *schedulers = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        schedulers = [[NSMutableDictionary alloc] init];
+    });
+
+    NSString *host = [NSString stringWithFormat:@"%@_%@", endpoint.host ?: @"localhost", endpoint.port ?: @""];
+    @synchronized(schedulers)
+    {
+        TCDRetryScheduler *scheduler = [schedulers objectForKey:host];
+        if (!scheduler)
+        {
+            NSString *documents = [NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES) objectAtIndex:0];
+            NSString *directory = [documents stringByAppendingPathComponent:kTCDRetryStateDirectory];
+            [[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:NULL];
+            NSString *path = [[directory stringByAppendingPathComponent:host] stringByAppendingPathExtension:@"plist"];
+            scheduler = [[TCDRetryScheduler alloc] initWithEndpoint:endpoint statePath:path];
+            [schedulers setObject:scheduler forKey:host];
+        }
+        return scheduler;
+    }
+}
+
+- (id) initWithEndpoint:(NSURL *)endpoint statePath:(NSString *)statePath
+{
+    if ((self = [super init]))
+    {
+        self.endpoint = endpoint;
+        self.statePath = statePath;
+        self.baseDelay = 1;
+        self.maxDelay = 300;
+        attemptCounts = [[NSMutableDictionary alloc] init];
+        [self restoreState];
+    }
+    return self;
+}
+
+- (BOOL) isReadyToSend
+{
+    @synchronized(self)
+    {
+        return !self.nextAttemptDate || [self.nextAttemptDate timeIntervalSinceNow] <= 0;
+    }
+}
+
+#pragma mark - Backoff
+
+- (NSTimeInterval) nextBackoffDelay
+{
+    // Decorrelated jitter: uniform in [base, 3 * previous], capped.
+    NSTimeInterval low = self.baseDelay;
+    NSTimeInterval high = MAX(low, MIN(self.maxDelay, MAX(previousDelay, low) * 3));
+    double unit = (double)arc4random_uniform(UINT32_MAX) / (double)UINT32_MAX;
+    return MIN(self.maxDelay, low + (high - low) * unit);
+}
+
+- (NSTimeInterval) recordFailureWithResponse:(NSHTTPURLResponse *)response statements:(NSArray *)statements
+{
+    @synchronized(self)
+    {
+        NSTimeInterval delay = -1;
+        if (response.statusCode == 429 || response.statusCode == 503)
+            delay = [[self class] retryAfterIntervalForResponse:response];
+        if (delay < 0)
+        {
+            delay = [self nextBackoffDelay];
+            previousDelay = delay;
+        }
+
+        self.consecutiveFailures++;
+        self.nextAttemptDate = [NSDate dateWithTimeIntervalSinceNow:delay];
+        for (TCStatement *statement in statements)
+        {
+            if (statement.sid)
+                [attemptCounts setObject:@([self attemptCountForStatement:statement] + 1) forKey:statement.sid];
+        }
+        [self saveState];
+        return delay;
+    }
+}
+
+- (void) recordSuccessForStatements:(NSArray *)statements
+{
+    @synchronized(self)
+    {
+        BOOL changed = (self.consecutiveFailures > 0 || self.nextAttemptDate);
+        self.consecutiveFailures = 0;
+        self.nextAttemptDate = nil;
+        previousDelay = 0;
+        if ([self removeAttemptCountsForStatements:statements] || changed)
+            [self saveState];
+    }
+}
+
+- (void) forgetStatements:(NSArray *)statements
+{
+    @synchronized(self)
+    {
+        if ([self removeAttemptCountsForStatements:statements])
+            [self saveState];
+    }
+}
+
+- (BOOL) removeAttemptCountsForStatements:(NSArray *)statements
+{
+    NSUInteger count = attemptCounts.count;
+    for (TCStatement *statement in statements)
+    {
+        if (statement.sid)
+            [attemptCounts removeObjectForKey:statement.sid];
+    }
+    return attemptCounts.count != count;
+}
+
+- (NSUInteger) attemptCountForStatement:(TCStatement *)statement
+{
+    @synchronized(self)
+    {
+        return statement.sid ? [[attemptCounts objectForKey:statement.sid] unsignedIntegerValue] : 0;
+    }
+}
+
++ (NSTimeInterval) retryAfterIntervalForResponse:(NSHTTPURLResponse *)response
+{
+    NSString *retryAfter = [[response allHeaderFields] objectForKey:@"Retry-After"];
+    if (retryAfter.length == 0)
+        return -1;
+
+    NSScanner *scanner = [NSScanner scannerWithString:retryAfter];
+    NSInteger seconds;
+    if ([scanner scanInteger:&seconds] && [scanner isAtEnd])
+        return MAX(seconds, 0);
+
+    static NSDateFormatter *formatter = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        formatter = [[NSDateFormatter alloc] init];
+        formatter.locale = [[NSLocale alloc] initWithLocaleIdentifier:@"en_US_POSIX"];
+        formatter.timeZone = [NSTimeZone timeZoneWithAbbreviation:@"GMT"];
+        formatter.dateFormat = @"EEE, dd MMM yyyy HH:mm:ss zzz";
+    });
+    NSDate *date;
+    @synchronized(formatter)
+    {
+        date = [formatter dateFromString:retryAfter];
+    }
+    return date ? MAX([date timeIntervalSinceNow], 0) : -1;
+}
+
+#pragma mark - Saved state
+
+- (void) restoreState
+{
+    NSDictionary *state = self.statePath ? [NSDictionary dictionaryWithContentsOfFile:self.statePath] : nil;
+    if (!state)
+        return;
+    self.consecutiveFailures = [[state objectForKey:@"consecutiveFailures"] unsignedIntegerValue];
+    previousDelay = [[state objectForKey:@"previousDelay"] doubleValue];
+    self.nextAttemptDate = [state objectForKey:@"nextAttemptDate"];
+    [attemptCounts addEntriesFromDictionary:[state objectForKey:@"attemptCounts"]];
+}
+
+- (void) saveState
+{
+    if (!self.statePath)
+        return;
+
+    NSMutableDictionary *state = [NSMutableDictionary dictionary];
+    [state setObject:@(self.consecutiveFailures) forKey:@"consecutiveFailures"];
+    [state setObject:@(previousDelay) forKey:@"previousDelay"];
+    [state setObject:attemptCounts forKey:@"attemptCounts"];
+    if (self.nextAttemptDate)
+        [state setObject:self.nextAttemptDate forKey:@"nextAttemptDate"];
+    if (![state writeToFile:self.statePath atomically:YES])
+        NSLog(@"Unable to save the retry state to %@", self.statePath);
+}
+
+@end
@@ -0,0 +1,92 @@
+//
+//  TCDStatementAttributes.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/3/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class TCStatement, TCAgent, TCStatementObject;
+
+/**
+ The parts of a statement that TCStatementQuery can filter on, read from the statement's JSON dictionary.
+
+ Agents are reduced to one identity key (mbox, mbox_sha1sum, openid, or account, in that order of preference),
+ so the same agent gives the same key whether it came from the LRS or from a TCAgent built in the app.
+ */
+@interface TCDStatementAttributes : NSObject
+
+@property (nonatomic, strong, readonly) NSString *sid;
+@property (nonatomic, strong, readonly) NSString *verb;
+@property (nonatomic, strong, readonly) NSString *objectId;
+@property (nonatomic, strong, readonly) NSString *actorKey;
+@property (nonatomic, strong, readonly) NSString *registration;
+@property (nonatomic, strong, readonly) NSString *instructorKey;
+
+/**
+ Ids of the context's parent, grouping and other activities (nil if it has none).
+ */
+@property (nonatomic, strong, readonly) NSArray *contextActivityIds;
+
+/**
+ Seconds since 1970 the LRS stored the statement (or its timestamp if it hasn't been stored); NAN if neither is known.
+ */
+@property (nonatomic, readonly) NSTimeInterval stored;
+
+/**
+ Reads the attributes of a statement dictionary (as returned by the LRS or by TCStatement's dictionary).
+ */
+- (id) initWithDictionary:(NSDictionary *)dictionary;
+
+/**
+ Reads the attributes of a statement's JSON (nil if the data isn't a JSON object).
+ */
+- (id) initWithJSONData:(NSData *)data;
+
+/**
+ Reads attributes packed by encodedData.
+
+ @param bytes   The packed attributes.
+ @param length  The length of the packed attributes.
+ @param sid     The id of the statement (it isn't packed).
+ @return        The attributes, or nil if the bytes aren't packed attributes (or were packed without context activities).
+ */
+- (id) initWithEncodedBytes:(const void *)bytes length:(NSUInteger)length sid:(NSString *)sid;
+
+/**
+ The attributes (except the statement id) packed in a compact binary form, e.g. to store next to the statement
+ so an index can be rebuilt without parsing it. nil if they don't fit in 64KB.
+ */
+- (NSData *) encodedData;
+
+/**
+ Reads the attributes of a statement. A statement that has already been encoded (see TCStatement+TCDJSONEncoding),
+ including a TCDLazyStatement restored from a log, is read from its JSON, so it isn't walked or inflated again.
+ */
++ (TCDStatementAttributes *) attributesOfStatement:(TCStatement *)statement;
+
+/**
+ The identity key of an agent dictionary (nil if it has no identifier).
+ */
++ (NSString *) keyForAgentDictionary:(NSDictionary *)agent;
+
+/**
+ The identity key of an agent (nil if it has no identifier).
+ */
++ (NSString *) keyForAgent:(TCAgent *)agent;
+
+/**
+ The id of a statement object (an activity id, an agent's identity key, or a statement id).
+ */
++ (NSString *) idForObject:(TCStatementObject *)object;
+
+/**
+ Parses an ISO 8601 date (YYYY-MM-DDTHH:MM:SS, optional fraction, Z or an offset).
+
+ @return    Seconds since 1970, or NAN if the string isn't a date.
+ */
++ (NSTimeInterval) timeIntervalForISO8601String:(NSString *)string;
+
+@end
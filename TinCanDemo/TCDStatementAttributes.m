@@ -0,0 +1,297 @@
+//
+//  TCDStatementAttributes.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/3/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDStatementAttributes.h"
+#import "TCStatement+TCDJSONEncoding.h"
+#import <time.h>
+
+/**
+ The first string in a value that is either a string or an array of strings (TinCan 0.9 agents hold arrays).
+ */
+static NSString *TCDFirstString(id value)
+{
+    if ([value isKindOfClass:[NSArray class]])
+        value = [value count] > 0 ? [value objectAtIndex:0] : nil;
+    return [value isKindOfClass:[NSString class]] && [value length] > 0 ? value : nil;
+}
+
+static NSString *TCDIdOfValue(id value)
+{
+    // Verbs and objects are either a bare id or a dictionary with an "id".
+    if ([value isKindOfClass:[NSDictionary class]])
+        return TCDFirstString([value objectForKey:@"id"]);
+    return TCDFirstString(value);
+}
+
+/**
+ Adds the id of a context activity, or of each activity in an array of them (as 1.0 LRSs send), to ids.
+ */
+static void TCDAddActivityIds(id value, NSMutableArray *ids)
+{
+    if ([value isKindOfClass:[NSArray class]])
+    {
+        for (id activity in value)
+            TCDAddActivityIds(activity, ids);
+        return;
+    }
+    NSString *activityId = [value isKindOfClass:[NSDictionary class]] ? TCDIdOfValue(value) : nil;
+    if (activityId && ![ids containsObject:activityId])
+        [ids addObject:activityId];
+}
+
+// encodedData: version(2), stored (8, little-endian double bits), then each of kTCDEncodedAttributeCount strings
+// as length (2, little-endian; 0xFFFF for nil) and UTF-8 bytes, then the number of context activity ids (2,
+// little-endian) and the ids as strings. Version 1 had no context activity ids; those records are read as unpacked.
+static const uint8_t kTCDEncodedAttributesVersion = 2;
+static const uint16_t kTCDEncodedNilString = 0xFFFF;
+static const NSUInteger kTCDEncodedAttributeCount = 5;
+
+static BOOL TCDReadEncodedString(const uint8_t **p, const uint8_t *end, NSString * __strong *string)
+{
+    if (end - *p < 2)
+        return NO;
+    uint16_t stringLength = (uint16_t)((*p)[0] | ((*p)[1] << 8));
+    *p += 2;
+    if (stringLength == kTCDEncodedNilString)
+    {
+        *string = nil;
+        return YES;
+    }
+    if (end - *p < stringLength)
+        return NO;
+    *string = [[NSString alloc] initWithBytes:*p length:stringLength encoding:NSUTF8StringEncoding];
+    *p += stringLength;
+    return YES;
+}
+
+static BOOL TCDAppendEncodedString(NSMutableData *data, NSString *string)
+{
+    NSData *bytes = [string dataUsingEncoding:NSUTF8StringEncoding];
+    if (bytes.length >= kTCDEncodedNilString)
+        return NO;
+    uint16_t stringLength = string ? (uint16_t)bytes.length : kTCDEncodedNilString;
+    uint8_t lengthBytes[2] = { stringLength & 0xFF, stringLength >> 8 };
+    [data appendBytes:lengthBytes length:2];
+    if (bytes)
+        [data appendData:bytes];
+    return YES;
+}
+
+@implementation TCDStatementAttributes
+
+- (id) initWithDictionary:(NSDictionary *)dictionary
+{
+    if ((self = [super init]))
+    {
+        _sid = TCDFirstString([dictionary objectForKey:@"id"]);
+        _verb = TCDIdOfValue([dictionary objectForKey:@"verb"]);
+
+        NSDictionary *object = [dictionary objectForKey:@"object"];
+        if ([object isKindOfClass:[NSDictionary class]])
+            _objectId = TCDIdOfValue(object) ?: [[self class] keyForAgentDictionary:object];
+
+        NSDictionary *actor = [dictionary objectForKey:@"actor"];
+        if ([actor isKindOfClass:[NSDictionary class]])
+            _actorKey = [[self class] keyForAgentDictionary:actor];
+
+        NSDictionary *context = [dictionary objectForKey:@"context"];
+        if ([context isKindOfClass:[NSDictionary class]])
+        {
+            _registration = TCDFirstString([context objectForKey:@"registration"]);
+            NSDictionary *instructor = [context objectForKey:@"instructor"];
+            if ([instructor isKindOfClass:[NSDictionary class]])
+                _instructorKey = [[self class] keyForAgentDictionary:instructor];
+
+            NSDictionary *contextActivities = [context objectForKey:@"contextActivities"];
+            if ([contextActivities isKindOfClass:[NSDictionary class]])
+            {
+                NSMutableArray *ids = [NSMutableArray array];
+                TCDAddActivityIds([contextActivities objectForKey:@"parent"], ids);
+                TCDAddActivityIds([contextActivities objectForKey:@"grouping"], ids);
+                TCDAddActivityIds([contextActivities objectForKey:@"other"], ids);
+                _contextActivityIds = ids.count > 0 ? ids : nil;
+            }
+        }
+
+        _stored = [[self class] timeIntervalForISO8601String:TCDFirstString([dictionary objectForKey:@"stored"])];
+        if (isnan(_stored))
+            _stored = [[self class] timeIntervalForISO8601String:TCDFirstString([dictionary objectForKey:@"timestamp"])];
+    }
+    return self;
+}
+
+- (id) initWithJSONData:(NSData *)data
+{
+    NSDictionary *dictionary = data ? [NSJSONSerialization JSONObjectWithData:data options:0 error:nil] : nil;
+    if (![dictionary isKindOfClass:[NSDictionary class]])
+        return nil;
+    return [self initWithDictionary:dictionary];
+}
+
+- (id) initWithEncodedBytes:(const void *)bytes length:(NSUInteger)length sid:(NSString *)sid
+{
+    const uint8_t *p = bytes, *end = p + length;
+    if (length < 9 || p[0] != kTCDEncodedAttributesVersion)
+        return nil;
+
+    if ((self = [super init]))
+    {
+        _sid = sid;
+        uint64_t storedBits;
+        memcpy(&storedBits, p + 1, sizeof(storedBits));
+        storedBits = CFSwapInt64LittleToHost(storedBits);
+        memcpy(&_stored, &storedBits, sizeof(_stored));
+        p += 9;
+
+        NSString *strings[kTCDEncodedAttributeCount];
+        for (NSUInteger i = 0; i < kTCDEncodedAttributeCount; i++)
+        {
+            if (!TCDReadEncodedString(&p, end, &strings[i]))
+                return nil;
+        }
+        _verb = strings[0];
+        _objectId = strings[1];
+        _actorKey = strings[2];
+        _registration = strings[3];
+        _instructorKey = strings[4];
+
+        if (end - p < 2)
+            return nil;
+        uint16_t contextActivityCount = (uint16_t)(p[0] | (p[1] << 8));
+        p += 2;
+        NSMutableArray *ids = [NSMutableArray arrayWithCapacity:contextActivityCount];
+        for (NSUInteger i = 0; i < contextActivityCount; i++)
+        {
+            NSString *activityId = nil;
+            if (!TCDReadEncodedString(&p, end, &activityId))
+                return nil;
+            if (activityId)
+                [ids addObject:activityId];
+        }
+        _contextActivityIds = ids.count > 0 ? ids : nil;
+    }
+    return self;
+}
+
+- (NSData *) encodedData
+{
+    NSMutableData *data = [NSMutableData dataWithLength:9];
+    uint8_t *header = data.mutableBytes;
+    header[0] = kTCDEncodedAttributesVersion;
+    uint64_t storedBits;
+    memcpy(&storedBits, &_stored, sizeof(storedBits));
+    storedBits = CFSwapInt64HostToLittle(storedBits);
+    memcpy(header + 1, &storedBits, sizeof(storedBits));
+
+    NSString *strings[kTCDEncodedAttributeCount] = { self.verb, self.objectId, self.actorKey, self.registration, self.instructorKey };
+    for (NSUInteger i = 0; i < kTCDEncodedAttributeCount; i++)
+    {
+        if (!TCDAppendEncodedString(data, strings[i]))
+            return nil;
+    }
+
+    if (self.contextActivityIds.count >= UINT16_MAX)
+        return nil;
+    uint16_t contextActivityCount = (uint16_t)self.contextActivityIds.count;
+    uint8_t countBytes[2] = { contextActivityCount & 0xFF, contextActivityCount >> 8 };
+    [data appendBytes:countBytes length:2];
+    for (NSString *activityId in self.contextActivityIds)
+    {
+        if (!TCDAppendEncodedString(data, activityId))
+            return nil;
+    }
+    return data.length <= UINT16_MAX ? data : nil;
+}
+
++ (TCDStatementAttributes *) attributesOfStatement:(TCStatement *)statement
+{
+    TCDStatementAttributes *attributes = nil;
+    if (statement.hasEncodedJSONData)
+        attributes = [[TCDStatementAttributes alloc] initWithJSONData:statement.encodedJSONData];
+    if (!attributes)
+        attributes = [[TCDStatementAttributes alloc] initWithDictionary:[statement dictionary]];
+    if (!attributes.sid && statement.sid.length > 0)
+        attributes->_sid = statement.sid;
+    return attributes;
+}
+
++ (NSString *) keyForAgentDictionary:(NSDictionary *)agent
+{
+    NSString *value;
+    if ((value = TCDFirstString([agent objectForKey:@"mbox"])))
+        return [@"mbox:" stringByAppendingString:[value lowercaseString]];
+    if ((value = TCDFirstString([agent objectForKey:@"mbox_sha1sum"])))
+        return [@"mbox_sha1sum:" stringByAppendingString:[value lowercaseString]];
+    if ((value = TCDFirstString([agent objectForKey:@"openid"])))
+        return [@"openid:" stringByAppendingString:value];
+
+    id account = [agent objectForKey:@"account"];
+    if ([account isKindOfClass:[NSArray class]])
+        account = [account count] > 0 ? [account objectAtIndex:0] : nil;
+    if ([account isKindOfClass:[NSDictionary class]])
+    {
+        NSString *homePage = TCDFirstString([account objectForKey:@"homePage"]) ?: TCDFirstString([account objectForKey:@"accountServiceHomePage"]);
+        NSString *name = TCDFirstString([account objectForKey:@"name"]) ?: TCDFirstString([account objectForKey:@"accountName"]);
+        if (name)
+            return [NSString stringWithFormat:@"account:%@|%@", homePage ?: @"", name];
+    }
+    return nil;
+}
+
++ (NSString *) keyForAgent:(TCAgent *)agent
+{
+    return agent ? [self keyForAgentDictionary:[agent dictionary]] : nil;
+}
+
++ (NSString *) idForObject:(TCStatementObject *)object
+{
+    if (!object)
+        return nil;
+    if ([object isKindOfClass:[TCActivity class]])
+        return [(TCActivity *)object activityId];
+    if ([object isKindOfClass:[TCStatement class]])
+        return [(TCStatement *)object sid];
+
+    NSDictionary *dictionary = [object dictionary];
+    return TCDIdOfValue(dictionary) ?: [self keyForAgentDictionary:dictionary];
+}
+
++ (NSTimeInterval) timeIntervalForISO8601String:(NSString *)string
+{
+    const char *s = [string UTF8String];
+    if (!s)
+        return NAN;
+
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    int consumed = 0;
+    if (sscanf(s, "%4d-%2d-%2dT%2d:%2d:%2d%n", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec, &consumed) != 6)
+        return NAN;
+    tm.tm_year -= 1900;
+    tm.tm_mon -= 1;
+
+    double seconds = (double)timegm(&tm);
+    s += consumed;
+    if (*s == '.')
+    {
+        double scale = 0.1;
+        for (s++; *s >= '0' && *s <= '9'; s++, scale /= 10)
+            seconds += (*s - '0') * scale;
+    }
+    if (*s == '+' || *s == '-')
+    {
+        int hours = 0, minutes = 0;
+        int sign = (*s == '-') ? -1 : 1;
+        if (sscanf(s + 1, "%2d:%2d", &hours, &minutes) < 1 && sscanf(s + 1, "%2d%2d", &hours, &minutes) < 1)
+            return NAN;
+        seconds -= sign * (hours * 3600 + minutes * 60);
+    }
+    return seconds;
+}
+
+@end
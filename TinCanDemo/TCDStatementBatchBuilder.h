@@ -0,0 +1,54 @@
+//
+//  TCDStatementBatchBuilder.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/22/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ Splits queued statements into batches for POSTing to the LRS.
+
+ A batch closes when adding the next statement would exceed either maxStatementCount or maxByteCount,
+ so large statements go out in small batches and small statements go out in large ones.
+ Sizes come from TCStatement's cached estimatedJSONLength. A statement that is larger than maxByteCount
+ on its own is sent in a batch by itself.
+ */
+@interface TCDStatementBatchBuilder : NSObject
+
+/**
+ The most statements put in one batch (default=50, the same as TCAPI's batchSize).
+ */
+@property (nonatomic, readwrite) NSUInteger maxStatementCount;
+
+/**
+ The most bytes of statement JSON put in one batch, including the enclosing array (default=256KB).
+ */
+@property (nonatomic, readwrite) NSUInteger maxByteCount;
+
+/**
+ The estimated length of the request body for a batch of statements.
+ */
++ (NSUInteger) estimatedLengthOfBatch:(NSArray *)statements;
+
+/**
+ Takes the next batch from an array of statements.
+
+ @param statements  The statements to take the batch from, in the order they should be sent.
+ @param index       The index of the first statement to put in the batch. On return, the index of the first statement after the batch.
+ @param byteCount   If not NULL, returns the estimated length of the batch.
+ @return            The batch (empty if index is past the end of the statements).
+ */
+- (NSArray *) nextBatchFromStatements:(NSArray *)statements atIndex:(NSUInteger *)index byteCount:(NSUInteger *)byteCount;
+
+/**
+ Splits an array of statements into batches.
+
+ @param statements  The statements to split, in the order they should be sent.
+ @return            An array of batches (arrays of statements).
+ */
+- (NSArray *) batchesFromStatements:(NSArray *)statements;
+
+@end
@@ -0,0 +1,68 @@
+//
+//  TCDStatementBatchBuilder.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/22/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDStatementBatchBuilder.h"
+#import "TCStatement+TCDSizeEstimate.h"
+
+@implementation TCDStatementBatchBuilder
+
+- (id) init
+{
+    if ((self = [super init]))
+    {
+        self.maxStatementCount = 50;
+        self.maxByteCount = 256 * 1024;
+    }
+    return self;
+}
+
++ (NSUInteger) estimatedLengthOfBatch:(NSArray *)statements
+{
+    // [statement,statement]
+    NSUInteger length = 2;
+    for (TCStatement *statement in statements)
+        length += statement.estimatedJSONLength + 1;
+    return statements.count > 0 ? length - 1 : length;
+}
+
+- (NSArray *) nextBatchFromStatements:(NSArray *)statements atIndex:(NSUInteger *)index byteCount:(NSUInteger *)byteCount
+{
+    NSUInteger maxCount = MAX(self.maxStatementCount, 1);
+    NSUInteger count = statements.count;
+    NSUInteger i = *index;
+    NSUInteger length = 2;
+    NSMutableArray *batch = [NSMutableArray arrayWithCapacity:MIN(maxCount, count - MIN(i, count))];
+
+    while (i < count && batch.count < maxCount)
+    {
+        TCStatement *statement = [statements objectAtIndex:i];
+        NSUInteger statementLength = statement.estimatedJSONLength + (batch.count > 0 ? 1 : 0);
+        if (batch.count > 0 && length + statementLength > self.maxByteCount)
+            break;
+
+        [batch addObject:statement];
+        length += statementLength;
+        i++;
+    }
+
+    *index = i;
+    if (byteCount)
+        *byteCount = length;
+    return batch;
+}
+
+- (NSArray *) batchesFromStatements:(NSArray *)statements
+{
+    NSMutableArray *batches = [NSMutableArray array];
+    NSUInteger index = 0;
+    while (index < statements.count)
+        [batches addObject:[self nextBatchFromStatements:statements atIndex:&index byteCount:NULL]];
+    return batches;
+}
+
+@end
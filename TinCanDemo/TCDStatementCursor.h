@@ -0,0 +1,102 @@
+//
+//  TCDStatementCursor.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/28/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class TCAPI, TCStatement, TCStatementQuery, TCDStatementCursor;
+
+@protocol TCDStatementCursorDelegate <NSObject>
+@optional
+/**
+ More statements can be read with nextStatement.
+ */
+- (void) statementCursorHasStatementsAvailable:(TCDStatementCursor *)cursor;
+
+/**
+ Every page has been retrieved and every statement has been read.
+ */
+- (void) statementCursorDidFinish:(TCDStatementCursor *)cursor;
+
+/**
+ A page couldn't be retrieved. Statements already buffered can still be read.
+ */
+- (void) statementCursor:(TCDStatementCursor *)cursor didFailWithError:(NSError *)error;
+@end
+
+/**
+ Walks every statement matching a query, page by page, without keeping what has already been read.
+
+ Pages are retrieved with TCDStatementPageRequest, so statements can be read while their page is still arriving.
+ The cursor holds at most the page being read plus the next one: as soon as the statements left to read fit
+ in one page, the next page is requested. A statement is released by the cursor once nextStatement returns it.
+ Use the cursor from the thread that created it (normally the main thread), and keep a reference to it until it finishes.
+ */
+@interface TCDStatementCursor : NSObject
+
+@property (nonatomic, weak) id<TCDStatementCursorDelegate> delegate;
+
+/**
+ The query being walked.
+ */
+@property (nonatomic, strong, readonly) TCStatementQuery *query;
+
+/**
+ Number of statements waiting to be read.
+ */
+@property (nonatomic, readonly) NSUInteger numberOfBufferedStatements;
+
+/**
+ Number of statements returned by nextStatement so far.
+ */
+@property (nonatomic, readonly) NSUInteger numberOfStatementsRead;
+
+/**
+ Number of pages requested so far.
+ */
+@property (nonatomic, readonly) NSUInteger numberOfPagesRequested;
+
+/**
+ YES once the last page has arrived and every statement has been read.
+ */
+@property (nonatomic, readonly) BOOL isFinished;
+
+/**
+ The error that stopped the cursor (nil unless a page failed).
+ */
+@property (nonatomic, strong, readonly) NSError *error;
+
+/**
+ Designated initializer. The first page isn't requested until start.
+ */
+- (id) initWithQuery:(TCStatementQuery *)aQuery api:(TCAPI *)aAPI;
+
+/**
+ Requests the first page.
+ */
+- (void) start;
+
+/**
+ Stops retrieving pages and discards buffered statements.
+ */
+- (void) cancel;
+
+/**
+ The next statement, or nil if none has arrived yet (or the cursor is finished).
+ */
+- (TCStatement *) nextStatement;
+
+/**
+ Reads every remaining statement as it becomes available.
+ Replaces the delegate for the rest of the walk.
+
+ @param block       Called with each statement, in order. Set stop to YES to cancel the cursor.
+ @param completion  Called once, when the walk is finished (error is nil), fails, or is stopped.
+ */
+- (void) enumerateStatementsUsingBlock:(void (^)(TCStatement *statement, BOOL *stop))block completion:(void (^)(NSError *error))completion;
+
+@end
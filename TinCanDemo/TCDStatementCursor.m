@@ -0,0 +1,211 @@
+//
+//  TCDStatementCursor.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/28/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDStatementCursor.h"
+#import "TCDStatementPageRequest.h"
+
+/**
+ Adapts the block-based enumeration to the delegate protocol.
+ */
+@interface TCDStatementCursorEnumeration : NSObject <TCDStatementCursorDelegate>
+@property (nonatomic, copy) void (^block)(TCStatement *, BOOL *);
+@property (nonatomic, copy) void (^completion)(NSError *);
+@end
+
+@implementation TCDStatementCursorEnumeration
+
+- (void) statementCursorHasStatementsAvailable:(TCDStatementCursor *)cursor
+{
+    if (!self.block)
+        return;
+
+    TCStatement *statement;
+    while ((statement = [cursor nextStatement]))
+    {
+        BOOL stop = NO;
+        self.block(statement, &stop);
+        if (stop)
+        {
+            [cursor cancel];
+            [self complete:nil];
+            return;
+        }
+    }
+}
+
+- (void) statementCursorDidFinish:(TCDStatementCursor *)cursor
+{
+    [self complete:nil];
+}
+
+- (void) statementCursor:(TCDStatementCursor *)cursor didFailWithError:(NSError *)error
+{
+    [self complete:error];
+}
+
+- (void) complete:(NSError *)error
+{
+    void (^completion)(NSError *) = self.completion;
+    self.completion = nil;
+    self.block = nil;
+    if (completion)
+        completion(error);
+}
+
+@end
+
+@interface TCDStatementCursor () <TCDStatementPageRequestDelegate>
+@property (nonatomic, strong, readwrite) TCStatementQuery *query;
+@property (nonatomic, readwrite) NSUInteger numberOfStatementsRead;
+@property (nonatomic, readwrite) NSUInteger numberOfPagesRequested;
+@property (nonatomic, strong, readwrite) NSError *error;
+@property (nonatomic, strong) TCDStatementCursorEnumeration *enumeration;
+@end
+
+@implementation TCDStatementCursor
+{
+    TCAPI *api;
+    NSMutableArray *buffer;
+    TCDStatementPageRequest *pageRequest;
+    NSURL *nextPageURL;
+    // Size of the largest page so far; used to decide when to prefetch.
+    NSUInteger pageSize;
+    BOOL lastPageArrived;
+    BOOL didFinish;
+}
+
+- (id) initWithQuery:(TCStatementQuery *)aQuery api:(TCAPI *)aAPI
+{
+    if ((self = [super init]))
+    {
+        self.query = aQuery;
+        api = aAPI;
+        buffer = [[NSMutableArray alloc] init];
+        pageSize = aQuery.limit > 0 ? (NSUInteger)aQuery.limit : 0;
+    }
+    return self;
+}
+
+- (NSUInteger) numberOfBufferedStatements
+{
+    return buffer.count;
+}
+
+- (BOOL) isFinished
+{
+    return lastPageArrived && buffer.count == 0;
+}
+
+- (void) start
+{
+    if (pageRequest || self.numberOfPagesRequested > 0)
+        return;
+    [self requestPage:[[TCDStatementPageRequest alloc] initWithQuery:self.query api:api]];
+}
+
+- (void) cancel
+{
+    pageRequest.delegate = nil;
+    [pageRequest cancel];
+    pageRequest = nil;
+    nextPageURL = nil;
+    [buffer removeAllObjects];
+    lastPageArrived = YES;
+    didFinish = YES;
+}
+
+- (void) requestPage:(TCDStatementPageRequest *)request
+{
+    pageRequest = request;
+    pageRequest.delegate = self;
+    self.numberOfPagesRequested++;
+    [pageRequest start];
+}
+
+- (void) prefetchIfNeeded
+{
+    // Keep at most one page in hand besides the one being read.
+    if (pageRequest || !nextPageURL || self.error)
+        return;
+    if (pageSize > 0 && buffer.count > pageSize)
+        return;
+
+    NSURL *URL = nextPageURL;
+    nextPageURL = nil;
+    [self requestPage:[[TCDStatementPageRequest alloc] initWithMoreURL:URL api:api]];
+}
+
+- (TCStatement *) nextStatement
+{
+    if (buffer.count == 0)
+        return nil;
+
+    TCStatement *statement = [buffer objectAtIndex:0];
+    [buffer removeObjectAtIndex:0];
+    self.numberOfStatementsRead++;
+    [self prefetchIfNeeded];
+    [self finishIfNeeded];
+    return statement;
+}
+
+- (void) finishIfNeeded
+{
+    if (didFinish || !self.isFinished)
+        return;
+    didFinish = YES;
+    // Let the caller finish with the statement it was just handed first.
+    dispatch_async(dispatch_get_main_queue(), ^{
+        if ([self.delegate respondsToSelector:@selector(statementCursorDidFinish:)])
+            [self.delegate statementCursorDidFinish:self];
+    });
+}
+
+- (void) enumerateStatementsUsingBlock:(void (^)(TCStatement *, BOOL *))block completion:(void (^)(NSError *))completion
+{
+    self.enumeration = [[TCDStatementCursorEnumeration alloc] init];
+    self.enumeration.block = block;
+    self.enumeration.completion = completion;
+    self.delegate = self.enumeration;
+
+    if (self.isFinished || self.error)
+    {
+        [self.enumeration complete:self.error];
+        return;
+    }
+    [self start];
+    [self.enumeration statementCursorHasStatementsAvailable:self];
+}
+
+#pragma mark - TCDStatementPageRequestDelegate
+
+- (void) pageRequest:(TCDStatementPageRequest *)request didReceiveStatement:(TCStatement *)statement
+{
+    [buffer addObject:statement];
+    if ([self.delegate respondsToSelector:@selector(statementCursorHasStatementsAvailable:)])
+        [self.delegate statementCursorHasStatementsAvailable:self];
+}
+
+- (void) pageRequest:(TCDStatementPageRequest *)request didFinishWithMoreURL:(NSURL *)moreURL
+{
+    pageSize = MAX(pageSize, request.statementCount);
+    pageRequest = nil;
+    nextPageURL = moreURL;
+    lastPageArrived = (moreURL == nil);
+    [self prefetchIfNeeded];
+    [self finishIfNeeded];
+}
+
+- (void) pageRequest:(TCDStatementPageRequest *)request didFailWithError:(NSError *)anError
+{
+    pageRequest = nil;
+    self.error = anError;
+    if ([self.delegate respondsToSelector:@selector(statementCursor:didFailWithError:)])
+        [self.delegate statementCursor:self didFailWithError:anError];
+}
+
+@end
@@ -0,0 +1,76 @@
+//
+//  TCDStatementDeque.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/20/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class TCStatement;
+
+/**
+ Insertion-ordered storage for queued statements.
+
+ Statements are appended to fixed-size chunks and indexed by statement id, so adding a statement,
+ looking one up, and removing one by id are all O(1) no matter how many statements are stored.
+ A removed statement leaves a hole in its chunk; chunks are released from the front once they are empty.
+ Reading a range of statements skips whole chunks using their live counts, so taking a batch from the
+ front of the deque is O(batch).
+
+ Not thread safe--TCDStatementQueue serializes access.
+ */
+@interface TCDStatementDeque : NSObject
+
+/**
+ Number of statements stored.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+
+/**
+ Appends a statement. The statement must have an id.
+
+ @param statement   The statement to append.
+ @return            NO if a statement with the same id is already stored (nothing is added).
+ */
+- (BOOL) addStatement:(TCStatement *)statement;
+
+/**
+ The stored statement with the specified id (nil if there isn't one).
+ */
+- (TCStatement *) statementWithId:(NSString *)sid;
+
+/**
+ Removes the statement with the specified id.
+
+ @param sid The id of the statement to remove.
+ @return    The removed statement (nil if there wasn't one).
+ */
+- (TCStatement *) removeStatementWithId:(NSString *)sid;
+
+/**
+ Removes every statement.
+ */
+- (void) removeAllStatements;
+
+/**
+ Retrieves statements by their position in the deque (oldest is 0).
+ If the range extends past the end of the deque, the statements up to the end are returned.
+
+ @param range   The positions of the statements to return.
+ @return        The statements in the range, oldest to newest.
+ */
+- (NSArray *) statementsInRange:(NSRange)range;
+
+/**
+ Every stored statement, oldest to newest.
+ */
+- (NSArray *) allStatements;
+
+/**
+ Enumerates the stored statements oldest to newest. The deque must not be modified during enumeration.
+ */
+- (void) enumerateStatementsUsingBlock:(void (^)(TCStatement *statement, BOOL *stop))block;
+
+@end
@@ -0,0 +1,191 @@
+//
+//  TCDStatementDeque.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/20/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDStatementDeque.h"
+
+static const NSUInteger kTCDDequeChunkCapacity = 256;
+
+/**
+ A run of kTCDDequeChunkCapacity slots. Removed statements are replaced with NSNull.
+ */
+@interface TCDDequeChunk : NSObject
+@property (nonatomic, strong) NSMutableArray *slots;
+@property (nonatomic, readwrite) NSUInteger liveCount;
+/**
+ Index of the first slot that may still hold a statement.
+ */
+@property (nonatomic, readwrite) NSUInteger head;
+@end
+
+@implementation TCDDequeChunk
+
+- (id) init
+{
+    if ((self = [super init]))
+        self.slots = [[NSMutableArray alloc] initWithCapacity:kTCDDequeChunkCapacity];
+    return self;
+}
+
+@end
+
+@implementation TCDStatementDeque
+{
+    NSMutableArray *chunks;
+    // Every statement gets a sequence number; chunk i holds sequences [firstChunkSequence + i * capacity, ...).
+    // Only the last chunk can be partially filled, so a sequence number maps straight to its slot.
+    unsigned long long firstChunkSequence;
+    unsigned long long nextSequence;
+    NSMutableDictionary *sequencesById;
+}
+
+- (id) init
+{
+    if ((self = [super init]))
+    {
+        chunks = [[NSMutableArray alloc] init];
+        sequencesById = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+- (NSUInteger) count
+{
+    return sequencesById.count;
+}
+
+- (BOOL) addStatement:(TCStatement *)statement
+{
+    NSString *sid = statement.sid;
+    if (sid.length == 0 || [sequencesById objectForKey:sid])
+        return NO;
+
+    TCDDequeChunk *tail = [chunks lastObject];
+    if (!tail || tail.slots.count == kTCDDequeChunkCapacity)
+    {
+        tail = [[TCDDequeChunk alloc] init];
+        [chunks addObject:tail];
+    }
+    [tail.slots addObject:statement];
+    tail.liveCount++;
+    [sequencesById setObject:@(nextSequence++) forKey:sid];
+    return YES;
+}
+
+- (TCDDequeChunk *) chunkForSequence:(unsigned long long)sequence slot:(NSUInteger *)slot
+{
+    unsigned long long position = sequence - firstChunkSequence;
+    *slot = (NSUInteger)(position % kTCDDequeChunkCapacity);
+    return [chunks objectAtIndex:(NSUInteger)(position / kTCDDequeChunkCapacity)];
+}
+
+- (TCStatement *) statementWithId:(NSString *)sid
+{
+    NSNumber *sequence = sid ? [sequencesById objectForKey:sid] : nil;
+    if (!sequence)
+        return nil;
+
+    NSUInteger slot;
+    TCDDequeChunk *chunk = [self chunkForSequence:[sequence unsignedLongLongValue] slot:&slot];
+    return [chunk.slots objectAtIndex:slot];
+}
+
+- (TCStatement *) removeStatementWithId:(NSString *)sid
+{
+    NSNumber *sequence = sid ? [sequencesById objectForKey:sid] : nil;
+    if (!sequence)
+        return nil;
+
+    NSUInteger slot;
+    TCDDequeChunk *chunk = [self chunkForSequence:[sequence unsignedLongLongValue] slot:&slot];
+    TCStatement *statement = [chunk.slots objectAtIndex:slot];
+    [chunk.slots replaceObjectAtIndex:slot withObject:[NSNull null]];
+    chunk.liveCount--;
+    [sequencesById removeObjectForKey:sid];
+
+    if (slot == chunk.head)
+    {
+        NSUInteger head = chunk.head;
+        while (head < chunk.slots.count && [chunk.slots objectAtIndex:head] == [NSNull null])
+            head++;
+        chunk.head = head;
+    }
+
+    while (chunks.count > 0 && [[chunks objectAtIndex:0] liveCount] == 0)
+    {
+        // Dropping the last (possibly partial) chunk restarts numbering at the next sequence.
+        if (chunks.count == 1)
+            firstChunkSequence = nextSequence;
+        else
+            firstChunkSequence += kTCDDequeChunkCapacity;
+        [chunks removeObjectAtIndex:0];
+    }
+    return statement;
+}
+
+- (void) removeAllStatements
+{
+    [chunks removeAllObjects];
+    [sequencesById removeAllObjects];
+    firstChunkSequence = nextSequence;
+}
+
+- (NSArray *) statementsInRange:(NSRange)range
+{
+    NSMutableArray *statements = [NSMutableArray arrayWithCapacity:MIN(range.length, self.count)];
+    NSUInteger skip = range.location;
+    for (TCDDequeChunk *chunk in chunks)
+    {
+        if (statements.count >= range.length)
+            break;
+        if (skip >= chunk.liveCount)
+        {
+            skip -= chunk.liveCount;
+            continue;
+        }
+
+        NSUInteger slotCount = chunk.slots.count;
+        for (NSUInteger i = chunk.head; i < slotCount && statements.count < range.length; i++)
+        {
+            id statement = [chunk.slots objectAtIndex:i];
+            if (statement == [NSNull null])
+                continue;
+            if (skip > 0)
+            {
+                skip--;
+                continue;
+            }
+            [statements addObject:statement];
+        }
+    }
+    return statements;
+}
+
+- (NSArray *) allStatements
+{
+    return [self statementsInRange:NSMakeRange(0, self.count)];
+}
+
+- (void) enumerateStatementsUsingBlock:(void (^)(TCStatement *, BOOL *))block
+{
+    BOOL stop = NO;
+    for (TCDDequeChunk *chunk in chunks)
+    {
+        NSUInteger slotCount = chunk.slots.count;
+        for (NSUInteger i = chunk.head; i < slotCount; i++)
+        {
+            id statement = [chunk.slots objectAtIndex:i];
+            if (statement == [NSNull null])
+                continue;
+            block(statement, &stop);
+            if (stop)
+                return;
+        }
+    }
+}
+
+@end
@@ -0,0 +1,68 @@
+//
+//  TCDStatementLane.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/12/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <TinCan/TCActivityDefinition.h>
+
+@class TCStatement;
+
+/**
+ A class of statements in a TCDStatementQueue, drained ahead of or behind the others.
+
+ A statement belongs to the first of the queue's lanes whose verbs include its verb or whose activity types include
+ the type of its activity; statements no lane claims go to the queue's last lane. Within a lane statements are sent
+ oldest first. Lanes share the uploads by weight: each round, a lane sends up to weight statements before the next
+ lane gets its turn, so a lane with weight 8 gets eight times the throughput of a lane with weight 1 while both have
+ a backlog, and neither ever stops completely. maxStatementAge puts a hard bound on how long a statement can wait.
+ */
+@interface TCDStatementLane : NSObject
+
+@property (nonatomic, copy, readonly) NSString *name;
+
+/**
+ Statements the lane sends per round (at least 1).
+ */
+@property (nonatomic, readwrite) NSUInteger weight;
+
+/**
+ Verbs (e.g. "completed", "passed") whose statements belong in the lane.
+ */
+@property (nonatomic, copy) NSSet *verbs;
+
+/**
+ TCActivityType values of the activities whose statements belong in the lane.
+ */
+@property (nonatomic, copy) NSIndexSet *activityTypes;
+
+/**
+ Seconds a statement may wait in the lane before it is sent ahead of every weighted lane (0, the default, for no bound).
+ */
+@property (nonatomic, readwrite) NSTimeInterval maxStatementAge;
+
+/**
+ Designated initializer.
+ */
+- (id) initWithName:(NSString *)name weight:(NSUInteger)weight;
+
+/**
+ YES if the statement's verb or activity type is one of the lane's.
+ */
+- (BOOL) acceptsStatement:(TCStatement *)statement;
+
+/**
+ A lane that takes every statement, i.e. a plain FIFO queue.
+ */
++ (TCDStatementLane *) defaultLane;
+
+/**
+ High (weight 8), normal (weight 3) and low (weight 1, statements wait at most 10 minutes) lanes: completion,
+ pass and fail statements go first, and interacted and experienced statements last.
+ */
++ (NSArray *) standardLanes;
+
+@end
@@ -0,0 +1,62 @@
+//
+//  TCDStatementLane.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/12/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDStatementLane.h"
+#import "TCStatement+TCDLaneAttributes.h"
+
+@implementation TCDStatementLane
+
+- (id) initWithName:(NSString *)name weight:(NSUInteger)weight
+{
+    if ((self = [super init]))
+    {
+        _name = [name copy];
+        self.weight = MAX(weight, (NSUInteger)1);
+    }
+    return self;
+}
+
+- (NSString *) description
+{
+    return [NSString stringWithFormat:@"<%@: %@, weight %lu>", NSStringFromClass([self class]), self.name, (unsigned long)self.weight];
+}
+
+- (BOOL) acceptsStatement:(TCStatement *)statement
+{
+    // The lane attributes of a restored TCDLazyStatement come from the log, so sorting doesn't inflate it.
+    NSString *verb = statement.laneVerb;
+    if (verb && [self.verbs containsObject:verb])
+        return YES;
+    if (self.activityTypes.count > 0)
+    {
+        NSUInteger activityType = statement.laneActivityType;
+        return activityType != NSNotFound && [self.activityTypes containsIndex:activityType];
+    }
+    return NO;
+}
+
++ (TCDStatementLane *) defaultLane
+{
+    return [[TCDStatementLane alloc] initWithName:@"default" weight:1];
+}
+
++ (NSArray *) standardLanes
+{
+    TCDStatementLane *high = [[TCDStatementLane alloc] initWithName:@"high" weight:8];
+    high.verbs = [NSSet setWithObjects:@"completed", @"passed", @"failed", @"mastered", nil];
+
+    TCDStatementLane *low = [[TCDStatementLane alloc] initWithName:@"low" weight:1];
+    low.verbs = [NSSet setWithObjects:@"interacted", @"experienced", nil];
+    low.maxStatementAge = 600;
+
+    // Unclaimed statements fall through to the last lane, so normal goes last and low is matched before it.
+    TCDStatementLane *normal = [[TCDStatementLane alloc] initWithName:@"normal" weight:3];
+    return @[high, low, normal];
+}
+
+@end
@@ -0,0 +1,247 @@
+//
+//  TCDStatementLog.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/18/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+extern NSString* const TCDStatementLogErrorDomain;
+
+typedef enum
+{
+    TCDStatementLogErrorInvalidArgument = 1,
+    /**
+     The records were dropped before they were committed because the log was rebuilt or deleted.
+     */
+    TCDStatementLogErrorDiscarded = 2
+} TCDStatementLogError;
+
+/**
+ How durable a write must be before the log returns to the caller.
+ */
+typedef enum
+{
+    /**
+     Every append/acknowledge call is written and fsync'd before it returns.
+     */
+    TCDStatementLogDurabilityPerStatement,
+    /**
+     Writes from every caller in a commit window share one write and one fsync.
+     Callers block until the window containing their records has been committed.
+     */
+    TCDStatementLogDurabilityPerWindow,
+    /**
+     Writes are committed at the end of the commit window but callers don't wait for it.
+     Records written in the last window before a crash can be lost, and a failed commit is only logged.
+     */
+    TCDStatementLogDurabilityBestEffort
+} TCDStatementLogDurability;
+
+/**
+ Counters describing the group commits a log has performed.
+ */
+@interface TCDStatementLogCommitStatistics : NSObject <NSCopying>
+
+/**
+ Number of commits (one write and fsync each).
+ */
+@property (nonatomic, readonly) NSUInteger commits;
+/**
+ Total number of records written by those commits.
+ */
+@property (nonatomic, readonly) NSUInteger records;
+/**
+ Total number of bytes written by those commits.
+ */
+@property (nonatomic, readonly) unsigned long long bytes;
+/**
+ The most records written by a single commit.
+ */
+@property (nonatomic, readonly) NSUInteger largestCommit;
+/**
+ Average number of records written per commit.
+ */
+@property (nonatomic, readonly) double averageCommitSize;
+/**
+ Sum of the time between the first record entering a commit window and that window being fsync'd.
+ */
+@property (nonatomic, readonly) NSTimeInterval totalLatency;
+/**
+ Average time between the first record entering a commit window and that window being fsync'd.
+ */
+@property (nonatomic, readonly) NSTimeInterval averageLatency;
+/**
+ The longest time a commit window took to be fsync'd.
+ */
+@property (nonatomic, readonly) NSTimeInterval maximumLatency;
+
+@end
+
+/**
+ An append-only, segmented log of keyed records (typically statement JSON keyed by statement id).
+
+ Every change is a single record appended to the active segment: a put for a new record or a tombstone
+ acknowledging that a key is no longer live. Each record carries a CRC32 checksum so a torn write at the
+ tail of the log is detected and discarded when the log is opened. Once the active segment grows past
+ maxSegmentSize a new segment is started. Any sealed segment is compacted in the background once its ratio of
+ live records drops below compactionThreshold: its live records, and the tombstones that still hide records in
+ older segments, are copied forward with their sequence numbers and the segment file is deleted. Replay lets the
+ record with the highest sequence number win for each key, so copied records can't undo newer ones.
+
+ Writes are group committed: records from concurrent callers are collected in a shared buffer and written
+ with a single fsync per commit window (see durability and commitInterval).
+
+ All I/O happens on a private serial queue, so the log may be used from any thread.
+ */
+@interface TCDStatementLog : NSObject
+
+/**
+ The directory holding the segment files.
+ */
+@property (nonatomic, strong, readonly) NSString *directory;
+
+/**
+ Size (in bytes) after which the active segment is sealed and a new one is started (default=1MB).
+ */
+@property (nonatomic, readwrite) unsigned long long maxSegmentSize;
+
+/**
+ Sealed segments with a smaller fraction of live records (counting tombstones that are still needed) than this
+ are compacted (default=0.5).
+ */
+@property (nonatomic, readwrite) double compactionThreshold;
+
+/**
+ Set to YES to set the NSFileProtectionKey on new segments to NSFileProtectionComplete. (default=YES)
+ */
+@property (nonatomic, readwrite) BOOL shouldProtectPersistentStore;
+
+/**
+ How durable a write must be before the log returns to the caller (default=TCDStatementLogDurabilityPerWindow).
+ Use TCDStatementLogDurabilityBestEffort to return without waiting for the fsync.
+ */
+@property (nonatomic, readwrite) TCDStatementLogDurability durability;
+
+/**
+ The length of a commit window in seconds (default=0.01).
+ Ignored when durability is TCDStatementLogDurabilityPerStatement.
+ */
+@property (nonatomic, readwrite) NSTimeInterval commitInterval;
+
+/**
+ A snapshot of the commit counters.
+ */
+@property (nonatomic, readonly) TCDStatementLogCommitStatistics *commitStatistics;
+
+/**
+ Number of live records in the log.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+
+/**
+ Initializes a log stored in the specified directory. The directory is created if it doesn't exist.
+ The log must be opened with -openWithError: before it is used.
+
+ @param aDirectory  The directory to store the segment files in.
+ @return            The initialized (unopened) log.
+ */
+- (id) initWithDirectory:(NSString *)aDirectory;
+
+/**
+ Replays the segments on disk to rebuild the in-memory index of live records.
+ A corrupt record at the end of the active segment (a torn write) is truncated away.
+
+ @param error   Return any error encountered while reading the log.
+ @return        YES if the log was opened.
+ */
+- (BOOL) openWithError:(NSError **)error;
+
+/**
+ Appends put records for the supplied payloads. An existing record with the same key is replaced.
+
+ @param payloads    An array of NSData payloads.
+ @param keys        An array of NSString keys matching the payloads array.
+ @param error       Return any error encountered while writing.
+ @return            YES if every record was written.
+ */
+- (BOOL) appendPayloads:(NSArray *)payloads forKeys:(NSArray *)keys error:(NSError **)error;
+
+/**
+ Appends put records that carry a small metadata blob alongside their payload (e.g. what an index or a queue needs
+ to know about a statement without parsing its JSON). Metadata is kept when records are compacted.
+
+ @param payloads    An array of NSData payloads.
+ @param metadata    An array of NSData metadata (at most 64KB each; NSNull for none) matching the payloads array, or nil.
+ @param keys        An array of NSString keys matching the payloads array.
+ @param error       Return any error encountered while writing.
+ @return            YES if every record was written.
+ */
+- (BOOL) appendPayloads:(NSArray *)payloads metadata:(NSArray *)metadata forKeys:(NSArray *)keys error:(NSError **)error;
+
+/**
+ Appends tombstones for the supplied keys. Keys that aren't live are ignored.
+
+ @param keys    The keys of the records that are no longer needed.
+ @param error   Return any error encountered while writing.
+ @return        YES if every tombstone was written.
+ */
+- (BOOL) acknowledgeKeys:(NSArray *)keys error:(NSError **)error;
+
+/**
+ Immediately commits any records waiting for the end of the current commit window.
+ */
+- (BOOL) synchronizeWithError:(NSError **)error;
+
+/**
+ Deletes every segment in the log.
+ */
+- (BOOL) removeAllRecordsWithError:(NSError **)error;
+
+/**
+ YES if a live record exists for the key.
+ */
+- (BOOL) containsKey:(NSString *)key;
+
+/**
+ The keys of every live record, ordered oldest to newest appended.
+ A record moved by compaction keeps its original position.
+ */
+- (NSArray *) keys;
+
+/**
+ Reads the payload of a live record (nil if the key isn't live).
+ */
+- (NSData *) payloadForKey:(NSString *)key;
+
+/**
+ Enumerates the live records oldest to newest.
+
+ @param block   Invoked with each key and payload. Set stop to YES to stop enumerating.
+ */
+- (void) enumerateRecordsUsingBlock:(void (^)(NSString *key, NSData *payload, BOOL *stop))block;
+
+/**
+ Enumerates the live records oldest to newest without copying their payloads.
+ Each segment is memory-mapped once; the block receives the mapped segment and the range of the payload within it.
+ The mapped data remains valid even if the segment is later compacted away.
+
+ @param block   Invoked with each key, the mapped segment, and the payload's range. Set stop to YES to stop enumerating.
+ */
+- (void) enumerateMappedRecordsUsingBlock:(void (^)(NSString *key, NSData *segmentData, NSRange payloadRange, BOOL *stop))block;
+
+/**
+ Like enumerateMappedRecordsUsingBlock:, also passing the range of each record's metadata within the mapped segment
+ (length 0 if the record has none).
+ */
+- (void) enumerateMappedRecordsWithMetadataUsingBlock:(void (^)(NSString *key, NSData *segmentData, NSRange payloadRange, NSRange metadataRange, BOOL *stop))block;
+
+/**
+ Schedules compaction of any sealed segments that have fallen below compactionThreshold.
+ This is invoked automatically after tombstones are appended.
+ */
+- (void) compactIfNeeded;
+
+@end
@@ -0,0 +1,1011 @@
+//
+//  TCDStatementLog.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/18/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDStatementLog.h"
+#import <zlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+NSString* const TCDStatementLogErrorDomain = @"TCDStatementLogErrorDomain";
+
+static NSString* const kTCDLogSegmentExtension = @"tclog";
+static const uint32_t kTCDLogRecordMagic = 0x52434454;
+// magic(4) type(1) reserved(1) keyLength(2) payloadLength(4) sequence(8) crc32(4)
+static const NSUInteger kTCDLogHeaderLength = 24;
+
+typedef enum
+{
+    TCDLogRecordTypePut = 1,
+    TCDLogRecordTypeTombstone = 2,
+    // A put whose body is key, metadataLength(2), metadata, payload; payloadLength covers all but the key.
+    TCDLogRecordTypePutWithMetadata = 3
+} TCDLogRecordType;
+
+#pragma mark - Byte helpers
+
+static void TCDWriteUInt16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+}
+
+static void TCDWriteUInt32(uint8_t *p, uint32_t v)
+{
+    TCDWriteUInt16(p, v & 0xffff);
+    TCDWriteUInt16(p + 2, (v >> 16) & 0xffff);
+}
+
+static void TCDWriteUInt64(uint8_t *p, uint64_t v)
+{
+    TCDWriteUInt32(p, v & 0xffffffff);
+    TCDWriteUInt32(p + 4, (v >> 32) & 0xffffffff);
+}
+
+static uint16_t TCDReadUInt16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t TCDReadUInt32(const uint8_t *p)
+{
+    return (uint32_t)TCDReadUInt16(p) | ((uint32_t)TCDReadUInt16(p + 2) << 16);
+}
+
+static uint64_t TCDReadUInt64(const uint8_t *p)
+{
+    return (uint64_t)TCDReadUInt32(p) | ((uint64_t)TCDReadUInt32(p + 4) << 32);
+}
+
+static uint32_t TCDRecordChecksum(const uint8_t *header, const uint8_t *body, NSUInteger bodyLength)
+{
+    uLong crc = crc32(0L, header + 4, 16);
+    crc = crc32(crc, body, (uInt)bodyLength);
+    return (uint32_t)crc;
+}
+
+static void TCDAppendRecord(NSMutableData *buffer, TCDLogRecordType type, uint64_t sequence, NSData *keyData, NSData *metadata, NSData *payload)
+{
+    NSUInteger start = buffer.length;
+    [buffer increaseLengthBy:kTCDLogHeaderLength];
+    [buffer appendData:keyData];
+    NSUInteger bodyLength = payload.length;
+    if (type == TCDLogRecordTypePutWithMetadata)
+    {
+        uint8_t metadataLength[2];
+        TCDWriteUInt16(metadataLength, (uint16_t)metadata.length);
+        [buffer appendBytes:metadataLength length:2];
+        [buffer appendData:metadata];
+        bodyLength += 2 + metadata.length;
+    }
+    if (payload)
+        [buffer appendData:payload];
+
+    uint8_t *header = (uint8_t *)buffer.mutableBytes + start;
+    TCDWriteUInt32(header, kTCDLogRecordMagic);
+    header[4] = type;
+    header[5] = 0;
+    TCDWriteUInt16(header + 6, (uint16_t)keyData.length);
+    TCDWriteUInt32(header + 8, (uint32_t)bodyLength);
+    TCDWriteUInt64(header + 12, sequence);
+    TCDWriteUInt32(header + 20, TCDRecordChecksum(header, header + kTCDLogHeaderLength, keyData.length + bodyLength));
+}
+
+#pragma mark - Segments and locations
+
+@interface TCDLogSegment : NSObject
+@property (nonatomic, readwrite) unsigned long long number;
+@property (nonatomic, strong) NSString *path;
+@property (nonatomic, readwrite) unsigned long long size;
+@property (nonatomic, readwrite) NSUInteger recordCount;
+@property (nonatomic, readwrite) NSUInteger liveCount;
+// Tombstones in the segment that still hide a record in an older segment.
+@property (nonatomic, readwrite) NSUInteger tombstoneCount;
+@end
+
+@implementation TCDLogSegment
+@end
+
+@interface TCDLogRecordLocation : NSObject
+@property (nonatomic, strong) NSString *key;
+@property (nonatomic, strong) TCDLogSegment *segment;
+@property (nonatomic, readwrite) unsigned long long offset;
+@property (nonatomic, readwrite) NSUInteger length;
+// Where the record's metadata is (length 0 if it has none).
+@property (nonatomic, readwrite) unsigned long long metadataOffset;
+@property (nonatomic, readwrite) NSUInteger metadataLength;
+@property (nonatomic, readwrite) uint64_t sequence;
+// The oldest segment that may still hold a record for the key; a tombstone is needed while any segment from here to its own exists.
+@property (nonatomic, readwrite) unsigned long long firstSegmentNumber;
+@end
+
+@implementation TCDLogRecordLocation
+@end
+
+/**
+ The records buffered for one commit. Writers waiting on the commit hold on to it to learn how it went,
+ so a failure is reported to exactly the writers whose records were lost.
+ */
+@interface TCDLogCommitWindow : NSObject
+@property (nonatomic, readwrite) BOOL finished;
+// Set if the window's records couldn't be written; guarded by the log's commitCondition.
+@property (nonatomic, strong) NSError *error;
+@end
+
+@implementation TCDLogCommitWindow
+@end
+
+#pragma mark - TCDStatementLogCommitStatistics
+
+@interface TCDStatementLogCommitStatistics ()
+@property (nonatomic, readwrite) NSUInteger commits;
+@property (nonatomic, readwrite) NSUInteger records;
+@property (nonatomic, readwrite) unsigned long long bytes;
+@property (nonatomic, readwrite) NSUInteger largestCommit;
+@property (nonatomic, readwrite) NSTimeInterval totalLatency;
+@property (nonatomic, readwrite) NSTimeInterval maximumLatency;
+@end
+
+@implementation TCDStatementLogCommitStatistics
+
+- (id) copyWithZone:(NSZone *)zone
+{
+    TCDStatementLogCommitStatistics *copy = [[[self class] allocWithZone:zone] init];
+    copy.commits = self.commits;
+    copy.records = self.records;
+    copy.bytes = self.bytes;
+    copy.largestCommit = self.largestCommit;
+    copy.totalLatency = self.totalLatency;
+    copy.maximumLatency = self.maximumLatency;
+    return copy;
+}
+
+- (double) averageCommitSize
+{
+    return self.commits ? (double)self.records / self.commits : 0;
+}
+
+- (NSTimeInterval) averageLatency
+{
+    return self.commits ? self.totalLatency / self.commits : 0;
+}
+
+- (NSString *) description
+{
+    return [NSString stringWithFormat:@"<%@: %lu commits, %.1f records/commit (max %lu), %.2fms average latency (max %.2fms)>", NSStringFromClass([self class]), (unsigned long)self.commits, self.averageCommitSize, (unsigned long)self.largestCommit, self.averageLatency * 1000, self.maximumLatency * 1000];
+}
+
+@end
+
+#pragma mark - TCDStatementLog
+
+@interface TCDStatementLog ()
+{
+    dispatch_queue_t ioQueue;
+    NSMutableDictionary *locations;
+    // Locations in sequence order, as they were put, so the keys don't have to be sorted each time they're read.
+    // Removing or rewriting a key leaves its entry behind to be skipped (see liveLocationForOrderEntry:) rather than
+    // searched for; the entries are pruned once the stale ones outnumber the live ones.
+    NSMutableArray *keyOrder;
+    // Key -> location of the tombstone that deleted it, for the tombstones that are still needed.
+    NSMutableDictionary *tombstones;
+    NSMutableArray *segments;
+    uint64_t nextSequence;
+    int activeFileDescriptor;
+
+    // Group commit: records are encoded into pendingData and written with one fsync per commit window.
+    NSMutableData *pendingData;
+    NSUInteger pendingRecords;
+    CFAbsoluteTime pendingSince;
+    TCDLogCommitWindow *pendingWindow;
+    BOOL commitScheduled;
+    NSCondition *commitCondition;
+    TCDStatementLogCommitStatistics *statistics;
+}
+@property (nonatomic, strong, readwrite) NSString *directory;
+@end
+
+@implementation TCDStatementLog
+
+- (id) initWithDirectory:(NSString *)aDirectory
+{
+    if ((self = [super init]))
+    {
+        self.directory = aDirectory;
+        self.maxSegmentSize = 1024 * 1024;
+        self.compactionThreshold = 0.5;
+        self.shouldProtectPersistentStore = YES;
+        ioQueue = dispatch_queue_create("com.meetmaestro.tincandemo.statementlog", DISPATCH_QUEUE_SERIAL);
+        locations = [[NSMutableDictionary alloc] init];
+        keyOrder = [[NSMutableArray alloc] init];
+        tombstones = [[NSMutableDictionary alloc] init];
+        segments = [[NSMutableArray alloc] init];
+        nextSequence = 1;
+        activeFileDescriptor = -1;
+
+        self.durability = TCDStatementLogDurabilityPerWindow;
+        self.commitInterval = 0.01;
+        pendingData = [[NSMutableData alloc] init];
+        pendingWindow = [[TCDLogCommitWindow alloc] init];
+        commitCondition = [[NSCondition alloc] init];
+        statistics = [[TCDStatementLogCommitStatistics alloc] init];
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    // Pending commits retain the log, so nothing else can be touching it by now.
+    [self commitPendingWithError:NULL];
+    if (activeFileDescriptor >= 0)
+        close(activeFileDescriptor);
+#if !OS_OBJECT_USE_OBJC
+    dispatch_release(ioQueue);
+#endif
+}
+
+#pragma mark Public
+
+- (BOOL) openWithError:(NSError **)error
+{
+    __block BOOL opened = NO;
+    __block NSError *openError = nil;
+    dispatch_sync(ioQueue, ^{
+        NSError *replayError = nil;
+        opened = [self replaySegmentsWithError:&replayError];
+        openError = replayError;
+    });
+    if (!opened && error)
+        *error = openError;
+    return opened;
+}
+
+- (BOOL) appendPayloads:(NSArray *)payloads forKeys:(NSArray *)keys error:(NSError **)error
+{
+    return [self appendPayloads:payloads metadata:nil forKeys:keys error:error];
+}
+
+- (BOOL) appendPayloads:(NSArray *)payloads metadata:(NSArray *)metadata forKeys:(NSArray *)keys error:(NSError **)error
+{
+    if (payloads.count != keys.count || (metadata && metadata.count != keys.count))
+    {
+        if (error)
+            *error = [NSError errorWithDomain:TCDStatementLogErrorDomain code:TCDStatementLogErrorInvalidArgument userInfo:@{NSLocalizedDescriptionKey : @"Every payload must have a key."}];
+        return NO;
+    }
+    if (keys.count == 0)
+        return YES;
+
+    return [self commitRecordsOfType:TCDLogRecordTypePut keys:keys payloads:payloads metadata:metadata error:error];
+}
+
+- (BOOL) acknowledgeKeys:(NSArray *)keys error:(NSError **)error
+{
+    if (keys.count == 0)
+        return YES;
+
+    BOOL acknowledged = [self commitRecordsOfType:TCDLogRecordTypeTombstone keys:keys payloads:nil metadata:nil error:error];
+    [self compactIfNeeded];
+    return acknowledged;
+}
+
+- (BOOL) synchronizeWithError:(NSError **)error
+{
+    __block BOOL synchronized = YES;
+    __block NSError *synchronizeError = nil;
+    dispatch_sync(ioQueue, ^{
+        NSError *commitError = nil;
+        synchronized = [self commitPendingWithError:&commitError];
+        synchronizeError = commitError;
+    });
+    if (!synchronized && error)
+        *error = synchronizeError;
+    return synchronized;
+}
+
+- (TCDStatementLogCommitStatistics *) commitStatistics
+{
+    __block TCDStatementLogCommitStatistics *snapshot = nil;
+    dispatch_sync(ioQueue, ^{
+        snapshot = [statistics copy];
+    });
+    return snapshot;
+}
+
+- (BOOL) removeAllRecordsWithError:(NSError **)error
+{
+    __block BOOL removed = YES;
+    __block NSError *removeError = nil;
+    dispatch_sync(ioQueue, ^{
+        [self discardPending];
+        [self closeActiveSegment];
+        for (TCDLogSegment *segment in segments)
+        {
+            NSError *deleteError = nil;
+            if (![[NSFileManager defaultManager] removeItemAtPath:segment.path error:&deleteError])
+            {
+                removed = NO;
+                removeError = deleteError;
+            }
+        }
+        [segments removeAllObjects];
+        [locations removeAllObjects];
+        [keyOrder removeAllObjects];
+        [tombstones removeAllObjects];
+
+        NSError *openError = nil;
+        if (![self openActiveSegmentWithError:&openError])
+        {
+            removed = NO;
+            removeError = openError;
+        }
+    });
+    if (!removed && error)
+        *error = removeError;
+    return removed;
+}
+
+- (NSUInteger) count
+{
+    __block NSUInteger count = 0;
+    dispatch_sync(ioQueue, ^{
+        count = locations.count;
+    });
+    return count;
+}
+
+- (BOOL) containsKey:(NSString *)key
+{
+    __block BOOL contains = NO;
+    dispatch_sync(ioQueue, ^{
+        contains = [locations objectForKey:key] != nil;
+    });
+    return contains;
+}
+
+- (NSArray *) keys
+{
+    __block NSArray *keys = nil;
+    dispatch_sync(ioQueue, ^{
+        keys = [[self orderedLocations] valueForKey:@"key"];
+    });
+    return keys;
+}
+
+- (NSData *) payloadForKey:(NSString *)key
+{
+    __block NSData *payload = nil;
+    dispatch_sync(ioQueue, ^{
+        TCDLogRecordLocation *location = [locations objectForKey:key];
+        if (!location || ![self commitPendingWithError:NULL])
+            return;
+        NSData *data = [NSData dataWithContentsOfFile:location.segment.path options:NSDataReadingMappedIfSafe error:nil];
+        if (data.length >= location.offset + location.length)
+            payload = [NSData dataWithBytes:(const uint8_t *)data.bytes + location.offset length:location.length];
+    });
+    return payload;
+}
+
+- (void) enumerateRecordsUsingBlock:(void (^)(NSString *, NSData *, BOOL *))block
+{
+    [self enumerateMappedRecordsUsingBlock:^(NSString *key, NSData *segmentData, NSRange payloadRange, BOOL *stop) {
+        block(key, [segmentData subdataWithRange:payloadRange], stop);
+    }];
+}
+
+- (void) enumerateMappedRecordsUsingBlock:(void (^)(NSString *, NSData *, NSRange, BOOL *))block
+{
+    [self enumerateMappedRecordsWithMetadataUsingBlock:^(NSString *key, NSData *segmentData, NSRange payloadRange, NSRange metadataRange, BOOL *stop) {
+        block(key, segmentData, payloadRange, stop);
+    }];
+}
+
+- (void) enumerateMappedRecordsWithMetadataUsingBlock:(void (^)(NSString *, NSData *, NSRange, NSRange, BOOL *))block
+{
+    __block NSArray *ordered = nil;
+    NSMutableDictionary *mappedSegments = [NSMutableDictionary dictionary];
+    dispatch_sync(ioQueue, ^{
+        // Map the segments while holding the queue so compaction can't delete one out from under us.
+        // A mapping stays valid after its segment file is unlinked.
+        [self commitPendingWithError:NULL];
+        ordered = [self orderedLocations];
+        for (TCDLogSegment *segment in segments)
+        {
+            NSData *data = [NSData dataWithContentsOfFile:segment.path options:NSDataReadingMappedIfSafe error:nil];
+            if (data)
+                [mappedSegments setObject:data forKey:segment.path];
+        }
+    });
+
+    BOOL stop = NO;
+    for (TCDLogRecordLocation *location in ordered)
+    {
+        NSData *data = [mappedSegments objectForKey:location.segment.path];
+        if (data.length < location.offset + location.length)
+            continue;
+
+        block(location.key, data, NSMakeRange((NSUInteger)location.offset, location.length), NSMakeRange((NSUInteger)location.metadataOffset, location.metadataLength), &stop);
+        if (stop)
+            break;
+    }
+}
+
+- (void) compactIfNeeded
+{
+    dispatch_async(ioQueue, ^{
+        if (segments.count < 2)
+            return;
+
+        // Any sealed segment may be compacted: its live records and the tombstones that still hide records in
+        // older segments are copied forward, so dropping it can't resurrect anything.
+        NSArray *sealed = [segments subarrayWithRange:NSMakeRange(0, segments.count - 1)];
+        for (TCDLogSegment *segment in sealed)
+        {
+            if (segment.recordCount > 0 && (double)(segment.liveCount + segment.tombstoneCount) / segment.recordCount >= self.compactionThreshold)
+                continue;
+
+            NSError *error = nil;
+            if (![self commitPendingWithError:&error] || ![self compactSegment:segment error:&error])
+            {
+                NSLog(@"Unable to compact statement log segment %@: %@", segment.path, error);
+                break;
+            }
+        }
+    });
+}
+
+#pragma mark Private (ioQueue only)
+
+- (NSString *) pathForSegmentNumber:(unsigned long long)number
+{
+    return [self.directory stringByAppendingPathComponent:[NSString stringWithFormat:@"%08llu.%@", number, kTCDLogSegmentExtension]];
+}
+
+- (NSArray *) orderedLocations
+{
+    NSMutableArray *ordered = [NSMutableArray arrayWithCapacity:locations.count];
+    for (TCDLogRecordLocation *entry in keyOrder)
+    {
+        TCDLogRecordLocation *location = [self liveLocationForOrderEntry:entry];
+        if (location)
+            [ordered addObject:location];
+    }
+    return ordered;
+}
+
+/**
+ The current location of an entry's key, or nil if the key has been removed or rewritten since the entry was added.
+ A record moved by compaction keeps its sequence, so its entry stays live.
+ */
+- (TCDLogRecordLocation *) liveLocationForOrderEntry:(TCDLogRecordLocation *)entry
+{
+    TCDLogRecordLocation *location = [locations objectForKey:entry.key];
+    return (location && location.sequence == entry.sequence) ? location : nil;
+}
+
+- (void) pruneKeyOrderIfNeeded
+{
+    // Amortized O(1) per record: the entries are only walked once there are as many stale ones as live ones.
+    if (keyOrder.count < 2 * locations.count + 64)
+        return;
+    keyOrder = [[self orderedLocations] mutableCopy];
+}
+
+/**
+ YES while a segment that may hold an older record for the tombstone's key still exists.
+ */
+- (BOOL) tombstoneIsNeeded:(TCDLogRecordLocation *)tombstone
+{
+    for (TCDLogSegment *segment in segments)
+    {
+        if (segment.number >= tombstone.segment.number)
+            break;
+        if (segment.number >= tombstone.firstSegmentNumber)
+            return YES;
+    }
+    return NO;
+}
+
+/**
+ Forgets tombstones whose older records have all been compacted away.
+ */
+- (void) discardObsoleteTombstones
+{
+    for (NSString *key in [tombstones allKeys])
+    {
+        TCDLogRecordLocation *tombstone = [tombstones objectForKey:key];
+        if ([self tombstoneIsNeeded:tombstone])
+            continue;
+        tombstone.segment.tombstoneCount--;
+        [tombstones removeObjectForKey:key];
+    }
+}
+
+- (BOOL) replaySegmentsWithError:(NSError **)error
+{
+    NSFileManager *fileManager = [NSFileManager defaultManager];
+    if (![fileManager createDirectoryAtPath:self.directory withIntermediateDirectories:YES attributes:nil error:error])
+        return NO;
+    NSArray *contents = [fileManager contentsOfDirectoryAtPath:self.directory error:error];
+    if (!contents)
+        return NO;
+
+    [self discardPending];
+    [self closeActiveSegment];
+    [locations removeAllObjects];
+    [keyOrder removeAllObjects];
+    [tombstones removeAllObjects];
+    [segments removeAllObjects];
+    nextSequence = 1;
+
+    NSMutableArray *numbers = [NSMutableArray array];
+    for (NSString *filename in contents)
+    {
+        if ([[filename pathExtension] isEqualToString:kTCDLogSegmentExtension])
+            [numbers addObject:@(strtoull([[filename stringByDeletingPathExtension] UTF8String], NULL, 10))];
+    }
+    [numbers sortUsingSelector:@selector(compare:)];
+
+    for (NSNumber *number in numbers)
+    {
+        TCDLogSegment *segment = [[TCDLogSegment alloc] init];
+        segment.number = [number unsignedLongLongValue];
+        segment.path = [self pathForSegmentNumber:segment.number];
+        if (![self replaySegment:segment isActive:(number == [numbers lastObject]) error:error])
+            return NO;
+        [segments addObject:segment];
+    }
+
+    // Compaction moves records forward without changing their sequence, so file order isn't sequence order.
+    keyOrder = [[self orderedLocations] mutableCopy];
+    [keyOrder sortUsingComparator:^NSComparisonResult(TCDLogRecordLocation *a, TCDLogRecordLocation *b) {
+        uint64_t sequenceA = a.sequence;
+        uint64_t sequenceB = b.sequence;
+        if (sequenceA == sequenceB)
+            return NSOrderedSame;
+        return sequenceA < sequenceB ? NSOrderedAscending : NSOrderedDescending;
+    }];
+
+    return [self openActiveSegmentWithError:error];
+}
+
+- (BOOL) replaySegment:(TCDLogSegment *)segment isActive:(BOOL)isActive error:(NSError **)error
+{
+    NSData *data = [NSData dataWithContentsOfFile:segment.path options:NSDataReadingMappedIfSafe error:error];
+    if (!data)
+        return NO;
+
+    const uint8_t *bytes = data.bytes;
+    NSUInteger length = data.length;
+    NSUInteger offset = 0;
+    while (length - offset >= kTCDLogHeaderLength)
+    {
+        const uint8_t *header = bytes + offset;
+        if (TCDReadUInt32(header) != kTCDLogRecordMagic)
+            break;
+
+        TCDLogRecordType type = header[4];
+        NSUInteger keyLength = TCDReadUInt16(header + 6);
+        NSUInteger payloadLength = TCDReadUInt32(header + 8);
+        uint64_t sequence = TCDReadUInt64(header + 12);
+        if (keyLength + payloadLength > length - offset - kTCDLogHeaderLength)
+            break;
+        if (TCDRecordChecksum(header, header + kTCDLogHeaderLength, keyLength + payloadLength) != TCDReadUInt32(header + 20))
+            break;
+        if (type != TCDLogRecordTypePut && type != TCDLogRecordTypeTombstone && type != TCDLogRecordTypePutWithMetadata)
+            break;
+        NSString *key = [[NSString alloc] initWithBytes:header + kTCDLogHeaderLength length:keyLength encoding:NSUTF8StringEncoding];
+        if (!key)
+            break;
+
+        unsigned long long bodyOffset = offset + kTCDLogHeaderLength + keyLength;
+        NSUInteger metadataLength = 0;
+        NSUInteger metadataHeaderLength = 0;
+        if (type == TCDLogRecordTypePutWithMetadata)
+        {
+            if (payloadLength < 2 || (metadataLength = TCDReadUInt16(header + kTCDLogHeaderLength + keyLength)) > payloadLength - 2)
+                break;
+            metadataHeaderLength = 2 + metadataLength;
+        }
+
+        segment.recordCount++;
+        [self applyRecordOfType:type key:key segment:segment offset:bodyOffset + metadataHeaderLength length:payloadLength - metadataHeaderLength
+                 metadataOffset:bodyOffset + 2 metadataLength:metadataLength sequence:sequence];
+        nextSequence = MAX(nextSequence, sequence + 1);
+        offset += kTCDLogHeaderLength + keyLength + payloadLength;
+    }
+    segment.size = offset;
+
+    if (offset < length)
+    {
+        NSLog(@"Discarding %lu unreadable bytes at the end of statement log segment %@", (unsigned long)(length - offset), segment.path);
+        // Anything after the first bad record in the active segment is a torn write; cut it off so new records follow valid ones.
+        if (isActive && truncate([segment.path fileSystemRepresentation], (off_t)offset) != 0)
+        {
+            if (error)
+                *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:@{NSFilePathErrorKey : segment.path}];
+            return NO;
+        }
+    }
+    return YES;
+}
+
+- (void) applyRecordOfType:(TCDLogRecordType)type key:(NSString *)key segment:(TCDLogSegment *)segment offset:(unsigned long long)offset length:(NSUInteger)length
+            metadataOffset:(unsigned long long)metadataOffset metadataLength:(NSUInteger)metadataLength sequence:(uint64_t)sequence
+{
+    TCDLogRecordLocation *previous = [locations objectForKey:key];
+    TCDLogRecordLocation *tombstone = previous ? nil : [tombstones objectForKey:key];
+    TCDLogRecordLocation *latest = previous ?: tombstone;
+    // Records moved by compaction keep their sequence, so a later segment can hold an older record for a key
+    // than an earlier one does; the newest record wins whatever order the segments are read in.
+    if (latest && latest.sequence > sequence)
+        return;
+
+    // A record that only moved (same sequence) keeps its place in the key order; otherwise the previous record's
+    // entry goes stale on its own.
+    BOOL moved = (previous && previous.sequence == sequence);
+    if (previous)
+    {
+        previous.segment.liveCount--;
+        [locations removeObjectForKey:key];
+    }
+    if (tombstone)
+    {
+        tombstone.segment.tombstoneCount--;
+        [tombstones removeObjectForKey:key];
+    }
+
+    TCDLogRecordLocation *location = [[TCDLogRecordLocation alloc] init];
+    location.key = key;
+    location.segment = segment;
+    location.sequence = sequence;
+    location.firstSegmentNumber = latest ? MIN(latest.firstSegmentNumber, segment.number) : segment.number;
+    if (type == TCDLogRecordTypeTombstone)
+    {
+        if ([self tombstoneIsNeeded:location])
+        {
+            [tombstones setObject:location forKey:key];
+            segment.tombstoneCount++;
+        }
+        return;
+    }
+
+    location.offset = offset;
+    location.length = length;
+    location.metadataOffset = metadataOffset;
+    location.metadataLength = metadataLength;
+    [locations setObject:location forKey:key];
+    segment.liveCount++;
+    if (!moved)
+    {
+        [keyOrder addObject:location];
+        [self pruneKeyOrderIfNeeded];
+    }
+}
+
+- (void) closeActiveSegment
+{
+    if (activeFileDescriptor >= 0)
+    {
+        close(activeFileDescriptor);
+        activeFileDescriptor = -1;
+    }
+}
+
+- (BOOL) openActiveSegmentWithError:(NSError **)error
+{
+    TCDLogSegment *active = [segments lastObject];
+    if (!active || (active.size > 0 && active.size >= self.maxSegmentSize))
+    {
+        TCDLogSegment *segment = [[TCDLogSegment alloc] init];
+        segment.number = active ? active.number + 1 : 1;
+        segment.path = [self pathForSegmentNumber:segment.number];
+        [segments addObject:segment];
+        active = segment;
+    }
+
+    [self closeActiveSegment];
+    activeFileDescriptor = open([active.path fileSystemRepresentation], O_WRONLY | O_CREAT | O_APPEND, 0600);
+    if (activeFileDescriptor < 0)
+    {
+        if (error)
+            *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:@{NSFilePathErrorKey : active.path}];
+        return NO;
+    }
+    if (self.shouldProtectPersistentStore)
+        [[NSFileManager defaultManager] setAttributes:@{NSFileProtectionKey : NSFileProtectionComplete} ofItemAtPath:active.path error:nil];
+    return YES;
+}
+
+- (BOOL) writeData:(NSData *)data toSegment:(TCDLogSegment *)segment error:(NSError **)error
+{
+    const uint8_t *bytes = data.bytes;
+    NSUInteger remaining = data.length;
+    while (remaining > 0)
+    {
+        ssize_t written = write(activeFileDescriptor, bytes, remaining);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            int writeErrno = errno;
+            // Drop whatever part of the batch made it to disk so the segment ends on a record boundary.
+            ftruncate(activeFileDescriptor, (off_t)segment.size);
+            if (error)
+                *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:writeErrno userInfo:@{NSFilePathErrorKey : segment.path}];
+            return NO;
+        }
+        bytes += written;
+        remaining -= written;
+    }
+    if (fsync(activeFileDescriptor) != 0)
+    {
+        if (error)
+            *error = [NSError errorWithDomain:NSPOSIXErrorDomain code:errno userInfo:@{NSFilePathErrorKey : segment.path}];
+        return NO;
+    }
+    segment.size += data.length;
+    return YES;
+}
+
+/**
+ Buffers one record per key for the next commit of the active segment and applies them to the index.
+ When sequences is nil each record is assigned a new sequence number.
+ */
+- (BOOL) writeRecordsOfType:(TCDLogRecordType)type keys:(NSArray *)keys payloads:(NSArray *)payloads metadata:(NSArray *)metadata sequences:(NSArray *)sequences error:(NSError **)error
+{
+    TCDLogSegment *active = [segments lastObject];
+    if (activeFileDescriptor < 0 || active.size + pendingData.length >= self.maxSegmentSize)
+    {
+        // Pending records belong to the current segment; commit them before moving on to a new one.
+        if (![self commitPendingWithError:error] || ![self openActiveSegmentWithError:error])
+            return NO;
+        active = [segments lastObject];
+    }
+
+    NSMutableData *batch = pendingData;
+    NSUInteger batchStart = batch.length;
+    unsigned long long *offsets = malloc(sizeof(unsigned long long) * keys.count);
+    NSUInteger *metadataLengths = calloc(keys.count, sizeof(NSUInteger));
+    uint64_t firstSequence = nextSequence;
+    for (NSUInteger i = 0; i < keys.count; i++)
+    {
+        NSData *keyData = [[keys objectAtIndex:i] dataUsingEncoding:NSUTF8StringEncoding];
+        NSData *payload = payloads ? [payloads objectAtIndex:i] : nil;
+        id recordMetadata = metadata ? [metadata objectAtIndex:i] : nil;
+        if (![recordMetadata isKindOfClass:[NSData class]])
+            recordMetadata = nil;
+        if (keyData.length > UINT16_MAX || [recordMetadata length] > UINT16_MAX)
+        {
+            [batch setLength:batchStart];
+            free(offsets);
+            free(metadataLengths);
+            if (error)
+                *error = [NSError errorWithDomain:TCDStatementLogErrorDomain code:TCDStatementLogErrorInvalidArgument userInfo:@{NSLocalizedDescriptionKey : @"Record key or metadata is too long."}];
+            return NO;
+        }
+        TCDLogRecordType recordType = (type == TCDLogRecordTypePut && recordMetadata) ? TCDLogRecordTypePutWithMetadata : type;
+        uint64_t sequence = sequences ? [[sequences objectAtIndex:i] unsignedLongLongValue] : firstSequence + i;
+        // Offset of the body; the payload follows the metadata when there is any.
+        offsets[i] = active.size + batch.length + kTCDLogHeaderLength + keyData.length;
+        metadataLengths[i] = recordMetadata ? [recordMetadata length] : 0;
+        TCDAppendRecord(batch, recordType, sequence, keyData, recordMetadata, payload);
+    }
+
+    if (pendingRecords == 0)
+        pendingSince = CFAbsoluteTimeGetCurrent();
+    pendingRecords += keys.count;
+
+    if (!sequences)
+        nextSequence += keys.count;
+    for (NSUInteger i = 0; i < keys.count; i++)
+    {
+        uint64_t sequence = sequences ? [[sequences objectAtIndex:i] unsignedLongLongValue] : firstSequence + i;
+        active.recordCount++;
+        BOOL hasMetadata = (metadata && [[metadata objectAtIndex:i] isKindOfClass:[NSData class]]);
+        NSUInteger metadataHeaderLength = hasMetadata ? 2 + metadataLengths[i] : 0;
+        [self applyRecordOfType:type key:[keys objectAtIndex:i] segment:active offset:offsets[i] + metadataHeaderLength length:[[payloads objectAtIndex:i] length]
+                 metadataOffset:offsets[i] + 2 metadataLength:metadataLengths[i] sequence:sequence];
+    }
+    free(offsets);
+    free(metadataLengths);
+    return YES;
+}
+
+- (BOOL) compactSegment:(TCDLogSegment *)segment error:(NSError **)error
+{
+    if (segment.liveCount > 0)
+    {
+        NSData *data = [NSData dataWithContentsOfFile:segment.path options:NSDataReadingMappedIfSafe error:error];
+        if (!data)
+            return NO;
+
+        NSMutableArray *keys = [NSMutableArray array];
+        NSMutableArray *payloads = [NSMutableArray array];
+        NSMutableArray *metadata = [NSMutableArray array];
+        NSMutableArray *sequences = [NSMutableArray array];
+        for (TCDLogRecordLocation *location in [self orderedLocations])
+        {
+            if (location.segment != segment)
+                continue;
+            [keys addObject:location.key];
+            [payloads addObject:[data subdataWithRange:NSMakeRange((NSUInteger)location.offset, location.length)]];
+            if (location.metadataLength > 0)
+                [metadata addObject:[data subdataWithRange:NSMakeRange((NSUInteger)location.metadataOffset, location.metadataLength)]];
+            else
+                [metadata addObject:[NSNull null]];
+            [sequences addObject:@(location.sequence)];
+        }
+        // Moved records keep their sequence numbers so the original queue order survives compaction.
+        if (![self writeRecordsOfType:TCDLogRecordTypePut keys:keys payloads:payloads metadata:metadata sequences:sequences error:error])
+            return NO;
+    }
+
+    // Tombstones hiding records in older segments go forward too, keeping their sequence numbers.
+    NSMutableArray *tombstoneKeys = [NSMutableArray array];
+    NSMutableArray *tombstoneSequences = [NSMutableArray array];
+    for (TCDLogRecordLocation *tombstone in [tombstones allValues])
+    {
+        if (tombstone.segment != segment || ![self tombstoneIsNeeded:tombstone])
+            continue;
+        [tombstoneKeys addObject:tombstone.key];
+        [tombstoneSequences addObject:@(tombstone.sequence)];
+    }
+    if (tombstoneKeys.count > 0 && ![self writeRecordsOfType:TCDLogRecordTypeTombstone keys:tombstoneKeys payloads:nil metadata:nil sequences:tombstoneSequences error:error])
+        return NO;
+
+    // Whatever was copied must be durable before the segment is deleted, whatever the durability setting.
+    if (![self commitPendingWithError:error])
+        return NO;
+    if (![[NSFileManager defaultManager] removeItemAtPath:segment.path error:error])
+        return NO;
+    [segments removeObject:segment];
+    [self discardObsoleteTombstones];
+    return YES;
+}
+
+#pragma mark Group commit
+
+/**
+ Buffers the records and then waits for them to be as durable as the durability setting asks for.
+ Tombstones are only written for keys that are live.
+ */
+- (BOOL) commitRecordsOfType:(TCDLogRecordType)type keys:(NSArray *)keys payloads:(NSArray *)payloads metadata:(NSArray *)metadata error:(NSError **)error
+{
+    __block BOOL written = YES;
+    __block NSError *writeError = nil;
+    __block TCDLogCommitWindow *window = nil;
+    TCDStatementLogDurability durability = self.durability;
+    dispatch_sync(ioQueue, ^{
+        NSArray *recordKeys = keys;
+        if (type == TCDLogRecordTypeTombstone)
+        {
+            NSMutableArray *liveKeys = [NSMutableArray arrayWithCapacity:keys.count];
+            for (NSString *key in keys)
+            {
+                if ([locations objectForKey:key])
+                    [liveKeys addObject:key];
+            }
+            recordKeys = liveKeys;
+        }
+        if (recordKeys.count == 0)
+            return;
+
+        NSError *blockError = nil;
+        written = [self writeRecordsOfType:type keys:recordKeys payloads:payloads metadata:metadata sequences:nil error:&blockError];
+        if (written)
+        {
+            window = pendingWindow;
+            if (durability == TCDStatementLogDurabilityPerStatement)
+                written = [self commitPendingWithError:&blockError];
+            else
+                [self scheduleCommit];
+        }
+        writeError = blockError;
+    });
+
+    if (written && window && durability == TCDStatementLogDurabilityPerWindow)
+    {
+        [commitCondition lock];
+        while (!window.finished)
+            [commitCondition wait];
+        if (window.error)
+        {
+            written = NO;
+            writeError = window.error;
+        }
+        [commitCondition unlock];
+    }
+
+    if (!written && error)
+        *error = writeError;
+    return written;
+}
+
+- (void) scheduleCommit
+{
+    if (commitScheduled)
+        return;
+    commitScheduled = YES;
+
+    dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(self.commitInterval * NSEC_PER_SEC)), ioQueue, ^{
+        commitScheduled = NO;
+        NSError *error = nil;
+        if (![self commitPendingWithError:&error])
+            NSLog(@"Unable to commit the statement log: %@", error);
+    });
+}
+
+/**
+ Writes every buffered record with a single fsync and wakes the writers waiting on this commit window.
+ */
+- (BOOL) commitPendingWithError:(NSError **)error
+{
+    if (pendingData.length == 0)
+        return YES;
+
+    NSData *data = pendingData;
+    NSUInteger records = pendingRecords;
+    CFAbsoluteTime since = pendingSince;
+    TCDLogCommitWindow *window = pendingWindow;
+    pendingData = [[NSMutableData alloc] init];
+    pendingRecords = 0;
+    pendingWindow = [[TCDLogCommitWindow alloc] init];
+
+    NSError *commitError = nil;
+    BOOL committed = [self writeData:data toSegment:[segments lastObject] error:&commitError];
+    if (committed)
+    {
+        NSTimeInterval latency = CFAbsoluteTimeGetCurrent() - since;
+        statistics.commits++;
+        statistics.records += records;
+        statistics.bytes += data.length;
+        statistics.largestCommit = MAX(statistics.largestCommit, records);
+        statistics.totalLatency += latency;
+        statistics.maximumLatency = MAX(statistics.maximumLatency, latency);
+    }
+    else
+    {
+        // The index already points at the lost records; rebuild it from what actually made it to disk.
+        [self replaySegmentsWithError:NULL];
+    }
+
+    [commitCondition lock];
+    window.finished = YES;
+    if (!committed)
+        window.error = commitError;
+    [commitCondition broadcast];
+    [commitCondition unlock];
+
+    if (!committed && error)
+        *error = commitError;
+    return committed;
+}
+
+/**
+ Drops buffered records without writing them (the caller is about to rebuild or delete the log).
+ Writers waiting on the window are told their records weren't committed.
+ */
+- (void) discardPending
+{
+    if (pendingData.length == 0)
+        return;
+
+    TCDLogCommitWindow *window = pendingWindow;
+    pendingData = [[NSMutableData alloc] init];
+    pendingRecords = 0;
+    pendingWindow = [[TCDLogCommitWindow alloc] init];
+
+    [commitCondition lock];
+    window.finished = YES;
+    window.error = [NSError errorWithDomain:TCDStatementLogErrorDomain code:TCDStatementLogErrorDiscarded userInfo:@{NSLocalizedDescriptionKey : @"The records were discarded before they were committed."}];
+    [commitCondition broadcast];
+    [commitCondition unlock];
+}
+
+@end
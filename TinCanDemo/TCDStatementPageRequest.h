@@ -0,0 +1,91 @@
+//
+//  TCDStatementPageRequest.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/27/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "TCDRequestRateLimiter.h"
+
+@class TCAPI, TCStatement, TCStatementQuery, TCDStatementPageRequest;
+
+/**
+ Notified as a page of statements arrives. Each method is called on the thread the request was started on.
+ */
+@protocol TCDStatementPageRequestDelegate <NSObject>
+@required
+/**
+ A statement in the page has arrived. Statements arrive in the order the LRS sent them.
+ */
+- (void) pageRequest:(TCDStatementPageRequest *)request didReceiveStatement:(TCStatement *)statement;
+
+/**
+ The whole page has arrived.
+
+ @param request The request that finished.
+ @param moreURL The URL of the next page (nil if this was the last page).
+ */
+- (void) pageRequest:(TCDStatementPageRequest *)request didFinishWithMoreURL:(NSURL *)moreURL;
+
+/**
+ The page couldn't be retrieved or read. Statements already delivered remain valid.
+ */
+- (void) pageRequest:(TCDStatementPageRequest *)request didFailWithError:(NSError *)error;
+@end
+
+/**
+ GETs one page of statements and delivers each statement as soon as its JSON has arrived.
+
+ TCAPIGetStatementsRequest waits for the whole response and parses it into one dictionary before any statement
+ exists. This request lets TinCan build the URL, headers, and credentials (through TCAPI's authorization provider,
+ so the request pipeline applies), then runs the connection itself and feeds the response through a
+ TCDStatementPageScanner, decoding one statement at a time. The connection waits for the TCDRequestRateLimiter
+ registered for the API's authorization provider, like any request TCAPI starts.
+ */
+@interface TCDStatementPageRequest : NSObject <NSURLConnectionDataDelegate, TCDRateLimitedRequest>
+
+@property (nonatomic, weak) id<TCDStatementPageRequestDelegate> delegate;
+
+/**
+ The URL of the page.
+ */
+@property (nonatomic, strong, readonly) NSURL *URL;
+
+/**
+ Number of statements delivered so far.
+ */
+@property (nonatomic, readonly) NSUInteger statementCount;
+
+/**
+ YES from start until the request finishes, fails, or is cancelled.
+ */
+@property (nonatomic, readonly) BOOL isActive;
+
+/**
+ Creates a request for the first page of a query.
+ */
+- (id) initWithQuery:(TCStatementQuery *)query api:(TCAPI *)api;
+
+/**
+ Creates a request for a page from the "more" URL of the previous page.
+ */
+- (id) initWithMoreURL:(NSURL *)moreURL api:(TCAPI *)api;
+
+/**
+ The URL of the page after a result's "more" property, resolved against the API's endpoint (nil if more is empty).
+ */
++ (NSURL *) URLForMore:(NSString *)more api:(TCAPI *)api;
+
+/**
+ Starts the request on the current run loop (once the API's rate limiter admits it).
+ */
+- (void) start;
+
+/**
+ Stops the request. No more delegate methods are called.
+ */
+- (void) cancel;
+
+@end
@@ -0,0 +1,201 @@
+//
+//  TCDStatementPageRequest.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/27/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDStatementPageRequest.h"
+#import "TCDStatementPageScanner.h"
+#import "TCAPIRequest+TCDURLRequest.h"
+#import "TCStatement+TCDJSONEncoding.h"
+
+@interface TCDStatementPageRequest ()
+@property (nonatomic, strong, readwrite) NSURL *URL;
+@property (nonatomic, readwrite) NSUInteger statementCount;
+@property (nonatomic, readwrite) BOOL isActive;
+@end
+
+@implementation TCDStatementPageRequest
+{
+    TCAPI *api;
+    TCAPIRequest *apiRequest;
+    NSURLRequest *URLRequest;
+    NSRunLoop *runLoop;
+    NSURLConnection *connection;
+    TCDStatementPageScanner *scanner;
+    NSInteger statusCode;
+    NSMutableData *errorBody;
+}
+
+- (id) initWithAPIRequest:(TCAPIRequest *)request api:(TCAPI *)aAPI
+{
+    if ((self = [super init]))
+    {
+        api = aAPI;
+        // Let TinCan build the request exactly as it would send it, without sending it.
+        // prepareRequest adds the credentials (and runs the pipeline's filters) itself.
+        [request prepareRequest];
+        apiRequest = request;
+        URLRequest = [request.URLRequest copy];
+        self.URL = URLRequest.URL ?: request.URL;
+    }
+    return self;
+}
+
+- (id) initWithQuery:(TCStatementQuery *)query api:(TCAPI *)aAPI
+{
+    TCAPIGetStatementsRequest *request = [[TCAPIGetStatementsRequest alloc] initWithQuery:query onLRS:aAPI.endpoint
+                                                                usingAuthenticationProvider:aAPI.authorizationProvider delegate:nil];
+    return [self initWithAPIRequest:request api:aAPI];
+}
+
+- (id) initWithMoreURL:(NSURL *)moreURL api:(TCAPI *)aAPI
+{
+    TCAPIRequest *request = [[TCAPIRequest alloc] initWithURL:moreURL andAuthorizationProvider:aAPI.authorizationProvider delegate:nil];
+    request.HTTPMethod = TCAPIRequestTypeGET;
+    return [self initWithAPIRequest:request api:aAPI];
+}
+
++ (NSURL *) URLForMore:(NSString *)more api:(TCAPI *)aAPI
+{
+    if (more.length == 0)
+        return nil;
+    // "more" is relative to the LRS host (e.g. /TCAPI/statements?more=...).
+    return [[NSURL URLWithString:more relativeToURL:aAPI.endpoint] absoluteURL];
+}
+
+- (void) start
+{
+    if (self.isActive || !URLRequest)
+        return;
+
+    __weak TCDStatementPageRequest *weakSelf = self;
+    scanner = [[TCDStatementPageScanner alloc] init];
+    scanner.statementHandler = ^(NSData *statementJSON) {
+        [weakSelf decodeStatement:statementJSON];
+    };
+    statusCode = 0;
+    errorBody = nil;
+    self.statementCount = 0;
+    self.isActive = YES;
+    runLoop = [NSRunLoop currentRunLoop];
+
+    // The connection is opened here rather than by -[TCAPIRequest start], so ask the limiter for admission directly.
+    TCDRequestRateLimiter *rateLimiter = [TCDRequestRateLimiter rateLimiterForAuthorizationProvider:api.authorizationProvider];
+    if (rateLimiter)
+        [rateLimiter startRequest:self];
+    else
+        [self startAdmittedRequest];
+}
+
+#pragma mark - TCDRateLimitedRequest
+
+- (TCAPIRequest *) rateLimitedRequest
+{
+    return apiRequest;
+}
+
+- (void) startAdmittedRequest
+{
+    // The limiter may admit the request after it was cancelled.
+    if (!self.isActive || connection)
+        return;
+    connection = [[NSURLConnection alloc] initWithRequest:URLRequest delegate:self startImmediately:NO];
+    [connection scheduleInRunLoop:runLoop forMode:NSDefaultRunLoopMode];
+    [connection start];
+}
+
+- (void) cancel
+{
+    [[TCDRequestRateLimiter rateLimiterForAuthorizationProvider:api.authorizationProvider] removeQueuedRequest:self];
+    [connection cancel];
+    [self end];
+}
+
+- (void) end
+{
+    connection = nil;
+    runLoop = nil;
+    [scanner stop];
+    scanner = nil;
+    self.isActive = NO;
+}
+
+- (void) decodeStatement:(NSData *)statementJSON
+{
+    if (!self.isActive)
+        return;
+
+    TCStatement *statement = [TCStatement statementWithJSONBytes:statementJSON.bytes length:statementJSON.length error:NULL];
+    if (!statement)
+        return;
+
+    self.statementCount++;
+    [self.delegate pageRequest:self didReceiveStatement:statement];
+}
+
+- (void) failWithError:(NSError *)error
+{
+    [connection cancel];
+    [self end];
+    [self.delegate pageRequest:self didFailWithError:error];
+}
+
+#pragma mark - NSURLConnectionDataDelegate
+
+- (void) connection:(NSURLConnection *)aConnection didReceiveResponse:(NSURLResponse *)response
+{
+    statusCode = [response isKindOfClass:[NSHTTPURLResponse class]] ? [(NSHTTPURLResponse *)response statusCode] : 200;
+    if (statusCode != 200)
+        errorBody = [[NSMutableData alloc] init];
+    if (statusCode == 429)
+        [[TCDRequestRateLimiter rateLimiterForAuthorizationProvider:api.authorizationProvider] requestWasThrottledWithResponse:(NSHTTPURLResponse *)response];
+}
+
+- (void) connection:(NSURLConnection *)aConnection didReceiveData:(NSData *)data
+{
+    if (errorBody)
+    {
+        [errorBody appendData:data];
+        return;
+    }
+
+    // A delegate that cancels from pageRequest:didReceiveStatement: releases the scanner while it is scanning.
+    TCDStatementPageScanner *pageScanner = scanner;
+    NSError *error = nil;
+    if (![pageScanner appendData:data error:&error])
+        [self failWithError:error];
+}
+
+- (void) connectionDidFinishLoading:(NSURLConnection *)aConnection
+{
+    if (errorBody)
+    {
+        NSString *message = [[NSString alloc] initWithData:errorBody encoding:NSUTF8StringEncoding];
+        [self failWithError:[NSError errorWithDomain:NSURLErrorDomain code:statusCode
+                                            userInfo:@{ NSLocalizedDescriptionKey : message ?: [NSHTTPURLResponse localizedStringForStatusCode:statusCode] }]];
+        return;
+    }
+
+    TCDStatementPageScanner *pageScanner = scanner;
+    NSError *error = nil;
+    if (![pageScanner finishWithError:&error])
+    {
+        [self failWithError:error];
+        return;
+    }
+
+    NSURL *moreURL = [[self class] URLForMore:pageScanner.more api:api];
+    [self end];
+    [self.delegate pageRequest:self didFinishWithMoreURL:moreURL];
+}
+
+- (void) connection:(NSURLConnection *)aConnection didFailWithError:(NSError *)error
+{
+    [self end];
+    [self.delegate pageRequest:self didFailWithError:error];
+}
+
+@end
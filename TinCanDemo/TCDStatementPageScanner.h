@@ -0,0 +1,72 @@
+//
+//  TCDStatementPageScanner.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/27/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+extern NSString* const TCDStatementPageScannerErrorDomain;
+
+/**
+ Finds the statements in a statement result ({"statements": [...], "more": "..."}) as its bytes arrive,
+ without building the whole response.
+
+ The scanner only looks at JSON structure: it jumps from one quote, bracket, brace, or comma to the next,
+ testing 16 bytes at a time (NEON on ARM, SSE2 on Intel, byte by byte elsewhere). Each element of the
+ top-level "statements" array is handed to statementHandler as soon as its closing brace arrives, and only
+ the bytes of an unfinished element are kept between calls to appendData:. The "more" URL is picked out
+ along the way.
+ */
+@interface TCDStatementPageScanner : NSObject
+
+/**
+ Called with the JSON of each statement, in order, from appendData: and finish.
+ */
+@property (nonatomic, copy) void (^statementHandler)(NSData *statementJSON);
+
+/**
+ The value of the "more" property (nil if the page didn't have one or it hasn't been read yet).
+ */
+@property (nonatomic, strong, readonly) NSString *more;
+
+/**
+ Number of statements found so far.
+ */
+@property (nonatomic, readonly) NSUInteger statementCount;
+
+/**
+ Number of bytes scanned so far.
+ */
+@property (nonatomic, readonly) unsigned long long byteCount;
+
+/**
+ Scans the next part of the response.
+
+ @param data    The bytes that follow the bytes already scanned.
+ @param error   Returns an error if the response isn't well-formed.
+ @return        NO if the response isn't well-formed (no more statements will be found).
+ */
+- (BOOL) appendData:(NSData *)data error:(NSError **)error;
+
+/**
+ Stops scanning. Called from statementHandler, appendData: returns as soon as the handler does; no more statements are found.
+ */
+- (void) stop;
+
+/**
+ YES once stop has been called.
+ */
+@property (nonatomic, readonly, getter = isStopped) BOOL stopped;
+
+/**
+ Checks that the whole response has been scanned.
+
+ @param error   Returns an error if the response ended early.
+ @return        NO if the response ended in the middle of a value.
+ */
+- (BOOL) finishWithError:(NSError **)error;
+
+@end
@@ -0,0 +1,319 @@
+//
+//  TCDStatementPageScanner.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/27/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDStatementPageScanner.h"
+
+#if defined(__ARM_NEON__)
+#import <arm_neon.h>
+#elif defined(__SSE2__)
+#import <emmintrin.h>
+#endif
+
+NSString* const TCDStatementPageScannerErrorDomain = @"TCDStatementPageScannerErrorDomain";
+
+static inline BOOL TCDIsStructural(uint8_t c)
+{
+    return c == '"' || c == '{' || c == '}' || c == '[' || c == ']' || c == ',';
+}
+
+static inline BOOL TCDIsStringSpecial(uint8_t c)
+{
+    return c == '"' || c == '\\';
+}
+
+/**
+ Offset of the first quote, brace, bracket, or comma in bytes (length if there isn't one).
+ */
+static size_t TCDFindStructural(const uint8_t *bytes, size_t length)
+{
+    size_t i = 0;
+#if defined(__ARM_NEON__)
+    const uint8x16_t quote = vdupq_n_u8('"'), comma = vdupq_n_u8(',');
+    const uint8x16_t openBrace = vdupq_n_u8('{'), closeBrace = vdupq_n_u8('}');
+    const uint8x16_t openBracket = vdupq_n_u8('['), closeBracket = vdupq_n_u8(']');
+    for (; i + 16 <= length; i += 16)
+    {
+        uint8x16_t v = vld1q_u8(bytes + i);
+        uint8x16_t match = vorrq_u8(vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, comma)),
+                                    vorrq_u8(vorrq_u8(vceqq_u8(v, openBrace), vceqq_u8(v, closeBrace)),
+                                             vorrq_u8(vceqq_u8(v, openBracket), vceqq_u8(v, closeBracket))));
+        uint64x2_t lanes = vreinterpretq_u64_u8(match);
+        if (vgetq_lane_u64(lanes, 0) | vgetq_lane_u64(lanes, 1))
+            break;
+    }
+#elif defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"'), comma = _mm_set1_epi8(',');
+    const __m128i openBrace = _mm_set1_epi8('{'), closeBrace = _mm_set1_epi8('}');
+    const __m128i openBracket = _mm_set1_epi8('['), closeBracket = _mm_set1_epi8(']');
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(bytes + i));
+        __m128i match = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, comma)),
+                                     _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, openBrace), _mm_cmpeq_epi8(v, closeBrace)),
+                                                  _mm_or_si128(_mm_cmpeq_epi8(v, openBracket), _mm_cmpeq_epi8(v, closeBracket))));
+        int mask = _mm_movemask_epi8(match);
+        if (mask)
+            return i + (size_t)__builtin_ctz(mask);
+    }
+#endif
+    // The vector loop stops at the first block with a match; find it exactly (or finish the tail).
+    for (; i < length; i++)
+    {
+        if (TCDIsStructural(bytes[i]))
+            return i;
+    }
+    return length;
+}
+
+/**
+ Offset of the first quote or backslash in bytes (length if there isn't one).
+ */
+static size_t TCDFindStringSpecial(const uint8_t *bytes, size_t length)
+{
+    size_t i = 0;
+#if defined(__ARM_NEON__)
+    const uint8x16_t quote = vdupq_n_u8('"'), backslash = vdupq_n_u8('\\');
+    for (; i + 16 <= length; i += 16)
+    {
+        uint8x16_t v = vld1q_u8(bytes + i);
+        uint64x2_t lanes = vreinterpretq_u64_u8(vorrq_u8(vceqq_u8(v, quote), vceqq_u8(v, backslash)));
+        if (vgetq_lane_u64(lanes, 0) | vgetq_lane_u64(lanes, 1))
+            break;
+    }
+#elif defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"'), backslash = _mm_set1_epi8('\\');
+    for (; i + 16 <= length; i += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i *)(bytes + i));
+        int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)));
+        if (mask)
+            return i + (size_t)__builtin_ctz(mask);
+    }
+#endif
+    for (; i < length; i++)
+    {
+        if (TCDIsStringSpecial(bytes[i]))
+            return i;
+    }
+    return length;
+}
+
+typedef enum
+{
+    TCDPageKeyOther,
+    TCDPageKeyStatements,
+    TCDPageKeyMore
+} TCDPageKey;
+
+@interface TCDStatementPageScanner ()
+@property (nonatomic, strong, readwrite) NSString *more;
+@property (nonatomic, readwrite) NSUInteger statementCount;
+@property (nonatomic, readwrite) unsigned long long byteCount;
+@property (nonatomic, readwrite, getter = isStopped) BOOL stopped;
+@end
+
+@implementation TCDStatementPageScanner
+{
+    // Bytes from the oldest one still needed (an unfinished statement or string) to the end of the data so far.
+    NSMutableData *buffer;
+    // Offsets into buffer.
+    NSUInteger position;
+    NSUInteger stringStart;
+    NSUInteger elementStart;
+
+    NSUInteger depth;
+    BOOL inString;
+    BOOL expectingKey;
+    BOOL inStatements;
+    TCDPageKey currentKey;
+    BOOL failed;
+}
+
+- (id) init
+{
+    if ((self = [super init]))
+    {
+        buffer = [[NSMutableData alloc] init];
+        elementStart = NSNotFound;
+    }
+    return self;
+}
+
+- (BOOL) failWithMessage:(NSString *)message error:(NSError **)error
+{
+    failed = YES;
+    if (error)
+        *error = [NSError errorWithDomain:TCDStatementPageScannerErrorDomain code:1
+                                 userInfo:@{ NSLocalizedDescriptionKey : message }];
+    return NO;
+}
+
+- (void) stringEndedAt:(NSUInteger)end
+{
+    if (depth != 1)
+        return;
+
+    const char *bytes = (const char *)buffer.bytes + stringStart + 1;
+    NSUInteger length = end - stringStart - 1;
+    if (expectingKey)
+    {
+        expectingKey = NO;
+        if (length == 10 && memcmp(bytes, "statements", 10) == 0)
+            currentKey = TCDPageKeyStatements;
+        else if (length == 4 && memcmp(bytes, "more", 4) == 0)
+            currentKey = TCDPageKeyMore;
+        else
+            currentKey = TCDPageKeyOther;
+    }
+    else if (currentKey == TCDPageKeyMore)
+    {
+        // Let NSJSONSerialization deal with any escapes in the one string we keep.
+        NSData *literal = [buffer subdataWithRange:NSMakeRange(stringStart, end + 1 - stringStart)];
+        id value = [NSJSONSerialization JSONObjectWithData:literal options:NSJSONReadingAllowFragments error:nil];
+        self.more = [value isKindOfClass:[NSString class]] && [value length] > 0 ? value : nil;
+    }
+}
+
+- (BOOL) scanWithError:(NSError **)error
+{
+    const uint8_t *bytes = buffer.bytes;
+    NSUInteger length = buffer.length;
+
+    while (position < length)
+    {
+        if (inString)
+        {
+            NSUInteger k = position + TCDFindStringSpecial(bytes + position, length - position);
+            if (k >= length)
+            {
+                position = length;
+                break;
+            }
+            if (bytes[k] == '\\')
+            {
+                // Skip the escaped character; if it hasn't arrived yet, resume at the backslash.
+                if (k + 1 >= length)
+                {
+                    position = k;
+                    break;
+                }
+                position = k + 2;
+                continue;
+            }
+            inString = NO;
+            position = k + 1;
+            [self stringEndedAt:k];
+            continue;
+        }
+
+        NSUInteger k = position + TCDFindStructural(bytes + position, length - position);
+        if (k >= length)
+        {
+            position = length;
+            break;
+        }
+        uint8_t c = bytes[k];
+        position = k + 1;
+
+        switch (c)
+        {
+            case '"':
+                inString = YES;
+                stringStart = k;
+                break;
+
+            case '{':
+            case '[':
+                if (depth == 1 && c == '[' && !expectingKey && currentKey == TCDPageKeyStatements)
+                    inStatements = YES;
+                else if (depth == 2 && inStatements && c == '{')
+                    elementStart = k;
+                depth++;
+                if (depth == 1)
+                    expectingKey = (c == '{');
+                break;
+
+            case '}':
+            case ']':
+                if (depth == 0)
+                    return [self failWithMessage:@"Unbalanced closing bracket in statement result" error:error];
+                depth--;
+                if (depth == 2 && inStatements && elementStart != NSNotFound)
+                {
+                    NSData *statement = [buffer subdataWithRange:NSMakeRange(elementStart, k + 1 - elementStart)];
+                    elementStart = NSNotFound;
+                    self.statementCount++;
+                    if (self.statementHandler)
+                        self.statementHandler(statement);
+                    // The handler may have cancelled the page; nothing after it should be scanned.
+                    if (self.stopped)
+                        return YES;
+                }
+                else if (depth == 1 && inStatements)
+                {
+                    inStatements = NO;
+                }
+                break;
+
+            case ',':
+                if (depth == 1)
+                    expectingKey = YES;
+                break;
+        }
+    }
+    return YES;
+}
+
+- (void) discardScannedBytes
+{
+    NSUInteger keepFrom = position;
+    if (inString)
+        keepFrom = MIN(keepFrom, stringStart);
+    if (elementStart != NSNotFound)
+        keepFrom = MIN(keepFrom, elementStart);
+    if (keepFrom == 0)
+        return;
+
+    [buffer replaceBytesInRange:NSMakeRange(0, keepFrom) withBytes:NULL length:0];
+    position -= keepFrom;
+    if (inString)
+        stringStart -= keepFrom;
+    if (elementStart != NSNotFound)
+        elementStart -= keepFrom;
+}
+
+- (void) stop
+{
+    self.stopped = YES;
+}
+
+- (BOOL) appendData:(NSData *)data error:(NSError **)error
+{
+    if (self.stopped)
+        return YES;
+    if (failed)
+        return [self failWithMessage:@"The statement result could not be read" error:error];
+
+    self.byteCount += data.length;
+    [buffer appendData:data];
+    if (![self scanWithError:error])
+        return NO;
+    [self discardScannedBytes];
+    return YES;
+}
+
+- (BOOL) finishWithError:(NSError **)error
+{
+    if (failed)
+        return [self failWithMessage:@"The statement result could not be read" error:error];
+    if (depth != 0 || inString)
+        return [self failWithMessage:@"The statement result ended early" error:error];
+    return YES;
+}
+
+@end
@@ -0,0 +1,67 @@
+//
+//  TCDStatementQueryMatcher.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/3/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class TCStatement, TCStatementQuery, TCDStatementAttributes;
+
+/**
+ Evaluates the filters of a TCStatementQuery on the client.
+
+ The query's statement id, verb, object, actor, registration, instructor, since and until are compared with
+ TCDStatementAttributes; the other parameters (limit, authoritative, sparse) don't select statements and are
+ ignored. A filter the query doesn't set matches every statement. With context set, the object filter also
+ matches statements that have the object as a parent, grouping or other context activity.
+ Since is exclusive and until inclusive, as on the LRS.
+ */
+@interface TCDStatementQueryMatcher : NSObject
+
+@property (nonatomic, strong, readonly) NSString *statementId;
+@property (nonatomic, strong, readonly) NSString *verb;
+@property (nonatomic, strong, readonly) NSString *objectId;
+@property (nonatomic, strong, readonly) NSString *actorKey;
+@property (nonatomic, strong, readonly) NSString *registration;
+@property (nonatomic, strong, readonly) NSString *instructorKey;
+
+/**
+ YES if the object filter also matches context activities (the query's context).
+ */
+@property (nonatomic, readonly) BOOL matchesContextActivities;
+
+/**
+ Lower (exclusive) and upper (inclusive) bounds on the stored time, in seconds since 1970; NAN when the query has no bound.
+ */
+@property (nonatomic, readonly) NSTimeInterval since;
+@property (nonatomic, readonly) NSTimeInterval until;
+
+/**
+ The query's limit (0 for no limit).
+ */
+@property (nonatomic, readonly) NSUInteger limit;
+
+/**
+ YES if the query filters on stored time.
+ */
+@property (nonatomic, readonly) BOOL hasTimeBounds;
+
+/**
+ Designated initializer.
+ */
+- (id) initWithQuery:(TCStatementQuery *)query;
+
+/**
+ YES if statements with the attributes satisfy the query.
+ */
+- (BOOL) matchesAttributes:(TCDStatementAttributes *)attributes;
+
+/**
+ YES if the statement satisfies the query.
+ */
+- (BOOL) matchesStatement:(TCStatement *)statement;
+
+@end
@@ -0,0 +1,72 @@
+//
+//  TCDStatementQueryMatcher.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/3/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDStatementQueryMatcher.h"
+#import "TCDStatementAttributes.h"
+
+static BOOL TCDFilterMatches(NSString *filter, NSString *value)
+{
+    return !filter || [filter isEqualToString:value];
+}
+
+@implementation TCDStatementQueryMatcher
+
+- (id) initWithQuery:(TCStatementQuery *)query
+{
+    if ((self = [super init]))
+    {
+        _statementId = query.statementId.length > 0 ? query.statementId : nil;
+        _verb = query.verb.length > 0 ? query.verb : nil;
+        _objectId = [TCDStatementAttributes idForObject:query.object];
+        _actorKey = [TCDStatementAttributes keyForAgent:query.actor];
+        _registration = query.registration.length > 0 ? query.registration : nil;
+        _instructorKey = [TCDStatementAttributes keyForAgent:query.instructor];
+        _matchesContextActivities = query.context;
+        _since = query.since ? [query.since timeIntervalSince1970] : NAN;
+        _until = query.until ? [query.until timeIntervalSince1970] : NAN;
+        _limit = query.limit > 0 ? (NSUInteger)query.limit : 0;
+    }
+    return self;
+}
+
+- (BOOL) hasTimeBounds
+{
+    return !isnan(self.since) || !isnan(self.until);
+}
+
+- (BOOL) matchesAttributes:(TCDStatementAttributes *)attributes
+{
+    if (!TCDFilterMatches(self.statementId, attributes.sid) ||
+        !TCDFilterMatches(self.verb, attributes.verb) ||
+        !TCDFilterMatches(self.actorKey, attributes.actorKey) ||
+        !TCDFilterMatches(self.registration, attributes.registration) ||
+        !TCDFilterMatches(self.instructorKey, attributes.instructorKey))
+        return NO;
+    if (!TCDFilterMatches(self.objectId, attributes.objectId) &&
+        !(self.matchesContextActivities && [attributes.contextActivityIds containsObject:self.objectId]))
+        return NO;
+
+    if (self.hasTimeBounds)
+    {
+        NSTimeInterval stored = attributes.stored;
+        if (isnan(stored))
+            return NO;
+        if (!isnan(self.since) && stored <= self.since)
+            return NO;
+        if (!isnan(self.until) && stored > self.until)
+            return NO;
+    }
+    return YES;
+}
+
+- (BOOL) matchesStatement:(TCStatement *)statement
+{
+    return statement && [self matchesAttributes:[TCDStatementAttributes attributesOfStatement:statement]];
+}
+
+@end
@@ -0,0 +1,138 @@
+//
+//  TCDStatementQueue.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/20/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import <TinCan/TCStatementQueue.h>
+#import "TCDStatementLane.h"
+
+/**
+ Posted whenever statements leave the queue, however they are removed (including removeAllStatements).
+ The userInfo holds the removed statements ("statements"). It may be posted on any thread.
+ */
+extern NSString* const TCDStatementQueueDidRemoveStatementsNotification;
+
+/**
+ A TCStatementQueue backed by a TCDStatementDeque instead of an array.
+
+ Statements are indexed by id, so acknowledging a batch costs O(batch) no matter how large the backlog is,
+ and taking a batch from the front of the queue doesn't copy or shift the rest of it.
+ Statements without an id are assigned one when they are queued. A statement whose id is already queued is ignored.
+
+ When the persistence coordinator implements TCDIncrementalStatementQueuePersisting, only the statements that
+ were added or removed are handed to it; otherwise the whole queue is persisted as before.
+
+ The queue may be used from multiple threads. Statements added from other threads go through a lock-free
+ TCDIngestionRing and are moved into the queue (and persisted) in batches by a dedicated ingestion thread,
+ so producers never wait on the queue's lock or on persistence. Changes are handed to the persistence coordinator
+ on a serial queue of their own, in the order they were made. The queue is therefore eventually consistent
+ with addStatement:--use waitUntilStatementsAreQueued when a caller needs to see its own additions.
+
+ Statements are kept in lanes (see TCDStatementLane). With the default single lane the queue is plain FIFO;
+ with several, statementsInDrainOrder:passingTest: interleaves them by weight so a backlog of low-value
+ statements doesn't hold back the ones that matter. The rest of the queue's methods see every lane merged
+ in the order statements were queued.
+ */
+@interface TCDStatementQueue : TCStatementQueue
+
+/**
+ A snapshot of the statements in the queue, ordered oldest to newest.
+ Unlike TCStatementQueue, changing this array does not change the queue.
+ */
+@property (nonatomic, strong, readonly) NSMutableArray *queuedStatements;
+
+/**
+ Number of statements the ingestion ring can hold before producers have to wait for the ingestion thread
+ (0 if statements are added synchronously).
+ */
+@property (nonatomic, readonly) NSUInteger ingestionCapacity;
+
+/**
+ The lanes statements are sorted into (default: a single TCDStatementLane defaultLane).
+ Setting lanes re-sorts the statements already queued; statements keep their age.
+ */
+@property (nonatomic, copy) NSArray *lanes;
+
+/**
+ Designated initializer.
+
+ @param capacity    Size of the ingestion ring. Pass 0 to add statements synchronously on the calling thread.
+ */
+- (id) initWithIngestionCapacity:(NSUInteger)capacity;
+
+/**
+ Blocks until every statement added before this call has been moved into the queue.
+ */
+- (void) waitUntilStatementsAreQueued;
+
+/**
+ Blocks until every statement added before this call, and every change to the queue made before it, has been
+ handed to the persistence coordinator.
+ */
+- (void) waitUntilStatementsArePersisted;
+
+/**
+ Moves what the ingestion ring holds into the queue and ends the ingestion thread, which otherwise keeps the queue
+ alive. Statements added afterwards are queued on the calling thread. Don't call it while other threads are adding statements.
+ */
+- (void) stopIngestion;
+
+/**
+ The queued statement with the specified id (nil if it isn't queued).
+ */
+- (TCStatement *) queuedStatementWithId:(NSString *)sid;
+
+/**
+ Removes the statement with the specified id from the queue (if it is queued).
+ */
+- (void) removeStatementWithId:(NSString *)sid;
+
+/**
+ Number of statements queued in a lane (0 if the lane isn't one of the queue's lanes).
+ */
+- (NSUInteger) depthOfLane:(TCDStatementLane *)lane;
+
+/**
+ Seconds since the oldest statement in a lane was first queued, including time before the app was relaunched
+ (0 if the lane is empty).
+ Statements restored from the persistence coordinator count from when they were restored.
+ */
+- (NSTimeInterval) ageOfOldestStatementInLane:(TCDStatementLane *)lane;
+
+/**
+ The statements to send next, weighted-fair across lanes.
+
+ Statements older than their lane's maxStatementAge come first, oldest first. The rest are taken in rounds:
+ each lane in turn gives up to its weight of its oldest statements.
+
+ @param count       The most statements to return.
+ @param predicate   Returns NO for statements that shouldn't be sent (e.g. ones already in flight). May be nil.
+ @return            Up to count statements, in the order they should be sent.
+ */
+- (NSArray *) statementsInDrainOrder:(NSUInteger)count passingTest:(BOOL (^)(TCStatement *statement))predicate;
+
+/**
+ The default statement queue. It is persisted with a TCStatementQueueFilePersistence of its own
+ (Documents/tcdStatementQueueStore.plist), never the plist of TCStatementQueue's default queue, which TCAPI
+ still creates; see adoptStatementsFromQueue: to move that queue's statements over.
+ */
++ (TCDStatementQueue *) defaultStatementQueue;
+
+/**
+ Queues statements restored from the persistence coordinator's store. They are added on the calling thread,
+ straight into the lanes rather than through the ingestion ring, and aren't handed back to the coordinator.
+ Setting persistenceCoordinator restores the coordinator's statements this way.
+ */
+- (void) restoreStatements:(NSArray *)statements;
+
+/**
+ Moves every statement out of another queue (e.g. TCStatementQueue's default queue) into this one,
+ so only one queue--and one store--holds them.
+ */
+- (void) adoptStatementsFromQueue:(TCStatementQueue *)queue;
+
+@end
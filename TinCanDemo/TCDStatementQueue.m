@@ -0,0 +1,739 @@
+//
+//  TCDStatementQueue.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/20/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDStatementQueue.h"
+#import "TCDStatementDeque.h"
+#import "TCDIngestionRing.h"
+#import "TCDIncrementalStatementQueuePersisting.h"
+#import "TCStatement+TCDQueueState.h"
+#import "TCStatement+TCDLaneAttributes.h"
+#import <TinCan/TCStatementQueueFilePersistence.h>
+
+NSString* const TCDStatementQueueDidRemoveStatementsNotification = @"TCDStatementQueueDidRemoveStatementsNotification";
+
+/**
+ Where a queued statement is: its lane, its position in the queue as a whole, and when it was queued.
+ */
+@interface TCDQueuedStatementEntry : NSObject
+@property (nonatomic, readwrite) NSUInteger laneIndex;
+@property (nonatomic, readwrite) unsigned long long sequence;
+@property (nonatomic, readwrite) NSTimeInterval queuedTime;
+@end
+
+@implementation TCDQueuedStatementEntry
+@end
+
+@interface TCDStatementQueue ()
+{
+    // One deque per lane, in the order of lanes.
+    NSArray *laneDeques;
+    NSMutableDictionary *entriesById;
+    unsigned long long nextSequence;
+    TCDIngestionRing *ingestionRing;
+    NSThread *ingestionThread;
+    dispatch_semaphore_t ingestionSignal;
+    NSCondition *ingestionCondition;
+    // Statements the ingestion thread has moved into the lanes; guarded by ingestionCondition.
+    unsigned long long ingestedCount;
+    // Set by stopIngestion; the ingestion thread exits once the ring is empty.
+    volatile BOOL ingestionStopped;
+    // Changes are handed to the persistence coordinator on this queue, in the order they were made to the lanes.
+    dispatch_queue_t persistenceQueue;
+}
+// Implemented by TCStatementQueue but not published; overridden so the stock array is never used.
+- (void) removePersistedStatements;
+- (void) cleanThenLocallyPersistStatements;
+@end
+
+// Most statements one pass of the ingestion thread hands to the queue (and the persistence coordinator) at once.
+static const NSUInteger kTCDIngestionBatchSize = 256;
+
+// The default queue's plist; TCStatementQueue's own default queue keeps tcStatementQueueStore.plist.
+static NSString* const kTCDDefaultQueueStoreFilename = @"tcdStatementQueueStore.plist";
+
+@implementation TCDStatementQueue
+
+@synthesize lanes = _lanes;
+
++ (TCDStatementQueue *) defaultStatementQueue
+{
+    static TCDStatementQueue *defaultStatementQueue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        defaultStatementQueue = [[TCDStatementQueue alloc] init];
+        TCStatementQueueFilePersistence *store = [[TCStatementQueueFilePersistence alloc] initWithQueue:defaultStatementQueue];
+        store.filename = kTCDDefaultQueueStoreFilename;
+        // Setting the coordinator restores what the store holds.
+        defaultStatementQueue.persistenceCoordinator = store;
+    });
+    return defaultStatementQueue;
+}
+
+- (id) init
+{
+    return [self initWithIngestionCapacity:1024];
+}
+
+- (id) initWithIngestionCapacity:(NSUInteger)capacity
+{
+    if ((self = [super init]))
+    {
+        persistenceQueue = dispatch_queue_create("com.meetmaestro.tincandemo.statementqueue.persistence", DISPATCH_QUEUE_SERIAL);
+        _lanes = @[[TCDStatementLane defaultLane]];
+        laneDeques = @[[[TCDStatementDeque alloc] init]];
+        entriesById = [[NSMutableDictionary alloc] init];
+        if (capacity > 0)
+        {
+            ingestionRing = [[TCDIngestionRing alloc] initWithCapacity:capacity];
+            ingestionSignal = dispatch_semaphore_create(0);
+            ingestionCondition = [[NSCondition alloc] init];
+        }
+
+        // TCStatementQueue may have restored statements into its own array while initializing; adopt them.
+        NSMutableArray *restored = [super queuedStatements];
+        for (TCStatement *statement in restored)
+            [self enqueueStatement:statement];
+        [restored removeAllObjects];
+
+        if (ingestionRing)
+        {
+            // Started once, here, so producers never have to check for it (or take a lock to).
+            ingestionThread = [[NSThread alloc] initWithTarget:self selector:@selector(runIngestionThread) object:nil];
+            [ingestionThread setName:@"TCDStatementQueue ingestion"];
+            [ingestionThread start];
+        }
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+#if !OS_OBJECT_USE_OBJC
+    if (ingestionSignal)
+        dispatch_release(ingestionSignal);
+    if (persistenceQueue)
+        dispatch_release(persistenceQueue);
+#endif
+}
+
+- (NSString *) description
+{
+    return [NSString stringWithFormat:@"<%@: %lu queued statements>", NSStringFromClass([self class]), (unsigned long)self.numberOfQueuedStatements];
+}
+
+#pragma mark - Adding statements
+
+- (BOOL) enqueueStatement:(TCStatement *)statement
+{
+    if (statement.persistedOnLRS)
+        return NO;
+    if (statement.sid.length == 0)
+        [statement setSid:[TCStatement generateUUID]];
+    if ([entriesById objectForKey:statement.sid])
+        return NO;
+
+    // A restored statement keeps the date it was first queued, so its age carries across launches.
+    NSDate *queuedDate = statement.queuedDate;
+    if (!queuedDate)
+    {
+        queuedDate = [NSDate date];
+        statement.queuedDate = queuedDate;
+    }
+    TCDQueuedStatementEntry *entry = [[TCDQueuedStatementEntry alloc] init];
+    entry.sequence = nextSequence++;
+    entry.queuedTime = [queuedDate timeIntervalSinceReferenceDate];
+    [self placeStatement:statement entry:entry];
+    return YES;
+}
+
+/**
+ Adds a statement to the deque of the lane that claims it.
+ */
+- (void) placeStatement:(TCStatement *)statement entry:(TCDQueuedStatementEntry *)entry
+{
+    NSUInteger laneIndex = self.lanes.count - 1;
+    for (NSUInteger i = 0; i + 1 < self.lanes.count; i++)
+    {
+        if ([[self.lanes objectAtIndex:i] acceptsStatement:statement])
+        {
+            laneIndex = i;
+            break;
+        }
+    }
+    entry.laneIndex = laneIndex;
+    [[laneDeques objectAtIndex:laneIndex] addStatement:statement];
+    [entriesById setObject:entry forKey:statement.sid];
+}
+
+- (TCStatement *) removeQueuedStatementWithId:(NSString *)sid
+{
+    TCDQueuedStatementEntry *entry = sid ? [entriesById objectForKey:sid] : nil;
+    if (!entry)
+        return nil;
+    [entriesById removeObjectForKey:sid];
+    return [[laneDeques objectAtIndex:entry.laneIndex] removeStatementWithId:sid];
+}
+
+- (void) addStatements:(NSArray *)statements
+{
+    if (!laneDeques)
+    {
+        // Still inside -[TCStatementQueue init]; let it fill its own array and adopt that afterwards.
+        [super addStatements:statements];
+        return;
+    }
+
+    if (!ingestionRing || ingestionStopped || [NSThread currentThread] == ingestionThread)
+    {
+        [self queueStatements:statements];
+        return;
+    }
+
+    for (TCStatement *statement in statements)
+        [self pushStatement:statement];
+}
+
+/**
+ Hands a statement to the ingestion thread. Takes no locks and allocates nothing unless the ring is full.
+ */
+- (void) pushStatement:(TCStatement *)statement
+{
+    while (![ingestionRing enqueueObject:statement])
+    {
+        // The ring is full; let the ingestion thread catch up rather than drop the statement.
+        dispatch_semaphore_signal(ingestionSignal);
+        [self waitUntilStatementsAreQueued];
+    }
+    dispatch_semaphore_signal(ingestionSignal);
+}
+
+- (void) queueStatements:(NSArray *)statements
+{
+    [self queueStatements:statements persisting:YES];
+}
+
+/**
+ Queues statements on the calling thread, bypassing the ingestion ring.
+
+ @param persisting  NO for statements that came from the persistence coordinator.
+ */
+- (void) queueStatements:(NSArray *)statements persisting:(BOOL)persisting
+{
+    NSMutableArray *added = [NSMutableArray arrayWithCapacity:statements.count];
+    @synchronized(self)
+    {
+        for (TCStatement *statement in statements)
+        {
+            if ([self enqueueStatement:statement])
+                [added addObject:statement];
+        }
+        if (persisting)
+            [self persistAddedStatements:added];
+    }
+}
+
+- (void) addStatement:(TCStatement *)statement
+{
+    if (!statement)
+        return;
+    if (laneDeques && ingestionRing && !ingestionStopped && [NSThread currentThread] != ingestionThread)
+        [self pushStatement:statement];
+    else
+        [self addStatements:@[statement]];
+}
+
+- (void) adoptStatementsFromQueue:(TCStatementQueue *)queue
+{
+    if (!queue || queue == self)
+        return;
+    NSArray *statements = [queue getQueuedStatements];
+    if (statements.count == 0)
+        return;
+    // Persisted once, as a whole, rather than batch by batch through the ingestion ring. Anything already in the
+    // ring goes first, so the queue keeps the order statements were added in.
+    [self waitUntilStatementsAreQueued];
+    [self queueStatements:statements persisting:YES];
+    // Empties the other queue's store too, so the statements aren't restored there again--once they're in this one's.
+    [self waitUntilStatementsArePersisted];
+    [queue removeAllStatements];
+}
+
+- (void) restoreStatements:(NSArray *)statements
+{
+    [self waitUntilStatementsAreQueued];
+    [self queueStatements:statements persisting:NO];
+}
+
+- (void) setPersistenceCoordinator:(id<TCStatementQueuePersisting>)coordinator
+{
+    // TCStatementQueue restores by handing the backlog to addStatements:, which would push it through the ingestion
+    // ring a statement at a time and persist it back to the store it came from. Restore it here instead; the
+    // coordinator then has nothing left to restore.
+    if (laneDeques && [coordinator needsToRestoreQueue])
+    {
+        NSError *error = nil;
+        NSArray *restored = [coordinator retrieveStatementsFromStoreWithError:&error];
+        if (!restored)
+            NSLog(@"Unable to restore the statement queue: %@", error);
+        [self restoreStatements:restored];
+    }
+    [super setPersistenceCoordinator:coordinator];
+}
+
+#pragma mark - Ingestion
+
+- (NSUInteger) ingestionCapacity
+{
+    return ingestionRing.capacity;
+}
+
+- (void) runIngestionThread
+{
+    NSMutableArray *batch = [NSMutableArray arrayWithCapacity:kTCDIngestionBatchSize];
+    while (!ingestionStopped)
+    {
+        dispatch_semaphore_wait(ingestionSignal, DISPATCH_TIME_FOREVER);
+        @autoreleasepool
+        {
+            while ([ingestionRing dequeueObjects:batch maxCount:kTCDIngestionBatchSize] > 0)
+            {
+                [self queueStatements:batch];
+
+                [ingestionCondition lock];
+                ingestedCount += batch.count;
+                [ingestionCondition broadcast];
+                [ingestionCondition unlock];
+                [batch removeAllObjects];
+            }
+        }
+    }
+}
+
+- (void) stopIngestion
+{
+    if (!ingestionRing || ingestionStopped)
+        return;
+    // Statements added from here on are queued on the calling thread; the thread drains what the ring holds, then exits.
+    ingestionStopped = YES;
+    dispatch_semaphore_signal(ingestionSignal);
+    [self waitUntilStatementsAreQueued];
+}
+
+- (void) waitUntilStatementsAreQueued
+{
+    if (!ingestionRing || [NSThread currentThread] == ingestionThread)
+        return;
+
+    unsigned long long target = ingestionRing.enqueuedCount;
+    [ingestionCondition lock];
+    while (ingestedCount < target)
+    {
+        dispatch_semaphore_signal(ingestionSignal);
+        [ingestionCondition waitUntilDate:[NSDate dateWithTimeIntervalSinceNow:0.1]];
+    }
+    [ingestionCondition unlock];
+}
+
+- (void) waitUntilStatementsArePersisted
+{
+    [self waitUntilStatementsAreQueued];
+    if (persistenceQueue)
+        dispatch_sync(persistenceQueue, ^{});
+}
+
+#pragma mark - Reading the queue
+
+- (NSMutableArray *) queuedStatements
+{
+    return [[self getQueuedStatements] mutableCopy];
+}
+
+- (NSArray *) getQueuedStatements:(int)count
+{
+    return [self getQueuedStatements:count startingAtIndex:0];
+}
+
+- (NSArray *) getQueuedStatements:(int)count startingAtIndex:(NSUInteger)index
+{
+    @synchronized(self)
+    {
+        return [self statementsInRange:NSMakeRange(index, (NSUInteger)MAX(count, 0))];
+    }
+}
+
+- (NSArray *) getQueuedStatements
+{
+    @synchronized(self)
+    {
+        return [self statementsInRange:NSMakeRange(0, entriesById.count)];
+    }
+}
+
+/**
+ Statements by their position in the queue as a whole, merging the lanes oldest to newest. Called with the queue locked.
+ */
+- (NSArray *) statementsInRange:(NSRange)range
+{
+    if (laneDeques.count == 1)
+        return [[laneDeques objectAtIndex:0] statementsInRange:range];
+
+    NSUInteger needed = MIN(range.location + range.length, entriesById.count);
+    NSMutableArray *heads = [NSMutableArray arrayWithCapacity:laneDeques.count];
+    for (TCDStatementDeque *laneDeque in laneDeques)
+        [heads addObject:[laneDeque statementsInRange:NSMakeRange(0, needed)]];
+
+    NSUInteger positions[laneDeques.count];
+    memset(positions, 0, sizeof(positions));
+    NSMutableArray *statements = [NSMutableArray arrayWithCapacity:needed > range.location ? needed - range.location : 0];
+    for (NSUInteger merged = 0; merged < needed; merged++)
+    {
+        NSUInteger oldestLane = NSNotFound;
+        unsigned long long oldestSequence = ULLONG_MAX;
+        for (NSUInteger lane = 0; lane < heads.count; lane++)
+        {
+            NSArray *head = [heads objectAtIndex:lane];
+            if (positions[lane] >= head.count)
+                continue;
+            TCStatement *statement = [head objectAtIndex:positions[lane]];
+            unsigned long long sequence = [[entriesById objectForKey:statement.sid] sequence];
+            if (sequence < oldestSequence)
+            {
+                oldestSequence = sequence;
+                oldestLane = lane;
+            }
+        }
+        if (oldestLane == NSNotFound)
+            break;
+        TCStatement *statement = [[heads objectAtIndex:oldestLane] objectAtIndex:positions[oldestLane]++];
+        if (merged >= range.location)
+            [statements addObject:statement];
+    }
+    return statements;
+}
+
+- (TCStatement *) queuedStatementWithId:(NSString *)sid
+{
+    @synchronized(self)
+    {
+        TCDQueuedStatementEntry *entry = sid ? [entriesById objectForKey:sid] : nil;
+        return entry ? [[laneDeques objectAtIndex:entry.laneIndex] statementWithId:sid] : nil;
+    }
+}
+
+- (NSArray *) unsentStatements
+{
+    NSMutableArray *unsent = [NSMutableArray array];
+    @synchronized(self)
+    {
+        for (TCStatement *statement in [self statementsInRange:NSMakeRange(0, entriesById.count)])
+        {
+            if (!statement.sentToLRS)
+                [unsent addObject:statement];
+        }
+    }
+    return unsent;
+}
+
+- (BOOL) hasQueuedStatements
+{
+    return self.numberOfQueuedStatements > 0;
+}
+
+- (NSUInteger) numberOfQueuedStatements
+{
+    @synchronized(self)
+    {
+        return entriesById.count;
+    }
+}
+
+#pragma mark - Lanes
+
+- (NSArray *) lanes
+{
+    @synchronized(self)
+    {
+        return _lanes;
+    }
+}
+
+- (void) setLanes:(NSArray *)lanes
+{
+    if (lanes.count == 0)
+        lanes = @[[TCDStatementLane defaultLane]];
+
+    [self waitUntilStatementsAreQueued];
+    @synchronized(self)
+    {
+        NSArray *statements = [self statementsInRange:NSMakeRange(0, entriesById.count)];
+        _lanes = [lanes copy];
+        NSMutableArray *deques = [NSMutableArray arrayWithCapacity:lanes.count];
+        for (NSUInteger i = 0; i < lanes.count; i++)
+            [deques addObject:[[TCDStatementDeque alloc] init]];
+        laneDeques = deques;
+
+        // Re-sort what's queued; statements keep their place in the queue and their age.
+        for (TCStatement *statement in statements)
+            [self placeStatement:statement entry:[entriesById objectForKey:statement.sid]];
+    }
+}
+
+- (NSUInteger) laneIndexOfLane:(TCDStatementLane *)lane
+{
+    return [_lanes indexOfObjectIdenticalTo:lane];
+}
+
+- (NSUInteger) depthOfLane:(TCDStatementLane *)lane
+{
+    @synchronized(self)
+    {
+        NSUInteger laneIndex = [self laneIndexOfLane:lane];
+        return laneIndex == NSNotFound ? 0 : [[laneDeques objectAtIndex:laneIndex] count];
+    }
+}
+
+- (NSTimeInterval) ageOfOldestStatementInLane:(TCDStatementLane *)lane
+{
+    @synchronized(self)
+    {
+        NSUInteger laneIndex = [self laneIndexOfLane:lane];
+        if (laneIndex == NSNotFound)
+            return 0;
+        TCStatement *oldest = [[[laneDeques objectAtIndex:laneIndex] statementsInRange:NSMakeRange(0, 1)] lastObject];
+        if (!oldest)
+            return 0;
+        return [NSDate timeIntervalSinceReferenceDate] - [[entriesById objectForKey:oldest.sid] queuedTime];
+    }
+}
+
+- (NSArray *) statementsInDrainOrder:(NSUInteger)count passingTest:(BOOL (^)(TCStatement *statement))predicate
+{
+    NSMutableArray *drained = [NSMutableArray arrayWithCapacity:count];
+    if (count == 0)
+        return drained;
+    @synchronized(self)
+    {
+        if (laneDeques.count == 1)
+        {
+            [[laneDeques objectAtIndex:0] enumerateStatementsUsingBlock:^(TCStatement *statement, BOOL *stop) {
+                if (!predicate || predicate(statement))
+                    [drained addObject:statement];
+                *stop = (drained.count >= count);
+            }];
+            return drained;
+        }
+
+        // No lane can contribute more than count statements, so that's all that is read from each.
+        NSMutableArray *candidates = [NSMutableArray arrayWithCapacity:laneDeques.count];
+        for (TCDStatementDeque *laneDeque in laneDeques)
+        {
+            NSMutableArray *laneCandidates = [NSMutableArray array];
+            [laneDeque enumerateStatementsUsingBlock:^(TCStatement *statement, BOOL *stop) {
+                if (!predicate || predicate(statement))
+                    [laneCandidates addObject:statement];
+                *stop = (laneCandidates.count >= count);
+            }];
+            [candidates addObject:laneCandidates];
+        }
+
+        NSUInteger positions[laneDeques.count];
+        memset(positions, 0, sizeof(positions));
+
+        // Statements that have waited longer than their lane allows go first, oldest first.
+        NSTimeInterval now = [NSDate timeIntervalSinceReferenceDate];
+        NSMutableArray *overdue = [NSMutableArray array];
+        for (NSUInteger lane = 0; lane < candidates.count; lane++)
+        {
+            NSTimeInterval maxAge = [[_lanes objectAtIndex:lane] maxStatementAge];
+            if (maxAge <= 0)
+                continue;
+            for (TCStatement *statement in [candidates objectAtIndex:lane])
+            {
+                if (now - [[entriesById objectForKey:statement.sid] queuedTime] <= maxAge)
+                    break;
+                [overdue addObject:statement];
+                positions[lane]++;
+            }
+        }
+        [overdue sortUsingComparator:^NSComparisonResult(TCStatement *a, TCStatement *b) {
+            unsigned long long sequenceA = [[entriesById objectForKey:a.sid] sequence];
+            unsigned long long sequenceB = [[entriesById objectForKey:b.sid] sequence];
+            return sequenceA < sequenceB ? NSOrderedAscending : (sequenceA > sequenceB ? NSOrderedDescending : NSOrderedSame);
+        }];
+        [drained addObjectsFromArray:[overdue subarrayWithRange:NSMakeRange(0, MIN(overdue.count, count))]];
+
+        // Then weighted rounds: each lane sends up to its weight before the next lane's turn.
+        BOOL remaining = YES;
+        while (drained.count < count && remaining)
+        {
+            remaining = NO;
+            for (NSUInteger lane = 0; lane < candidates.count && drained.count < count; lane++)
+            {
+                NSArray *laneCandidates = [candidates objectAtIndex:lane];
+                NSUInteger weight = [[_lanes objectAtIndex:lane] weight];
+                for (NSUInteger taken = 0; taken < weight && positions[lane] < laneCandidates.count && drained.count < count; taken++)
+                    [drained addObject:[laneCandidates objectAtIndex:positions[lane]++]];
+                if (positions[lane] < laneCandidates.count)
+                    remaining = YES;
+            }
+        }
+    }
+    return drained;
+}
+
+#pragma mark - Removing statements
+
+- (void) removeStatement:(TCStatement *)statement
+{
+    if (statement)
+        [self removeStatementsInArray:@[statement]];
+}
+
+- (void) removeStatementWithId:(NSString *)sid
+{
+    TCStatement *removed = nil;
+    @synchronized(self)
+    {
+        removed = [self removeQueuedStatementWithId:sid];
+        if (removed)
+            [self persistRemovedStatements:@[removed]];
+    }
+    if (removed)
+        [self postRemovalOfStatements:@[removed]];
+}
+
+- (void) removeStatementsInArray:(NSArray *)statementsToRemove
+{
+    NSMutableArray *removed = [NSMutableArray arrayWithCapacity:statementsToRemove.count];
+    @synchronized(self)
+    {
+        for (TCStatement *statement in statementsToRemove)
+        {
+            TCStatement *queued = [self removeQueuedStatementWithId:statement.sid];
+            if (queued)
+                [removed addObject:queued];
+        }
+        [self persistRemovedStatements:removed];
+    }
+    [self postRemovalOfStatements:removed];
+}
+
+- (void) removeAllStatements
+{
+    [self waitUntilStatementsAreQueued];
+
+    NSArray *removed = nil;
+    @synchronized(self)
+    {
+        removed = [self statementsInRange:NSMakeRange(0, entriesById.count)];
+        for (TCDStatementDeque *laneDeque in laneDeques)
+            [laneDeque removeAllStatements];
+        [entriesById removeAllObjects];
+        [self persistRemovedStatements:removed];
+    }
+    [self postRemovalOfStatements:removed];
+}
+
+- (void) removePersistedStatements
+{
+    NSMutableArray *persisted = [NSMutableArray array];
+    @synchronized(self)
+    {
+        for (TCDStatementDeque *laneDeque in laneDeques)
+        {
+            [laneDeque enumerateStatementsUsingBlock:^(TCStatement *statement, BOOL *stop) {
+                if (statement.persistedOnLRS)
+                    [persisted addObject:statement];
+            }];
+        }
+        for (TCStatement *statement in persisted)
+            [self removeQueuedStatementWithId:statement.sid];
+        [self persistRemovedStatements:persisted];
+    }
+    [self postRemovalOfStatements:persisted];
+}
+
+#pragma mark - Persistence
+
+// persistAddedStatements: and persistRemovedStatements: are called while holding the queue's lock, so changes reach
+// persistenceQueue--and the coordinator--in the order they were made to the lanes: the removal of a statement can't
+// be persisted ahead of its addition and bring it back on the next launch. The coordinator runs outside the lock.
+
+- (void) persistAddedStatements:(NSArray *)added
+{
+    id<TCStatementQueuePersisting> coordinator = self.persistenceCoordinator;
+    if (added.count == 0 || !coordinator)
+        return;
+
+    dispatch_async(persistenceQueue, ^{
+        NSError *error = nil;
+        BOOL persisted;
+        if ([coordinator conformsToProtocol:@protocol(TCDIncrementalStatementQueuePersisting)])
+            persisted = [(id<TCDIncrementalStatementQueuePersisting>)coordinator appendStatements:added withError:&error];
+        else
+            persisted = [coordinator persistStatements:[self getQueuedStatements] withError:&error];
+        if (!persisted)
+            NSLog(@"Unable to persist the statement queue: %@", error);
+    });
+}
+
+- (void) persistRemovedStatements:(NSArray *)removed
+{
+    id<TCStatementQueuePersisting> coordinator = self.persistenceCoordinator;
+    if (removed.count == 0 || !coordinator)
+        return;
+
+    dispatch_async(persistenceQueue, ^{
+        NSError *error = nil;
+        BOOL persisted;
+        if ([coordinator conformsToProtocol:@protocol(TCDIncrementalStatementQueuePersisting)])
+            persisted = [(id<TCDIncrementalStatementQueuePersisting>)coordinator acknowledgeStatements:removed withError:&error];
+        else
+            persisted = [coordinator persistStatements:[self getQueuedStatements] withError:&error];
+        if (!persisted)
+            NSLog(@"Unable to persist the statement queue: %@", error);
+    });
+}
+
+- (void) postRemovalOfStatements:(NSArray *)removed
+{
+    if (removed.count == 0)
+        return;
+    [[NSNotificationCenter defaultCenter] postNotificationName:TCDStatementQueueDidRemoveStatementsNotification
+                                                        object:self
+                                                      userInfo:@{@"statements": removed}];
+}
+
+- (void) persistToLocalStore
+{
+    if (!laneDeques)
+    {
+        [super persistToLocalStore];
+        return;
+    }
+
+    [self waitUntilStatementsAreQueued];
+    [self removePersistedStatements];
+
+    id<TCStatementQueuePersisting> coordinator = self.persistenceCoordinator;
+    if (!coordinator)
+        return;
+    // Behind every change already handed over, and waited for: the store is up to date when this returns.
+    dispatch_sync(persistenceQueue, ^{
+        NSError *error = nil;
+        if (![coordinator persistStatements:[self getQueuedStatements] withError:&error])
+            NSLog(@"Unable to persist the statement queue: %@", error);
+    });
+}
+
+- (void) cleanThenLocallyPersistStatements
+{
+    [self persistToLocalStore];
+}
+
+@end
@@ -0,0 +1,91 @@
+//
+//  TCDStatementQueueLogPersistence.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/18/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "TCDIncrementalStatementQueuePersisting.h"
+#import "TCDStatementLog.h"
+
+@class TCStatementQueue;
+
+/**
+ Persists a statement queue in a TCDStatementLog instead of rewriting a plist of the whole queue.
+
+ When the queue hands over its current contents with persistStatements:withError:, only the difference
+ against the log is written: a record for each newly queued statement and a tombstone for each statement
+ that left the queue. Statements passed to appendStatements:withError: that the log already holds are skipped, so
+ handing restored statements back costs no I/O. Each record also stores the statement's lane attributes (see
+ TCStatement+TCDLaneAttributes), so a restored queue sorts statements into lanes and ages them from when they were
+ first queued. A statement is keyed by its id; one without an id is keyed by a digest of its JSON instead, so
+ persisting never changes the statement.
+ */
+@interface TCDStatementQueueLogPersistence : NSObject <TCDIncrementalStatementQueuePersisting>
+
+/**
+ The statement queue this persisting coordinator is tied to.
+ */
+@property (nonatomic, strong) TCStatementQueue *queue;
+
+/**
+ The log the statements are stored in.
+ */
+@property (nonatomic, strong, readonly) TCDStatementLog *log;
+
+/**
+ NO if the log couldn't be opened, in which case the coordinator can't store anything and another should be used.
+ */
+@property (nonatomic, readonly) BOOL isOpen;
+
+/**
+ Set to YES to set the NSFileProtectionKey on the store to NSFileProtectionComplete. (default=YES)
+ */
+@property (nonatomic, readwrite) BOOL shouldProtectPersistentStore;
+
+/**
+ Set to YES to restore the queue without inflating the statements (default=NO).
+ retrieveStatementsFromStoreWithError: then memory-maps the log and returns TCDLazyStatement stand-ins that only
+ know their id and where their JSON lives; each one becomes a full TCStatement the first time it is used
+ (typically when a batch taken with getQueuedStatements:startingAtIndex: is sent to the LRS).
+ */
+@property (nonatomic, readwrite) BOOL restoresLazily;
+
+/**
+ How durable a change to the queue must be before persisting returns (default=TCDStatementLogDurabilityPerWindow).
+ By default persisting returns once the commit window holding the change has been fsync'd; concurrent callers
+ within a window wait for and share a single fsync. TCDStatementQueue persists on a queue of its own, so adding
+ statements still doesn't wait on the disk. With TCDStatementLogDurabilityBestEffort persisting returns as soon as
+ the change is buffered, and changes from the last window before a crash can be lost.
+ */
+@property (nonatomic, readwrite) TCDStatementLogDurability durability;
+
+/**
+ The length of a group commit window in seconds (default=0.01).
+ */
+@property (nonatomic, readwrite) NSTimeInterval commitInterval;
+
+/**
+ Counters reporting the size and latency of the group commits made so far.
+ */
+@property (nonatomic, readonly) TCDStatementLogCommitStatistics *commitStatistics;
+
+/**
+ Initializes the persisting coordinator with a statement queue.
+ The log is stored in the tcStatementQueueLog directory inside the documents directory.
+ */
+- (id) initWithQueue:(TCStatementQueue *)queue;
+
+/**
+ Initializes the persisting coordinator with a statement queue and the directory to keep the log in.
+ */
+- (id) initWithQueue:(TCStatementQueue *)queue directory:(NSString *)directory;
+
+/**
+ Commits changes still waiting for the end of the current commit window (e.g. when the application enters the background).
+ */
+- (BOOL) synchronizeWithError:(NSError **)error;
+
+@end
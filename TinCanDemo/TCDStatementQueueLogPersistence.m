@@ -0,0 +1,212 @@
+//
+//  TCDStatementQueueLogPersistence.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/18/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDStatementQueueLogPersistence.h"
+#import "TCDLazyStatement.h"
+#import "TCStatement+TCDJSONEncoding.h"
+#import "TCStatement+TCDLaneAttributes.h"
+#import <CommonCrypto/CommonDigest.h>
+
+static NSString* const kTCDDefaultLogDirectory = @"tcStatementQueueLog";
+
+@interface TCDStatementQueueLogPersistence ()
+@property (nonatomic, strong, readwrite) TCDStatementLog *log;
+@property (nonatomic, readwrite) BOOL hasRestoredQueue;
+@property (nonatomic, readwrite) BOOL isOpen;
+@end
+
+@implementation TCDStatementQueueLogPersistence
+
+- (id) init
+{
+    return [self initWithQueue:nil];
+}
+
+- (id) initWithQueue:(TCStatementQueue *)queue
+{
+    NSString *documents = [NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES) objectAtIndex:0];
+    return [self initWithQueue:queue directory:[documents stringByAppendingPathComponent:kTCDDefaultLogDirectory]];
+}
+
+- (id) initWithQueue:(TCStatementQueue *)queue directory:(NSString *)directory
+{
+    if ((self = [super init]))
+    {
+        self.queue = queue;
+        self.log = [[TCDStatementLog alloc] initWithDirectory:directory];
+
+        NSError *error = nil;
+        self.isOpen = [self.log openWithError:&error];
+        if (!self.isOpen)
+            NSLog(@"Unable to open the statement queue log at %@: %@", directory, error);
+    }
+    return self;
+}
+
+- (BOOL) shouldProtectPersistentStore
+{
+    return self.log.shouldProtectPersistentStore;
+}
+
+- (void) setShouldProtectPersistentStore:(BOOL)shouldProtectPersistentStore
+{
+    self.log.shouldProtectPersistentStore = shouldProtectPersistentStore;
+}
+
+- (TCDStatementLogDurability) durability
+{
+    return self.log.durability;
+}
+
+- (void) setDurability:(TCDStatementLogDurability)durability
+{
+    self.log.durability = durability;
+}
+
+- (NSTimeInterval) commitInterval
+{
+    return self.log.commitInterval;
+}
+
+- (void) setCommitInterval:(NSTimeInterval)commitInterval
+{
+    self.log.commitInterval = commitInterval;
+}
+
+- (TCDStatementLogCommitStatistics *) commitStatistics
+{
+    return self.log.commitStatistics;
+}
+
+- (BOOL) synchronizeWithError:(NSError **)error
+{
+    return [self.log synchronizeWithError:error];
+}
+
+#pragma mark - Incremental updates
+
+/**
+ The statement's id, or for a statement without one, a digest of its JSON; the statement itself isn't changed.
+ */
+- (NSString *) keyForStatement:(TCStatement *)statement
+{
+    if (statement.sid.length > 0)
+        return statement.sid;
+
+    NSData *payload = statement.encodedJSONData;
+    if (!payload)
+        return nil;
+    unsigned char digest[CC_SHA1_DIGEST_LENGTH];
+    CC_SHA1(payload.bytes, (CC_LONG)payload.length, digest);
+    NSMutableString *key = [NSMutableString stringWithString:@"sha1:"];
+    for (NSUInteger i = 0; i < CC_SHA1_DIGEST_LENGTH; i++)
+        [key appendFormat:@"%02x", digest[i]];
+    return key;
+}
+
+- (BOOL) appendStatements:(NSArray *)statements withError:(NSError **)error
+{
+    NSMutableArray *keys = [NSMutableArray arrayWithCapacity:statements.count];
+    NSMutableArray *payloads = [NSMutableArray arrayWithCapacity:statements.count];
+    NSMutableArray *laneAttributes = [NSMutableArray arrayWithCapacity:statements.count];
+    for (TCStatement *statement in statements)
+    {
+        // A statement the log already holds (e.g. one just restored from it) isn't written again, or even encoded.
+        NSString *key = [self keyForStatement:statement];
+        if (!key || [self.log containsKey:key])
+            continue;
+        NSData *payload = statement.encodedJSONData;
+        if (!payload)
+            continue;
+        [keys addObject:key];
+        [payloads addObject:payload];
+        // Stored with the record so a restored statement can be sorted into its lane, and keep its age, without parsing.
+        [laneAttributes addObject:statement.laneAttributesData];
+    }
+    return [self.log appendPayloads:payloads metadata:laneAttributes forKeys:keys error:error];
+}
+
+- (BOOL) acknowledgeStatements:(NSArray *)statements withError:(NSError **)error
+{
+    NSMutableArray *keys = [NSMutableArray arrayWithCapacity:statements.count];
+    for (TCStatement *statement in statements)
+    {
+        NSString *key = [self keyForStatement:statement];
+        if (key)
+            [keys addObject:key];
+    }
+    return [self.log acknowledgeKeys:keys error:error];
+}
+
+#pragma mark - TCStatementQueuePersisting
+
+- (BOOL) persistStatements:(NSArray *)statements withError:(NSError **)error
+{
+    NSArray *storedKeys = [self.log keys];
+    NSSet *stored = [NSSet setWithArray:storedKeys];
+    NSMutableSet *queuedKeys = [NSMutableSet setWithCapacity:statements.count];
+    NSMutableArray *added = [NSMutableArray array];
+    for (TCStatement *statement in statements)
+    {
+        NSString *key = [self keyForStatement:statement];
+        if (!key)
+            continue;
+        [queuedKeys addObject:key];
+        if (![stored containsObject:key])
+            [added addObject:statement];
+    }
+
+    NSMutableArray *removedKeys = [NSMutableArray array];
+    for (NSString *key in storedKeys)
+    {
+        if (![queuedKeys containsObject:key])
+            [removedKeys addObject:key];
+    }
+
+    if (![self appendStatements:added withError:error])
+        return NO;
+    return [self.log acknowledgeKeys:removedKeys error:error];
+}
+
+- (BOOL) needsToRestoreQueue
+{
+    return !self.hasRestoredQueue && self.log.count > 0;
+}
+
+- (NSArray *) retrieveStatementsFromStoreWithError:(NSError **)error
+{
+    NSMutableArray *statements = [NSMutableArray arrayWithCapacity:self.log.count];
+    if (self.restoresLazily)
+    {
+        [self.log enumerateMappedRecordsWithMetadataUsingBlock:^(NSString *key, NSData *segmentData, NSRange payloadRange, NSRange metadataRange, BOOL *stop) {
+            [statements addObject:[[TCDLazyStatement alloc] initWithSid:key segmentData:segmentData range:payloadRange laneAttributesRange:metadataRange]];
+        }];
+        self.hasRestoredQueue = YES;
+        return statements;
+    }
+
+    [self.log enumerateMappedRecordsWithMetadataUsingBlock:^(NSString *key, NSData *segmentData, NSRange payloadRange, NSRange metadataRange, BOOL *stop) {
+        NSError *readError = nil;
+        TCStatement *statement = [TCStatement statementWithJSONBytes:(const uint8_t *)segmentData.bytes + payloadRange.location
+                                                              length:payloadRange.length error:&readError];
+        if (!statement)
+        {
+            NSLog(@"Skipping unreadable statement %@ in the statement queue log: %@", key, readError);
+            return;
+        }
+        NSDate *queuedDate = nil;
+        if (metadataRange.length > 0 && [TCStatement getLaneVerb:NULL activityType:NULL queuedDate:&queuedDate
+                                                        fromBytes:(const uint8_t *)segmentData.bytes + metadataRange.location length:metadataRange.length])
+            statement.queuedDate = queuedDate;
+        [statements addObject:statement];
+    }];
+    self.hasRestoredQueue = YES;
+    return statements;
+}
+
+@end
@@ -0,0 +1,51 @@
+//
+//  TCDStatementStore.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/2/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class TCStatement;
+
+/**
+ A local collection of statements retrieved from the LRS, keyed by statement id.
+ */
+@protocol TCDStatementStore <NSObject>
+@required
+
+/**
+ Number of statements in the store.
+ */
+@property (nonatomic, readonly) NSUInteger count;
+
+/**
+ Adds the statements that aren't stored yet. A statement whose id is already stored (or appears earlier in the
+ array) is skipped rather than replacing the stored one--statements can't change once the LRS has stored them--
+ so storing the same statements again writes nothing. Statements without an id are skipped.
+
+ @param statements      The statements to store.
+ @param insertedCount   If not NULL, returns how many of the statements weren't already stored.
+ @param error           Returns any error encountered while storing the statements.
+ @return                YES if the statements were stored.
+ */
+- (BOOL) upsertStatements:(NSArray *)statements insertedCount:(NSUInteger *)insertedCount error:(NSError **)error;
+
+/**
+ YES if a statement with the id is stored.
+ */
+- (BOOL) containsStatementWithId:(NSString *)sid;
+
+/**
+ The stored statement with the id (nil if there isn't one).
+ */
+- (TCStatement *) statementWithId:(NSString *)sid;
+
+/**
+ Enumerates every stored statement.
+ */
+- (void) enumerateStatementsUsingBlock:(void (^)(TCStatement *statement, BOOL *stop))block;
+
+@end
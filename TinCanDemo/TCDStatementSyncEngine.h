@@ -0,0 +1,76 @@
+//
+//  TCDStatementSyncEngine.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/2/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+#import "TCDStatementStore.h"
+
+@class TCAPI, TCStatementQuery;
+
+/**
+ Keeps a local statement store up to date with the statements matching queries on the LRS.
+
+ For each query signature (its verb, object, actor, instructor, registration, and context settings) the engine keeps
+ a high-water mark: the latest stored time it has seen. A sync asks the LRS only for statements stored since that
+ mark, less overlapWindow to catch statements the LRS stored out of order, and adds the ones the store doesn't
+ have yet by id, so statements fetched twice are skipped without being written again. The mark only moves once a sync has walked every page, and it's saved
+ to disk, so repeated syncs cost as much as the new statements rather than the whole history.
+
+ Use the engine from the main thread.
+ */
+@interface TCDStatementSyncEngine : NSObject
+
+/**
+ The store statements are synced into.
+ */
+@property (nonatomic, strong, readonly) id<TCDStatementStore> store;
+
+/**
+ How far before the high-water mark each sync starts (default=5 minutes).
+ */
+@property (nonatomic, readwrite) NSTimeInterval overlapWindow;
+
+/**
+ Designated initializer.
+
+ @param aAPI            The API to retrieve statements with.
+ @param aStore          The store to sync statements into.
+ @param aWatermarkPath  The file the high-water marks are saved in.
+ */
+- (id) initWithAPI:(TCAPI *)aAPI store:(id<TCDStatementStore>)aStore watermarkPath:(NSString *)aWatermarkPath;
+
+/**
+ Creates an engine that saves its high-water marks in Documents/tcStatementSync.plist.
+ */
+- (id) initWithAPI:(TCAPI *)aAPI store:(id<TCDStatementStore>)aStore;
+
+/**
+ The key high-water marks are saved under for a query. Queries with the same filters share a signature;
+ since, until, and limit are not part of it.
+ */
++ (NSString *) signatureForQuery:(TCStatementQuery *)query;
+
+/**
+ The latest stored time synced for a query (nil if it has never been synced).
+ */
+- (NSDate *) watermarkForQuery:(TCStatementQuery *)query;
+
+/**
+ Forgets the high-water mark for a query, so the next sync retrieves its whole history again.
+ */
+- (void) resetWatermarkForQuery:(TCStatementQuery *)query;
+
+/**
+ Retrieves the statements stored since the last sync of a query and upserts them into the store.
+ If the same query is already syncing, the completion block is called when that sync completes.
+
+ @param query       The query to sync. Its since and until are ignored.
+ @param completion  Called with the number of statements that weren't stored before, or the error that stopped the sync.
+ */
+- (void) syncQuery:(TCStatementQuery *)query completion:(void (^)(NSUInteger newStatementCount, NSError *error))completion;
+
+@end
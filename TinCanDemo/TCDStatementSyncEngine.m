@@ -0,0 +1,196 @@
+//
+//  TCDStatementSyncEngine.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/2/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDStatementSyncEngine.h"
+#import "TCDStatementCursor.h"
+#import "TCDJSONWriter.h"
+#import "TCStatementQuery+TCDCopying.h"
+
+static NSString* const kTCDDefaultWatermarkFile = @"tcStatementSync.plist";
+// Statements are upserted in groups of this many as they arrive.
+static const NSUInteger kTCDSyncUpsertBatchSize = 256;
+
+/**
+ One sync in progress.
+ */
+@interface TCDStatementSync : NSObject
+@property (nonatomic, strong) TCDStatementCursor *cursor;
+@property (nonatomic, strong) NSMutableArray *completions;
+@property (nonatomic, strong) NSMutableArray *pending;
+@property (nonatomic, strong) NSDate *latestStored;
+@property (nonatomic, readwrite) NSUInteger insertedCount;
+/**
+ Set if the store failed; the sync stops and the mark isn't moved.
+ */
+@property (nonatomic, strong) NSError *storeError;
+@end
+
+@implementation TCDStatementSync
+@end
+
+@implementation TCDStatementSyncEngine
+{
+    TCAPI *api;
+    NSString *watermarkPath;
+    NSMutableDictionary *watermarks;
+    NSMutableDictionary *activeSyncs;
+}
+
+- (id) initWithAPI:(TCAPI *)aAPI store:(id<TCDStatementStore>)aStore
+{
+    NSString *documents = [NSSearchPathForDirectoriesInDomains(NSDocumentDirectory, NSUserDomainMask, YES) objectAtIndex:0];
+    return [self initWithAPI:aAPI store:aStore watermarkPath:[documents stringByAppendingPathComponent:kTCDDefaultWatermarkFile]];
+}
+
+- (id) initWithAPI:(TCAPI *)aAPI store:(id<TCDStatementStore>)aStore watermarkPath:(NSString *)aWatermarkPath
+{
+    if ((self = [super init]))
+    {
+        api = aAPI;
+        _store = aStore;
+        watermarkPath = aWatermarkPath;
+        self.overlapWindow = 5 * 60;
+        watermarks = [[NSMutableDictionary alloc] initWithContentsOfFile:watermarkPath] ?: [[NSMutableDictionary alloc] init];
+        activeSyncs = [[NSMutableDictionary alloc] init];
+    }
+    return self;
+}
+
+#pragma mark - Watermarks
+
++ (NSString *) signatureForQuery:(TCStatementQuery *)query
+{
+    NSMutableDictionary *filters = [NSMutableDictionary dictionary];
+    if (query.verb)
+        [filters setObject:query.verb forKey:@"verb"];
+    if (query.object)
+        [filters setObject:[query.object dictionary] forKey:@"object"];
+    if (query.actor)
+        [filters setObject:[query.actor dictionary] forKey:@"actor"];
+    if (query.instructor)
+        [filters setObject:[query.instructor dictionary] forKey:@"instructor"];
+    if (query.registration)
+        [filters setObject:query.registration forKey:@"registration"];
+    [filters setObject:@(query.context) forKey:@"context"];
+    [filters setObject:@(query.authoritative) forKey:@"authoritative"];
+    [filters setObject:@(query.sparse) forKey:@"sparse"];
+
+    // TCDJSONWriter sorts keys, so the same filters always give the same signature.
+    NSData *JSON = [TCDJSONWriter dataWithJSONObject:filters error:NULL];
+    if (!JSON)
+        return [filters description];
+    return [[NSString alloc] initWithData:JSON encoding:NSUTF8StringEncoding];
+}
+
+- (NSDate *) watermarkForQuery:(TCStatementQuery *)query
+{
+    return [watermarks objectForKey:[[self class] signatureForQuery:query]];
+}
+
+- (void) setWatermark:(NSDate *)watermark forSignature:(NSString *)signature
+{
+    if (watermark)
+        [watermarks setObject:watermark forKey:signature];
+    else
+        [watermarks removeObjectForKey:signature];
+
+    if (![watermarks writeToFile:watermarkPath atomically:YES])
+        NSLog(@"Unable to save the statement sync watermarks to %@", watermarkPath);
+}
+
+- (void) resetWatermarkForQuery:(TCStatementQuery *)query
+{
+    [self setWatermark:nil forSignature:[[self class] signatureForQuery:query]];
+}
+
+#pragma mark - Syncing
+
+- (void) syncQuery:(TCStatementQuery *)query completion:(void (^)(NSUInteger, NSError *))completion
+{
+    NSString *signature = [[self class] signatureForQuery:query];
+    TCDStatementSync *sync = [activeSyncs objectForKey:signature];
+    if (sync)
+    {
+        if (completion)
+            [sync.completions addObject:[completion copy]];
+        return;
+    }
+
+    TCStatementQuery *incremental = [query queryCopy];
+    NSDate *watermark = [watermarks objectForKey:signature];
+    incremental.since = watermark ? [watermark dateByAddingTimeInterval:-self.overlapWindow] : nil;
+    incremental.until = nil;
+
+    sync = [[TCDStatementSync alloc] init];
+    sync.completions = [NSMutableArray array];
+    if (completion)
+        [sync.completions addObject:[completion copy]];
+    sync.pending = [NSMutableArray arrayWithCapacity:kTCDSyncUpsertBatchSize];
+    sync.latestStored = watermark;
+    sync.cursor = [[TCDStatementCursor alloc] initWithQuery:incremental api:api];
+    [activeSyncs setObject:sync forKey:signature];
+
+    __weak TCDStatementSyncEngine *weakSelf = self;
+    [sync.cursor enumerateStatementsUsingBlock:^(TCStatement *statement, BOOL *stop) {
+        [weakSelf sync:sync receivedStatement:statement stop:stop];
+    } completion:^(NSError *error) {
+        [weakSelf sync:sync signature:signature completedWithError:error];
+    }];
+}
+
+- (BOOL) upsertPendingStatementsOfSync:(TCDStatementSync *)sync error:(NSError **)error
+{
+    NSUInteger inserted = 0;
+    BOOL stored = [self.store upsertStatements:sync.pending insertedCount:&inserted error:error];
+    sync.insertedCount += inserted;
+    [sync.pending removeAllObjects];
+    return stored;
+}
+
+- (void) sync:(TCDStatementSync *)sync receivedStatement:(TCStatement *)statement stop:(BOOL *)stop
+{
+    NSDate *stored = statement.stored;
+    if (stored && (!sync.latestStored || [stored compare:sync.latestStored] == NSOrderedDescending))
+        sync.latestStored = stored;
+
+    [sync.pending addObject:statement];
+    if (sync.pending.count < kTCDSyncUpsertBatchSize)
+        return;
+
+    NSError *error = nil;
+    if (![self upsertPendingStatementsOfSync:sync error:&error])
+    {
+        sync.storeError = error;
+        *stop = YES;
+    }
+}
+
+- (void) sync:(TCDStatementSync *)sync signature:(NSString *)signature completedWithError:(NSError *)error
+{
+    [activeSyncs removeObjectForKey:signature];
+
+    if (!error)
+        error = sync.storeError;
+    if (!error)
+    {
+        NSError *storeError = nil;
+        if (![self upsertPendingStatementsOfSync:sync error:&storeError])
+            error = storeError;
+    }
+
+    // The LRS returns the newest statements first, so the mark can only move once every page has been stored.
+    if (!error && sync.latestStored)
+        [self setWatermark:sync.latestStored forSignature:signature];
+    if (error)
+        NSLog(@"Unable to sync statements: %@", error);
+
+    for (void (^completion)(NSUInteger, NSError *) in sync.completions)
+        completion(sync.insertedCount, error);
+}
+
+@end
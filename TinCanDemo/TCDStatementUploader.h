@@ -0,0 +1,144 @@
+//
+//  TCDStatementUploader.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/22/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+@class TCAPI, TCDStatementQueue, TCDStatementBatchBuilder, TCDAdaptiveBatchController, TCDDeadLetterStore, TCDRetryScheduler, TCDCircuitBreaker;
+
+/**
+ Sends the statement queue to the LRS in place of TCAPI's statement post interval.
+
+ Statements that aren't already in flight are taken in the queue's lane drain order
+ (statementsInDrainOrder:passingTest:), split into batches by batchBuilder and each batch is POSTed with
+ postStatements:delegate:. batchController limits how many batches are in flight and how many statements each holds;
+ as batches are stored, more of the queue is sent until it is empty. Batches that are stored are removed from the queue;
+ batches that fail are left in the queue to be sent on the next flush. TCAPI's queue delegate and notifications (TCStatementsPersistedNotification and
+ TCStatementsFailedPersistingNotification) are sent the same way TCAPI sends them.
+
+ When isolatesRejectedStatements is set, a batch the LRS rejects (400, 409 or 413) isn't handed back whole:
+ it is split in half and both halves are sent again, recursively, so the statements that are fine get stored and
+ the ones the LRS rejects on their own are found with O(k log n) requests for k bad statements in a batch of n.
+ The halves wait their turn ahead of the rest of the queue and are sent within the same limits (the batch window
+ and circuitBreaker) as any other batch.
+ Each rejected statement is kept in deadLetterStore, then removed from the queue and reported to the queue delegate
+ and notifications on its own; if deadLetterStore can't keep it, it stays queued instead. The delegate's return
+ value doesn't clear the queue in this mode.
+
+ start turns off TCAPI's own post interval and hands every later flushStatementQueue TCAPI makes (including those
+ behind startRequestAfterFlushingStatementQueue: and getStatementWithQuery:afterFlushingQueue:delegate:) to the
+ uploader, so no statement is POSTed outside its limits or sent twice. Use the uploader from the main thread.
+ */
+@interface TCDStatementUploader : NSObject
+
+/**
+ The API used to send statements.
+ */
+@property (nonatomic, strong, readonly) TCAPI *api;
+
+/**
+ The queue whose statements are sent.
+ */
+@property (nonatomic, strong, readonly) TCDStatementQueue *queue;
+
+/**
+ Decides how statements are grouped into requests.
+ */
+@property (nonatomic, strong) TCDStatementBatchBuilder *batchBuilder;
+
+/**
+ Sizes the batches and limits how many are in flight. Its maxStatementsPerBatch overrides batchBuilder's maxStatementCount.
+ */
+@property (nonatomic, strong) TCDAdaptiveBatchController *batchController;
+
+/**
+ If set, a batch that times out, can't reach the LRS, or is answered with 429 or a 5xx response holds back the whole
+ queue until the scheduler's backoff has passed, and is then sent again without waiting for postInterval.
+ Those failures aren't reported as persist failures.
+
+ The scheduler counts each statement's failed attempts; a statement's count is forgotten as soon as it leaves the
+ queue, however it is removed.
+ */
+@property (nonatomic, strong) TCDRetryScheduler *retryScheduler;
+
+/**
+ Failed attempts after which a statement is given up on (default=10; 0 for no limit). Once a statement has been
+ attempted this many times it is moved to deadLetterStore, removed from the queue and reported as failed, so it
+ can't hold back the rest of the queue forever. Only applies when both retryScheduler and deadLetterStore are set.
+ */
+@property (nonatomic, readwrite) NSUInteger maxAttempts;
+
+/**
+ If set, nothing is taken off the queue, serialized or sent while the breaker is open. Once it lets a probe through,
+ a single batch is sent; the queue is sent normally again as soon as the breaker closes.
+ */
+@property (nonatomic, strong) TCDCircuitBreaker *circuitBreaker;
+
+/**
+ YES to split rejected batches to find the statements the LRS rejects (default=NO).
+ */
+@property (nonatomic, readwrite) BOOL isolatesRejectedStatements;
+
+/**
+ Where statements the LRS rejects on their own are kept when isolatesRejectedStatements is set, and statements
+ that ran out of attempts (see maxAttempts).
+ */
+@property (nonatomic, strong) TCDDeadLetterStore *deadLetterStore;
+
+/**
+ Batches resent as halves of a rejected batch, and statements found to be rejected on their own.
+ */
+@property (nonatomic, readonly) NSUInteger isolationBatchCount;
+@property (nonatomic, readonly) NSUInteger rejectedStatementCount;
+
+/**
+ Seconds between attempts to send the queue while the uploader is running (default=120).
+ */
+@property (nonatomic, readwrite) NSTimeInterval postInterval;
+
+/**
+ YES between start and stop.
+ */
+@property (nonatomic, readonly) BOOL isRunning;
+
+/**
+ Number of batches that have been sent and haven't finished.
+ */
+@property (nonatomic, readonly) NSUInteger numberOfBatchesInFlight;
+
+/**
+ Designated initializer.
+
+ @param aAPI    The API used to send statements.
+ @param aQueue  The queue whose statements are sent.
+ */
+- (id) initWithAPI:(TCAPI *)aAPI queue:(TCDStatementQueue *)aQueue;
+
+/**
+ The started uploader that sends the API's statement queue, or nil if it has none.
+ */
++ (TCDStatementUploader *) uploaderForAPI:(TCAPI *)api;
+
+/**
+ Disables the API's statement post interval and starts sending the queue every postInterval seconds.
+ */
+- (void) start;
+
+/**
+ Stops sending the queue on an interval. Batches already in flight still finish.
+ */
+- (void) stop;
+
+/**
+ Sends statements in the queue that aren't already in flight, as many batches as batchController allows.
+ The rest of the queue is sent as those batches are stored.
+
+ @return    The number of statements sent now.
+ */
+- (NSUInteger) flushStatementQueue;
+
+@end
@@ -0,0 +1,488 @@
+//
+//  TCDStatementUploader.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/22/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDStatementUploader.h"
+#import "TCDStatementQueue.h"
+#import "TCDStatementBatchBuilder.h"
+#import "TCDAdaptiveBatchController.h"
+#import "TCDDeadLetterStore.h"
+#import "TCDRetryScheduler.h"
+#import "TCDCircuitBreaker.h"
+#import "TCAPIRequest+TCDURLRequest.h"
+#import "TCStatement+TCDQueueState.h"
+#import <objc/runtime.h>
+
+@class TCDStatementBatch;
+
+// TCAPI -> the uploader that sends its statement queue.
+static NSMapTable *uploadersByAPI = nil;
+
+@interface TCDStatementUploader ()
+@property (nonatomic, strong) NSTimer *postTimer;
+@property (nonatomic, strong) NSTimer *retryTimer;
+@property (nonatomic, readwrite) NSUInteger isolationBatchCount;
+@property (nonatomic, readwrite) NSUInteger rejectedStatementCount;
+- (void) batchDidFinish:(TCDStatementBatch *)batch;
+- (void) batch:(TCDStatementBatch *)batch didFailWithError:(NSError *)error;
+@end
+
+/**
+ The delegate of one POST. TCAPIRequest doesn't retain its delegate, so the uploader keeps each batch until it completes.
+ */
+@interface TCDStatementBatch : NSObject <TCAPIStatementRequestDelegate>
+@property (nonatomic, weak) TCDStatementUploader *uploader;
+@property (nonatomic, copy) NSArray *statements;
+@property (nonatomic, readwrite) NSUInteger byteCount;
+@property (nonatomic, strong) NSDate *sentDate;
+@property (nonatomic, strong) TCAPIStoreStatementsRequest *request;
+/**
+ Set when the LRS rejected the statements (rather than the request failing to get through).
+ */
+@property (nonatomic, strong) NSError *persistError;
+@end
+
+@implementation TCDStatementBatch
+
+- (void) statementsFailedToPersist:(NSArray *)statements withError:(NSError *)error
+{
+    self.persistError = error;
+}
+
+- (void) requestDidFinish:(TCAPIRequest *)request
+{
+    [self.uploader batchDidFinish:self];
+}
+
+- (void) request:(TCAPIRequest *)request didFailWithError:(NSError *)error
+{
+    [self.uploader batch:self didFailWithError:error];
+}
+
+@end
+
+/**
+ TCAPI's flushStatementQueue, handed to the API's uploader once it has started. The post interval, startStatementPostInterval
+ (e.g. when the endpoint becomes available), startRequestAfterFlushingStatementQueue: and
+ getStatementWithQuery:afterFlushingQueue:delegate: all flush through it, so this is the one point every statement
+ POST TCAPI would make from its queue passes.
+ */
+@interface TCAPI (TCDStatementUploading)
+- (NSUInteger) tcd_flushStatementQueue;
+@end
+
+// Implemented by TCAPI but not published.
+@interface TCAPI (TCDPendingRequests)
+- (void) startPendingRequests;
+@end
+
+@implementation TCAPI (TCDStatementUploading)
+
++ (void) load
+{
+    method_exchangeImplementations(class_getInstanceMethod(self, @selector(flushStatementQueue)), class_getInstanceMethod(self, @selector(tcd_flushStatementQueue)));
+}
+
+- (NSUInteger) tcd_flushStatementQueue
+{
+    // The implementations are exchanged: tcd_flushStatementQueue is TCAPI's own flushStatementQueue.
+    TCDStatementUploader *uploader = [TCDStatementUploader uploaderForAPI:self];
+    if (!uploader)
+        return [self tcd_flushStatementQueue];
+
+    NSUInteger sentCount = [uploader flushStatementQueue];
+    // TCAPI starts the requests waiting on a flush when its last POST finishes; with none in flight there won't be one.
+    if (uploader.numberOfBatchesInFlight == 0 && [self respondsToSelector:@selector(startPendingRequests)])
+        [self startPendingRequests];
+    return sentCount;
+}
+
+@end
+
+@implementation TCDStatementUploader
+{
+    NSMutableArray *activeBatches;
+    // Ids of statements that are being sent, or are waiting in isolationBatches to be; the queue isn't drained of them.
+    NSMutableSet *idsInFlight;
+    // Halves of rejected batches, waiting for room in the window to be sent.
+    NSMutableArray *isolationBatches;
+}
+
+- (id) initWithAPI:(TCAPI *)aAPI queue:(TCDStatementQueue *)aQueue
+{
+    if ((self = [super init]))
+    {
+        _api = aAPI;
+        _queue = aQueue;
+        self.batchBuilder = [[TCDStatementBatchBuilder alloc] init];
+        self.batchController = [[TCDAdaptiveBatchController alloc] init];
+        self.postInterval = 120;
+        self.maxAttempts = 10;
+        activeBatches = [[NSMutableArray alloc] init];
+        idsInFlight = [[NSMutableSet alloc] init];
+        isolationBatches = [[NSMutableArray alloc] init];
+        [[NSNotificationCenter defaultCenter] addObserver:self selector:@selector(queueDidRemoveStatements:) name:TCDStatementQueueDidRemoveStatementsNotification object:aQueue];
+    }
+    return self;
+}
+
+- (void) dealloc
+{
+    [[NSNotificationCenter defaultCenter] removeObserver:self];
+    [self.postTimer invalidate];
+    [self.retryTimer invalidate];
+}
+
+- (BOOL) isRunning
+{
+    return self.postTimer != nil;
+}
+
+- (NSUInteger) numberOfBatchesInFlight
+{
+    return activeBatches.count;
+}
+
+- (void) setCircuitBreaker:(TCDCircuitBreaker *)circuitBreaker
+{
+    NSNotificationCenter *center = [NSNotificationCenter defaultCenter];
+    if (_circuitBreaker)
+        [center removeObserver:self name:TCDCircuitBreakerStateDidChangeNotification object:_circuitBreaker];
+    _circuitBreaker = circuitBreaker;
+    if (circuitBreaker)
+        [center addObserver:self selector:@selector(circuitBreakerStateDidChange:) name:TCDCircuitBreakerStateDidChangeNotification object:circuitBreaker];
+}
+
+- (void) circuitBreakerStateDidChange:(NSNotification *)notification
+{
+    TCDCircuitBreakerState state = [[notification.userInfo objectForKey:@"state"] intValue];
+    dispatch_async(dispatch_get_main_queue(), ^{
+        if (state == TCDCircuitBreakerStateClosed)
+            [self flushStatementQueue];
+        else if (state == TCDCircuitBreakerStateOpen)
+            [self scheduleFlushAtDate:self.circuitBreaker.probeDate];
+    });
+}
+
+- (void) queueDidRemoveStatements:(NSNotification *)notification
+{
+    // Posted on whichever thread removed the statements; the scheduler can be used from any thread.
+    [self.retryScheduler forgetStatements:[notification.userInfo objectForKey:@"statements"]];
+}
+
+#pragma mark - Interval
+
++ (TCDStatementUploader *) uploaderForAPI:(TCAPI *)api
+{
+    if (!api)
+        return nil;
+    @synchronized(self)
+    {
+        return [uploadersByAPI objectForKey:api];
+    }
+}
+
+- (void) start
+{
+    if (self.isRunning)
+        return;
+
+    self.api.statementPostInterval = 0;
+    // From here on TCAPI's own flushes are sent by the uploader too (see TCAPI (TCDStatementUploading)).
+    @synchronized([TCDStatementUploader class])
+    {
+        if (!uploadersByAPI)
+            uploadersByAPI = [NSMapTable weakToWeakObjectsMapTable];
+        [uploadersByAPI setObject:self forKey:self.api];
+    }
+    // The timer retains the uploader until stop is called.
+    self.postTimer = [NSTimer scheduledTimerWithTimeInterval:self.postInterval target:self selector:@selector(postTimerFired:) userInfo:nil repeats:YES];
+}
+
+- (void) stop
+{
+    [self.postTimer invalidate];
+    self.postTimer = nil;
+}
+
+- (void) postTimerFired:(NSTimer *)timer
+{
+    [self flushStatementQueue];
+}
+
+- (void) scheduleRetry
+{
+    [self scheduleFlushAtDate:self.retryScheduler.nextAttemptDate];
+}
+
+/**
+ Flushes the queue at the specified date, sooner than postInterval, e.g. when a backoff ends or a breaker allows a probe.
+ */
+- (void) scheduleFlushAtDate:(NSDate *)date
+{
+    if (!date || [self.retryTimer.fireDate isEqualToDate:date])
+        return;
+    [self.retryTimer invalidate];
+    self.retryTimer = [[NSTimer alloc] initWithFireDate:date interval:0 target:self selector:@selector(retryTimerFired:) userInfo:nil repeats:NO];
+    [[NSRunLoop mainRunLoop] addTimer:self.retryTimer forMode:NSDefaultRunLoopMode];
+}
+
+- (void) retryTimerFired:(NSTimer *)timer
+{
+    self.retryTimer = nil;
+    [self flushStatementQueue];
+}
+
+#pragma mark - Sending
+
+- (NSUInteger) flushStatementQueue
+{
+    if (self.retryScheduler && !self.retryScheduler.isReadyToSend)
+    {
+        [self scheduleRetry];
+        return 0;
+    }
+
+    NSUInteger maxBatchesInFlight = self.batchController.maxBatchesInFlight;
+    TCDCircuitBreaker *breaker = self.circuitBreaker;
+    BOOL probing = NO;
+    if (breaker && breaker.state != TCDCircuitBreakerStateClosed)
+    {
+        // Checked before the queue is read so an open breaker costs no serialization at all.
+        if (activeBatches.count > 0 || ![breaker allowsRequest])
+        {
+            [self scheduleFlushAtDate:breaker.probeDate];
+            return 0;
+        }
+        maxBatchesInFlight = 1;
+        probing = YES;
+    }
+
+    // Halves of rejected batches go first, through the same window and breaker as the rest of the queue.
+    NSUInteger sentCount = 0;
+    while (isolationBatches.count > 0 && activeBatches.count < maxBatchesInFlight)
+    {
+        NSArray *statements = [self nextIsolationBatch];
+        if (!statements)
+            continue;
+        self.isolationBatchCount++;
+        sentCount += statements.count;
+        TCDStatementBatch *batch = [self sendBatch:statements byteCount:[TCDStatementBatchBuilder estimatedLengthOfBatch:statements]];
+        if (probing)
+            [breaker beginProbeWithRequest:batch.request];
+    }
+    if (activeBatches.count >= maxBatchesInFlight)
+        return sentCount;
+
+    // Only as much of the queue as the window can take is read, in the order the lanes should drain.
+    NSSet *inFlight = idsInFlight;
+    NSUInteger windowCount = self.batchController.maxStatementsPerBatch * (maxBatchesInFlight - MIN(activeBatches.count, maxBatchesInFlight));
+    NSArray *pending = [self.queue statementsInDrainOrder:windowCount passingTest:^BOOL(TCStatement *statement) {
+        return ![inFlight containsObject:statement.sid];
+    }];
+
+    self.batchBuilder.maxStatementCount = self.batchController.maxStatementsPerBatch;
+    NSUInteger index = 0;
+    while (index < pending.count && activeBatches.count < maxBatchesInFlight)
+    {
+        NSUInteger byteCount = 0;
+        NSArray *statements = [self.batchBuilder nextBatchFromStatements:pending atIndex:&index byteCount:&byteCount];
+        TCDStatementBatch *batch = [self sendBatch:statements byteCount:byteCount];
+        // The probe is claimed only once there is a batch to be it.
+        if (probing)
+            [breaker beginProbeWithRequest:batch.request];
+    }
+    return sentCount + index;
+}
+
+- (TCDStatementBatch *) sendBatch:(NSArray *)statements byteCount:(NSUInteger)byteCount
+{
+    TCDStatementBatch *batch = [[TCDStatementBatch alloc] init];
+    batch.uploader = self;
+    batch.statements = statements;
+    batch.byteCount = byteCount;
+    batch.sentDate = [NSDate date];
+
+    for (TCStatement *statement in statements)
+    {
+        [idsInFlight addObject:statement.sid];
+        statement.sentToLRS = YES;
+    }
+    [activeBatches addObject:batch];
+    batch.request = [self.api postStatements:statements delegate:batch];
+    return batch;
+}
+
+- (void) endBatch:(TCDStatementBatch *)batch
+{
+    for (TCStatement *statement in batch.statements)
+        [idsInFlight removeObject:statement.sid];
+    batch.request = nil;
+    [activeBatches removeObjectIdenticalTo:batch];
+}
+
+- (void) batchDidFinish:(TCDStatementBatch *)batch
+{
+    [self.batchController recordSuccessForBatchSentAt:batch.sentDate latency:-[batch.sentDate timeIntervalSinceNow]];
+    [self.retryScheduler recordSuccessForStatements:batch.statements];
+    for (TCStatement *statement in batch.statements)
+        statement.persistedOnLRS = YES;
+    [self.queue removeStatementsInArray:batch.statements];
+    [self endBatch:batch];
+
+    id<TCAPIQueueDelegate> delegate = self.api.delegate;
+    if ([delegate respondsToSelector:@selector(statementsStored:)])
+        [delegate statementsStored:batch.statements];
+    [[NSNotificationCenter defaultCenter] postNotificationName:TCStatementsPersistedNotification
+                                                        object:self.api
+                                                      userInfo:@{ @"statements" : batch.statements }];
+
+    // Keep the window full until the queue is empty.
+    [self flushStatementQueue];
+}
+
+- (void) batch:(TCDStatementBatch *)batch didFailWithError:(NSError *)error
+{
+    NSHTTPURLResponse *response = batch.request.HTTPResponse;
+    NSInteger statusCode = response.statusCode;
+    BOOL rejected = batch.persistError && (statusCode == 400 || statusCode == 409 || statusCode == 413);
+    BOOL isolating = rejected && self.isolatesRejectedStatements;
+    // A rejected batch says nothing about the network, so it doesn't shrink the window when it's being isolated.
+    if (!isolating)
+        [self.batchController recordFailureForBatchSentAt:batch.sentDate error:error timedOut:batch.request.didTimeOut];
+    NSString *serverMessage = isolating ? [[NSString alloc] initWithData:batch.request.responseBody encoding:NSUTF8StringEncoding] : nil;
+    for (TCStatement *statement in batch.statements)
+        statement.sentToLRS = NO;
+    [self endBatch:batch];
+
+    // Timeouts and connection failures aren't reported as persist failures; the statements are simply sent again next time.
+    BOOL throttled = (statusCode == 429 || statusCode >= 500);
+    if (!batch.persistError || (throttled && self.retryScheduler))
+    {
+        if (self.retryScheduler)
+        {
+            [self.retryScheduler recordFailureWithResponse:response statements:batch.statements];
+            [self giveUpOnStatementsOutOfAttempts:batch.statements error:batch.persistError ?: error statusCode:statusCode];
+            [self scheduleRetry];
+        }
+        return;
+    }
+
+    if (isolating)
+    {
+        [self isolateRejectedBatch:batch statusCode:statusCode serverMessage:serverMessage];
+        return;
+    }
+
+    BOOL keepQueue = [self reportFailedStatements:batch.statements error:batch.persistError];
+    if (!keepQueue)
+        [self.queue removeAllStatements];
+}
+
+/**
+ Tells the queue delegate and observers that statements failed to persist.
+
+ @return    The delegate's answer to whether the queue should be kept.
+ */
+- (BOOL) reportFailedStatements:(NSArray *)statements error:(NSError *)error
+{
+    BOOL keepQueue = YES;
+    id<TCAPIQueueDelegate> delegate = self.api.delegate;
+    if ([delegate respondsToSelector:@selector(statementsFailed:withError:)])
+        keepQueue = [delegate statementsFailed:statements withError:error];
+    [[NSNotificationCenter defaultCenter] postNotificationName:TCStatementsFailedPersistingNotification
+                                                        object:self.api
+                                                      userInfo:@{ @"statements" : statements, @"error" : error }];
+    return keepQueue;
+}
+
+/**
+ Moves the statements that have used up maxAttempts to the dead letter store and out of the queue.
+ */
+- (void) giveUpOnStatementsOutOfAttempts:(NSArray *)statements error:(NSError *)error statusCode:(NSInteger)statusCode
+{
+    if (self.maxAttempts == 0 || !self.deadLetterStore)
+        return;
+
+    NSMutableArray *exhausted = [NSMutableArray array];
+    for (TCStatement *statement in statements)
+    {
+        if ([self.retryScheduler attemptCountForStatement:statement] < self.maxAttempts)
+            continue;
+        NSError *storeError = nil;
+        if (![self.deadLetterStore addStatement:statement rejectedWithError:error statusCode:statusCode serverMessage:nil error:&storeError])
+        {
+            // Keep it queued rather than lose it.
+            NSLog(@"Unable to keep statement %@ that ran out of attempts: %@", statement.sid, storeError);
+            continue;
+        }
+        [exhausted addObject:statement];
+    }
+    if (exhausted.count == 0)
+        return;
+
+    // Removing them from the queue forgets their attempt counts too.
+    [self.queue removeStatementsInArray:exhausted];
+    [self reportFailedStatements:exhausted error:error];
+}
+
+#pragma mark - Isolating rejected statements
+
+- (void) isolateRejectedBatch:(TCDStatementBatch *)batch statusCode:(NSInteger)statusCode serverMessage:(NSString *)serverMessage
+{
+    NSArray *statements = batch.statements;
+    if (statements.count > 1)
+    {
+        // Bisect: whichever half holds the bad statements is rejected again and split further.
+        NSUInteger half = statements.count / 2;
+        NSArray *halves = @[[statements subarrayWithRange:NSMakeRange(0, half)],
+                            [statements subarrayWithRange:NSMakeRange(half, statements.count - half)]];
+        [isolationBatches addObjectsFromArray:halves];
+        // Keep the statements out of the queue's drain until their half is sent.
+        for (TCStatement *statement in statements)
+            [idsInFlight addObject:statement.sid];
+        [self flushStatementQueue];
+        return;
+    }
+
+    TCStatement *statement = [statements lastObject];
+    self.rejectedStatementCount++;
+    NSError *storeError = nil;
+    if (self.deadLetterStore && ![self.deadLetterStore addStatement:statement rejectedWithError:batch.persistError statusCode:statusCode serverMessage:serverMessage error:&storeError])
+    {
+        // Keep it queued rather than lose it; it is sent (and isolated) again on a later flush.
+        NSLog(@"Unable to keep rejected statement %@: %@", statement.sid, storeError);
+        return;
+    }
+    [self.queue removeStatementsInArray:statements];
+
+    // Only this statement was rejected; the rest of the queue stays whatever the delegate answers.
+    [self reportFailedStatements:statements error:batch.persistError];
+}
+
+/**
+ Takes the oldest waiting half of a rejected batch, leaving out statements that have left the queue meanwhile.
+
+ @return    The statements to send, or nil if none of them are queued any more.
+ */
+- (NSArray *) nextIsolationBatch
+{
+    NSArray *half = [isolationBatches objectAtIndex:0];
+    [isolationBatches removeObjectAtIndex:0];
+
+    NSMutableArray *statements = [NSMutableArray arrayWithCapacity:half.count];
+    for (TCStatement *statement in half)
+    {
+        if ([self.queue queuedStatementWithId:statement.sid])
+            [statements addObject:statement];
+        else
+            [idsInFlight removeObject:statement.sid];
+    }
+    return statements.count > 0 ? statements : nil;
+}
+
+@end
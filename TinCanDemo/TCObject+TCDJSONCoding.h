@@ -0,0 +1,55 @@
+//
+//  TCObject+TCDJSONCoding.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/12/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <TinCan/TCObject.h>
+
+@class TCDJSONWriter, TCDJSONReader;
+
+/**
+ JSON coding for the TinCan object types without going through -dictionary and -initWithDictionary:.
+
+ Each type (TCStatement, TCAgent and its subclasses, TCActivity, TCActivityDefinition, TCResult, TCScore, TCContext,
+ TCContextActivities, TCAccount, TCLanguageMap) writes its properties straight to a TCDJSONWriter, in sorted key
+ order, following the rules of -dictionary and -tinCanValueForKey: (nil values and empty arrays are left out, dates
+ are RFC 3339 timestamps, and so on). The bytes are the same as TCDJSONWriter gives for the object's dictionary,
+ except that TinCan objects inside arrays (a group's members) are written as objects, where the dictionary can't be written at all.
+
+ Reading fills an object in from a TCDJSONReader as -initWithDictionary: would, picking the class from objectType
+ the same way +objectFromDictionary: does. Keys a type doesn't know are handed to -setTinCanValue:forProperty:;
+ values of the wrong JSON type for a known key (and nulls) are left out rather than stored in the property.
+
+ Other TCObject subclasses fall back to -dictionary and -setTinCanValue:forProperty:.
+ */
+@interface TCObject (TCDJSONCoding)
+
+/**
+ Writes the object as a JSON object.
+ */
+- (void) writeJSONWithWriter:(TCDJSONWriter *)writer;
+
+/**
+ Reads an object of the receiving class (or the subclass its objectType names) from the reader's next value.
+
+ @return    The object, or nil if the next value isn't an object or the reader ran into malformed JSON.
+ */
++ (id) objectWithJSONReader:(TCDJSONReader *)reader;
+
+/**
+ Reads an object of the receiving class from JSON bytes that hold just that object.
+
+ @param error   Set if the JSON is malformed or isn't an object.
+ */
++ (id) objectWithJSONBytes:(const uint8_t *)bytes length:(NSUInteger)length error:(NSError **)error;
+
+/**
+ Reads the value for one key of the object's JSON into the object. Subclasses handle their own keys and pass the
+ rest to super; the base implementation hands the value to -setTinCanValue:forProperty:.
+ */
+- (void) readJSONValueForKey:(const char *)key reader:(TCDJSONReader *)reader;
+
+@end
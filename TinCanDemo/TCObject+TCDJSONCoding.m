@@ -0,0 +1,676 @@
+//
+//  TCObject+TCDJSONCoding.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/12/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCObject+TCDJSONCoding.h"
+#import "TCDJSONWriter.h"
+#import "TCDJSONReader.h"
+
+// Declared by the framework, but not in its public headers.
+@interface NSDate (InternetTimestamps)
+- (NSString *) RFC3339Timestamp;
++ (NSDate *) dateFromRFC3339Timestamp:(NSString *)timestamp;
+@end
+
+@interface TCResult (ISO8601Duration)
+- (NSString *) ISO8601durationWithTimeInterval:(NSTimeInterval)interval;
+- (NSTimeInterval) timeIntervalWithISO8601duration:(NSString *)duration;
+@end
+
+@interface TCObject (TCDJSONCodingClass)
++ (Class) classForJSONReader:(TCDJSONReader *)reader;
+@end
+
+// TCActivityType values as -[TCActivityDefinition tinCanValueForKey:] writes them (its spelling of "interaction" included).
+static NSString* const kTCDActivityTypeNames[] = {
+    nil, @"course", @"module", @"meeting", @"media", @"performance", @"simulation",
+    @"assessment", @"interation", @"cmi.interaction", @"question", @"objective", @"link"
+};
+
+static inline BOOL TCDKeyIs(const char *key, const char *name)
+{
+    return strcmp(key, name) == 0;
+}
+
+#pragma mark - Writing
+
+/**
+ Writes a value the way -dictionary holds it: TinCan objects write themselves, dates become RFC 3339 timestamps.
+ Array elements are taken as they are, except that TinCan objects in them write themselves too.
+ */
+static void TCDWriteValue(TCDJSONWriter *writer, id value)
+{
+    if ([value isKindOfClass:[TCObject class]])
+    {
+        [value writeJSONWithWriter:writer];
+    }
+    else if ([value isKindOfClass:[NSDate class]])
+    {
+        [writer writeString:[value RFC3339Timestamp]];
+    }
+    else if ([value isKindOfClass:[NSArray class]])
+    {
+        [writer beginArray];
+        for (id element in value)
+        {
+            if ([element isKindOfClass:[TCObject class]])
+                [element writeJSONWithWriter:writer];
+            else
+                [writer writeJSONObject:element];
+        }
+        [writer endArray];
+    }
+    else
+    {
+        [writer writeJSONObject:value];
+    }
+}
+
+/**
+ Writes a property by -tinCanValueForKey:'s rules: nil values and empty arrays are left out.
+ */
+static void TCDWriteProperty(TCDJSONWriter *writer, const char *key, id value)
+{
+    if (!value || ([value isKindOfClass:[NSArray class]] && [value count] == 0))
+        return;
+    [writer writeKey:key];
+    TCDWriteValue(writer, value);
+}
+
+/**
+ BOOL properties reach -dictionary through KVC, which boxes a signed char BOOL as a char (written 0 or 1)
+ and a bool BOOL as a boolean.
+ */
+static void TCDWriteBOOLProperty(TCDJSONWriter *writer, const char *key, BOOL value)
+{
+    [writer writeKey:key];
+    if (strcmp(@encode(BOOL), @encode(bool)) == 0)
+        [writer writeBool:value];
+    else
+        [writer writeInteger:value];
+}
+
+/**
+ -[TCAgent tinCanValueForKey:] always gives an array for account, even an empty one, holding each account's dictionary.
+ */
+static void TCDWriteAgentAccounts(TCDJSONWriter *writer, TCAgent *agent)
+{
+    [writer writeKey:"account"];
+    [writer beginArray];
+    for (id account in agent.account)
+    {
+        if ([account isKindOfClass:[TCObject class]])
+            [account writeJSONWithWriter:writer];
+        else
+            [writer failWithMessage:[NSString stringWithFormat:@"Agent account %@ isn't a TCAccount", account]];
+    }
+    [writer endArray];
+}
+
+static NSString *TCDActivityTypeName(TCActivityType type)
+{
+    NSUInteger count = sizeof(kTCDActivityTypeNames) / sizeof(kTCDActivityTypeNames[0]);
+    return (NSUInteger)type < count ? kTCDActivityTypeNames[type] : nil;
+}
+
+#pragma mark - Reading
+
+static NSDate *TCDReadDate(TCDJSONReader *reader)
+{
+    NSString *timestamp = [reader readString];
+    return timestamp ? [NSDate dateFromRFC3339Timestamp:timestamp] : nil;
+}
+
+static id TCDReadValueOfClass(TCDJSONReader *reader, Class valueClass)
+{
+    id value = [reader readValue];
+    return [value isKindOfClass:valueClass] ? value : nil;
+}
+
+#pragma mark -
+
+@implementation TCObject (TCDJSONCoding)
+
+- (void) writeJSONWithWriter:(TCDJSONWriter *)writer
+{
+    [writer writeJSONObject:[self dictionary]];
+}
+
++ (Class) classForJSONReader:(TCDJSONReader *)reader
+{
+    static NSDictionary *classesByObjectType;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        classesByObjectType = @{ @"Agent" : [TCAgent class], @"Statement" : [TCStatement class], @"Activity" : [TCActivity class],
+                                 @"Person" : [TCPerson class], @"Group" : [TCGroup class] };
+    });
+
+    // As +objectFromDictionary: does, objectType only ever picks a subclass of the class asked for.
+    NSString *objectType = [reader peekStringForKey:"objectType" inObjectForKey:NULL];
+    Class objectClass = objectType ? [classesByObjectType objectForKey:objectType] : Nil;
+    if (objectClass && objectClass != self && [objectClass isSubclassOfClass:self])
+        return objectClass;
+    return self;
+}
+
++ (id) objectWithJSONReader:(TCDJSONReader *)reader
+{
+    Class objectClass = [self classForJSONReader:reader];
+    if (objectClass != self)
+        return [objectClass objectWithJSONReader:reader];
+
+    if (![reader beginObject])
+        return nil;
+    TCObject *object = [[self alloc] init];
+    const char *key;
+    while ((key = [reader nextKey]))
+        [object readJSONValueForKey:key reader:reader];
+    return reader.error ? nil : object;
+}
+
++ (id) objectWithJSONBytes:(const uint8_t *)bytes length:(NSUInteger)length error:(NSError **)error
+{
+    TCDJSONReader *reader = [[TCDJSONReader alloc] initWithBytes:bytes length:length];
+    id object = [self objectWithJSONReader:reader];
+    if (object && [reader isAtEnd])
+        return object;
+    if (error)
+        *error = reader.error ?: [NSError errorWithDomain:TCDJSONReaderErrorDomain code:2
+                                                 userInfo:@{ NSLocalizedDescriptionKey : @"The JSON isn't a single object" }];
+    return nil;
+}
+
+- (void) readJSONValueForKey:(const char *)key reader:(TCDJSONReader *)reader
+{
+    id value = [reader readValue];
+    if (value && value != [NSNull null])
+        [self setTinCanValue:value forProperty:[NSString stringWithUTF8String:key]];
+}
+
+@end
+
+#pragma mark - Statements
+
+@implementation TCStatementObject (TCDJSONCoding)
+
+- (void) writeJSONWithWriter:(TCDJSONWriter *)writer
+{
+    [writer beginObject];
+    TCDWriteProperty(writer, "objectType", self.objectType);
+    [writer endObject];
+}
+
+- (void) readJSONValueForKey:(const char *)key reader:(TCDJSONReader *)reader
+{
+    if (TCDKeyIs(key, "objectType"))
+        self.objectType = [reader readString];
+    else
+        [super readJSONValueForKey:key reader:reader];
+}
+
+@end
+
+@implementation TCStatement (TCDJSONCoding)
+
+- (void) writeJSONWithWriter:(TCDJSONWriter *)writer
+{
+    [writer beginObject];
+    TCDWriteProperty(writer, "actor", self.actor);
+    TCDWriteProperty(writer, "authority", self.authority);
+    TCDWriteProperty(writer, "context", self.context);
+    TCDWriteProperty(writer, "id", self.sid);
+    TCDWriteBOOLProperty(writer, "inProgress", self.inProgress);
+    TCDWriteProperty(writer, "object", self.object);
+    TCDWriteProperty(writer, "objectType", self.objectType);
+    TCDWriteProperty(writer, "result", self.result);
+    TCDWriteProperty(writer, "stored", self.stored);
+    TCDWriteProperty(writer, "timestamp", self.timestamp);
+    TCDWriteProperty(writer, "verb", self.verb);
+    TCDWriteBOOLProperty(writer, "voided", self.voided);
+    [writer endObject];
+}
+
+- (void) readJSONValueForKey:(const char *)key reader:(TCDJSONReader *)reader
+{
+    if (TCDKeyIs(key, "id"))
+        self.sid = [reader readString];
+    else if (TCDKeyIs(key, "actor"))
+        self.actor = [TCAgent objectWithJSONReader:reader];
+    else if (TCDKeyIs(key, "verb"))
+        self.verb = [reader readString];
+    else if (TCDKeyIs(key, "inProgress"))
+        self.inProgress = [reader readBool];
+    else if (TCDKeyIs(key, "object"))
+        self.object = [TCStatementObject objectWithJSONReader:reader];
+    else if (TCDKeyIs(key, "result"))
+        self.result = [TCResult objectWithJSONReader:reader];
+    else if (TCDKeyIs(key, "context"))
+        self.context = [TCContext objectWithJSONReader:reader];
+    else if (TCDKeyIs(key, "timestamp"))
+        self.timestamp = TCDReadDate(reader);
+    else if (TCDKeyIs(key, "stored"))
+        [self setValue:TCDReadDate(reader) forKey:@"stored"];    // readonly; -setTinCanValue:forProperty: sets it the same way
+    else if (TCDKeyIs(key, "authority"))
+        self.authority = [TCAgent objectWithJSONReader:reader];
+    else if (TCDKeyIs(key, "voided"))
+        self.voided = [reader readBool];
+    else
+        [super readJSONValueForKey:key reader:reader];
+}
+
+@end
+
+#pragma mark - Agents
+
+@implementation TCAgent (TCDJSONCoding)
+
+- (void) writeJSONWithWriter:(TCDJSONWriter *)writer
+{
+    [writer beginObject];
+    TCDWriteAgentAccounts(writer, self);
+    TCDWriteProperty(writer, "mbox", self.mbox);
+    TCDWriteProperty(writer, "mbox_sha1sum", self.mbox_sha1sum);
+    TCDWriteProperty(writer, "name", self.name);
+    TCDWriteProperty(writer, "objectType", self.objectType);
+    TCDWriteProperty(writer, "openid", self.openid);
+    [writer endObject];
+}
+
+- (void) readJSONValueForKey:(const char *)key reader:(TCDJSONReader *)reader
+{
+    if (TCDKeyIs(key, "name"))
+    {
+        self.name = TCDReadValueOfClass(reader, [NSMutableArray class]);
+    }
+    else if (TCDKeyIs(key, "mbox"))
+    {
+        self.mbox = TCDReadValueOfClass(reader, [NSMutableArray class]);
+    }
+    else if (TCDKeyIs(key, "openid"))
+    {
+        self.openid = TCDReadValueOfClass(reader, [NSMutableArray class]);
+    }
+    else if (TCDKeyIs(key, "account"))
+    {
+        NSMutableArray *accounts = [NSMutableArray array];
+        if ([reader beginArray])
+        {
+            while ([reader nextElement])
+            {
+                TCAccount *account = [TCAccount objectWithJSONReader:reader];
+                if (account)
+                    [accounts addObject:account];
+            }
+        }
+        self.account = accounts;
+    }
+    else if (TCDKeyIs(key, "mbox_sha1sum"))
+    {
+        // Worked out from mbox; -setTinCanValue:forProperty: drops it too.
+        [reader skipValue];
+    }
+    else
+    {
+        [super readJSONValueForKey:key reader:reader];
+    }
+}
+
+@end
+
+@implementation TCPerson (TCDJSONCoding)
+
+- (void) writeJSONWithWriter:(TCDJSONWriter *)writer
+{
+    [writer beginObject];
+    TCDWriteAgentAccounts(writer, self);
+    TCDWriteProperty(writer, "familyName", self.familyName);
+    TCDWriteProperty(writer, "firstName", self.firstName);
+    TCDWriteProperty(writer, "givenName", self.givenName);
+    TCDWriteProperty(writer, "lastName", self.lastName);
+    TCDWriteProperty(writer, "mbox", self.mbox);
+    TCDWriteProperty(writer, "mbox_sha1sum", self.mbox_sha1sum);
+    TCDWriteProperty(writer, "name", self.name);
+    TCDWriteProperty(writer, "objectType", self.objectType);
+    TCDWriteProperty(writer, "openid", self.openid);
+    [writer endObject];
+}
+
+- (void) readJSONValueForKey:(const char *)key reader:(TCDJSONReader *)reader
+{
+    if (TCDKeyIs(key, "givenName"))
+        self.givenName = TCDReadValueOfClass(reader, [NSMutableArray class]);
+    else if (TCDKeyIs(key, "familyName"))
+        self.familyName = TCDReadValueOfClass(reader, [NSMutableArray class]);
+    else if (TCDKeyIs(key, "firstName"))
+        self.firstName = TCDReadValueOfClass(reader, [NSMutableArray class]);
+    else if (TCDKeyIs(key, "lastName"))
+        self.lastName = TCDReadValueOfClass(reader, [NSMutableArray class]);
+    else
+        [super readJSONValueForKey:key reader:reader];
+}
+
+@end
+
+@implementation TCGroup (TCDJSONCoding)
+
+- (void) writeJSONWithWriter:(TCDJSONWriter *)writer
+{
+    [writer beginObject];
+    TCDWriteAgentAccounts(writer, self);
+    TCDWriteProperty(writer, "mbox", self.mbox);
+    TCDWriteProperty(writer, "mbox_sha1sum", self.mbox_sha1sum);
+    TCDWriteProperty(writer, "members", self.members);
+    TCDWriteProperty(writer, "name", self.name);
+    TCDWriteProperty(writer, "objectType", self.objectType);
+    TCDWriteProperty(writer, "openid", self.openid);
+    [writer endObject];
+}
+
+@end
+
+@implementation TCAccount (TCDJSONCoding)
+
+- (void) writeJSONWithWriter:(TCDJSONWriter *)writer
+{
+    [writer beginObject];
+    TCDWriteProperty(writer, "accountName", self.accountName);
+    TCDWriteProperty(writer, "accountServiceHomePage", self.accountServiceHomePage);
+    [writer endObject];
+}
+
+- (void) readJSONValueForKey:(const char *)key reader:(TCDJSONReader *)reader
+{
+    if (TCDKeyIs(key, "accountName"))
+        self.accountName = [reader readString];
+    else if (TCDKeyIs(key, "accountServiceHomePage"))
+        self.accountServiceHomePage = [reader readString];
+    else
+        [super readJSONValueForKey:key reader:reader];
+}
+
+@end
+
+#pragma mark - Activities
+
+@implementation TCActivity (TCDJSONCoding)
+
++ (Class) classForJSONReader:(TCDJSONReader *)reader
+{
+    // As +[TCActivity objectFromDictionary:] does, a cmi.interaction definition makes the activity an interaction.
+    if (self != [TCInteraction class])
+    {
+        NSString *type = [reader peekStringForKey:"type" inObjectForKey:"definition"];
+        if ([type isEqualToString:@"cmi.interaction"])
+            return [TCInteraction class];
+    }
+    return [super classForJSONReader:reader];
+}
+
+- (void) writeJSONWithWriter:(TCDJSONWriter *)writer
+{
+    [writer beginObject];
+    TCDWriteProperty(writer, "definition", self.definition);
+    TCDWriteProperty(writer, "id", self.activityId);
+    TCDWriteProperty(writer, "objectType", self.objectType);
+    [writer endObject];
+}
+
+- (void) readJSONValueForKey:(const char *)key reader:(TCDJSONReader *)reader
+{
+    if (TCDKeyIs(key, "id"))
+    {
+        self.activityId = [reader readString];
+    }
+    else if (TCDKeyIs(key, "definition"))
+    {
+        // TCInteraction redeclares definition as a TCInteractionDefinition.
+        Class definitionClass = [self isKindOfClass:[TCInteraction class]] ? [TCInteractionDefinition class] : [TCActivityDefinition class];
+        self.definition = [definitionClass objectWithJSONReader:reader];
+    }
+    else
+    {
+        [super readJSONValueForKey:key reader:reader];
+    }
+}
+
+@end
+
+@implementation TCActivityDefinition (TCDJSONCoding)
+
+- (void) writeJSONWithWriter:(TCDJSONWriter *)writer
+{
+    [writer beginObject];
+    TCDWriteProperty(writer, "description", [self getDescription]);
+    TCDWriteProperty(writer, "extensions", self.extensions);
+    TCDWriteProperty(writer, "interactionType", self.interactionType);
+    TCDWriteProperty(writer, "name", self.name);
+    TCDWriteProperty(writer, "type", TCDActivityTypeName(self.type));
+    [writer endObject];
+}
+
+- (void) readJSONValueForKey:(const char *)key reader:(TCDJSONReader *)reader
+{
+    if (TCDKeyIs(key, "name"))
+    {
+        self.name = [TCLanguageMap objectWithJSONReader:reader];
+    }
+    else if (TCDKeyIs(key, "description"))
+    {
+        self.description = [TCLanguageMap objectWithJSONReader:reader];
+    }
+    else if (TCDKeyIs(key, "type"))
+    {
+        NSString *type = [reader readString];
+        if (type)
+            [self setActivityTypeWithString:type];
+    }
+    else if (TCDKeyIs(key, "interactionType"))
+    {
+        self.interactionType = [reader readString];
+    }
+    else if (TCDKeyIs(key, "extensions"))
+    {
+        self.extensions = TCDReadValueOfClass(reader, [NSMutableDictionary class]);
+    }
+    else
+    {
+        [super readJSONValueForKey:key reader:reader];
+    }
+}
+
+@end
+
+@implementation TCInteractionDefinition (TCDJSONCoding)
+
+- (void) writeJSONWithWriter:(TCDJSONWriter *)writer
+{
+    [writer beginObject];
+    TCDWriteProperty(writer, "choices", self.choices);
+    TCDWriteProperty(writer, "correctResponsesPattern", self.correctResponsesPattern);
+    TCDWriteProperty(writer, "description", [self getDescription]);
+    TCDWriteProperty(writer, "extensions", self.extensions);
+    TCDWriteProperty(writer, "interactionType", self.interactionType);
+    TCDWriteProperty(writer, "name", self.name);
+    TCDWriteProperty(writer, "scale", self.scale);
+    TCDWriteProperty(writer, "source", self.source);
+    TCDWriteProperty(writer, "steps", self.steps);
+    TCDWriteProperty(writer, "target", self.target);
+    TCDWriteProperty(writer, "type", TCDActivityTypeName(self.type));
+    [writer endObject];
+}
+
+@end
+
+@implementation TCLanguageMap (TCDJSONCoding)
+
++ (id) objectWithJSONReader:(TCDJSONReader *)reader
+{
+    NSDictionary *map = TCDReadValueOfClass(reader, [NSDictionary class]);
+    return map ? [[TCLanguageMap alloc] initWithDictionary:map] : nil;
+}
+
+- (void) writeJSONWithWriter:(TCDJSONWriter *)writer
+{
+    [writer writeJSONObject:self.map];
+}
+
+@end
+
+#pragma mark - Results and context
+
+@implementation TCResult (TCDJSONCoding)
+
+- (void) writeJSONWithWriter:(TCDJSONWriter *)writer
+{
+    [writer beginObject];
+    if (self.completion == TCResultCompletionStatusCompleted)
+    {
+        [writer writeKey:"completion"];
+        [writer writeBool:YES];
+    }
+    [writer writeKey:"duration"];
+    [writer writeString:[self ISO8601durationWithTimeInterval:self.duration]];
+    TCDWriteProperty(writer, "extensions", self.extensions);
+    TCDWriteProperty(writer, "response", self.response);
+    TCDWriteProperty(writer, "score", self.score);
+    if (self.success == TCResultSuccessStatusFailed || self.success == TCResultSuccessStatusSucceeded)
+    {
+        [writer writeKey:"success"];
+        [writer writeBool:self.success == TCResultSuccessStatusSucceeded];
+    }
+    [writer endObject];
+}
+
+- (void) readJSONValueForKey:(const char *)key reader:(TCDJSONReader *)reader
+{
+    if (TCDKeyIs(key, "score"))
+    {
+        self.score = [TCScore objectWithJSONReader:reader];
+    }
+    else if (TCDKeyIs(key, "success"))
+    {
+        self.success = [reader readBool] ? TCResultSuccessStatusSucceeded : TCResultSuccessStatusFailed;
+    }
+    else if (TCDKeyIs(key, "completion"))
+    {
+        self.completion = [reader readBool] ? TCResultCompletionStatusCompleted : TCResultCompletionStatusNotSpecified;
+    }
+    else if (TCDKeyIs(key, "response"))
+    {
+        self.response = [reader readString];
+    }
+    else if (TCDKeyIs(key, "duration"))
+    {
+        NSString *duration = [reader readString];
+        if (duration)
+            self.duration = [self timeIntervalWithISO8601duration:duration];
+    }
+    else if (TCDKeyIs(key, "extensions"))
+    {
+        self.extensions = TCDReadValueOfClass(reader, [NSDictionary class]);
+    }
+    else
+    {
+        [super readJSONValueForKey:key reader:reader];
+    }
+}
+
+@end
+
+@implementation TCScore (TCDJSONCoding)
+
+- (void) writeJSONWithWriter:(TCDJSONWriter *)writer
+{
+    [writer beginObject];
+    TCDWriteProperty(writer, "max", self.max);
+    TCDWriteProperty(writer, "min", self.min);
+    TCDWriteProperty(writer, "raw", self.raw);
+    TCDWriteProperty(writer, "scaled", self.scaled);
+    [writer endObject];
+}
+
+- (void) readJSONValueForKey:(const char *)key reader:(TCDJSONReader *)reader
+{
+    if (TCDKeyIs(key, "scaled"))
+        self.scaled = [reader readNumber];
+    else if (TCDKeyIs(key, "raw"))
+        self.raw = [reader readNumber];
+    else if (TCDKeyIs(key, "min"))
+        self.min = [reader readNumber];
+    else if (TCDKeyIs(key, "max"))
+        self.max = [reader readNumber];
+    else
+        [super readJSONValueForKey:key reader:reader];
+}
+
+@end
+
+@implementation TCContext (TCDJSONCoding)
+
+- (void) writeJSONWithWriter:(TCDJSONWriter *)writer
+{
+    [writer beginObject];
+    TCDWriteProperty(writer, "contextActivities", self.contextActivities);
+    TCDWriteProperty(writer, "extensions", self.extensions);
+    TCDWriteProperty(writer, "instructor", self.instructor);
+    TCDWriteProperty(writer, "language", self.language);
+    TCDWriteProperty(writer, "platform", self.platform);
+    TCDWriteProperty(writer, "registration", self.registration);
+    TCDWriteProperty(writer, "revision", self.revision);
+    TCDWriteProperty(writer, "statement", self.statement);
+    TCDWriteProperty(writer, "team", self.team);
+    [writer endObject];
+}
+
+- (void) readJSONValueForKey:(const char *)key reader:(TCDJSONReader *)reader
+{
+    if (TCDKeyIs(key, "registration"))
+        self.registration = [reader readString];
+    else if (TCDKeyIs(key, "instructor"))
+        self.instructor = [TCAgent objectWithJSONReader:reader];
+    else if (TCDKeyIs(key, "team"))
+        self.team = [TCAgent objectWithJSONReader:reader];
+    else if (TCDKeyIs(key, "contextActivities"))
+        self.contextActivities = [TCContextActivities objectWithJSONReader:reader];
+    else if (TCDKeyIs(key, "platform"))
+        self.platform = [reader readString];
+    else if (TCDKeyIs(key, "language"))
+        self.language = [reader readString];
+    else if (TCDKeyIs(key, "statement"))
+        self.statement = [TCStatement objectWithJSONReader:reader];
+    else if (TCDKeyIs(key, "extensions"))
+        self.extensions = TCDReadValueOfClass(reader, [NSMutableDictionary class]);
+    else
+        [super readJSONValueForKey:key reader:reader];
+}
+
+@end
+
+@implementation TCContextActivities (TCDJSONCoding)
+
+- (void) writeJSONWithWriter:(TCDJSONWriter *)writer
+{
+    [writer beginObject];
+    TCDWriteProperty(writer, "grouping", self.grouping);
+    TCDWriteProperty(writer, "other", self.other);
+    TCDWriteProperty(writer, "parent", self.parent);
+    [writer endObject];
+}
+
+- (void) readJSONValueForKey:(const char *)key reader:(TCDJSONReader *)reader
+{
+    if (TCDKeyIs(key, "parent"))
+        self.parent = [TCActivity objectWithJSONReader:reader];
+    else if (TCDKeyIs(key, "grouping"))
+        self.grouping = [TCActivity objectWithJSONReader:reader];
+    else if (TCDKeyIs(key, "other"))
+        self.other = [TCActivity objectWithJSONReader:reader];
+    else
+        [super readJSONValueForKey:key reader:reader];
+}
+
+@end
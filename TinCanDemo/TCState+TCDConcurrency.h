@@ -0,0 +1,21 @@
+//
+//  TCState+TCDConcurrency.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/5/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <TinCan/TCState.h>
+
+/**
+ Concurrency bookkeeping that TCState implements but doesn't publish in its header.
+ */
+@interface TCState (TCDConcurrency)
+
+/**
+ The ETag of the version of the document this state was read from (or last saved as).
+ */
+@property (nonatomic, strong) NSString *concurencyDigest;
+
+@end
@@ -0,0 +1,42 @@
+//
+//  TCStatement+TCDJSONEncoding.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/26/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <TinCan/TCStatement.h>
+
+/**
+ The JSON encoding of a statement, written with TCDJSONWriter and cached on the statement.
+
+ The statement is written straight from its properties (see TCObject+TCDJSONCoding) once; after that,
+ persisting it and measuring it reuse the same bytes.
+ */
+@interface TCStatement (TCDJSONEncoding)
+
+/**
+ The statement encoded as JSON, or nil if something in it can't be written as JSON (the reason is logged).
+ */
+@property (nonatomic, readonly) NSData *encodedJSONData;
+
+/**
+ YES if encodedJSONData has already been worked out.
+ */
+@property (nonatomic, readonly) BOOL hasEncodedJSONData;
+
+/**
+ Discards the cached encoding (and the cached size estimate). Call this after changing a statement that has already been encoded.
+ */
+- (void) invalidateEncodedJSONData;
+
+/**
+ Reads a statement from its JSON without building a dictionary first.
+
+ @param error   Set if the JSON is malformed or isn't an object.
+ @return        The statement, or nil on error.
+ */
++ (TCStatement *) statementWithJSONBytes:(const uint8_t *)bytes length:(NSUInteger)length error:(NSError **)error;
+
+@end
@@ -0,0 +1,54 @@
+//
+//  TCStatement+TCDJSONEncoding.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/26/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCStatement+TCDJSONEncoding.h"
+#import "TCStatement+TCDSizeEstimate.h"
+#import "TCObject+TCDJSONCoding.h"
+#import "TCDJSONWriter.h"
+#import <objc/runtime.h>
+
+static char kTCDEncodedJSONDataKey;
+
+@implementation TCStatement (TCDJSONEncoding)
+
+- (NSData *) encodedJSONData
+{
+    NSData *encoded = objc_getAssociatedObject(self, &kTCDEncodedJSONDataKey);
+    if (!encoded)
+    {
+        NSMutableData *data = [NSMutableData dataWithCapacity:1024];
+        TCDJSONWriter *writer = [[TCDJSONWriter alloc] initWithData:data];
+        [self writeJSONWithWriter:writer];
+        if (writer.error)
+        {
+            NSLog(@"Unable to encode statement %@: %@", self.sid, writer.error);
+            return nil;
+        }
+        encoded = data;
+        objc_setAssociatedObject(self, &kTCDEncodedJSONDataKey, encoded, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    }
+    return encoded;
+}
+
+- (BOOL) hasEncodedJSONData
+{
+    return objc_getAssociatedObject(self, &kTCDEncodedJSONDataKey) != nil;
+}
+
+- (void) invalidateEncodedJSONData
+{
+    objc_setAssociatedObject(self, &kTCDEncodedJSONDataKey, nil, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    [self invalidateEstimatedJSONLength];
+}
+
++ (TCStatement *) statementWithJSONBytes:(const uint8_t *)bytes length:(NSUInteger)length error:(NSError **)error
+{
+    return [self objectWithJSONBytes:bytes length:length error:error];
+}
+
+@end
@@ -0,0 +1,57 @@
+//
+//  TCStatement+TCDLaneAttributes.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/12/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <TinCan/TCStatement.h>
+
+/**
+ What TCDStatementLane sorts a statement by, and when the statement was first queued.
+
+ These are stored next to the statement's JSON in the statement queue log (see laneAttributesData), so a
+ TCDLazyStatement restored from the log answers them without inflating, and a restored statement keeps its age.
+ */
+@interface TCStatement (TCDLaneAttributes)
+
+/**
+ The statement's verb, lowercased (nil if it has none).
+ */
+@property (nonatomic, readonly) NSString *laneVerb;
+
+/**
+ The TCActivityType of the statement's activity, or NSNotFound if its object isn't an activity with a definition.
+ */
+@property (nonatomic, readonly) NSUInteger laneActivityType;
+
+/**
+ When the statement was first added to a statement queue (nil if it hasn't been).
+ */
+@property (nonatomic, strong) NSDate *queuedDate;
+
+/**
+ laneVerb, laneActivityType, and queuedDate packed for storing with the statement.
+ */
+- (NSData *) laneAttributesData;
+
+/**
+ Packs lane attributes the way laneAttributesData does.
+ */
++ (NSData *) laneAttributesDataWithVerb:(NSString *)verb activityType:(NSUInteger)activityType queuedDate:(NSDate *)queuedDate;
+
+/**
+ Unpacks data written by laneAttributesData.
+
+ @param bytes           The packed attributes.
+ @param length          The length of the packed attributes.
+ @param verb            Returns the lane verb (nil if there is none).
+ @param activityType    Returns the lane activity type.
+ @param queuedDate      Returns the queued date (nil if there is none).
+ @return                NO if the data isn't packed lane attributes.
+ */
++ (BOOL) getLaneVerb:(NSString **)verb activityType:(NSUInteger *)activityType queuedDate:(NSDate **)queuedDate
+           fromBytes:(const void *)bytes length:(NSUInteger)length;
+
+@end
@@ -0,0 +1,102 @@
+//
+//  TCStatement+TCDLaneAttributes.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/12/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCStatement+TCDLaneAttributes.h"
+#import <objc/runtime.h>
+
+static char kTCDQueuedDateKey;
+
+// version(1), queued time since the reference date (8, little-endian double bits; NAN if not queued),
+// activity type (4, little-endian; 0xFFFFFFFF if none), then the UTF-8 verb.
+static const uint8_t kTCDLaneAttributesVersion = 1;
+static const NSUInteger kTCDLaneAttributesHeaderLength = 13;
+static const uint32_t kTCDLaneAttributesNoActivityType = 0xFFFFFFFF;
+
+@implementation TCStatement (TCDLaneAttributes)
+
+- (NSString *) laneVerb
+{
+    return self.verb.length > 0 ? [self.verb lowercaseString] : nil;
+}
+
+- (NSUInteger) laneActivityType
+{
+    if (![self.object isKindOfClass:[TCActivity class]])
+        return NSNotFound;
+    TCActivityDefinition *definition = [(TCActivity *)self.object definition];
+    return definition ? (NSUInteger)definition.type : NSNotFound;
+}
+
+- (NSDate *) queuedDate
+{
+    return objc_getAssociatedObject(self, &kTCDQueuedDateKey);
+}
+
+- (void) setQueuedDate:(NSDate *)queuedDate
+{
+    objc_setAssociatedObject(self, &kTCDQueuedDateKey, queuedDate, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+}
+
+- (NSData *) laneAttributesData
+{
+    return [[self class] laneAttributesDataWithVerb:self.laneVerb activityType:self.laneActivityType queuedDate:self.queuedDate];
+}
+
++ (NSData *) laneAttributesDataWithVerb:(NSString *)verb activityType:(NSUInteger)activityType queuedDate:(NSDate *)queuedDate
+{
+    NSData *verbData = [verb dataUsingEncoding:NSUTF8StringEncoding];
+    NSMutableData *data = [NSMutableData dataWithLength:kTCDLaneAttributesHeaderLength];
+    uint8_t *bytes = data.mutableBytes;
+    bytes[0] = kTCDLaneAttributesVersion;
+
+    double queuedTime = queuedDate ? [queuedDate timeIntervalSinceReferenceDate] : NAN;
+    uint64_t timeBits;
+    memcpy(&timeBits, &queuedTime, sizeof(timeBits));
+    timeBits = CFSwapInt64HostToLittle(timeBits);
+    memcpy(bytes + 1, &timeBits, sizeof(timeBits));
+
+    uint32_t typeBits = CFSwapInt32HostToLittle(activityType == NSNotFound ? kTCDLaneAttributesNoActivityType : (uint32_t)activityType);
+    memcpy(bytes + 9, &typeBits, sizeof(typeBits));
+
+    if (verbData)
+        [data appendData:verbData];
+    return data;
+}
+
++ (BOOL) getLaneVerb:(NSString **)verb activityType:(NSUInteger *)activityType queuedDate:(NSDate **)queuedDate
+           fromBytes:(const void *)bytes length:(NSUInteger)length
+{
+    const uint8_t *attributes = bytes;
+    if (length < kTCDLaneAttributesHeaderLength || attributes[0] != kTCDLaneAttributesVersion)
+        return NO;
+
+    if (queuedDate)
+    {
+        uint64_t timeBits;
+        memcpy(&timeBits, attributes + 1, sizeof(timeBits));
+        timeBits = CFSwapInt64LittleToHost(timeBits);
+        double queuedTime;
+        memcpy(&queuedTime, &timeBits, sizeof(queuedTime));
+        *queuedDate = isnan(queuedTime) ? nil : [NSDate dateWithTimeIntervalSinceReferenceDate:queuedTime];
+    }
+    if (activityType)
+    {
+        uint32_t typeBits;
+        memcpy(&typeBits, attributes + 9, sizeof(typeBits));
+        typeBits = CFSwapInt32LittleToHost(typeBits);
+        *activityType = (typeBits == kTCDLaneAttributesNoActivityType) ? NSNotFound : typeBits;
+    }
+    if (verb)
+    {
+        NSUInteger verbLength = length - kTCDLaneAttributesHeaderLength;
+        *verb = verbLength > 0 ? [[NSString alloc] initWithBytes:attributes + kTCDLaneAttributesHeaderLength length:verbLength encoding:NSUTF8StringEncoding] : nil;
+    }
+    return YES;
+}
+
+@end
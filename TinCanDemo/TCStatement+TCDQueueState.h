@@ -0,0 +1,27 @@
+//
+//  TCStatement+TCDQueueState.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/19/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <TinCan/TCStatement.h>
+
+/**
+ Queue bookkeeping that TCStatement implements but doesn't publish in its header.
+ TCAPI sets these while a statement is in flight so TCStatementQueue can tell which statements still need to be sent.
+ */
+@interface TCStatement (TCDQueueState)
+
+/**
+ YES once the statement has been handed to the LRS in a request.
+ */
+@property (nonatomic, readwrite) BOOL sentToLRS;
+
+/**
+ YES once the LRS has acknowledged storing the statement.
+ */
+@property (nonatomic, readwrite) BOOL persistedOnLRS;
+
+@end
@@ -0,0 +1,28 @@
+//
+//  TCStatement+TCDSizeEstimate.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/22/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <TinCan/TCStatement.h>
+
+/**
+ A cached estimate of how many bytes a statement takes up in a request body.
+ */
+@interface TCStatement (TCDSizeEstimate)
+
+/**
+ The approximate length in bytes of the statement's JSON.
+ Worked out from the statement's dictionary without encoding it, then cached on the statement,
+ so packing the same statement into batches again doesn't cost anything.
+ */
+@property (nonatomic, readonly) NSUInteger estimatedJSONLength;
+
+/**
+ Discards the cached estimate. Call this after changing a statement that has already been measured.
+ */
+- (void) invalidateEstimatedJSONLength;
+
+@end
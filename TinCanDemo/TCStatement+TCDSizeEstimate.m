@@ -0,0 +1,66 @@
+//
+//  TCStatement+TCDSizeEstimate.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 2/22/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCStatement+TCDSizeEstimate.h"
+#import "TCStatement+TCDJSONEncoding.h"
+#import <objc/runtime.h>
+
+static char kTCDEstimatedJSONLengthKey;
+
+/**
+ Length of the JSON NSJSONSerialization would write for an object (ignoring escapes).
+ */
+static NSUInteger TCDEstimatedJSONLength(id object)
+{
+    if ([object isKindOfClass:[NSString class]])
+        return [object lengthOfBytesUsingEncoding:NSUTF8StringEncoding] + 2;
+
+    if ([object isKindOfClass:[NSNumber class]])
+        return [[object stringValue] length];
+
+    if ([object isKindOfClass:[NSDictionary class]])
+    {
+        // {"key":value,"key":value}
+        NSUInteger length = 2;
+        for (id key in object)
+            length += TCDEstimatedJSONLength(key) + 1 + TCDEstimatedJSONLength([object objectForKey:key]) + 1;
+        return [object count] > 0 ? length - 1 : length;
+    }
+
+    if ([object isKindOfClass:[NSArray class]])
+    {
+        NSUInteger length = 2;
+        for (id element in object)
+            length += TCDEstimatedJSONLength(element) + 1;
+        return [object count] > 0 ? length - 1 : length;
+    }
+
+    // null
+    return 4;
+}
+
+@implementation TCStatement (TCDSizeEstimate)
+
+- (NSUInteger) estimatedJSONLength
+{
+    NSNumber *cached = objc_getAssociatedObject(self, &kTCDEstimatedJSONLengthKey);
+    if (cached)
+        return [cached unsignedIntegerValue];
+
+    // Once the statement has been encoded (e.g. when it was persisted) its length is known exactly.
+    NSUInteger length = self.hasEncodedJSONData ? self.encodedJSONData.length : TCDEstimatedJSONLength([self dictionary]);
+    objc_setAssociatedObject(self, &kTCDEstimatedJSONLengthKey, @(length), OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+    return length;
+}
+
+- (void) invalidateEstimatedJSONLength
+{
+    objc_setAssociatedObject(self, &kTCDEstimatedJSONLengthKey, nil, OBJC_ASSOCIATION_RETAIN_NONATOMIC);
+}
+
+@end
@@ -0,0 +1,18 @@
+//
+//  TCStatementQuery+TCDCopying.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/1/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <TinCan/TCStatementQuery.h>
+
+@interface TCStatementQuery (TCDCopying)
+
+/**
+ A new query with the same parameters (the actor, object, and instructor are shared, not copied).
+ */
+- (TCStatementQuery *) queryCopy;
+
+@end
@@ -0,0 +1,31 @@
+//
+//  TCStatementQuery+TCDCopying.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/1/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCStatementQuery+TCDCopying.h"
+
+@implementation TCStatementQuery (TCDCopying)
+
+- (TCStatementQuery *) queryCopy
+{
+    TCStatementQuery *query = [[TCStatementQuery alloc] init];
+    query.verb = self.verb;
+    query.object = self.object;
+    query.registration = self.registration;
+    query.context = self.context;
+    query.actor = self.actor;
+    query.since = self.since;
+    query.until = self.until;
+    query.limit = self.limit;
+    query.authoritative = self.authoritative;
+    query.sparse = self.sparse;
+    query.instructor = self.instructor;
+    query.statementId = self.statementId;
+    return query;
+}
+
+@end
@@ -0,0 +1,184 @@
+//
+//  TCDIndexedStatementStoreTests.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/12/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <SenTestingKit/SenTestingKit.h>
+#import <TinCan/TinCan.h>
+#import "TCDIndexedStatementStore.h"
+#import "TCDStatementAttributes.h"
+#import "TCDStatementQueryMatcher.h"
+#import "TCDTestFixtures.h"
+
+static NSString* const kTCDCourseId = @"http://meetmaestro.com/activities/course";
+
+@interface TCDIndexedStatementStoreTests : SenTestCase
+{
+    NSString *directory;
+}
+@end
+
+@implementation TCDIndexedStatementStoreTests
+
+- (void) setUp
+{
+    [super setUp];
+    directory = [TCDTestFixtures temporaryDirectory];
+}
+
+- (void) tearDown
+{
+    [[NSFileManager defaultManager] removeItemAtPath:directory error:NULL];
+    [super tearDown];
+}
+
+/**
+ Statement index, with the course as its parent activity when inCourse is YES.
+ */
+- (TCStatement *) statementWithIndex:(NSUInteger)index inCourse:(BOOL)inCourse
+{
+    TCStatement *statement = [TCDTestFixtures statementWithIndex:index];
+    if (inCourse)
+    {
+        statement.context = [TCContext context];
+        statement.context.contextActivities = [[TCContextActivities alloc] init];
+        statement.context.contextActivities.parent = [TCActivity activityWithId:kTCDCourseId];
+    }
+    return statement;
+}
+
+- (TCStatementQuery *) courseQueryWithContext:(BOOL)context
+{
+    TCStatementQuery *query = [[TCStatementQuery alloc] init];
+    query.object = [TCActivity activityWithId:kTCDCourseId];
+    query.context = context;
+    return query;
+}
+
+- (void) testContextActivitiesMatchTheObjectOnlyWithContextSet
+{
+    TCStatement *inCourse = [self statementWithIndex:1 inCourse:YES];
+    TCStatement *outside = [self statementWithIndex:2 inCourse:NO];
+    TCStatement *aboutCourse = [TCDTestFixtures statementWithIndex:3];
+    aboutCourse.object = [TCActivity activityWithId:kTCDCourseId];
+
+    STAssertEqualObjects([TCDStatementAttributes attributesOfStatement:inCourse].contextActivityIds, @[kTCDCourseId], nil);
+
+    TCDStatementQueryMatcher *withContext = [[TCDStatementQueryMatcher alloc] initWithQuery:[self courseQueryWithContext:YES]];
+    TCDStatementQueryMatcher *withoutContext = [[TCDStatementQueryMatcher alloc] initWithQuery:[self courseQueryWithContext:NO]];
+    STAssertTrue([withContext matchesStatement:inCourse], nil);
+    STAssertTrue([withContext matchesStatement:aboutCourse], nil);
+    STAssertFalse([withContext matchesStatement:outside], nil);
+    STAssertFalse([withoutContext matchesStatement:inCourse], nil);
+    STAssertTrue([withoutContext matchesStatement:aboutCourse], nil);
+
+    TCDIndexedStatementStore *store = [[TCDIndexedStatementStore alloc] initWithDirectory:directory];
+    NSError *error = nil;
+    STAssertTrue([store upsertStatements:@[inCourse, outside, aboutCourse] insertedCount:NULL error:&error], @"%@", error);
+
+    // Newest first; the indexes rebuilt from the stored attributes must give the same answers.
+    NSArray *expected = @[aboutCourse.sid, inCourse.sid];
+    STAssertEqualObjects([store statementIdsMatchingQuery:[self courseQueryWithContext:YES]], expected, nil);
+    STAssertEqualObjects([store statementIdsMatchingQuery:[self courseQueryWithContext:NO]], @[aboutCourse.sid], nil);
+    store = nil;
+
+    store = [[TCDIndexedStatementStore alloc] initWithDirectory:directory];
+    STAssertEqualObjects([store statementIdsMatchingQuery:[self courseQueryWithContext:YES]], expected, nil);
+    STAssertEqualObjects([store statementIdsMatchingQuery:[self courseQueryWithContext:NO]], @[aboutCourse.sid], nil);
+}
+
+- (void) testEncodedAttributesRoundTrip
+{
+    TCStatement *statement = [self statementWithIndex:7 inCourse:YES];
+    statement.context.contextActivities.grouping = [TCActivity activityWithId:@"http://meetmaestro.com/activities/program"];
+    statement.context.registration = [TCStatement generateUUID];
+
+    TCDStatementAttributes *attributes = [TCDStatementAttributes attributesOfStatement:statement];
+    NSData *encoded = [attributes encodedData];
+    TCDStatementAttributes *decoded = [[TCDStatementAttributes alloc] initWithEncodedBytes:encoded.bytes length:encoded.length sid:statement.sid];
+    STAssertNotNil(decoded, nil);
+    for (NSString *key in @[@"sid", @"verb", @"objectId", @"actorKey", @"registration", @"instructorKey", @"contextActivityIds"])
+        STAssertEqualObjects([decoded valueForKey:key], [attributes valueForKey:key], key);
+    STAssertEquals(decoded.stored, attributes.stored, nil);
+}
+
+/**
+ Index build, point, range and multi-attribute queries over a million statements. Each query is timed over
+ 100 runs and logged; the point and range queries must average under a millisecond.
+ */
+- (void) testMillionStatementBenchmark
+{
+    const NSUInteger count = 1000000, batchSize = 10000, runs = 100;
+    NSArray *actors = @[[TCAgent agentWithName:@"William" andMbox:@"mailto:william@gmail.com"],
+                        [TCAgent agentWithName:@"Dan" andMbox:@"mailto:dan@meetmaestro.com"]];
+
+    TCDIndexedStatementStore *store = [[TCDIndexedStatementStore alloc] initWithDirectory:directory];
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (NSUInteger first = 0; first < count; first += batchSize)
+    {
+        @autoreleasepool
+        {
+            NSMutableArray *batch = [NSMutableArray arrayWithCapacity:batchSize];
+            for (NSUInteger i = first; i < first + batchSize; i++)
+            {
+                TCStatement *statement = [self statementWithIndex:i inCourse:(i % 10 == 0)];
+                statement.actor = [actors objectAtIndex:i % actors.count];
+                [batch addObject:statement];
+            }
+            NSError *error = nil;
+            STAssertTrue([store upsertStatements:batch insertedCount:NULL error:&error], @"%@", error);
+        }
+    }
+    NSLog(@"Indexed store: %lu statements written and indexed in %.1fs", (unsigned long)count, CFAbsoluteTimeGetCurrent() - start);
+    store = nil;
+
+    store = [[TCDIndexedStatementStore alloc] initWithDirectory:directory];
+    STAssertEquals(store.count, count, nil);
+    NSLog(@"Indexed store: indexes rebuilt in %.2fs", store.indexBuildTime);
+
+    NSDate *base = [NSDate dateWithTimeIntervalSince1970:1362000000];
+    NSString *verb = [TCDTestFixtures statementWithIndex:0].verb;
+    NSMutableDictionary *queries = [NSMutableDictionary dictionary];
+
+    TCStatementQuery *point = [[TCStatementQuery alloc] init];
+    point.object = [TCActivity activityWithId:@"http://meetmaestro.com/activities/777777"];
+    [queries setObject:point forKey:@"point"];
+
+    TCStatementQuery *range = [TCStatementQuery statementQueryWithLimit:100];
+    range.since = [base dateByAddingTimeInterval:500000];
+    range.until = [base dateByAddingTimeInterval:500100];
+    [queries setObject:range forKey:@"range"];
+
+    // Verb and actor each select half a million statements; the time bounds select 1000.
+    TCStatementQuery *multi = [TCStatementQuery statementQueryWithLimit:100];
+    multi.verb = verb;
+    multi.actor = [actors objectAtIndex:1];
+    multi.since = [base dateByAddingTimeInterval:900000];
+    multi.until = [base dateByAddingTimeInterval:901000];
+    [queries setObject:multi forKey:@"multi-attribute"];
+
+    NSDictionary *expectedCounts = @{ @"point" : @1, @"range" : @100, @"multi-attribute" : @100 };
+    for (NSString *name in queries)
+    {
+        TCStatementQuery *query = [queries objectForKey:name];
+        NSUInteger matched = 0;
+        start = CFAbsoluteTimeGetCurrent();
+        for (NSUInteger run = 0; run < runs; run++)
+        {
+            @autoreleasepool
+            {
+                matched = [store statementIdsMatchingQuery:query].count;
+            }
+        }
+        NSTimeInterval average = (CFAbsoluteTimeGetCurrent() - start) / runs;
+        NSLog(@"Indexed store: %@ query, %lu statements, %.3f ms", name, (unsigned long)matched, average * 1000);
+        STAssertEquals(matched, [[expectedCounts objectForKey:name] unsignedIntegerValue], name);
+        if (![name isEqualToString:@"multi-attribute"])
+            STAssertTrue(average < 0.001, @"%@ query took %.3f ms", name, average * 1000);
+    }
+}
+
+@end
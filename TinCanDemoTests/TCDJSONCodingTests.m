@@ -0,0 +1,138 @@
+//
+//  TCDJSONCodingTests.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/12/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <SenTestingKit/SenTestingKit.h>
+#import <TinCan/TinCan.h>
+#import "TCStatement+TCDJSONEncoding.h"
+#import "TCDJSONWriter.h"
+#import "TCDTestFixtures.h"
+
+@interface TCDJSONCodingTests : SenTestCase
+@end
+
+@implementation TCDJSONCodingTests
+
+/**
+ A statement that sets every part the per-type codecs write: account actor, scored result, full context and an
+ activity definition of the given type.
+ */
+- (TCStatement *) richStatementWithIndex:(NSUInteger)index type:(TCActivityType)type
+{
+    TCStatement *statement = [TCDTestFixtures statementWithIndex:index];
+    [statement.actor addAccountWithID:@"william" forService:@"http://meetmaestro.com"];
+
+    TCActivityDefinition *definition = [TCActivityDefinition activityDefinitionWithName:@"Lesson \"1\" – café"
+                                                                            description:@"Line one\nline two\t/ tab"
+                                                                                   type:type
+                                                                             extensions:[NSDictionary dictionaryWithObject:[NSNumber numberWithInt:3] forKey:@"http://meetmaestro.com/extensions/attempts"]];
+    statement.object = [TCActivity activityWithID:[NSString stringWithFormat:@"http://meetmaestro.com/activities/%lu", (unsigned long)index]
+                                    andDefinition:definition];
+
+    TCScore *score = [[TCScore alloc] initWithRawScore:[NSNumber numberWithInt:87] minimumScore:[NSNumber numberWithInt:0]
+                                          maximumScore:[NSNumber numberWithInt:100] scaledScore:[NSNumber numberWithDouble:0.87]];
+    statement.result = [TCResult resultWithScore:score completion:TCResultCompletionStatusCompleted success:TCResultSuccessStatusSucceeded];
+    statement.result.response = @"b";
+    statement.result.duration = 95.5;
+
+    TCContext *context = [TCContext context];
+    context.registration = [TCStatement generateUUID];
+    context.instructor = [TCAgent agentWithName:@"Dan" andMbox:@"mailto:dan@meetmaestro.com"];
+    context.contextActivities = [[TCContextActivities alloc] init];
+    context.contextActivities.parent = [TCActivity activityWithId:@"http://meetmaestro.com/activities/course"];
+    context.contextActivities.grouping = [TCActivity activityWithId:@"http://meetmaestro.com/activities/program"];
+    context.contextActivities.other = [TCActivity activityWithId:@"http://meetmaestro.com/activities/other"];
+    context.platform = @"iOS";
+    context.language = @"en-US";
+    context.extensions = [NSMutableDictionary dictionaryWithObject:@"value" forKey:@"http://meetmaestro.com/extensions/key"];
+    statement.context = context;
+    return statement;
+}
+
+/**
+ One rich statement per activity type, so every entry of the type name table (including "interation") is covered.
+ */
+- (NSArray *) richStatements
+{
+    NSMutableArray *statements = [NSMutableArray array];
+    for (TCActivityType type = TCActivityTypeNotSpecified; type <= TCActivityTypeLink; type++)
+        [statements addObject:[self richStatementWithIndex:type type:type]];
+    return statements;
+}
+
+- (void) testEncodedBytesEqualWriterOutputOfDictionary
+{
+    for (TCStatement *statement in [self richStatements])
+    {
+        NSError *error = nil;
+        NSData *expected = [TCDJSONWriter dataWithJSONObject:[statement dictionary] error:&error];
+        STAssertNotNil(expected, @"%@", error);
+        STAssertEqualObjects([statement encodedJSONData], expected, @"%@", [[NSString alloc] initWithData:[statement encodedJSONData] encoding:NSUTF8StringEncoding]);
+    }
+}
+
+- (void) testEncodedJSONParsesToSerializedDictionary
+{
+    for (TCStatement *statement in [self richStatements])
+    {
+        NSData *serialized = [NSJSONSerialization dataWithJSONObject:[statement dictionary] options:0 error:NULL];
+        id expected = [NSJSONSerialization JSONObjectWithData:serialized options:0 error:NULL];
+        id encoded = [NSJSONSerialization JSONObjectWithData:[statement encodedJSONData] options:0 error:NULL];
+        STAssertNotNil(encoded, nil);
+        STAssertEqualObjects(encoded, expected, nil);
+    }
+}
+
+- (void) testDecodingRoundTripsDictionary
+{
+    for (TCStatement *statement in [self richStatements])
+    {
+        NSData *data = [statement encodedJSONData];
+        NSError *error = nil;
+        TCStatement *decoded = [TCStatement statementWithJSONBytes:data.bytes length:data.length error:&error];
+        STAssertNotNil(decoded, @"%@", error);
+        STAssertEqualObjects([decoded dictionary], [statement dictionary], nil);
+    }
+}
+
+/**
+ Logs the throughput of the codecs against the -dictionary + NSJSONSerialization path they replace, and
+ fails if they are not at least as fast.
+ */
+- (void) testEncodingIsFasterThanSerializingDictionary
+{
+    NSMutableArray *statements = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 2000; i++)
+        [statements addObject:[self richStatementWithIndex:i type:TCActivityTypeInteraction]];
+
+    CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+    for (TCStatement *statement in statements)
+    {
+        @autoreleasepool
+        {
+            [NSJSONSerialization dataWithJSONObject:[statement dictionary] options:0 error:NULL];
+        }
+    }
+    CFAbsoluteTime serializing = CFAbsoluteTimeGetCurrent() - start;
+
+    start = CFAbsoluteTimeGetCurrent();
+    for (TCStatement *statement in statements)
+    {
+        @autoreleasepool
+        {
+            [statement invalidateEncodedJSONData];
+            [statement encodedJSONData];
+        }
+    }
+    CFAbsoluteTime encoding = CFAbsoluteTimeGetCurrent() - start;
+
+    NSLog(@"JSON encoding: -dictionary + NSJSONSerialization %.0f statements/s, codecs %.0f statements/s",
+          statements.count / serializing, statements.count / encoding);
+    STAssertTrue(encoding <= serializing, @"codecs %.3fs, dictionary %.3fs", encoding, serializing);
+}
+
+@end
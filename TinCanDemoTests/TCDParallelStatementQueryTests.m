@@ -0,0 +1,229 @@
+//
+//  TCDParallelStatementQueryTests.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/12/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <SenTestingKit/SenTestingKit.h>
+#import <TinCan/TinCan.h>
+#import "TCDParallelStatementQuery.h"
+#import "TCStatement+TCDJSONEncoding.h"
+#import "TCDTestFixtures.h"
+
+// Declared by the framework, but not in its public headers.
+@interface NSDate (InternetTimestamps)
++ (NSDate *) dateFromRFC3339Timestamp:(NSString *)timestamp;
+@end
+
+static NSString* const kTCDStubLRSHost = @"stub.lrs.test";
+static NSArray *stubStatements;
+static NSMutableArray *stubRequestURLs;
+static NSUInteger stubPageSize = 3;
+
+/**
+ Answers GET statements requests to kTCDStubLRSHost from stubStatements, newest stored first, stubPageSize at a time.
+ since and until are both inclusive, so a statement stored on a window boundary is returned by both windows,
+ and every page after the first starts with the last statement of the page before it.
+ */
+@interface TCDStubLRSProtocol : NSURLProtocol
+@end
+
+@implementation TCDStubLRSProtocol
+
++ (BOOL) canInitWithRequest:(NSURLRequest *)request
+{
+    return [request.URL.host isEqualToString:kTCDStubLRSHost];
+}
+
++ (NSURLRequest *) canonicalRequestForRequest:(NSURLRequest *)request
+{
+    return request;
+}
+
+- (NSDictionary *) parameters
+{
+    NSMutableDictionary *parameters = [NSMutableDictionary dictionary];
+    for (NSString *pair in [self.request.URL.query componentsSeparatedByString:@"&"])
+    {
+        NSRange equals = [pair rangeOfString:@"="];
+        if (equals.location == NSNotFound)
+            continue;
+        NSString *value = [[pair substringFromIndex:NSMaxRange(equals)] stringByReplacingPercentEscapesUsingEncoding:NSUTF8StringEncoding];
+        [parameters setObject:value forKey:[pair substringToIndex:equals.location]];
+    }
+    return parameters;
+}
+
+- (void) startLoading
+{
+    @synchronized (stubRequestURLs)
+    {
+        [stubRequestURLs addObject:self.request.URL];
+    }
+
+    NSDictionary *parameters = [self parameters];
+    NSDate *since = [parameters objectForKey:@"since"] ? [NSDate dateFromRFC3339Timestamp:[parameters objectForKey:@"since"]] : nil;
+    NSDate *until = [parameters objectForKey:@"until"] ? [NSDate dateFromRFC3339Timestamp:[parameters objectForKey:@"until"]] : nil;
+    NSUInteger page = [[parameters objectForKey:@"page"] integerValue];
+
+    NSMutableArray *matching = [NSMutableArray array];
+    for (TCStatement *statement in [stubStatements reverseObjectEnumerator])
+    {
+        if (since && [statement.stored compare:since] == NSOrderedAscending)
+            continue;
+        if (until && [statement.stored compare:until] == NSOrderedDescending)
+            continue;
+        [matching addObject:statement];
+    }
+
+    NSUInteger start = page * stubPageSize;
+    NSRange range = NSMakeRange(start > 0 ? start - 1 : 0, 0);
+    range.length = MIN(start + stubPageSize, matching.count) - MIN(range.location, matching.count);
+
+    NSMutableData *body = [NSMutableData dataWithData:[@"{\"statements\":[" dataUsingEncoding:NSUTF8StringEncoding]];
+    [[matching subarrayWithRange:range] enumerateObjectsUsingBlock:^(TCStatement *statement, NSUInteger index, BOOL *stop) {
+        if (index > 0)
+            [body appendBytes:"," length:1];
+        [body appendData:[statement encodedJSONData]];
+    }];
+    NSString *more = @"";
+    if (start + stubPageSize < matching.count)
+    {
+        NSMutableArray *pairs = [NSMutableArray arrayWithObject:[NSString stringWithFormat:@"page=%lu", (unsigned long)page + 1]];
+        for (NSString *pair in [self.request.URL.query componentsSeparatedByString:@"&"])
+        {
+            if (![pair hasPrefix:@"page="])
+                [pairs addObject:pair];
+        }
+        more = [NSString stringWithFormat:@"%@?%@", self.request.URL.path, [pairs componentsJoinedByString:@"&"]];
+    }
+    [body appendData:[[NSString stringWithFormat:@"],\"more\":\"%@\"}", more] dataUsingEncoding:NSUTF8StringEncoding]];
+
+    NSHTTPURLResponse *response = [[NSHTTPURLResponse alloc] initWithURL:self.request.URL statusCode:200 HTTPVersion:@"HTTP/1.1"
+                                                            headerFields:@{ @"Content-Type" : @"application/json" }];
+    [self.client URLProtocol:self didReceiveResponse:response cacheStoragePolicy:NSURLCacheStorageNotAllowed];
+    // In two pieces, so statements are split across chunks.
+    NSUInteger half = body.length / 2;
+    [self.client URLProtocol:self didLoadData:[body subdataWithRange:NSMakeRange(0, half)]];
+    [self.client URLProtocol:self didLoadData:[body subdataWithRange:NSMakeRange(half, body.length - half)]];
+    [self.client URLProtocolDidFinishLoading:self];
+}
+
+- (void) stopLoading
+{
+}
+
+@end
+
+@interface TCDParallelStatementQueryTests : SenTestCase
+{
+    TCAPI *api;
+    NSDate *since;
+}
+@end
+
+@implementation TCDParallelStatementQueryTests
+
+- (void) setUp
+{
+    [super setUp];
+    [NSURLProtocol registerClass:[TCDStubLRSProtocol class]];
+    stubRequestURLs = [NSMutableArray array];
+
+    api = [[TCAPI alloc] initWithEndpoint:[NSURL URLWithString:[NSString stringWithFormat:@"http://%@/TCAPI/", kTCDStubLRSHost]]];
+    api.authorizationProvider = [[TCBasicHTTPAuthentication alloc] initWithUsername:@"user" andPassword:@"password"];
+
+    // One statement every 15 seconds over 10 minutes, oldest first; 4 windows put three of them on a boundary.
+    since = [NSDate dateWithTimeIntervalSince1970:1362000000];
+    NSMutableArray *statements = [NSMutableArray array];
+    for (NSUInteger i = 0; i < 40; i++)
+    {
+        TCStatement *statement = [TCDTestFixtures statementWithIndex:i];
+        [statement setValue:[since dateByAddingTimeInterval:i * 15] forKey:@"stored"];
+        [statements addObject:statement];
+    }
+    stubStatements = statements;
+}
+
+- (void) tearDown
+{
+    [NSURLProtocol unregisterClass:[TCDStubLRSProtocol class]];
+    stubStatements = nil;
+    stubRequestURLs = nil;
+    [super tearDown];
+}
+
+- (TCStatementQuery *) queryWithLimit:(NSInteger)limit
+{
+    TCStatementQuery *query = [TCStatementQuery statementQueryWithLimit:limit];
+    query.since = since;
+    query.until = [since dateByAddingTimeInterval:600];
+    return query;
+}
+
+/**
+ Runs the query to completion on the main run loop and returns the statements it handed out.
+ */
+- (NSArray *) statementsOfParallelQuery:(TCDParallelStatementQuery *)parallelQuery
+{
+    NSMutableArray *statements = [NSMutableArray array];
+    __block BOOL completed = NO;
+    __block NSError *queryError = nil;
+    [parallelQuery enumerateStatementsUsingBlock:^(TCStatement *statement, BOOL *stop) {
+        [statements addObject:statement];
+    } completion:^(NSError *error) {
+        queryError = error;
+        completed = YES;
+    }];
+
+    NSDate *timeout = [NSDate dateWithTimeIntervalSinceNow:10];
+    while (!completed && [timeout timeIntervalSinceNow] > 0)
+        [[NSRunLoop currentRunLoop] runMode:NSDefaultRunLoopMode beforeDate:[NSDate dateWithTimeIntervalSinceNow:0.05]];
+    STAssertTrue(completed, @"the query didn't complete");
+    STAssertNil(queryError, @"%@", queryError);
+    return statements;
+}
+
+- (void) testWindowsReturnEveryStatementOnceNewestFirst
+{
+    TCDParallelStatementQuery *parallelQuery = [[TCDParallelStatementQuery alloc] initWithQuery:[self queryWithLimit:0] api:api];
+    NSArray *statements = [self statementsOfParallelQuery:parallelQuery];
+
+    NSArray *expected = [TCDTestFixtures idsOfStatements:[[stubStatements reverseObjectEnumerator] allObjects]];
+    STAssertEqualObjects([TCDTestFixtures idsOfStatements:statements], expected, nil);
+    STAssertEquals(parallelQuery.numberOfStatements, stubStatements.count, nil);
+    // Three on the boundaries, and one repeated at the start of every page after a window's first.
+    STAssertTrue(parallelQuery.numberOfDuplicates > 3, @"%lu duplicates", (unsigned long)parallelQuery.numberOfDuplicates);
+}
+
+- (void) testLimitCapsTheWholeQueryNotEachWindow
+{
+    TCDParallelStatementQuery *parallelQuery = [[TCDParallelStatementQuery alloc] initWithQuery:[self queryWithLimit:5] api:api];
+    NSArray *statements = [self statementsOfParallelQuery:parallelQuery];
+
+    NSArray *newest = [[[stubStatements reverseObjectEnumerator] allObjects] subarrayWithRange:NSMakeRange(0, 5)];
+    STAssertEqualObjects([TCDTestFixtures idsOfStatements:statements], [TCDTestFixtures idsOfStatements:newest], nil);
+    // TCStatementQuery always sends a limit; 0 leaves the page size to the LRS.
+    for (NSURL *URL in stubRequestURLs)
+    {
+        for (NSString *pair in [URL.query componentsSeparatedByString:@"&"])
+        {
+            if ([pair hasPrefix:@"limit="])
+                STAssertEqualObjects(pair, @"limit=0", @"%@", URL);
+        }
+    }
+}
+
+- (void) testWindowQueriesDropTheLimit
+{
+    NSArray *windows = [TCDParallelStatementQuery windowQueriesForQuery:[self queryWithLimit:25] count:4];
+    STAssertEquals(windows.count, (NSUInteger)4, nil);
+    for (TCStatementQuery *window in windows)
+        STAssertEquals(window.limit, (NSInteger)0, nil);
+    STAssertEqualObjects([[windows objectAtIndex:0] until], [since dateByAddingTimeInterval:600], nil);
+    STAssertEqualObjects([[windows lastObject] since], since, nil);
+}
+
+@end
@@ -0,0 +1,158 @@
+//
+//  TCDStatementLogTests.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/12/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <SenTestingKit/SenTestingKit.h>
+#import "TCDStatementLog.h"
+#import "TCDTestFixtures.h"
+
+@interface TCDStatementLogTests : SenTestCase
+{
+    NSString *directory;
+}
+@end
+
+@implementation TCDStatementLogTests
+
+- (void) setUp
+{
+    [super setUp];
+    directory = [TCDTestFixtures temporaryDirectory];
+}
+
+- (void) tearDown
+{
+    [[NSFileManager defaultManager] removeItemAtPath:directory error:NULL];
+    [super tearDown];
+}
+
+- (TCDStatementLog *) openLog
+{
+    TCDStatementLog *log = [[TCDStatementLog alloc] initWithDirectory:directory];
+    log.shouldProtectPersistentStore = NO;
+    NSError *error = nil;
+    STAssertTrue([log openWithError:&error], @"The log didn't open: %@", error);
+    return log;
+}
+
+- (NSArray *) keysWithCount:(NSUInteger)count
+{
+    NSMutableArray *keys = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count; i++)
+        [keys addObject:[NSString stringWithFormat:@"key-%lu", (unsigned long)i]];
+    return keys;
+}
+
+- (NSArray *) payloadsForKeys:(NSArray *)keys
+{
+    NSMutableArray *payloads = [NSMutableArray arrayWithCapacity:keys.count];
+    for (NSString *key in keys)
+        [payloads addObject:[[NSString stringWithFormat:@"{\"id\":\"%@\"}", key] dataUsingEncoding:NSUTF8StringEncoding]];
+    return payloads;
+}
+
+- (void) testRecordsSurviveReopening
+{
+    NSArray *keys = [self keysWithCount:100];
+    NSArray *payloads = [self payloadsForKeys:keys];
+    TCDStatementLog *log = [self openLog];
+    STAssertTrue([log appendPayloads:payloads forKeys:keys error:NULL], nil);
+
+    TCDStatementLog *reopened = [self openLog];
+    STAssertEqualObjects([reopened keys], keys, nil);
+    for (NSUInteger i = 0; i < keys.count; i++)
+        STAssertEqualObjects([reopened payloadForKey:[keys objectAtIndex:i]], [payloads objectAtIndex:i], nil);
+}
+
+- (void) testAcknowledgedKeysStayRemovedAfterReopening
+{
+    NSArray *keys = [self keysWithCount:100];
+    TCDStatementLog *log = [self openLog];
+    [log appendPayloads:[self payloadsForKeys:keys] forKeys:keys error:NULL];
+
+    NSMutableArray *acknowledged = [NSMutableArray array];
+    NSMutableArray *live = [NSMutableArray array];
+    [keys enumerateObjectsUsingBlock:^(NSString *key, NSUInteger index, BOOL *stop) {
+        [(index % 3 == 0 ? acknowledged : live) addObject:key];
+    }];
+    STAssertTrue([log acknowledgeKeys:acknowledged error:NULL], nil);
+    STAssertEqualObjects([log keys], live, nil);
+
+    TCDStatementLog *reopened = [self openLog];
+    STAssertEqualObjects([reopened keys], live, nil);
+    for (NSString *key in acknowledged)
+        STAssertFalse([reopened containsKey:key], @"%@ came back after it was acknowledged", key);
+}
+
+- (void) testRewrittenKeysMoveToTheEnd
+{
+    NSArray *keys = [self keysWithCount:10];
+    TCDStatementLog *log = [self openLog];
+    [log appendPayloads:[self payloadsForKeys:keys] forKeys:keys error:NULL];
+    NSArray *rewritten = @[[keys objectAtIndex:2], [keys objectAtIndex:5]];
+    [log appendPayloads:[self payloadsForKeys:rewritten] forKeys:rewritten error:NULL];
+
+    NSMutableArray *expected = [keys mutableCopy];
+    [expected removeObjectsInArray:rewritten];
+    [expected addObjectsFromArray:rewritten];
+    STAssertEqualObjects([log keys], expected, nil);
+    STAssertEqualObjects([[self openLog] keys], expected, nil);
+}
+
+- (void) testCompactionKeepsLiveRecordsInOrder
+{
+    NSArray *keys = [self keysWithCount:2000];
+    TCDStatementLog *log = [self openLog];
+    log.maxSegmentSize = 4096;
+    [log appendPayloads:[self payloadsForKeys:keys] forKeys:keys error:NULL];
+
+    NSMutableArray *live = [NSMutableArray array];
+    NSMutableArray *acknowledged = [NSMutableArray array];
+    [keys enumerateObjectsUsingBlock:^(NSString *key, NSUInteger index, BOOL *stop) {
+        [(index % 10 == 0 ? live : acknowledged) addObject:key];
+    }];
+    [log acknowledgeKeys:acknowledged error:NULL];
+    [log compactIfNeeded];
+    // count waits for the log's queue, so compaction has finished by the time it returns.
+    STAssertEquals(log.count, live.count, nil);
+
+    STAssertEqualObjects([log keys], live, nil);
+    TCDStatementLog *reopened = [self openLog];
+    STAssertEqualObjects([reopened keys], live, nil);
+    STAssertEqualObjects([reopened payloadForKey:[live lastObject]], [[self payloadsForKeys:@[[live lastObject]]] lastObject], nil);
+}
+
+- (void) testTornWriteIsDiscarded
+{
+    NSArray *keys = [self keysWithCount:10];
+    TCDStatementLog *log = [self openLog];
+    [log appendPayloads:[self payloadsForKeys:keys] forKeys:keys error:NULL];
+    log = nil;
+
+    NSArray *segments = [[[NSFileManager defaultManager] contentsOfDirectoryAtPath:directory error:NULL] sortedArrayUsingSelector:@selector(compare:)];
+    NSFileHandle *handle = [NSFileHandle fileHandleForWritingAtPath:[directory stringByAppendingPathComponent:[segments lastObject]]];
+    [handle seekToEndOfFile];
+    [handle writeData:[@"half a record" dataUsingEncoding:NSUTF8StringEncoding]];
+    [handle closeFile];
+
+    TCDStatementLog *reopened = [self openLog];
+    STAssertEqualObjects([reopened keys], keys, nil);
+    NSArray *more = @[@"key-after"];
+    STAssertTrue([reopened appendPayloads:[self payloadsForKeys:more] forKeys:more error:NULL], nil);
+    STAssertEqualObjects([[[self openLog] keys] lastObject], @"key-after", nil);
+}
+
+- (void) testWritesWaitForTheirCommitByDefault
+{
+    TCDStatementLog *log = [self openLog];
+    STAssertEquals(log.durability, TCDStatementLogDurabilityPerWindow, nil);
+    NSArray *keys = [self keysWithCount:1];
+    [log appendPayloads:[self payloadsForKeys:keys] forKeys:keys error:NULL];
+    STAssertEquals(log.commitStatistics.records, (NSUInteger)1, @"append returned before its window was committed");
+}
+
+@end
@@ -0,0 +1,107 @@
+//
+//  TCDStatementPageScannerTests.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/12/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <SenTestingKit/SenTestingKit.h>
+#import "TCDStatementPageScanner.h"
+#import "TCDTestFixtures.h"
+
+@interface TCDStatementPageScannerTests : SenTestCase
+@end
+
+@implementation TCDStatementPageScannerTests
+
+/**
+ A statement result holding the statements' dictionaries, as an LRS would send it.
+ */
+- (NSData *) pageWithStatements:(NSArray *)statements more:(NSString *)more
+{
+    NSMutableArray *dictionaries = [NSMutableArray arrayWithCapacity:statements.count];
+    for (TCStatement *statement in statements)
+        [dictionaries addObject:[statement dictionary]];
+    NSDictionary *page = more ? @{@"statements": dictionaries, @"more": more} : @{@"statements": dictionaries};
+    return [NSJSONSerialization dataWithJSONObject:page options:NSJSONWritingPrettyPrinted error:NULL];
+}
+
+/**
+ Scans the page in chunks of chunkLength bytes and returns each statement found, parsed.
+ */
+- (NSArray *) scanPage:(NSData *)page chunkLength:(NSUInteger)chunkLength scanner:(TCDStatementPageScanner *)scanner
+{
+    NSMutableArray *found = [NSMutableArray array];
+    scanner.statementHandler = ^(NSData *statementJSON) {
+        id statement = [NSJSONSerialization JSONObjectWithData:statementJSON options:0 error:NULL];
+        [found addObject:statement ?: [NSNull null]];
+    };
+    for (NSUInteger offset = 0; offset < page.length; offset += chunkLength)
+    {
+        NSError *error = nil;
+        NSData *chunk = [page subdataWithRange:NSMakeRange(offset, MIN(chunkLength, page.length - offset))];
+        STAssertTrue([scanner appendData:chunk error:&error], @"%@", error);
+    }
+    return found;
+}
+
+- (void) testStatementsRoundTripWhateverTheChunking
+{
+    NSArray *statements = [TCDTestFixtures statementsWithCount:25];
+    NSString *more = @"/TCAPI/statements?more=abc\"}],{";
+    NSData *page = [self pageWithStatements:statements more:more];
+    NSDictionary *expected = [NSJSONSerialization JSONObjectWithData:page options:0 error:NULL];
+
+    for (NSUInteger chunkLength = 1; chunkLength <= 33; chunkLength += 4)
+    {
+        TCDStatementPageScanner *scanner = [[TCDStatementPageScanner alloc] init];
+        NSArray *found = [self scanPage:page chunkLength:chunkLength scanner:scanner];
+        STAssertTrue([scanner finishWithError:NULL], nil);
+        STAssertEqualObjects(found, [expected objectForKey:@"statements"], @"chunks of %lu bytes", (unsigned long)chunkLength);
+        STAssertEqualObjects(scanner.more, more, nil);
+        STAssertEquals(scanner.statementCount, statements.count, nil);
+        STAssertEquals(scanner.byteCount, (unsigned long long)page.length, nil);
+    }
+}
+
+- (void) testStructuralCharactersInsideStringsAreSkipped
+{
+    TCStatement *statement = [TCDTestFixtures statementWithIndex:0];
+    statement.actor = [TCAgent agentWithName:@"Bill \"}], {[\\\" O'Brien" andMbox:@"mailto:bill@gmail.com"];
+    NSData *page = [self pageWithStatements:@[statement, [TCDTestFixtures statementWithIndex:1]] more:nil];
+    NSDictionary *expected = [NSJSONSerialization JSONObjectWithData:page options:0 error:NULL];
+
+    TCDStatementPageScanner *scanner = [[TCDStatementPageScanner alloc] init];
+    NSArray *found = [self scanPage:page chunkLength:7 scanner:scanner];
+    STAssertEqualObjects(found, [expected objectForKey:@"statements"], nil);
+    STAssertNil(scanner.more, nil);
+}
+
+- (void) testTruncatedPageDoesNotFinish
+{
+    NSData *page = [self pageWithStatements:[TCDTestFixtures statementsWithCount:3] more:nil];
+    TCDStatementPageScanner *scanner = [[TCDStatementPageScanner alloc] init];
+    NSArray *found = [self scanPage:[page subdataWithRange:NSMakeRange(0, page.length - 20)] chunkLength:16 scanner:scanner];
+    STAssertTrue(found.count < 3, nil);
+    NSError *error = nil;
+    STAssertFalse([scanner finishWithError:&error], nil);
+    STAssertNotNil(error, nil);
+}
+
+- (void) testStoppingFromTheHandlerStopsScanning
+{
+    NSData *page = [self pageWithStatements:[TCDTestFixtures statementsWithCount:10] more:nil];
+    TCDStatementPageScanner *scanner = [[TCDStatementPageScanner alloc] init];
+    __block NSUInteger handled = 0;
+    __weak TCDStatementPageScanner *weakScanner = scanner;
+    scanner.statementHandler = ^(NSData *statementJSON) {
+        if (++handled == 2)
+            [weakScanner stop];
+    };
+    [scanner appendData:page error:NULL];
+    STAssertEquals(handled, (NSUInteger)2, nil);
+    STAssertTrue(scanner.isStopped, nil);
+}
+
+@end
@@ -0,0 +1,176 @@
+//
+//  TCDStatementQueueTests.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/12/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <SenTestingKit/SenTestingKit.h>
+#import "TCDStatementQueue.h"
+#import "TCDStatementQueueLogPersistence.h"
+#import "TCDTestFixtures.h"
+
+@interface TCDStatementQueueTests : SenTestCase
+{
+    NSString *directory;
+}
+@end
+
+@implementation TCDStatementQueueTests
+
+- (void) setUp
+{
+    [super setUp];
+    directory = [TCDTestFixtures temporaryDirectory];
+}
+
+- (void) tearDown
+{
+    [[NSFileManager defaultManager] removeItemAtPath:directory error:NULL];
+    [super tearDown];
+}
+
+/**
+ A queue persisted to the log in directory, restored from whatever the log already holds.
+ */
+- (TCDStatementQueue *) persistedQueue
+{
+    TCDStatementQueue *queue = [[TCDStatementQueue alloc] initWithIngestionCapacity:0];
+    TCDStatementQueueLogPersistence *store = [[TCDStatementQueueLogPersistence alloc] initWithQueue:queue directory:directory];
+    store.shouldProtectPersistentStore = NO;
+    STAssertTrue(store.isOpen, nil);
+    queue.persistenceCoordinator = store;
+    return queue;
+}
+
+- (void) testRemovingByIdKeepsTheRestInOrder
+{
+    TCDStatementQueue *queue = [[TCDStatementQueue alloc] initWithIngestionCapacity:0];
+    NSArray *statements = [TCDTestFixtures statementsWithCount:100];
+    [queue addStatements:statements];
+
+    NSMutableArray *removed = [NSMutableArray array];
+    NSMutableArray *kept = [NSMutableArray array];
+    [statements enumerateObjectsUsingBlock:^(TCStatement *statement, NSUInteger index, BOOL *stop) {
+        [(index % 2 ? removed : kept) addObject:statement];
+    }];
+    [queue removeStatementsInArray:removed];
+    [queue removeStatementWithId:[[kept objectAtIndex:0] sid]];
+    [kept removeObjectAtIndex:0];
+
+    STAssertEquals([queue getQueuedStatements].count, kept.count, nil);
+    STAssertEqualObjects([TCDTestFixtures idsOfStatements:[queue getQueuedStatements]], [TCDTestFixtures idsOfStatements:kept], nil);
+    STAssertNil([queue queuedStatementWithId:[[removed objectAtIndex:0] sid]], nil);
+}
+
+- (void) testAddingAQueuedStatementAgainIsIgnored
+{
+    TCDStatementQueue *queue = [[TCDStatementQueue alloc] initWithIngestionCapacity:0];
+    NSArray *statements = [TCDTestFixtures statementsWithCount:3];
+    [queue addStatements:statements];
+    [queue addStatement:[statements objectAtIndex:1]];
+    STAssertEquals([queue getQueuedStatements].count, (NSUInteger)3, nil);
+}
+
+/**
+ Acknowledging a batch should cost the same whatever the size of the backlog behind it.
+ */
+- (void) testAcknowledgingABatchDoesNotDependOnTheBacklog
+{
+    NSTimeInterval perBatch[2];
+    NSUInteger backlogs[2] = { 1000, 20000 };
+    for (int run = 0; run < 2; run++)
+    {
+        TCDStatementQueue *queue = [[TCDStatementQueue alloc] initWithIngestionCapacity:0];
+        NSArray *statements = [TCDTestFixtures statementsWithCount:backlogs[run]];
+        [queue addStatements:statements];
+
+        NSUInteger batches = 0;
+        CFAbsoluteTime start = CFAbsoluteTimeGetCurrent();
+        for (NSUInteger index = 0; index + 50 <= 1000; index += 50, batches++)
+            [queue removeStatementsInArray:[statements subarrayWithRange:NSMakeRange(index, 50)]];
+        perBatch[run] = (CFAbsoluteTimeGetCurrent() - start) / batches;
+        NSLog(@"Acknowledging 50 of %lu statements: %.1f us", (unsigned long)backlogs[run], perBatch[run] * 1e6);
+    }
+    // 20x the backlog; generous so the check isn't at the mercy of the machine running it.
+    STAssertTrue(perBatch[1] < perBatch[0] * 4 + 0.0005, @"acknowledging grew with the backlog (%f s vs %f s)", perBatch[1], perBatch[0]);
+}
+
+/**
+ Several threads adding at once through the ingestion ring: every statement is queued exactly once.
+ */
+- (void) testConcurrentProducersNeitherLoseNorDuplicateStatements
+{
+    TCDStatementQueue *queue = [[TCDStatementQueue alloc] initWithIngestionCapacity:64];
+    const NSUInteger producers = 4, perProducer = 5000;
+    NSMutableArray *batches = [NSMutableArray array];
+    for (NSUInteger p = 0; p < producers; p++)
+        [batches addObject:[TCDTestFixtures statementsWithCount:perProducer]];
+
+    dispatch_apply(producers, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t p) {
+        for (TCStatement *statement in [batches objectAtIndex:p])
+        {
+            [queue addStatement:statement];
+            // Re-adding is a no-op, whichever thread wins.
+            if ([statement.sid hasPrefix:@"0"])
+                [queue addStatement:statement];
+        }
+    });
+    [queue waitUntilStatementsAreQueued];
+
+    NSArray *queued = [queue getQueuedStatements];
+    STAssertEquals(queued.count, producers * perProducer, nil);
+    STAssertEquals([NSSet setWithArray:[TCDTestFixtures idsOfStatements:queued]].count, producers * perProducer, nil);
+    for (NSArray *batch in batches)
+    {
+        // Each producer's statements stay in the order it added them.
+        NSSet *ids = [NSSet setWithArray:[TCDTestFixtures idsOfStatements:batch]];
+        NSArray *order = [[TCDTestFixtures idsOfStatements:queued] filteredArrayUsingPredicate:[NSPredicate predicateWithFormat:@"SELF IN %@", ids]];
+        STAssertEqualObjects(order, [TCDTestFixtures idsOfStatements:batch], nil);
+    }
+    [queue stopIngestion];
+}
+
+- (void) testQueueRoundTripsThroughTheLog
+{
+    TCDStatementQueue *queue = [self persistedQueue];
+    NSArray *statements = [TCDTestFixtures statementsWithCount:20];
+    [queue addStatements:statements];
+    [queue removeStatementsInArray:[statements subarrayWithRange:NSMakeRange(5, 5)]];
+    [queue waitUntilStatementsArePersisted];
+
+    NSArray *expected = [TCDTestFixtures idsOfStatements:[queue getQueuedStatements]];
+    TCDStatementQueue *restored = [self persistedQueue];
+    STAssertEqualObjects([TCDTestFixtures idsOfStatements:[restored getQueuedStatements]], expected, nil);
+    STAssertEqualObjects([[[restored getQueuedStatements] objectAtIndex:0] dictionary], [[statements objectAtIndex:0] dictionary], nil);
+}
+
+- (void) testRemovalIsPersistedAfterTheAdditionItUndoes
+{
+    TCDStatementQueue *queue = [self persistedQueue];
+    NSArray *statements = [TCDTestFixtures statementsWithCount:200];
+    for (TCStatement *statement in statements)
+    {
+        [queue addStatement:statement];
+        [queue removeStatement:statement];
+    }
+    [queue waitUntilStatementsArePersisted];
+
+    STAssertEquals([[self persistedQueue] getQueuedStatements].count, (NSUInteger)0, @"a removed statement came back");
+}
+
+- (void) testRestoringDoesNotRewriteTheLog
+{
+    TCDStatementQueue *queue = [self persistedQueue];
+    [queue addStatements:[TCDTestFixtures statementsWithCount:50]];
+    [queue waitUntilStatementsArePersisted];
+
+    TCDStatementQueue *restored = [self persistedQueue];
+    TCDStatementQueueLogPersistence *store = (TCDStatementQueueLogPersistence *)restored.persistenceCoordinator;
+    [restored waitUntilStatementsArePersisted];
+    STAssertEquals([restored getQueuedStatements].count, (NSUInteger)50, nil);
+    STAssertEquals(store.commitStatistics.records, (NSUInteger)0, @"restoring wrote the statements back to the log");
+}
+
+@end
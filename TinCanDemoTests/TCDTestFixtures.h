@@ -0,0 +1,36 @@
+//
+//  TCDTestFixtures.h
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/12/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import <Foundation/Foundation.h>
+
+/**
+ Statements and scratch directories for the unit tests.
+ */
+@interface TCDTestFixtures : NSObject
+
+/**
+ A statement with its own id, by the same actor as every other fixture, about activity number index.
+ */
++ (TCStatement *) statementWithIndex:(NSUInteger)index;
+
+/**
+ count statements made with statementWithIndex:, starting at 0.
+ */
++ (NSArray *) statementsWithCount:(NSUInteger)count;
+
+/**
+ A new, empty directory in the temporary directory.
+ */
++ (NSString *) temporaryDirectory;
+
+/**
+ The ids of the statements, in order.
+ */
++ (NSArray *) idsOfStatements:(NSArray *)statements;
+
+@end
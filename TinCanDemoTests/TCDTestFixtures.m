@@ -0,0 +1,47 @@
+//
+//  TCDTestFixtures.m
+//  TinCanDemo
+//
+//  Created by Dan Frazee on 3/12/13.
+//  Copyright (c) 2013 Maestro. All rights reserved.
+//
+
+#import "TCDTestFixtures.h"
+
+@implementation TCDTestFixtures
+
++ (TCStatement *) statementWithIndex:(NSUInteger)index
+{
+    NSString *activityId = [NSString stringWithFormat:@"http://meetmaestro.com/activities/%lu", (unsigned long)index];
+    TCStatement *statement = [TCStatement statementWithActor:[TCAgent agentWithName:@"William" andMbox:@"mailto:william@gmail.com"]
+                                               statementVerb:TCStatementVerbAttempted
+                                                   andObject:[TCActivity activityWithId:activityId]];
+    statement.sid = [TCStatement generateUUID];
+    statement.timestamp = [NSDate dateWithTimeIntervalSince1970:1362000000 + index];
+    return statement;
+}
+
++ (NSArray *) statementsWithCount:(NSUInteger)count
+{
+    NSMutableArray *statements = [NSMutableArray arrayWithCapacity:count];
+    for (NSUInteger i = 0; i < count; i++)
+        [statements addObject:[self statementWithIndex:i]];
+    return statements;
+}
+
++ (NSString *) temporaryDirectory
+{
+    NSString *directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[TCStatement generateUUID]];
+    [[NSFileManager defaultManager] createDirectoryAtPath:directory withIntermediateDirectories:YES attributes:nil error:NULL];
+    return directory;
+}
+
++ (NSArray *) idsOfStatements:(NSArray *)statements
+{
+    NSMutableArray *ids = [NSMutableArray arrayWithCapacity:statements.count];
+    for (TCStatement *statement in statements)
+        [ids addObject:statement.sid];
+    return ids;
+}
+
+@end